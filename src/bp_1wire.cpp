@@ -0,0 +1,521 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_1wire.cpp
+ *
+ *   Description:
+ *       Implements the 1-Wire interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_1wire.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+#include <cstring>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Bus Control Commands. A reset is answered with 0x01, a read with the byte read.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_1W_RESET = 0x02;
+    static constexpr uint8_t CMD_1W_READ  = 0x04;
+
+    /*------------------------------------------------
+    Search Macros. Answered with 0x01, then the 8 byte ID of each device as the
+    search finds it, then 8 bytes of 0xFF.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_1W_SEARCH_ROM   = 0x08;
+    static constexpr uint8_t CMD_1W_SEARCH_ALARM = 0x09;
+
+    /*------------------------------------------------
+    ROM Commands, sent on the bus after a reset to pick the devices that respond
+    ------------------------------------------------*/
+    static constexpr uint8_t ROM_MATCH = 0x55;
+    static constexpr uint8_t ROM_SKIP  = 0xCC;
+
+    /*------------------------------------------------
+    Board Configuration Options
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_PERIPH     = 0x40;
+    static constexpr uint8_t MSK_CFG_PERIPH     = 0x0F;
+    static constexpr uint8_t CFG_PERIPH_POWER   = ( 1u << 3 );
+    static constexpr uint8_t CFG_PERIPH_PULLUP  = ( 1u << 2 );
+    static constexpr uint8_t CFG_PERIPH_AUX_PIN = ( 1u << 1 );
+    static constexpr uint8_t CFG_PERIPH_CS_PIN  = ( 1u << 0 );
+
+    /*------------------------------------------------
+    1-Wire Write Commands. A bulk write is answered with 0x01 for the command and
+    another for each byte written.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_BULK_1W_WRITE       = 0x10;
+    static constexpr uint8_t MSK_BULK_1W_WRITE_BYTES = 0x0F;
+    static constexpr size_t BULK_WRITE_MAX_LEN       = 16;
+
+    /*------------------------------------------------
+    Flow control. A byte is eight standard speed time slots, and a reset with its
+    presence window takes about twice that.
+    ------------------------------------------------*/
+    static constexpr uint64_t ONE_WIRE_SLOT_nS = 70000;
+
+    /*------------------------------------------------
+    A search takes three time slots per ID bit, so a few tens of milliseconds per
+    device at most. This is how long to wait on each one.
+    ------------------------------------------------*/
+    static constexpr uint32_t SEARCH_TIMEOUT_MS = 500;
+
+    /*------------------------------------------------
+    How long to let the bus settle after the supplies switch on
+    ------------------------------------------------*/
+    static constexpr uint32_t DEFAULT_POWER_UP_DELAY_MS = 100;
+
+
+    Binary1Wire::Binary1Wire( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+
+      /*------------------------------------------------
+      Initialize the virtual registers
+      ------------------------------------------------*/
+      reg_PeriphCfg = { CMD_CFG_PERIPH, MSK_CFG_PERIPH, 0, 0, false };
+      stagingConfig = false;
+
+      powerUpDelay_mS = DEFAULT_POWER_UP_DELAY_MS;
+    }
+
+    Chimera::Status_t Binary1Wire::init( const OneWireSetup &setupStruct ) noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      CommandBatch batch;
+      size_t entry = 0;
+
+      /*------------------------------------------------
+      Skip the mode switch if the board is already in 1-Wire mode, otherwise queue
+      it up to go out together with the configuration
+      ------------------------------------------------*/
+      bool in1WireMode =
+          ( busPirate.state->currentMode == OperationalModes::BP_MODE_1WIRE_BIT_BANG ) && busPirate.resyncFraming();
+
+      if ( !in1WireMode
+           && ( ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) || busPirate.bbInit() ) )
+      {
+        entry = batch.add( { BitBangCommands::enter1Wire }, BitBangCommands::oneWireSuccess.size(), false );
+
+        /*------------------------------------------------
+        Entering 1-Wire mode resets the firmware's configuration
+        ------------------------------------------------*/
+        invalidateShadowRegisters( { &reg_PeriphCfg } );
+      }
+
+      if ( in1WireMode || batch.size() )
+      {
+        const bool powered  = reg_PeriphCfg.valid && ( reg_PeriphCfg.applied & CFG_PERIPH_POWER );
+        bool entryConfirmed = in1WireMode;
+
+        /*------------------------------------------------
+        The mode switch answers once whichever batch carries it has gone out
+        ------------------------------------------------*/
+        auto confirmEntry = [ this, &batch, &entry, &entryConfirmed ]() -> Chimera::Status_t {
+          if ( entryConfirmed )
+          {
+            return Status::OK;
+          }
+
+          const std::string &expected = BitBangCommands::oneWireSuccess;
+          auto reply                  = batch.reply( entry );
+
+          entryConfirmed = true;
+          if ( ( reply.length == expected.size() ) && std::equal( expected.begin(), expected.end(), reply.data ) )
+          {
+            busPirate.state->currentMode = OperationalModes::BP_MODE_1WIRE_BIT_BANG;
+            return Status::OK;
+          }
+
+          return Status::FAIL;
+        };
+
+        stageConfig();
+
+        /*------------------------------------------------
+        Switching the supplies on goes out by itself and gets its delay before the
+        pull-ups, usually fed from those same supplies, are put on the bus
+        ------------------------------------------------*/
+        result = cfgPowerSupplies( true );
+
+        if ( !powered && powerUpDelay_mS )
+        {
+          result |= commitConfig( batch );
+          result |= confirmEntry();
+          batch.clear();
+
+          if ( reg_PeriphCfg.applied & CFG_PERIPH_POWER )
+          {
+            Chimera::delayMilliseconds( powerUpDelay_mS );
+          }
+
+          stageConfig();
+        }
+
+        result |= cfgPullups( setupStruct.pullups );
+        result |= commitConfig( batch );
+        result |= confirmEntry();
+      }
+
+      if ( result == Status::OK )
+      {
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed 1-Wire initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t Binary1Wire::deInit() noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      busPirate.close();
+      result            = Status::OK;
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t Binary1Wire::reset() noexcept
+    {
+      CommandBatch batch;
+      batch.add( { CMD_1W_RESET }, 1 );
+
+      return run( batch, {} );
+    }
+
+    Chimera::Status_t Binary1Wire::write( const uint8_t *const txBuffer, const size_t length ) noexcept
+    {
+      if ( !txBuffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      CommandBatch batch;
+      std::vector<size_t> writes;
+
+      queueWrite( batch, std::vector<uint8_t>( txBuffer, txBuffer + length ), writes );
+
+      return run( batch, writes );
+    }
+
+    Chimera::Status_t Binary1Wire::read( uint8_t *const rxBuffer, const size_t length ) noexcept
+    {
+      if ( !rxBuffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      CommandBatch batch;
+
+      for ( size_t x = 0; x < length; x++ )
+      {
+        batch.add( { CMD_1W_READ }, 1, false );
+      }
+
+      Chimera::Status_t result = run( batch, {} );
+
+      for ( size_t x = 0; ( x < length ) && ( result == Status::OK ); x++ )
+      {
+        rxBuffer[ x ] = batch.reply( x ).data[ 0 ];
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t Binary1Wire::searchROM( std::vector<RomCode> &roms ) noexcept
+    {
+      return search( CMD_1W_SEARCH_ROM, roms );
+    }
+
+    Chimera::Status_t Binary1Wire::searchAlarm( std::vector<RomCode> &roms ) noexcept
+    {
+      return search( CMD_1W_SEARCH_ALARM, roms );
+    }
+
+    Chimera::Status_t Binary1Wire::transfer( const RomCode &rom, const uint8_t *const txBuffer, const size_t txLength,
+                                             uint8_t *const rxBuffer, const size_t rxLength ) noexcept
+    {
+      if ( !txBuffer || !txLength || ( rxLength && !rxBuffer ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      std::vector<OneWireTransfer> transfers( 1 );
+      transfers[ 0 ].rom      = rom;
+      transfers[ 0 ].rxLength = rxLength;
+      transfers[ 0 ].tx.assign( txBuffer, txBuffer + txLength );
+
+      Chimera::Status_t result = transfer( transfers );
+
+      if ( ( result == Status::OK ) && rxLength )
+      {
+        memcpy( rxBuffer, transfers[ 0 ].rx.data(), rxLength );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t Binary1Wire::transfer( std::vector<OneWireTransfer> &transfers ) noexcept
+    {
+      if ( transfers.empty() ||
+           std::any_of( transfers.begin(), transfers.end(), []( const OneWireTransfer &t ) { return t.tx.empty(); } ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      CommandBatch batch;
+      std::vector<size_t> writes;
+      std::vector<size_t> firstRead( transfers.size() );
+      std::vector<uint8_t> data;
+
+      /*------------------------------------------------
+      Each transfer is a reset, the ROM selection and function command in as few bulk
+      writes as they fit in, then a read per reply byte. All of it is answered byte
+      for byte, so the whole list streams out in one go.
+      ------------------------------------------------*/
+      for ( size_t x = 0; x < transfers.size(); x++ )
+      {
+        const auto &t = transfers[ x ];
+
+        if ( t.skipRom )
+        {
+          data.assign( 1, ROM_SKIP );
+        }
+        else
+        {
+          data.assign( 1, ROM_MATCH );
+          data.insert( data.end(), t.rom.begin(), t.rom.end() );
+        }
+
+        data.insert( data.end(), t.tx.begin(), t.tx.end() );
+
+        batch.add( { CMD_1W_RESET }, 1 );
+        queueWrite( batch, data, writes );
+
+        firstRead[ x ] = batch.size();
+        for ( size_t y = 0; y < t.rxLength; y++ )
+        {
+          batch.add( { CMD_1W_READ }, 1, false );
+        }
+      }
+
+      Chimera::Status_t result = run( batch, writes );
+
+      if ( result == Status::OK )
+      {
+        for ( size_t x = 0; x < transfers.size(); x++ )
+        {
+          auto &t = transfers[ x ];
+          t.rx.resize( t.rxLength );
+
+          for ( size_t y = 0; y < t.rxLength; y++ )
+          {
+            t.rx[ y ] = batch.reply( firstRead[ x ] + y ).data[ 0 ];
+          }
+        }
+      }
+
+      return result;
+    }
+
+    uint8_t Binary1Wire::crc8( const uint8_t *const data, const size_t length ) noexcept
+    {
+      /*------------------------------------------------
+      x^8 + x^5 + x^4 + 1, shifted in LSB first
+      ------------------------------------------------*/
+      uint8_t crc = 0;
+
+      for ( size_t x = 0; x < length; x++ )
+      {
+        uint8_t byte = data[ x ];
+
+        for ( size_t bit = 0; bit < 8; bit++ )
+        {
+          const bool mix = ( crc ^ byte ) & 0x01;
+          crc >>= 1;
+          byte >>= 1;
+
+          if ( mix )
+          {
+            crc ^= 0x8C;
+          }
+        }
+      }
+
+      return crc;
+    }
+
+    Chimera::Status_t Binary1Wire::cfgPowerSupplies( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_POWER, state );
+    }
+
+    Chimera::Status_t Binary1Wire::cfgPullups( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_PULLUP, state );
+    }
+
+    Chimera::Status_t Binary1Wire::cfgAuxPin( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_AUX_PIN, state );
+    }
+
+    Chimera::Status_t Binary1Wire::cfgChipSelect( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_CS_PIN, state );
+    }
+
+    void Binary1Wire::stageConfig()
+    {
+      stagingConfig = true;
+    }
+
+    Chimera::Status_t Binary1Wire::commitConfig()
+    {
+      CommandBatch batch;
+      return commitConfig( batch );
+    }
+
+    void Binary1Wire::setPowerUpDelay( const uint32_t delay_mS )
+    {
+      powerUpDelay_mS = delay_mS;
+    }
+
+    Chimera::Status_t Binary1Wire::commitConfig( CommandBatch &batch )
+    {
+      stagingConfig = false;
+      return commitShadowRegisters( busPirate, batch, { &reg_PeriphCfg } );
+    }
+
+    Chimera::Status_t Binary1Wire::cfgField( ShadowRegister &reg, const uint8_t field, const bool state )
+    {
+      return writeShadowRegister( busPirate, reg, reg.withField( field, state ), stagingConfig );
+    }
+
+    Chimera::Status_t Binary1Wire::search( const uint8_t cmd, std::vector<RomCode> &roms )
+    {
+      Chimera::Status_t result = Status::OK;
+      const auto serial        = busPirate.serial;
+
+      roms.clear();
+
+      if ( !serial )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      /*------------------------------------------------
+      The reply length depends on how many devices there are, so read it an ID at a
+      time until the terminator turns up. The bus does the waiting, not the link.
+      ------------------------------------------------*/
+      uint8_t ack = 0;
+      RomCode rom;
+
+      busPirate.resyncSerial();
+      serial->write( &cmd, 1 );
+
+      if ( ( serial->read( &ack, 1, SEARCH_TIMEOUT_MS ) != Status::OK ) || ( ack != BitBangCommands::success ) )
+      {
+        result = Status::FAIL;
+      }
+
+      while ( result == Status::OK )
+      {
+        if ( serial->read( rom.data(), rom.size(), SEARCH_TIMEOUT_MS ) != Status::OK )
+        {
+          result = Status::TIMEOUT;
+        }
+        else if ( std::all_of( rom.begin(), rom.end(), []( uint8_t b ) { return b == 0xFF; } ) )
+        {
+          break;
+        }
+        else if ( crc8( rom.data(), rom.size() ) == 0 )
+        {
+          roms.push_back( rom );
+        }
+        else
+        {
+          spdlog::error( "1-Wire search found an ID with a bad CRC" );
+          result = Status::FAIL;
+        }
+      }
+
+      /*------------------------------------------------
+      A corrupted ID means the rest of the reply is still coming, and a timeout that
+      it may yet arrive. Either way the link needs bringing back into step.
+      ------------------------------------------------*/
+      if ( ( result != Status::OK ) && !busPirate.resyncFraming() )
+      {
+        spdlog::error( "Lost framing after a failed 1-Wire search" );
+      }
+
+      return result;
+    }
+
+    void Binary1Wire::queueWrite( CommandBatch &batch, const std::vector<uint8_t> &data, std::vector<size_t> &writes )
+    {
+      std::vector<uint8_t> chunk;
+
+      for ( size_t offset = 0; offset < data.size(); offset += BULK_WRITE_MAX_LEN )
+      {
+        const size_t len = std::min( BULK_WRITE_MAX_LEN, data.size() - offset );
+
+        chunk.assign( 1, static_cast<uint8_t>( CMD_BULK_1W_WRITE | ( ( len - 1 ) & MSK_BULK_1W_WRITE_BYTES ) ) );
+        chunk.insert( chunk.end(), data.begin() + offset, data.begin() + offset + len );
+        writes.push_back( batch.add( chunk, len + 1 ) );
+      }
+    }
+
+    Chimera::Status_t Binary1Wire::run( CommandBatch &batch, const std::vector<size_t> &writes )
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      Chimera::Status_t result = busPirate.stream( batch, streamWindow() );
+
+      for ( size_t x = 0; ( x < writes.size() ) && ( result == Status::OK ); x++ )
+      {
+        auto reply = batch.reply( writes[ x ] );
+
+        if ( std::any_of( reply.data, reply.data + reply.length, []( uint8_t ack ) { return ack != BitBangCommands::success; } ) )
+        {
+          result = Status::FAIL;
+        }
+      }
+
+      return result;
+    }
+
+    size_t Binary1Wire::streamWindow() const
+    {
+      /*------------------------------------------------
+      The bus is always far slower than the link, so this always throttles, to about
+      as many bytes as the FIFO holds
+      ------------------------------------------------*/
+      return busPirate.streamWindow( 8 * ONE_WIRE_SLOT_nS );
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
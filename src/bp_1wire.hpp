@@ -0,0 +1,284 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_1wire.hpp
+ *
+ *   Description:
+ *       Provides an interface to the 1-Wire hardware on the Bus Pirate. Follows the
+ *       conventions of the Chimera HAL drivers.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_1WIRE_DRIVER_HPP
+#define BUS_PIRATE_CPP_1WIRE_DRIVER_HPP
+
+/* C++ Includes */
+#include <array>
+#include <memory>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  64-bit device ID: family code, 48-bit serial number and CRC, in bus order
+     */
+    using RomCode = std::array<uint8_t, 8>;
+
+    /**
+     *  Settings applied by Binary1Wire::init()
+     */
+    struct OneWireSetup
+    {
+      bool pullups; /**< Enables the on-board pullup on the data line, which needs a supply on the Vpu pin */
+
+      OneWireSetup()
+      {
+        pullups = true;
+      }
+    };
+
+    /**
+     *  One addressed exchange with a device: reset, ROM selection, the function command
+     *  and its data, then the reply
+     */
+    struct OneWireTransfer
+    {
+      RomCode rom;             /**< Device to select, ignored if skipRom is set */
+      bool skipRom;            /**< Address every device on the bus at once */
+      std::vector<uint8_t> tx; /**< Function command followed by any data to write */
+      size_t rxLength;         /**< Number of bytes to read after writing */
+      std::vector<uint8_t> rx; /**< Holds the bytes read once the transfer completes */
+
+      OneWireTransfer()
+      {
+        rom.fill( 0 );
+        skipRom  = false;
+        rxLength = 0;
+      }
+    };
+
+    class Binary1Wire;
+    using Binary1Wire_sPtr = std::shared_ptr<Binary1Wire>;
+    using Binary1Wire_uPtr = std::unique_ptr<Binary1Wire>;
+
+    /**
+     *  1-Wire master on the binary 1-Wire mode. Bus enumeration uses the firmware's
+     *  search macros, which walk the whole ROM tree on the board and return every ID
+     *  from a single command. Device traffic can be batched, so talking to every
+     *  sensor on a bus takes one pipelined stream rather than a round trip per byte.
+     *
+     *  The binary mode has no bit level commands, so searches can't be steered from
+     *  the host, eg to a single family code. Filter the results of searchROM() instead.
+     */
+    class Binary1Wire
+    {
+    public:
+      /**
+       *  Primary constructor for creating the 1-Wire interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      Binary1Wire( Device &device );
+
+      Binary1Wire()  = default;
+      ~Binary1Wire() = default;
+
+      Chimera::Status_t init( const OneWireSetup &setupStruct ) noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Sends a reset pulse. The firmware doesn't report whether any device answered
+       *  with a presence pulse.
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t reset() noexcept;
+
+      /**
+       *	Writes a block of data to the bus
+       *
+       *	@param[in]	txBuffer      Data to write
+       *	@param[in]	length        Number of bytes to write
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t write( const uint8_t *const txBuffer, const size_t length ) noexcept;
+
+      /**
+       *	Reads a block of data from the bus
+       *
+       *	@param[out]	rxBuffer      Receives the data
+       *	@param[in]	length        Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t read( uint8_t *const rxBuffer, const size_t length ) noexcept;
+
+      /**
+       *	Finds every device on the bus. IDs that fail their CRC are left out.
+       *
+       *	@param[out]	roms          Receives the IDs found, in the order the search found them
+       *	@return Chimera::Status_t: FAIL if an ID was corrupted, TIMEOUT if the search didn't finish
+       */
+      Chimera::Status_t searchROM( std::vector<RomCode> &roms ) noexcept;
+
+      /**
+       *	Finds every device on the bus with its alarm flag set
+       *
+       *	@param[out]	roms          Receives the IDs found, in the order the search found them
+       *	@return Chimera::Status_t: FAIL if an ID was corrupted, TIMEOUT if the search didn't finish
+       */
+      Chimera::Status_t searchAlarm( std::vector<RomCode> &roms ) noexcept;
+
+      /**
+       *	Selects a single device, writes to it and reads back its reply
+       *
+       *	@param[in]	rom           Device to select
+       *	@param[in]	txBuffer      Function command and its data
+       *	@param[in]	txLength      Number of bytes to write
+       *	@param[out]	rxBuffer      Receives the reply, may be null if rxLength is 0
+       *	@param[in]	rxLength      Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t transfer( const RomCode &rom, const uint8_t *const txBuffer, const size_t txLength,
+                                  uint8_t *const rxBuffer, const size_t rxLength ) noexcept;
+
+      /**
+       *	Runs a list of transfers as one stream, ie reading the scratchpad of every
+       *  sensor found by searchROM(). The cost is a single round trip for the whole list.
+       *
+       *	@param[in]	transfers     Transfers to run, in order. Their rx fields hold the replies on return.
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t transfer( std::vector<OneWireTransfer> &transfers ) noexcept;
+
+      /**
+       *	Calculates the Dallas/Maxim CRC8 used by ROM codes and most device memories.
+       *  Running it over data that ends with its own CRC gives 0.
+       *
+       *	@param[in]	data          Data to check
+       *	@param[in]	length        Number of bytes
+       *	@return uint8_t
+       */
+      static uint8_t crc8( const uint8_t *const data, const size_t length ) noexcept;
+
+      /**
+       *	Enables or disables the on-board power supplies
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPowerSupplies( const bool state );
+
+      /**
+       *	Enables or disables the pullup on the data line
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPullups( const bool state );
+
+      /**
+       *	Enables or disables the Auxiliary pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgAuxPin( const bool state );
+
+      /**
+       *	Enables or disables the chip select pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgChipSelect( const bool state );
+
+      /**
+       *	Starts staging configuration changes. Until commitConfig() is called, the cfg
+       *  functions only update the shadow registers.
+       *
+       *	@return void
+       */
+      void stageConfig();
+
+      /**
+       *	Writes every register that was changed while staging and stops staging
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t commitConfig();
+
+      /**
+       *	Sets how long init() waits for the bus to settle after switching the
+       *  power supplies on. There is no wait if the supplies were already on.
+       *
+       *	@param[in]	delay_mS      Settling time in milliseconds, 0 to skip it
+       *	@return void
+       */
+      void setPowerUpDelay( const uint32_t delay_mS );
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized;
+      bool stagingConfig;
+      uint32_t powerUpDelay_mS;
+
+      ShadowRegister reg_PeriphCfg;
+
+      Chimera::Status_t cfgField( ShadowRegister &reg, const uint8_t field, const bool state );
+
+      Chimera::Status_t commitConfig( CommandBatch &batch );
+
+      /**
+       *	Runs one of the firmware's search macros and collects the IDs it reports
+       *
+       *	@param[in]	cmd           The search macro
+       *	@param[out]	roms          Receives the IDs found
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t search( const uint8_t cmd, std::vector<RomCode> &roms );
+
+      /**
+       *	Queues bulk writes for a block of data
+       *
+       *	@param[in]	batch         Batch to add to
+       *	@param[in]	data          Data to write
+       *	@param[out]	writes        Receives the index of every command queued
+       *	@return void
+       */
+      void queueWrite( CommandBatch &batch, const std::vector<uint8_t> &data, std::vector<size_t> &writes );
+
+      /**
+       *	Streams a batch of bus commands and checks that every write was acknowledged
+       *
+       *	@param[in]	batch         Commands to send
+       *	@param[in]	writes        Indices of the bulk writes in the batch
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t run( CommandBatch &batch, const std::vector<size_t> &writes );
+
+      /**
+       *	Works out how far a stream of bus commands can run ahead of the replies without
+       *  overrunning the Bus Pirate's UART FIFO
+       *
+       *	@return size_t: Window in bytes, 0 if the stream doesn't need throttling
+       */
+      size_t streamWindow() const;
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_1WIRE_DRIVER_HPP */
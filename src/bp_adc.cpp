@@ -0,0 +1,383 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_adc.cpp
+ *
+ *   Description:
+ *       Implements the voltage probe ADC interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_adc.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Every reading is two bytes, MSB first
+    ------------------------------------------------*/
+    static constexpr size_t READING_SIZE = 2;
+    static constexpr uint16_t ADC_MAX    = 0x3FF;
+
+    /*------------------------------------------------
+    Any byte stops the stream. The firmware swallows it without an answer.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_STREAM_STOP = 0xFF;
+
+    /*------------------------------------------------
+    Stopping the stream: how long the line has to be quiet before the last reading
+    is taken to have arrived, and how long to wait overall
+    ------------------------------------------------*/
+    static constexpr uint32_t STREAM_QUIET_MS        = 20;
+    static constexpr uint32_t STREAM_STOP_TIMEOUT_MS = 500;
+
+    /*------------------------------------------------
+    Enough for several seconds of readings at 115200 baud
+    ------------------------------------------------*/
+    static constexpr size_t DEFAULT_RING_SIZE = 32 * 1024;
+
+
+    BinaryADC::BinaryADC( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+      streaming         = false;
+      ringSize          = DEFAULT_RING_SIZE;
+      partialValid      = false;
+      partialByte       = 0;
+    }
+
+    Chimera::Status_t BinaryADC::init() noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      if ( streaming )
+      {
+        stopStream();
+      }
+
+      bool inRootMode =
+          ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) && busPirate.resyncFraming();
+
+      if ( inRootMode || busPirate.bbInit() )
+      {
+        result            = Status::OK;
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed ADC initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryADC::deInit() noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      if ( streaming )
+      {
+        stopStream();
+      }
+
+      busPirate.close();
+      result            = Status::OK;
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryADC::measure( float &volts ) noexcept
+    {
+      uint16_t counts          = 0;
+      Chimera::Status_t result = measureRaw( counts );
+
+      if ( result == Status::OK )
+      {
+        toVolts( &counts, &volts, 1 );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryADC::measureRaw( uint16_t &counts ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( streaming )
+      {
+        return Status::NOT_READY;
+      }
+
+      Chimera::Status_t result = Status::FAIL;
+      std::vector<uint8_t> cmd = { BitBangCommands::adcMeasure };
+
+      auto response = busPirate.sendResponsiveCommand( cmd, READING_SIZE );
+
+      if ( response.size() == READING_SIZE )
+      {
+        counts = static_cast<uint16_t>( ( response[ 0 ] << 8 ) | response[ 1 ] ) & ADC_MAX;
+        result = Status::OK;
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryADC::startStream() noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( streaming )
+      {
+        return Status::OK;
+      }
+
+      const auto serial = busPirate.serial;
+
+      /*------------------------------------------------
+      An overflow has to drop whole readings, or everything after it would be
+      decoded with its bytes swapped
+      ------------------------------------------------*/
+      serial->setRxBufferSize( ringSize * READING_SIZE );
+      serial->setRxRecordSize( READING_SIZE );
+      Chimera::Status_t result = serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::INTERRUPT );
+
+      /*------------------------------------------------
+      There's no ack, the readings just start coming
+      ------------------------------------------------*/
+      if ( result == Status::OK )
+      {
+        const uint8_t cmd = BitBangCommands::adcStream;
+
+        busPirate.resyncSerial();
+        result = serial->write( &cmd, 1 );
+
+        streaming    = true;
+        partialValid = false;
+      }
+
+      if ( result != Status::OK )
+      {
+        spdlog::error( "Failed starting ADC stream" );
+        stopStream();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryADC::stopStream() noexcept
+    {
+      using namespace std::chrono;
+
+      if ( !streaming )
+      {
+        return Status::OK;
+      }
+
+      Chimera::Status_t result = Status::OK;
+      const auto serial        = busPirate.serial;
+      const auto deadline      = steady_clock::now() + milliseconds( STREAM_STOP_TIMEOUT_MS );
+      const uint8_t cmd        = CMD_STREAM_STOP;
+
+      serial->write( &cmd, 1 );
+      streaming = false;
+
+      /*------------------------------------------------
+      Readings already on their way still arrive, so drain until the line goes quiet
+      ------------------------------------------------*/
+      std::array<uint8_t, 256> chunk;
+      size_t received  = 0;
+      size_t discarded = 0;
+
+      while ( ( serial->readSome( chunk.data(), chunk.size(), received, STREAM_QUIET_MS ) == Status::OK ) &&
+              ( steady_clock::now() < deadline ) )
+      {
+        discarded += received;
+      }
+
+      spdlog::debug( "Discarded {} ADC readings after stopping the stream", discarded / READING_SIZE );
+
+      serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::BLOCKING );
+      serial->setRxRecordSize( 1 );
+
+      if ( !busPirate.resyncFraming() )
+      {
+        spdlog::error( "Failed stopping ADC stream" );
+        result = Status::FAIL;
+      }
+
+      return result;
+    }
+
+    bool BinaryADC::isStreaming() const noexcept
+    {
+      return streaming;
+    }
+
+    Chimera::Status_t BinaryADC::read( uint16_t *const counts, const size_t length, size_t &received,
+                                       const uint32_t timeout_mS ) noexcept
+    {
+      using namespace std::chrono;
+
+      received = 0;
+
+      if ( !streaming )
+      {
+        return Status::NOT_READY;
+      }
+
+      if ( !counts || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      /*------------------------------------------------
+      Pull the raw bytes straight into the caller's buffer, behind any half reading
+      left over from last time, until there's at least one whole reading
+      ------------------------------------------------*/
+      const auto serial   = busPirate.serial;
+      const auto deadline = steady_clock::now() + milliseconds( timeout_mS );
+      uint8_t *const raw  = reinterpret_cast<uint8_t *>( counts );
+      const size_t size   = length * READING_SIZE;
+      size_t filled       = 0;
+
+      if ( partialValid )
+      {
+        raw[ filled++ ] = partialByte;
+        partialValid    = false;
+      }
+
+      while ( filled < READING_SIZE )
+      {
+        const auto now = steady_clock::now();
+        size_t bytes   = 0;
+
+        if ( now >= deadline )
+        {
+          break;
+        }
+
+        const auto remaining = duration_cast<milliseconds>( deadline - now ).count();
+
+        if ( serial->readSome( raw + filled, size - filled, bytes, static_cast<uint32_t>( remaining ) ) == Status::OK )
+        {
+          filled += bytes;
+        }
+      }
+
+      if ( filled % READING_SIZE )
+      {
+        partialByte  = raw[ --filled ];
+        partialValid = true;
+      }
+
+      /*------------------------------------------------
+      Unpack in place. Each reading is read out of the two bytes it overwrites.
+      ------------------------------------------------*/
+      received = filled / READING_SIZE;
+
+      for ( size_t x = 0; x < received; x++ )
+      {
+        const uint8_t msb = raw[ READING_SIZE * x ];
+        const uint8_t lsb = raw[ READING_SIZE * x + 1 ];
+
+        counts[ x ] = static_cast<uint16_t>( ( msb << 8 ) | lsb ) & ADC_MAX;
+      }
+
+      return received ? Status::OK : Status::EMPTY;
+    }
+
+    void BinaryADC::setRingSize( const size_t samples ) noexcept
+    {
+      ringSize = samples;
+    }
+
+    size_t BinaryADC::getOverflowCount() const noexcept
+    {
+      return busPirate.serial ? busPirate.serial->getRxOverflowCount() / READING_SIZE : 0;
+    }
+
+    void BinaryADC::toVolts( const uint16_t *const counts, float *const volts, const size_t count ) noexcept
+    {
+      for ( size_t x = 0; x < count; x++ )
+      {
+        volts[ x ] = static_cast<float>( counts[ x ] ) * VOLTS_PER_COUNT;
+      }
+    }
+
+    size_t BinaryADC::decimate( const float *const volts, const size_t count, const size_t factor, float *const out ) noexcept
+    {
+      if ( !factor )
+      {
+        return 0;
+      }
+
+      const size_t groups = count / factor;
+      const float scale   = 1.0f / static_cast<float>( factor );
+
+      for ( size_t x = 0; x < groups; x++ )
+      {
+        const float *group = volts + ( x * factor );
+        float sum          = 0.0f;
+
+        for ( size_t y = 0; y < factor; y++ )
+        {
+          sum += group[ y ];
+        }
+
+        out[ x ] = sum * scale;
+      }
+
+      return groups;
+    }
+
+    size_t BinaryADC::summarize( const float *const volts, const size_t count, const size_t window, ADCWindow *const out ) noexcept
+    {
+      if ( !window )
+      {
+        return 0;
+      }
+
+      const size_t windows = count / window;
+
+      for ( size_t x = 0; x < windows; x++ )
+      {
+        const float *samples = volts + ( x * window );
+        float lo             = samples[ 0 ];
+        float hi             = samples[ 0 ];
+        float sum            = 0.0f;
+
+        for ( size_t y = 0; y < window; y++ )
+        {
+          lo = std::min( lo, samples[ y ] );
+          hi = std::max( hi, samples[ y ] );
+          sum += samples[ y ];
+        }
+
+        out[ x ] = { lo, hi, sum / static_cast<float>( window ) };
+      }
+
+      return windows;
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
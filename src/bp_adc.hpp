@@ -0,0 +1,189 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_adc.hpp
+ *
+ *   Description:
+ *       Provides access to the Bus Pirate's voltage probe ADC from bit bang root
+ *       mode, one measurement at a time or as a continuous stream.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_ADC_DRIVER_HPP
+#define BUS_PIRATE_CPP_ADC_DRIVER_HPP
+
+/* C++ Includes */
+#include <memory>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  Summary of a window of measurements
+     */
+    struct ADCWindow
+    {
+      float min;
+      float max;
+      float mean;
+    };
+
+    class BinaryADC;
+    using BinaryADC_sPtr = std::shared_ptr<BinaryADC>;
+    using BinaryADC_uPtr = std::unique_ptr<BinaryADC>;
+
+    /**
+     *  Reads the voltage probe (the ADC pin). A measurement is a 10-bit count of the
+     *  probe voltage through the board's 1/2 divider, so the range is 0V to 6.6V.
+     *
+     *  While streaming, the firmware sends measurements back to back as fast as the
+     *  link takes them. They are collected by the serial port's background reader into
+     *  its ring buffer, and read() unpacks them in place in the caller's buffer. The
+     *  board can't do anything else until the stream is stopped.
+     */
+    class BinaryADC
+    {
+    public:
+      static constexpr float VOLTS_PER_COUNT = 6.6f / 1024.0f;
+
+      /**
+       *  Primary constructor for creating the ADC interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      BinaryADC( Device &device );
+
+      BinaryADC()  = default;
+      ~BinaryADC() = default;
+
+      /**
+       *  Enters bit bang root mode, where the ADC commands live
+       */
+      Chimera::Status_t init() noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Takes a single measurement
+       *
+       *	@param[out]	volts         The probe voltage
+       *	@return Chimera::Status_t: NOT_READY while streaming
+       */
+      Chimera::Status_t measure( float &volts ) noexcept;
+
+      /**
+       *	Takes a single measurement
+       *
+       *	@param[out]	counts        The raw 10-bit reading
+       *	@return Chimera::Status_t: NOT_READY while streaming
+       */
+      Chimera::Status_t measureRaw( uint16_t &counts ) noexcept;
+
+      /**
+       *	Starts the continuous stream
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t startStream() noexcept;
+
+      /**
+       *	Stops the continuous stream. Measurements not yet read are thrown away.
+       *
+       *	@return Chimera::Status_t: FAIL if the link couldn't be brought back into step
+       */
+      Chimera::Status_t stopStream() noexcept;
+
+      bool isStreaming() const noexcept;
+
+      /**
+       *	Reads streamed measurements, waiting for at least one to arrive
+       *
+       *	@param[out]	counts        Receives the raw readings, oldest first
+       *	@param[in]	length        Maximum number of readings
+       *	@param[out]	received      Number of readings actually read
+       *	@param[in]	timeout_mS    How long to wait for the first reading
+       *	@return Chimera::Status_t: EMPTY if nothing arrived, NOT_READY if not streaming
+       */
+      Chimera::Status_t read( uint16_t *const counts, const size_t length, size_t &received,
+                              const uint32_t timeout_mS = 500 ) noexcept;
+
+      /**
+       *	Sets how many measurements the host can hold until they are read. Only takes
+       *  effect the next time the stream starts.
+       *
+       *	@param[in]	samples       Number of measurements, rounded up to a power of two
+       *	@return void
+       */
+      void setRingSize( const size_t samples ) noexcept;
+
+      /**
+       *	Number of measurements lost because they weren't read in time, since the
+       *  stream last started
+       *
+       *	@return size_t
+       */
+      size_t getOverflowCount() const noexcept;
+
+      /**
+       *	Converts raw readings to volts. A plain loop over contiguous arrays, which
+       *  compilers turn into vector instructions.
+       *
+       *	@param[in]	counts        Raw readings
+       *	@param[out]	volts         Receives the voltages
+       *	@param[in]	count         Number of readings
+       *	@return void
+       */
+      static void toVolts( const uint16_t *const counts, float *const volts, const size_t count ) noexcept;
+
+      /**
+       *	Averages every group of samples down to one. A partial group at the end is
+       *  left over for the caller to carry into the next call.
+       *
+       *	@param[in]	volts         Voltages to decimate
+       *	@param[in]	count         Number of voltages
+       *	@param[in]	factor        Samples per group
+       *	@param[out]	out           Receives count / factor averages
+       *	@return size_t: Number of averages written
+       */
+      static size_t decimate( const float *const volts, const size_t count, const size_t factor, float *const out ) noexcept;
+
+      /**
+       *	Finds the minimum, maximum and mean of every window of samples. A partial
+       *  window at the end is left over, as for decimate().
+       *
+       *	@param[in]	volts         Voltages to summarize
+       *	@param[in]	count         Number of voltages
+       *	@param[in]	window        Samples per window
+       *	@param[out]	out           Receives count / window summaries
+       *	@return size_t: Number of summaries written
+       */
+      static size_t summarize( const float *const volts, const size_t count, const size_t window, ADCWindow *const out ) noexcept;
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized;
+      bool streaming;
+      size_t ringSize;
+
+      /*------------------------------------------------
+      Half a reading left over from the last read()
+      ------------------------------------------------*/
+      bool partialValid;
+      uint8_t partialByte;
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_ADC_DRIVER_HPP */
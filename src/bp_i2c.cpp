@@ -0,0 +1,496 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_i2c.cpp
+ *
+ *   Description:
+ *       Implements the I2C interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_i2c.hpp"
+
+/* C++ Includes */
+#include <array>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Bus Control Commands. Each is answered with 0x01, except for a read which
+    answers with the byte read.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_I2C_START = 0x02;
+    static constexpr uint8_t CMD_I2C_STOP  = 0x03;
+    static constexpr uint8_t CMD_I2C_READ  = 0x04;
+    static constexpr uint8_t CMD_I2C_ACK   = 0x06;
+    static constexpr uint8_t CMD_I2C_NACK  = 0x07;
+
+    /*------------------------------------------------
+    Board Configuration Options
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_PERIPH     = 0x40;
+    static constexpr uint8_t MSK_CFG_PERIPH     = 0x0F;
+    static constexpr uint8_t CFG_PERIPH_POWER   = ( 1u << 3 );
+    static constexpr uint8_t CFG_PERIPH_PULLUP  = ( 1u << 2 );
+    static constexpr uint8_t CFG_PERIPH_AUX_PIN = ( 1u << 1 );
+    static constexpr uint8_t CFG_PERIPH_CS_PIN  = ( 1u << 0 );
+
+    /*------------------------------------------------
+    I2C Speed Configuration. The register value indexes the table.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_SPEED = 0x60;
+    static constexpr uint8_t MSK_CFG_SPEED = 0x03;
+
+    static constexpr std::array<uint32_t, 4> sortedI2CSpeeds = { I2C_SPEED_5kHz, I2C_SPEED_50kHz, I2C_SPEED_100kHz,
+                                                                 I2C_SPEED_400kHz };
+
+    /*------------------------------------------------
+    I2C Write/Read Commands. A bulk write is answered with 0x01 and then one byte
+    per byte written: 0x00 if the target acknowledged it, 0x01 if not.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_BULK_I2C_WRITE       = 0x10;
+    static constexpr uint8_t MSK_BULK_I2C_WRITE_BYTES = 0x0F;
+    static constexpr uint8_t CMD_TX_THEN_RX           = 0x08;
+
+    static constexpr size_t BULK_WRITE_MAX_LEN = 16;
+    static constexpr uint8_t I2C_ACK           = 0x00;
+    static constexpr uint8_t I2C_READ_BIT      = 0x01;
+
+    /*------------------------------------------------
+    Write-then-read limits. The firmware buffers up to 4096 bytes in each direction.
+    Below the minimum length, a transaction built from single byte commands gets
+    through just as fast and can use a repeated start.
+    ------------------------------------------------*/
+    static constexpr size_t TX_THEN_RX_MAX_LEN = 4096;
+    static constexpr size_t TX_THEN_RX_MIN_LEN = 16;
+
+    /*------------------------------------------------
+    Flow control for streamed transactions. An I2C byte takes nine clocks with the
+    acknowledge bit.
+    ------------------------------------------------*/
+    static constexpr uint64_t I2C_CLOCKS_PER_BYTE = 9;
+
+    /*------------------------------------------------
+    How long to let a target settle after the supplies switch on
+    ------------------------------------------------*/
+    static constexpr uint32_t DEFAULT_POWER_UP_DELAY_MS = 100;
+
+
+    BinaryI2C::BinaryI2C( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+
+      /*------------------------------------------------
+      Initialize the virtual registers
+      ------------------------------------------------*/
+      reg_PeriphCfg = { CMD_CFG_PERIPH, MSK_CFG_PERIPH, 0, 0, false };
+      reg_I2CSpeed  = { CMD_CFG_SPEED, MSK_CFG_SPEED, 0, 0, false };
+      stagingConfig = false;
+
+      powerUpDelay_mS = DEFAULT_POWER_UP_DELAY_MS;
+    }
+
+    Chimera::Status_t BinaryI2C::init( const I2CSetup &setupStruct ) noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      CommandBatch batch;
+      size_t entry = 0;
+
+      /*------------------------------------------------
+      Skip the mode switch if the board is already in I2C mode, otherwise queue it
+      up to go out together with the configuration
+      ------------------------------------------------*/
+      bool inI2CMode = ( busPirate.state->currentMode == OperationalModes::BP_MODE_I2C_BIT_BANG ) && busPirate.resyncFraming();
+
+      if ( !inI2CMode && ( ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) || busPirate.bbInit() ) )
+      {
+        entry = batch.add( { BitBangCommands::enterI2C }, BitBangCommands::i2cSuccess.size(), false );
+
+        /*------------------------------------------------
+        Entering I2C mode resets the firmware's configuration
+        ------------------------------------------------*/
+        invalidateShadowRegisters( { &reg_PeriphCfg, &reg_I2CSpeed } );
+      }
+
+      if ( inI2CMode || batch.size() )
+      {
+        const bool powered  = reg_PeriphCfg.valid && ( reg_PeriphCfg.applied & CFG_PERIPH_POWER );
+        bool entryConfirmed = inI2CMode;
+
+        /*------------------------------------------------
+        The mode switch answers once whichever batch carries it has gone out
+        ------------------------------------------------*/
+        auto confirmEntry = [ this, &batch, &entry, &entryConfirmed ]() -> Chimera::Status_t {
+          if ( entryConfirmed )
+          {
+            return Status::OK;
+          }
+
+          const std::string &expected = BitBangCommands::i2cSuccess;
+          auto reply                  = batch.reply( entry );
+
+          entryConfirmed = true;
+          if ( ( reply.length == expected.size() ) && std::equal( expected.begin(), expected.end(), reply.data ) )
+          {
+            busPirate.state->currentMode = OperationalModes::BP_MODE_I2C_BIT_BANG;
+            return Status::OK;
+          }
+
+          return Status::FAIL;
+        };
+
+        stageConfig();
+
+        /*------------------------------------------------
+        Switching the supplies on goes out on its own, and the delay runs before the
+        pull-ups and clock setting follow, so the bus only comes up on a powered target
+        ------------------------------------------------*/
+        result = cfgPowerSupplies( true );
+
+        if ( !powered && powerUpDelay_mS )
+        {
+          result |= commitConfig( batch );
+          result |= confirmEntry();
+          batch.clear();
+
+          if ( reg_PeriphCfg.applied & CFG_PERIPH_POWER )
+          {
+            Chimera::delayMilliseconds( powerUpDelay_mS );
+          }
+
+          stageConfig();
+        }
+
+        result |= cfgPullups( setupStruct.pullups );
+        result |= setClockFrequency( setupStruct.clockFrequency, 0 );
+        result |= commitConfig( batch );
+        result |= confirmEntry();
+      }
+
+      if ( result == Status::OK )
+      {
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed I2C initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::deInit() noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      busPirate.close();
+      result            = Status::OK;
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::write( const uint8_t address, const uint8_t *const txBuffer, const size_t length ) noexcept
+    {
+      if ( ( address > 0x7F ) || !txBuffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      /*------------------------------------------------
+      Larger writes go out in one command that the firmware clocks out on its own,
+      rather than as bulk writes that echo an ACK back for every byte
+      ------------------------------------------------*/
+      if ( ( length + 1 < TX_THEN_RX_MIN_LEN ) || ( length + 1 > TX_THEN_RX_MAX_LEN ) )
+      {
+        return transaction( address, txBuffer, length, nullptr, 0 );
+      }
+
+      std::vector<uint8_t> data = { static_cast<uint8_t>( address << 1 ) };
+      data.insert( data.end(), txBuffer, txBuffer + length );
+
+      return writeThenRead( data, nullptr, 0 );
+    }
+
+    Chimera::Status_t BinaryI2C::read( const uint8_t address, uint8_t *const rxBuffer, const size_t length ) noexcept
+    {
+      if ( ( address > 0x7F ) || !rxBuffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( length < TX_THEN_RX_MIN_LEN )
+      {
+        return transaction( address, nullptr, 0, rxBuffer, length );
+      }
+
+      /*------------------------------------------------
+      Each segment is a transaction of its own. Memories carry on reading from
+      where the last one stopped.
+      ------------------------------------------------*/
+      Chimera::Status_t result        = Status::OK;
+      const std::vector<uint8_t> data = { static_cast<uint8_t>( ( address << 1 ) | I2C_READ_BIT ) };
+
+      for ( size_t offset = 0; ( offset < length ) && ( result == Status::OK ); offset += TX_THEN_RX_MAX_LEN )
+      {
+        result = writeThenRead( data, rxBuffer + offset, std::min( TX_THEN_RX_MAX_LEN, length - offset ) );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::writeRead( const uint8_t address, const uint8_t *const txBuffer, const size_t txLength,
+                                            uint8_t *const rxBuffer, const size_t rxLength ) noexcept
+    {
+      if ( ( address > 0x7F ) || !txBuffer || !txLength || !rxBuffer || !rxLength )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( rxLength < TX_THEN_RX_MIN_LEN )
+      {
+        return transaction( address, txBuffer, txLength, rxBuffer, rxLength );
+      }
+
+      /*------------------------------------------------
+      The read is only sent once the write has been acknowledged, so a missing target
+      is reported without waiting on data that will never come
+      ------------------------------------------------*/
+      Chimera::Status_t result = write( address, txBuffer, txLength );
+
+      if ( result == Status::OK )
+      {
+        result = read( address, rxBuffer, rxLength );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::setClockFrequency( const uint32_t freq, const uint32_t tolerance ) noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      /*------------------------------------------------
+      Find the lowest error clock
+      ------------------------------------------------*/
+      auto iter = std::min_element( sortedI2CSpeeds.begin(), sortedI2CSpeeds.end(), [freq]( uint32_t a, uint32_t b ) {
+        return std::labs( static_cast<long>( a ) - static_cast<long>( freq ) ) <
+               std::labs( static_cast<long>( b ) - static_cast<long>( freq ) );
+      } );
+
+      auto bitVals = static_cast<uint8_t>( std::distance( sortedI2CSpeeds.begin(), iter ) );
+
+      if ( writeShadowRegister( busPirate, reg_I2CSpeed, bitVals, stagingConfig ) == Status::OK )
+      {
+        result = Status::OK;
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::getClockFrequency( uint32_t &freq ) noexcept
+    {
+      Chimera::Status_t result = Status::OK;
+
+      freq = sortedI2CSpeeds[ reg_I2CSpeed.staged & MSK_CFG_SPEED ];
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::reserve( const uint32_t timeout_ms )
+    {
+      return Status::NOT_SUPPORTED;
+    }
+
+    Chimera::Status_t BinaryI2C::release( const uint32_t timeout_ms )
+    {
+      return Status::NOT_SUPPORTED;
+    }
+
+    Chimera::Status_t BinaryI2C::cfgPowerSupplies( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_POWER, state );
+    }
+
+    Chimera::Status_t BinaryI2C::cfgPullups( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_PULLUP, state );
+    }
+
+    Chimera::Status_t BinaryI2C::cfgAuxPin( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_AUX_PIN, state );
+    }
+
+    Chimera::Status_t BinaryI2C::cfgChipSelect( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_CS_PIN, state );
+    }
+
+    void BinaryI2C::stageConfig()
+    {
+      stagingConfig = true;
+    }
+
+    Chimera::Status_t BinaryI2C::commitConfig()
+    {
+      CommandBatch batch;
+      return commitConfig( batch );
+    }
+
+    void BinaryI2C::setPowerUpDelay( const uint32_t delay_mS )
+    {
+      powerUpDelay_mS = delay_mS;
+    }
+
+    Chimera::Status_t BinaryI2C::commitConfig( CommandBatch &batch )
+    {
+      stagingConfig = false;
+      return commitShadowRegisters( busPirate, batch, { &reg_PeriphCfg, &reg_I2CSpeed } );
+    }
+
+    Chimera::Status_t BinaryI2C::cfgField( ShadowRegister &reg, const uint8_t field, const bool state )
+    {
+      return writeShadowRegister( busPirate, reg, reg.withField( field, state ), stagingConfig );
+    }
+
+    Chimera::Status_t BinaryI2C::transaction( const uint8_t address, const uint8_t *const txBuffer, const size_t txLength,
+                                              uint8_t *const rxBuffer, const size_t rxLength )
+    {
+      CommandBatch batch;
+      std::vector<size_t> writes;
+      std::vector<size_t> reads;
+      std::vector<uint8_t> chunk;
+
+      /*------------------------------------------------
+      Every command in here is answered with exactly one byte per byte sent, so the
+      whole transaction streams out back to back and costs a single round trip
+      ------------------------------------------------*/
+      auto bulkWrite = [&]( const std::vector<uint8_t> &data ) {
+        for ( size_t offset = 0; offset < data.size(); offset += BULK_WRITE_MAX_LEN )
+        {
+          const size_t len = std::min( BULK_WRITE_MAX_LEN, data.size() - offset );
+
+          chunk.assign( 1, static_cast<uint8_t>( CMD_BULK_I2C_WRITE | ( ( len - 1 ) & MSK_BULK_I2C_WRITE_BYTES ) ) );
+          chunk.insert( chunk.end(), data.begin() + offset, data.begin() + offset + len );
+          writes.push_back( batch.add( chunk, len + 1 ) );
+        }
+      };
+
+      if ( txLength )
+      {
+        std::vector<uint8_t> data = { static_cast<uint8_t>( address << 1 ) };
+        data.insert( data.end(), txBuffer, txBuffer + txLength );
+
+        batch.add( { CMD_I2C_START }, 1 );
+        bulkWrite( data );
+      }
+
+      if ( rxLength )
+      {
+        /*------------------------------------------------
+        A start straight after the write is the repeated start. The target is told
+        to keep going by an ACK after each byte, and to let go by a NACK on the last.
+        ------------------------------------------------*/
+        batch.add( { CMD_I2C_START }, 1 );
+        bulkWrite( { static_cast<uint8_t>( ( address << 1 ) | I2C_READ_BIT ) } );
+
+        for ( size_t x = 0; x < rxLength; x++ )
+        {
+          reads.push_back( batch.add( { CMD_I2C_READ }, 1, false ) );
+          batch.add( { ( x + 1 < rxLength ) ? CMD_I2C_ACK : CMD_I2C_NACK }, 1 );
+        }
+      }
+
+      batch.add( { CMD_I2C_STOP }, 1 );
+
+      Chimera::Status_t result = busPirate.stream( batch, streamWindow() );
+
+      /*------------------------------------------------
+      The firmware carries on regardless of what the target says, so the ACKs are
+      only checked once the bus is released again
+      ------------------------------------------------*/
+      for ( size_t x = 0; ( x < writes.size() ) && ( result == Status::OK ); x++ )
+      {
+        auto reply = batch.reply( writes[ x ] );
+
+        if ( std::any_of( reply.data + 1, reply.data + reply.length, []( uint8_t ack ) { return ack != I2C_ACK; } ) )
+        {
+          spdlog::debug( "I2C target 0x{:02X} did not acknowledge", address );
+          result = Status::FAIL;
+        }
+      }
+
+      if ( result == Status::OK )
+      {
+        for ( size_t x = 0; x < reads.size(); x++ )
+        {
+          rxBuffer[ x ] = batch.reply( reads[ x ] ).data[ 0 ];
+        }
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryI2C::writeThenRead( const std::vector<uint8_t> &txData, uint8_t *const rxBuffer,
+                                                const size_t rxLength )
+    {
+      Chimera::Status_t result = Status::FAIL;
+      CommandBatch batch;
+
+      /*------------------------------------------------
+      Command preamble, then the data to write. The Bus Pirate answers once the
+      whole transaction is done: 0x01 followed by the bytes read, or a lone 0x00
+      if the target didn't acknowledge a byte written.
+      ------------------------------------------------*/
+      const size_t txLength     = txData.size();
+      std::vector<uint8_t> data = { CMD_TX_THEN_RX,
+                                    static_cast<uint8_t>( ( txLength >> 8 ) & 0xFF ),
+                                    static_cast<uint8_t>( ( txLength & 0xFF ) ),
+                                    static_cast<uint8_t>( ( rxLength >> 8 ) & 0xFF ),
+                                    static_cast<uint8_t>( ( rxLength & 0xFF ) ) };
+      data.insert( data.end(), txData.begin(), txData.end() );
+
+      const size_t index = batch.add( data, rxLength + 1 );
+      busPirate.execute( batch );
+
+      auto reply = batch.reply( index );
+
+      if ( reply.status == Status::OK )
+      {
+        if ( rxLength )
+        {
+          memcpy( rxBuffer, reply.data + 1, rxLength );
+        }
+
+        result = Status::OK;
+      }
+
+      return result;
+    }
+
+    size_t BinaryI2C::streamWindow() const
+    {
+      if ( !reg_I2CSpeed.valid )
+      {
+        return 1;
+      }
+
+      return busPirate.streamWindow( ( I2C_CLOCKS_PER_BYTE * 1000000000ull ) / sortedI2CSpeeds[ reg_I2CSpeed.applied ] );
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,241 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_i2c.hpp
+ *
+ *   Description:
+ *       Provides an interface to the I2C hardware on the Bus Pirate. Follows the
+ *       conventions of the Chimera HAL drivers.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_I2C_DRIVER_HPP
+#define BUS_PIRATE_CPP_I2C_DRIVER_HPP
+
+/* C++ Includes */
+#include <memory>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  Supported Bus Pirate I2C Speeds
+     */
+    enum I2CSpeed
+    {
+      I2C_SPEED_5kHz   = 5000,
+      I2C_SPEED_50kHz  = 50000,
+      I2C_SPEED_100kHz = 100000,
+      I2C_SPEED_400kHz = 400000,
+    };
+
+    /**
+     *  Settings applied by BinaryI2C::init()
+     */
+    struct I2CSetup
+    {
+      uint32_t clockFrequency; /**< Desired bus clock, rounded to the nearest supported speed */
+      bool pullups;            /**< Enables the on-board pullups, which need a supply on the Vpu pin */
+
+      I2CSetup()
+      {
+        clockFrequency = I2C_SPEED_100kHz;
+        pullups        = false;
+      }
+    };
+
+    class BinaryI2C;
+    using BinaryI2C_sPtr = std::shared_ptr<BinaryI2C>;
+    using BinaryI2C_uPtr = std::unique_ptr<BinaryI2C>;
+
+    /**
+     *  I2C master built for throughput. Short transactions go out as a single stream
+     *  of start, bulk write, read, ACK and stop commands, so a whole register access
+     *  costs one round trip. Longer blocks use the firmware's write-then-read command,
+     *  which moves up to 4096 bytes each way without per byte overhead on the link.
+     *
+     *  Addresses are 7-bit. A transfer fails with FAIL if the target doesn't
+     *  acknowledge its address or any byte written to it.
+     */
+    class BinaryI2C
+    {
+    public:
+      /**
+       *  Primary constructor for creating the I2C interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      BinaryI2C( Device &device );
+
+      BinaryI2C()  = default;
+      ~BinaryI2C() = default;
+
+      Chimera::Status_t init( const I2CSetup &setupStruct ) noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Writes a block of data to a target: start, address, data, stop
+       *
+       *	@param[in]	address       7-bit target address
+       *	@param[in]	txBuffer      Data to write
+       *	@param[in]	length        Number of bytes to write
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t write( const uint8_t address, const uint8_t *const txBuffer, const size_t length ) noexcept;
+
+      /**
+       *	Reads a block of data from a target: start, address, data, stop. Every byte
+       *  but the last is acknowledged.
+       *
+       *	@param[in]	address       7-bit target address
+       *	@param[out]	rxBuffer      Receives the data
+       *	@param[in]	length        Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t read( const uint8_t address, uint8_t *const rxBuffer, const size_t length ) noexcept;
+
+      /**
+       *	Writes to a target and then reads back from it, ie a register or EEPROM address
+       *  followed by its contents. Short reads join the two halves with a repeated start.
+       *  Longer reads go through write-then-read, which ends the write with a stop
+       *  instead. That suits EEPROMs and most sensors, which keep their address
+       *  pointer across a stop.
+       *
+       *	@param[in]	address       7-bit target address
+       *	@param[in]	txBuffer      Data to write first
+       *	@param[in]	txLength      Number of bytes to write
+       *	@param[out]	rxBuffer      Receives the data read
+       *	@param[in]	rxLength      Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t writeRead( const uint8_t address, const uint8_t *const txBuffer, const size_t txLength,
+                                   uint8_t *const rxBuffer, const size_t rxLength ) noexcept;
+
+      Chimera::Status_t setClockFrequency( const uint32_t freq, const uint32_t tolerance ) noexcept;
+
+      Chimera::Status_t getClockFrequency( uint32_t &freq ) noexcept;
+
+      Chimera::Status_t reserve( const uint32_t timeout_ms = 0u );
+
+      Chimera::Status_t release( const uint32_t timeout_ms = 0u );
+
+      /**
+       *	Enables or disables the on-board power supplies
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPowerSupplies( const bool state );
+
+      /**
+       *	Enables or disables the pullups on SDA and SCL
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPullups( const bool state );
+
+      /**
+       *	Enables or disables the Auxiliary pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgAuxPin( const bool state );
+
+      /**
+       *	Enables or disables the chip select pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgChipSelect( const bool state );
+
+      /**
+       *	Starts staging configuration changes. Until commitConfig() is called, the cfg
+       *  functions and setClockFrequency() only update the shadow registers.
+       *
+       *	@return void
+       */
+      void stageConfig();
+
+      /**
+       *	Writes every register that was changed while staging and stops staging
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t commitConfig();
+
+      /**
+       *	Sets how long init() waits for the target to settle after switching the
+       *  power supplies on. There is no wait if the supplies were already on.
+       *
+       *	@param[in]	delay_mS      Settling time in milliseconds, 0 to skip it
+       *	@return void
+       */
+      void setPowerUpDelay( const uint32_t delay_mS );
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized;
+      bool stagingConfig;
+      uint32_t powerUpDelay_mS;
+
+      ShadowRegister reg_PeriphCfg;
+      ShadowRegister reg_I2CSpeed;
+
+      Chimera::Status_t cfgField( ShadowRegister &reg, const uint8_t field, const bool state );
+
+      Chimera::Status_t commitConfig( CommandBatch &batch );
+
+      /**
+       *	Runs a whole transaction as one stream of single byte commands: start, the
+       *  address and data in bulk writes, a repeated start and the reads if there are
+       *  any, then stop
+       *
+       *	@param[in]	address       7-bit target address
+       *	@param[in]	txBuffer      Data to write, may be null if txLength is 0
+       *	@param[in]	txLength      Number of bytes to write
+       *	@param[out]	rxBuffer      Receives the data read, may be null if rxLength is 0
+       *	@param[in]	rxLength      Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t transaction( const uint8_t address, const uint8_t *const txBuffer, const size_t txLength,
+                                     uint8_t *const rxBuffer, const size_t rxLength );
+
+      /**
+       *	Sends a single write-then-read command. The firmware wraps it in its own start
+       *  and stop, so the data must begin with the address byte.
+       *
+       *	@param[in]	txData        Address byte followed by the data to write
+       *	@param[out]	rxBuffer      Receives the data read, may be null if rxLength is 0
+       *	@param[in]	rxLength      Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t writeThenRead( const std::vector<uint8_t> &txData, uint8_t *const rxBuffer, const size_t rxLength );
+
+      /**
+       *	Works out how far a transaction can stream ahead of the replies at the current
+       *  I2C clock and baud rate without overrunning the Bus Pirate's UART FIFO
+       *
+       *	@return size_t: Window in bytes, 0 if the stream doesn't need throttling
+       */
+      size_t streamWindow() const;
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_I2C_DRIVER_HPP */
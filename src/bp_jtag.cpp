@@ -0,0 +1,745 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_jtag.cpp
+ *
+ *   Description:
+ *       Implements the JTAG interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_jtag.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+#include <array>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Configuration Commands. These aren't answered.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_PORT_MODE     = 0x01;
+    static constexpr uint8_t PORT_MODE_JTAG    = 0x01;
+    static constexpr uint8_t PORT_MODE_JTAG_OD = 0x02;
+
+    static constexpr uint8_t CMD_FEATURE    = 0x02;
+    static constexpr uint8_t FEATURE_VREG   = 0x02;
+    static constexpr uint8_t FEATURE_TRST   = 0x04;
+    static constexpr uint8_t FEATURE_SRST   = 0x08;
+    static constexpr uint8_t FEATURE_PULLUP = 0x10;
+    static constexpr uint8_t ACTION_DISABLE = 0x00;
+    static constexpr uint8_t ACTION_ENABLE  = 0x01;
+
+    /*------------------------------------------------
+    TAP Shift Command. Followed by a 16-bit bit count and then a TDI byte and a TMS
+    byte for each 8 bits, LSB first. Answered with the command and count, then a TDO
+    byte for each 8 bits.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_TAP_SHIFT     = 0x05;
+    static constexpr size_t TAP_SHIFT_HEADER   = 3;
+    static constexpr size_t TAP_SHIFT_MAX_BITS = 0x2000;
+
+    /*------------------------------------------------
+    TMS high for this many clocks reaches Test-Logic-Reset from any state
+    ------------------------------------------------*/
+    static constexpr size_t RESET_CLOCKS = 5;
+
+    /*------------------------------------------------
+    detectChain() looks for at most this many devices
+    ------------------------------------------------*/
+    static constexpr size_t MAX_CHAIN_DEVICES = 16;
+    static constexpr size_t IDCODE_BITS       = 32;
+    static constexpr uint32_t IDCODE_NONE     = 0xFFFFFFFF;
+
+    /*------------------------------------------------
+    How long to let the target settle after the supplies switch on
+    ------------------------------------------------*/
+    static constexpr uint32_t DEFAULT_POWER_UP_DELAY_MS = 100;
+
+    /*------------------------------------------------
+    Where the TAP goes on each clock, indexed by state and then TMS
+    ------------------------------------------------*/
+    static constexpr std::array<std::array<TAPState, 2>, TAP_NUM_STATES> nextState = { {
+        { { TAP_IDLE, TAP_RESET } },           /* TAP_RESET */
+        { { TAP_IDLE, TAP_DR_SELECT } },       /* TAP_IDLE */
+        { { TAP_DR_CAPTURE, TAP_IR_SELECT } }, /* TAP_DR_SELECT */
+        { { TAP_DR_SHIFT, TAP_DR_EXIT1 } },    /* TAP_DR_CAPTURE */
+        { { TAP_DR_SHIFT, TAP_DR_EXIT1 } },    /* TAP_DR_SHIFT */
+        { { TAP_DR_PAUSE, TAP_DR_UPDATE } },   /* TAP_DR_EXIT1 */
+        { { TAP_DR_PAUSE, TAP_DR_EXIT2 } },    /* TAP_DR_PAUSE */
+        { { TAP_DR_SHIFT, TAP_DR_UPDATE } },   /* TAP_DR_EXIT2 */
+        { { TAP_IDLE, TAP_DR_SELECT } },       /* TAP_DR_UPDATE */
+        { { TAP_IR_CAPTURE, TAP_RESET } },     /* TAP_IR_SELECT */
+        { { TAP_IR_SHIFT, TAP_IR_EXIT1 } },    /* TAP_IR_CAPTURE */
+        { { TAP_IR_SHIFT, TAP_IR_EXIT1 } },    /* TAP_IR_SHIFT */
+        { { TAP_IR_PAUSE, TAP_IR_UPDATE } },   /* TAP_IR_EXIT1 */
+        { { TAP_IR_PAUSE, TAP_IR_EXIT2 } },    /* TAP_IR_PAUSE */
+        { { TAP_IR_SHIFT, TAP_IR_UPDATE } },   /* TAP_IR_EXIT2 */
+        { { TAP_IDLE, TAP_DR_SELECT } },       /* TAP_IR_UPDATE */
+    } };
+
+    /*------------------------------------------------
+    TMS bits to clock, first bit in bit 0, to get from one state to another
+    ------------------------------------------------*/
+    struct TMSPath
+    {
+      uint8_t bits;
+      uint8_t length;
+    };
+
+    using TMSPathTable = std::array<std::array<TMSPath, TAP_NUM_STATES>, TAP_NUM_STATES>;
+
+    /*------------------------------------------------
+    Shortest paths between every pair of states, found once with a breadth first
+    search of the state graph
+    ------------------------------------------------*/
+    static const TMSPathTable &tmsPaths()
+    {
+      static const TMSPathTable table = []() {
+        TMSPathTable paths = {};
+
+        for ( size_t from = 0; from < TAP_NUM_STATES; from++ )
+        {
+          std::array<bool, TAP_NUM_STATES> seen = {};
+          std::array<size_t, TAP_NUM_STATES> queue;
+          size_t head = 0;
+          size_t tail = 0;
+
+          seen[ from ]    = true;
+          queue[ tail++ ] = from;
+
+          while ( head < tail )
+          {
+            const size_t state = queue[ head++ ];
+            const auto &path   = paths[ from ][ state ];
+
+            for ( uint8_t tms = 0; tms < 2; tms++ )
+            {
+              const size_t next = nextState[ state ][ tms ];
+
+              if ( !seen[ next ] )
+              {
+                seen[ next ]          = true;
+                queue[ tail++ ]       = next;
+                paths[ from ][ next ] = { static_cast<uint8_t>( path.bits | ( tms << path.length ) ),
+                                          static_cast<uint8_t>( path.length + 1 ) };
+              }
+            }
+          }
+        }
+
+        return paths;
+      }();
+
+      return table;
+    }
+
+    /*------------------------------------------------
+    States the TAP stays in with the clock stopped or TMS held
+    ------------------------------------------------*/
+    static bool isStable( const TAPState state )
+    {
+      return ( state == TAP_RESET ) || ( state == TAP_IDLE ) || ( state == TAP_DR_SHIFT ) || ( state == TAP_DR_PAUSE ) ||
+             ( state == TAP_IR_SHIFT ) || ( state == TAP_IR_PAUSE );
+    }
+
+    static bool getBit( const uint8_t *const data, const size_t bit )
+    {
+      return ( data[ bit / 8 ] >> ( bit % 8 ) ) & 0x01;
+    }
+
+    /*-------------------------------------------------------------------------------
+    JTAGSequence
+    -------------------------------------------------------------------------------*/
+    JTAGSequence &JTAGSequence::reset()
+    {
+      return add( Op::RESET, TAP_RESET );
+    }
+
+    JTAGSequence &JTAGSequence::goTo( const TAPState state )
+    {
+      valid &= ( state < TAP_NUM_STATES ) && isStable( state );
+      return add( Op::GOTO, state );
+    }
+
+    JTAGSequence &JTAGSequence::idle( const size_t cycles )
+    {
+      valid &= ( cycles > 0 );
+      return add( Op::IDLE, TAP_IDLE, 0, cycles );
+    }
+
+    JTAGSequence &JTAGSequence::scanIR( const uint8_t *const tdi, const size_t bits, const bool capture, const TAPState end )
+    {
+      return scan( Op::SCAN_IR, tdi, bits, capture, end );
+    }
+
+    JTAGSequence &JTAGSequence::scanIRBits( const uint64_t tdi, const size_t bits, const bool capture, const TAPState end )
+    {
+      std::array<uint8_t, sizeof( uint64_t )> data;
+      for ( size_t x = 0; x < data.size(); x++ )
+      {
+        data[ x ] = static_cast<uint8_t>( tdi >> ( 8 * x ) );
+      }
+
+      valid &= ( bits <= 64 );
+      return scan( Op::SCAN_IR, data.data(), std::min<size_t>( bits, 64 ), capture, end );
+    }
+
+    JTAGSequence &JTAGSequence::scanDR( const uint8_t *const tdi, const size_t bits, const bool capture, const TAPState end )
+    {
+      return scan( Op::SCAN_DR, tdi, bits, capture, end );
+    }
+
+    JTAGSequence &JTAGSequence::scanDRBits( const uint64_t tdi, const size_t bits, const bool capture, const TAPState end )
+    {
+      std::array<uint8_t, sizeof( uint64_t )> data;
+      for ( size_t x = 0; x < data.size(); x++ )
+      {
+        data[ x ] = static_cast<uint8_t>( tdi >> ( 8 * x ) );
+      }
+
+      valid &= ( bits <= 64 );
+      return scan( Op::SCAN_DR, data.data(), std::min<size_t>( bits, 64 ), capture, end );
+    }
+
+    void JTAGSequence::clear()
+    {
+      steps.clear();
+      tdiData.clear();
+      scanResults.clear();
+      batch.clear();
+      captures.clear();
+
+      valid    = true;
+      compiled = false;
+      clocks   = 0;
+    }
+
+    bool JTAGSequence::empty() const
+    {
+      return steps.empty();
+    }
+
+    const std::vector<std::vector<uint8_t>> &JTAGSequence::results() const
+    {
+      return scanResults;
+    }
+
+    uint64_t JTAGSequence::result( const size_t index ) const
+    {
+      uint64_t value = 0;
+
+      if ( index < scanResults.size() )
+      {
+        const auto &bytes = scanResults[ index ];
+
+        for ( size_t x = 0; ( x < bytes.size() ) && ( x < sizeof( uint64_t ) ); x++ )
+        {
+          value |= static_cast<uint64_t>( bytes[ x ] ) << ( 8 * x );
+        }
+      }
+
+      return value;
+    }
+
+    size_t JTAGSequence::txBytes() const
+    {
+      return compiled ? batch.txBytes() : 0;
+    }
+
+    size_t JTAGSequence::clockCycles() const
+    {
+      return compiled ? clocks : 0;
+    }
+
+    JTAGSequence &JTAGSequence::scan( const Op op, const uint8_t *const tdi, const size_t bits, const bool capture,
+                                      const TAPState end )
+    {
+      if ( !tdi || !bits || ( end >= TAP_NUM_STATES ) || !isStable( end ) )
+      {
+        valid = false;
+        return *this;
+      }
+
+      const size_t offset = tdiData.size();
+      tdiData.insert( tdiData.end(), tdi, tdi + ( bits + 7 ) / 8 );
+
+      return add( op, end, offset, bits, capture );
+    }
+
+    JTAGSequence &JTAGSequence::add( const Op op, const TAPState state, const size_t offset, const size_t count,
+                                     const bool capture )
+    {
+      steps.push_back( { op, state, offset, count, capture } );
+      compiled = false;
+
+      return *this;
+    }
+
+    /*-------------------------------------------------------------------------------
+    BinaryJTAG
+    -------------------------------------------------------------------------------*/
+    BinaryJTAG::BinaryJTAG( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+      powerUpDelay_mS   = DEFAULT_POWER_UP_DELAY_MS;
+      tapState          = TAP_RESET;
+    }
+
+    Chimera::Status_t BinaryJTAG::init( const JTAGSetup &setupStruct ) noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      CommandBatch batch;
+      size_t modeEntry = 0;
+
+      /*------------------------------------------------
+      Skip the mode switch if the board is already in OpenOCD mode, otherwise queue it
+      up to go out together with the configuration
+      ------------------------------------------------*/
+      bool inJTAGMode =
+          ( busPirate.state->currentMode == OperationalModes::BP_MODE_JTAG_BIT_BANG ) && busPirate.resyncFraming();
+
+      if ( !inJTAGMode
+           && ( ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) || busPirate.bbInit() ) )
+      {
+        modeEntry = batch.add( { BitBangCommands::enterOpenOCD }, BitBangCommands::openOCDSuccess.size(), false );
+      }
+
+      if ( inJTAGMode || batch.size() )
+      {
+        /*------------------------------------------------
+        Switch the regulator on first, together with any mode switch, and give the
+        target its power-up delay before a single pin is driven
+        ------------------------------------------------*/
+        batch.add( { CMD_FEATURE, FEATURE_VREG, ACTION_ENABLE }, 0, false );
+        result = busPirate.execute( batch );
+
+        if ( !inJTAGMode )
+        {
+          const std::string &expected = BitBangCommands::openOCDSuccess;
+          auto reply                  = batch.reply( modeEntry );
+
+          if ( ( reply.length == expected.size() ) && std::equal( expected.begin(), expected.end(), reply.data ) )
+          {
+            busPirate.state->currentMode = OperationalModes::BP_MODE_JTAG_BIT_BANG;
+          }
+          else
+          {
+            result |= Status::FAIL;
+          }
+        }
+
+        if ( ( result == Status::OK ) && powerUpDelay_mS )
+        {
+          Chimera::delayMilliseconds( powerUpDelay_mS );
+        }
+
+        /*------------------------------------------------
+        Configure the pins, then clock the TAP into Test-Logic-Reset so its state is
+        known from here on
+        ------------------------------------------------*/
+        const uint8_t portMode  = setupStruct.openDrain ? PORT_MODE_JTAG_OD : PORT_MODE_JTAG;
+        const uint8_t pullups   = setupStruct.pullups ? ACTION_ENABLE : ACTION_DISABLE;
+        const uint8_t resetBits = static_cast<uint8_t>( ( 1u << RESET_CLOCKS ) - 1 );
+
+        batch.clear();
+        batch.add( { CMD_PORT_MODE, portMode }, 0, false );
+        batch.add( { CMD_FEATURE, FEATURE_PULLUP, pullups }, 0, false );
+        const size_t resetEntry = batch.add( { CMD_TAP_SHIFT, 0, RESET_CLOCKS, 0x00, resetBits }, TAP_SHIFT_HEADER + 1, false );
+
+        if ( result == Status::OK )
+        {
+          result = busPirate.execute( batch );
+
+          auto reply = batch.reply( resetEntry );
+          if ( ( result == Status::OK ) && ( ( reply.data[ 0 ] != CMD_TAP_SHIFT ) || ( reply.data[ 2 ] != RESET_CLOCKS ) ) )
+          {
+            result = Status::FAIL;
+          }
+        }
+
+        tapState = TAP_RESET;
+      }
+
+      if ( result == Status::OK )
+      {
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed JTAG initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryJTAG::deInit() noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      busPirate.close();
+      result            = Status::OK;
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryJTAG::run( JTAGSequence &sequence ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      Chimera::Status_t result = compile( sequence );
+
+      if ( result == Status::OK )
+      {
+        result = busPirate.execute( sequence.batch );
+      }
+
+      if ( result == Status::OK )
+      {
+        result = collectResults( sequence );
+      }
+
+      if ( result == Status::OK )
+      {
+        tapState = sequence.compiledTo;
+      }
+      else if ( sequence.compiled )
+      {
+        /*------------------------------------------------
+        There's no telling how far the TAP got, so put it somewhere known
+        ------------------------------------------------*/
+        JTAGSequence recovery;
+        recovery.reset();
+
+        if ( ( compile( recovery ) == Status::OK ) && ( busPirate.execute( recovery.batch ) == Status::OK ) )
+        {
+          tapState = TAP_RESET;
+        }
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryJTAG::compile( JTAGSequence &sequence ) noexcept
+    {
+      using Op = JTAGSequence::Op;
+
+      if ( !sequence.valid )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( sequence.compiled && ( sequence.compiledFrom == tapState ) )
+      {
+        return Status::OK;
+      }
+
+      /*------------------------------------------------
+      Flatten the sequence into one TMS/TDI bit stream, tracking the TAP state so
+      every move takes the shortest path from wherever the last step left it
+      ------------------------------------------------*/
+      const auto &paths = tmsPaths();
+      std::vector<bool> tms;
+      std::vector<bool> tdi;
+      TAPState state = tapState;
+
+      sequence.captures.clear();
+
+      auto clock = [ & ]( const bool tmsBit, const bool tdiBit ) {
+        tms.push_back( tmsBit );
+        tdi.push_back( tdiBit );
+      };
+
+      auto moveTo = [ & ]( const TAPState target ) {
+        const auto &path = paths[ state ][ target ];
+
+        for ( size_t x = 0; x < path.length; x++ )
+        {
+          clock( ( path.bits >> x ) & 0x01, false );
+        }
+
+        state = target;
+      };
+
+      for ( const auto &step : sequence.steps )
+      {
+        switch ( step.op )
+        {
+          case Op::RESET:
+            for ( size_t x = 0; x < RESET_CLOCKS; x++ )
+            {
+              clock( true, false );
+            }
+            state = TAP_RESET;
+            break;
+
+          case Op::GOTO:
+            moveTo( step.state );
+            break;
+
+          case Op::IDLE:
+            moveTo( TAP_IDLE );
+            for ( size_t x = 0; x < step.count; x++ )
+            {
+              clock( false, false );
+            }
+            break;
+
+          case Op::SCAN_IR:
+          case Op::SCAN_DR:
+          {
+            const bool ir         = ( step.op == Op::SCAN_IR );
+            const TAPState shift  = ir ? TAP_IR_SHIFT : TAP_DR_SHIFT;
+            const TAPState exit1  = ir ? TAP_IR_EXIT1 : TAP_DR_EXIT1;
+            const bool leaveShift = ( step.state != shift );
+            const uint8_t *data   = sequence.tdiData.data() + step.offset;
+
+            moveTo( shift );
+
+            if ( step.capture )
+            {
+              sequence.captures.push_back( { tms.size(), step.count } );
+            }
+
+            /*------------------------------------------------
+            The last bit goes with TMS high to leave the shift state, unless the scan
+            is to be continued by the next one
+            ------------------------------------------------*/
+            for ( size_t x = 0; x < step.count; x++ )
+            {
+              clock( leaveShift && ( x + 1 == step.count ), getBit( data, x ) );
+            }
+
+            if ( leaveShift )
+            {
+              state = exit1;
+              moveTo( step.state );
+            }
+          }
+          break;
+        }
+      }
+
+      /*------------------------------------------------
+      Pack the bit stream into as few shift commands as will hold it
+      ------------------------------------------------*/
+      auto &batch = sequence.batch;
+      batch.clear();
+
+      std::vector<uint8_t> cmd;
+
+      for ( size_t first = 0; first < tms.size(); first += TAP_SHIFT_MAX_BITS )
+      {
+        const size_t count = std::min( tms.size() - first, TAP_SHIFT_MAX_BITS );
+        const size_t bytes = ( count + 7 ) / 8;
+
+        cmd.assign( { CMD_TAP_SHIFT, static_cast<uint8_t>( count >> 8 ), static_cast<uint8_t>( count ) } );
+
+        for ( size_t x = 0; x < bytes; x++ )
+        {
+          uint8_t tdiByte = 0;
+          uint8_t tmsByte = 0;
+
+          for ( size_t bit = 0; ( bit < 8 ) && ( 8 * x + bit < count ); bit++ )
+          {
+            tdiByte |= static_cast<uint8_t>( tdi[ first + 8 * x + bit ] << bit );
+            tmsByte |= static_cast<uint8_t>( tms[ first + 8 * x + bit ] << bit );
+          }
+
+          cmd.push_back( tdiByte );
+          cmd.push_back( tmsByte );
+        }
+
+        batch.add( cmd, TAP_SHIFT_HEADER + bytes, false );
+      }
+
+      sequence.clocks       = tms.size();
+      sequence.compiledFrom = tapState;
+      sequence.compiledTo   = state;
+      sequence.compiled     = true;
+
+      return Status::OK;
+    }
+
+    Chimera::Status_t BinaryJTAG::detectChain( std::vector<uint32_t> &idcodes ) noexcept
+    {
+      /*------------------------------------------------
+      Reset loads IDCODE, or BYPASS for devices without one, into every data register.
+      Shifting ones through the chain pushes them all out, followed by the ones.
+      ------------------------------------------------*/
+      const size_t bits = ( MAX_CHAIN_DEVICES + 1 ) * IDCODE_BITS;
+      const std::vector<uint8_t> ones( bits / 8, 0xFF );
+
+      JTAGSequence sequence;
+      sequence.reset().scanDR( ones.data(), bits, true );
+
+      idcodes.clear();
+      Chimera::Status_t result = run( sequence );
+
+      if ( result != Status::OK )
+      {
+        return result;
+      }
+
+      /*------------------------------------------------
+      An IDCODE always has bit 0 set and BYPASS captures a 0
+      ------------------------------------------------*/
+      const uint8_t *const tdo = sequence.results()[ 0 ].data();
+      size_t offset            = 0;
+
+      while ( offset < bits )
+      {
+        if ( !getBit( tdo, offset ) )
+        {
+          idcodes.push_back( 0 );
+          offset++;
+          continue;
+        }
+
+        if ( offset + IDCODE_BITS > bits )
+        {
+          break;
+        }
+
+        uint32_t idcode = 0;
+        for ( size_t x = 0; x < IDCODE_BITS; x++ )
+        {
+          idcode |= static_cast<uint32_t>( getBit( tdo, offset + x ) ) << x;
+        }
+
+        if ( idcode == IDCODE_NONE )
+        {
+          break;
+        }
+
+        idcodes.push_back( idcode );
+        offset += IDCODE_BITS;
+      }
+
+      if ( idcodes.size() > MAX_CHAIN_DEVICES )
+      {
+        spdlog::error( "JTAG chain is broken or longer than {} devices", MAX_CHAIN_DEVICES );
+        result = Status::FAIL;
+      }
+
+      return result;
+    }
+
+    TAPState BinaryJTAG::getState() const noexcept
+    {
+      return tapState;
+    }
+
+    Chimera::Status_t BinaryJTAG::cfgPowerSupplies( const bool state )
+    {
+      return configure( { CMD_FEATURE, FEATURE_VREG, state ? ACTION_ENABLE : ACTION_DISABLE } );
+    }
+
+    Chimera::Status_t BinaryJTAG::cfgPullups( const bool state )
+    {
+      return configure( { CMD_FEATURE, FEATURE_PULLUP, state ? ACTION_ENABLE : ACTION_DISABLE } );
+    }
+
+    Chimera::Status_t BinaryJTAG::cfgOpenDrain( const bool openDrain )
+    {
+      return configure( { CMD_PORT_MODE, openDrain ? PORT_MODE_JTAG_OD : PORT_MODE_JTAG } );
+    }
+
+    Chimera::Status_t BinaryJTAG::cfgTRST( const bool asserted )
+    {
+      /*------------------------------------------------
+      The reset lines are active low, so asserting one switches its output off
+      ------------------------------------------------*/
+      Chimera::Status_t result = configure( { CMD_FEATURE, FEATURE_TRST, asserted ? ACTION_DISABLE : ACTION_ENABLE } );
+
+      if ( ( result == Status::OK ) && asserted )
+      {
+        tapState = TAP_RESET;
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryJTAG::cfgSRST( const bool asserted )
+    {
+      return configure( { CMD_FEATURE, FEATURE_SRST, asserted ? ACTION_DISABLE : ACTION_ENABLE } );
+    }
+
+    void BinaryJTAG::setPowerUpDelay( const uint32_t delay_mS )
+    {
+      powerUpDelay_mS = delay_mS;
+    }
+
+    Chimera::Status_t BinaryJTAG::configure( const std::vector<uint8_t> &cmd )
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      CommandBatch batch;
+      batch.add( cmd, 0, false );
+
+      return busPirate.execute( batch );
+    }
+
+    Chimera::Status_t BinaryJTAG::collectResults( JTAGSequence &sequence )
+    {
+      const auto &batch = sequence.batch;
+
+      /*------------------------------------------------
+      Every reply repeats its command's bit count ahead of the TDO bytes
+      ------------------------------------------------*/
+      for ( size_t x = 0; x < batch.size(); x++ )
+      {
+        const size_t count = std::min( sequence.clocks - x * TAP_SHIFT_MAX_BITS, TAP_SHIFT_MAX_BITS );
+        auto reply         = batch.reply( x );
+
+        if ( ( reply.data[ 0 ] != CMD_TAP_SHIFT ) || ( reply.data[ 1 ] != static_cast<uint8_t>( count >> 8 ) ) ||
+             ( reply.data[ 2 ] != static_cast<uint8_t>( count ) ) )
+        {
+          spdlog::error( "Unexpected reply to a JTAG shift" );
+          return Status::FAIL;
+        }
+      }
+
+      sequence.scanResults.clear();
+
+      for ( const auto &capture : sequence.captures )
+      {
+        std::vector<uint8_t> bytes( ( capture.bits + 7 ) / 8, 0 );
+
+        for ( size_t x = 0; x < capture.bits; x++ )
+        {
+          const size_t bit = capture.offset + x;
+          auto reply       = batch.reply( bit / TAP_SHIFT_MAX_BITS );
+
+          if ( getBit( reply.data + TAP_SHIFT_HEADER, bit % TAP_SHIFT_MAX_BITS ) )
+          {
+            bytes[ x / 8 ] |= static_cast<uint8_t>( 1u << ( x % 8 ) );
+          }
+        }
+
+        sequence.scanResults.push_back( std::move( bytes ) );
+      }
+
+      return Status::OK;
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
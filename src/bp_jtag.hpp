@@ -0,0 +1,371 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_jtag.hpp
+ *
+ *   Description:
+ *       Provides a JTAG interface through the Bus Pirate's binary OpenOCD mode.
+ *       Follows the conventions of the Chimera HAL drivers.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_JTAG_DRIVER_HPP
+#define BUS_PIRATE_CPP_JTAG_DRIVER_HPP
+
+/* C++ Includes */
+#include <memory>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  States of the JTAG TAP controller
+     */
+    enum TAPState : uint8_t
+    {
+      TAP_RESET = 0,
+      TAP_IDLE,
+      TAP_DR_SELECT,
+      TAP_DR_CAPTURE,
+      TAP_DR_SHIFT,
+      TAP_DR_EXIT1,
+      TAP_DR_PAUSE,
+      TAP_DR_EXIT2,
+      TAP_DR_UPDATE,
+      TAP_IR_SELECT,
+      TAP_IR_CAPTURE,
+      TAP_IR_SHIFT,
+      TAP_IR_EXIT1,
+      TAP_IR_PAUSE,
+      TAP_IR_EXIT2,
+      TAP_IR_UPDATE,
+
+      TAP_NUM_STATES
+    };
+
+    /**
+     *  Settings applied by BinaryJTAG::init()
+     */
+    struct JTAGSetup
+    {
+      bool openDrain; /**< Drive the pins open drain (true) or at 3.3V (false) */
+      bool pullups;   /**< Enables the on-board pullups, which need a supply on the Vpu pin */
+
+      JTAGSetup()
+      {
+        openDrain = false;
+        pullups   = false;
+      }
+    };
+
+    /**
+     *  A list of TAP operations, built up by chaining calls and then handed to
+     *  BinaryJTAG::run(). Scans and state changes only say where the TAP has to end up;
+     *  the driver tracks the TAP state and works out the TMS path to get there.
+     *
+     *  Scan data is LSB first: bit 0 of the first byte is the first bit shifted in on
+     *  TDI, and likewise for the captured TDO bits.
+     *
+     *  The sequence keeps its compiled form, so running it again costs nothing to
+     *  prepare unless it was changed or the TAP starts in a different state.
+     */
+    class JTAGSequence
+    {
+    public:
+      JTAGSequence()  = default;
+      ~JTAGSequence() = default;
+
+      /**
+       *  Forces the TAP into Test-Logic-Reset with TMS held high, whatever state it was in
+       */
+      JTAGSequence &reset();
+
+      /**
+       *  Moves the TAP to a stable state along the shortest path
+       *
+       *  @param[in]  state     Run-Test/Idle, Test-Logic-Reset, or a shift or pause state
+       */
+      JTAGSequence &goTo( const TAPState state );
+
+      /**
+       *  Clocks the TAP in Run-Test/Idle
+       *
+       *  @param[in]  cycles    Number of clock cycles
+       */
+      JTAGSequence &idle( const size_t cycles );
+
+      /**
+       *  Shifts data through the instruction register chain
+       *
+       *  @param[in]  tdi       Bits to shift in
+       *  @param[in]  bits      Number of bits
+       *  @param[in]  capture   Keep the bits shifted out, adding them to results()
+       *  @param[in]  end       Stable state to leave the TAP in
+       */
+      JTAGSequence &scanIR( const uint8_t *const tdi, const size_t bits, const bool capture = false, const TAPState end = TAP_IDLE );
+
+      /**
+       *  Shifts up to 64 bits through the instruction register chain
+       */
+      JTAGSequence &scanIRBits( const uint64_t tdi, const size_t bits, const bool capture = false, const TAPState end = TAP_IDLE );
+
+      /**
+       *  Shifts data through the data register chain
+       *
+       *  @param[in]  tdi       Bits to shift in
+       *  @param[in]  bits      Number of bits
+       *  @param[in]  capture   Keep the bits shifted out, adding them to results()
+       *  @param[in]  end       Stable state to leave the TAP in
+       */
+      JTAGSequence &scanDR( const uint8_t *const tdi, const size_t bits, const bool capture = false, const TAPState end = TAP_IDLE );
+
+      /**
+       *  Shifts up to 64 bits through the data register chain
+       */
+      JTAGSequence &scanDRBits( const uint64_t tdi, const size_t bits, const bool capture = false, const TAPState end = TAP_IDLE );
+
+      /**
+       *	Removes every step and result
+       *
+       *	@return void
+       */
+      void clear();
+
+      bool empty() const;
+
+      /**
+       *	Bits captured by each scan that asked for them, in the order the scans were made
+       *
+       *	@return const std::vector<std::vector<uint8_t>>&
+       */
+      const std::vector<std::vector<uint8_t>> &results() const;
+
+      /**
+       *	Up to the first 64 bits of a captured scan
+       *
+       *	@param[in]	index         Which captured scan, in the order they were made
+       *	@return uint64_t
+       */
+      uint64_t result( const size_t index ) const;
+
+      /**
+       *	Size of the compiled command stream, 0 if the sequence hasn't been compiled
+       *
+       *	@return size_t
+       */
+      size_t txBytes() const;
+
+      /**
+       *	Number of TCK cycles the compiled sequence takes, 0 if it hasn't been compiled
+       *
+       *	@return size_t
+       */
+      size_t clockCycles() const;
+
+    private:
+      friend class BinaryJTAG;
+
+      enum class Op : uint8_t
+      {
+        RESET,
+        GOTO,
+        IDLE,
+        SCAN_IR,
+        SCAN_DR
+      };
+
+      struct Step
+      {
+        Op op;
+        TAPState state; /**< Target or end state */
+        size_t offset;  /**< Offset into tdiData */
+        size_t count;   /**< Bits or cycles */
+        bool capture;
+      };
+
+      /**
+       *  Where a captured scan's bits are in the TDO stream
+       */
+      struct Capture
+      {
+        size_t offset;
+        size_t bits;
+      };
+
+      std::vector<Step> steps;
+      std::vector<uint8_t> tdiData;
+      bool valid = true;
+
+      std::vector<std::vector<uint8_t>> scanResults;
+
+      /*------------------------------------------------
+      Compiled form
+      ------------------------------------------------*/
+      bool compiled = false;
+      TAPState compiledFrom;
+      TAPState compiledTo;
+      CommandBatch batch;
+      std::vector<Capture> captures;
+      size_t clocks = 0;
+
+      JTAGSequence &scan( const Op op, const uint8_t *const tdi, const size_t bits, const bool capture, const TAPState end );
+
+      JTAGSequence &add( const Op op, const TAPState state, const size_t offset = 0, const size_t count = 0, const bool capture = false );
+    };
+
+    class BinaryJTAG;
+    using BinaryJTAG_sPtr = std::shared_ptr<BinaryJTAG>;
+    using BinaryJTAG_uPtr = std::unique_ptr<BinaryJTAG>;
+
+    /**
+     *  JTAG master using the Bus Pirate's OpenOCD mode, in which one command shifts
+     *  thousands of TMS and TDI bits and returns the TDO bits for them. A JTAGSequence
+     *  is flattened into a single TMS/TDI bit stream, with the TAP moved between scans
+     *  along the shortest TMS paths, and packed into as few of those commands as will
+     *  hold it. The whole stream goes out in one pipelined write, so boundary scan
+     *  sweeps and device programming run at link speed rather than a round trip per
+     *  scan.
+     */
+    class BinaryJTAG
+    {
+    public:
+      /**
+       *  Primary constructor for creating the JTAG interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      BinaryJTAG( Device &device );
+
+      BinaryJTAG()  = default;
+      ~BinaryJTAG() = default;
+
+      /**
+       *  Enters OpenOCD mode, powers the target and resets the TAP. All of it is one
+       *  round trip.
+       */
+      Chimera::Status_t init( const JTAGSetup &setupStruct ) noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Runs a sequence, compiling it first if needed. The captured bits are available
+       *  from the sequence afterwards.
+       *
+       *	@param[in]	sequence      Sequence to run
+       *	@return Chimera::Status_t: INVAL_FUNC_PARAM if a step was given bad arguments
+       */
+      Chimera::Status_t run( JTAGSequence &sequence ) noexcept;
+
+      /**
+       *	Flattens a sequence into commands, starting from the current TAP state, without
+       *  sending anything. run() does this itself when needed.
+       *
+       *	@param[in]	sequence      Sequence to compile
+       *	@return Chimera::Status_t: INVAL_FUNC_PARAM if a step was given bad arguments
+       */
+      Chimera::Status_t compile( JTAGSequence &sequence ) noexcept;
+
+      /**
+       *	Resets the TAP and reads the IDCODE of every device on the chain. Devices
+       *  that reset to BYPASS instead of IDCODE are listed as 0.
+       *
+       *	@param[out]	idcodes       Receives the IDCODEs, the device closest to TDO first
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t detectChain( std::vector<uint32_t> &idcodes ) noexcept;
+
+      /**
+       *	The state the TAP was left in by the last sequence
+       *
+       *	@return TAPState
+       */
+      TAPState getState() const noexcept;
+
+      /**
+       *	Enables or disables the on-board power supplies
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPowerSupplies( const bool state );
+
+      /**
+       *	Enables or disables the pullups on the bus pins
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPullups( const bool state );
+
+      /**
+       *	Selects how the pins are driven
+       *
+       *	@param[in]	openDrain     Open drain (true) or 3.3V (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgOpenDrain( const bool openDrain );
+
+      /**
+       *	Drives the TAP reset line. Asserting it puts the TAP in Test-Logic-Reset.
+       *
+       *	@param[in]	asserted      Held in reset (true), released (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgTRST( const bool asserted );
+
+      /**
+       *	Drives the system reset line
+       *
+       *	@param[in]	asserted      Held in reset (true), released (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgSRST( const bool asserted );
+
+      /**
+       *	Sets how long init() waits for the target to settle after switching the
+       *  power supplies on
+       *
+       *	@param[in]	delay_mS      Settling time in milliseconds, 0 to skip it
+       *	@return void
+       */
+      void setPowerUpDelay( const uint32_t delay_mS );
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized;
+      uint32_t powerUpDelay_mS;
+      TAPState tapState;
+
+      /**
+       *	Sends one of the mode's configuration commands, which aren't answered
+       *
+       *	@param[in]	cmd           Command bytes
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t configure( const std::vector<uint8_t> &cmd );
+
+      /**
+       *	Splits the TDO bits of a run back out to the scans of its sequence
+       *
+       *	@param[in]	sequence      Sequence that was just run
+       *	@return Chimera::Status_t: FAIL if a reply wasn't for the command sent
+       */
+      Chimera::Status_t collectResults( JTAGSequence &sequence );
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_JTAG_DRIVER_HPP */
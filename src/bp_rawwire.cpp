@@ -0,0 +1,784 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_rawwire.cpp
+ *
+ *   Description:
+ *       Implements the raw-wire interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_rawwire.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Pin Control Commands, each answered with 0x01
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_START      = 0x02;
+    static constexpr uint8_t CMD_STOP       = 0x03;
+    static constexpr uint8_t CMD_CS_LOW     = 0x04;
+    static constexpr uint8_t CMD_CS_HIGH    = 0x05;
+    static constexpr uint8_t CMD_CLOCK_LOW  = 0x0A;
+    static constexpr uint8_t CMD_CLOCK_HIGH = 0x0B;
+    static constexpr uint8_t CMD_DATA_LOW   = 0x0C;
+    static constexpr uint8_t CMD_DATA_HIGH  = 0x0D;
+
+    /*------------------------------------------------
+    Indexed by RawWireSequence::Op, which lists the pin steps first in this order
+    ------------------------------------------------*/
+    static constexpr std::array<uint8_t, 8> pinCommands = { CMD_START,     CMD_STOP,       CMD_CS_LOW,   CMD_CS_HIGH,
+                                                            CMD_CLOCK_LOW, CMD_CLOCK_HIGH, CMD_DATA_LOW, CMD_DATA_HIGH };
+
+    /*------------------------------------------------
+    Read Commands. Answered with the byte read, or with 0x00/0x01 for a single bit.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_READ_BYTE = 0x06;
+    static constexpr uint8_t CMD_READ_BIT  = 0x07;
+    static constexpr uint8_t CMD_PEEK      = 0x08;
+
+    /*------------------------------------------------
+    Bulk Commands. A bulk write is answered with 0x01 for the command, then for each
+    byte the byte clocked in (3-wire) or 0x01 (2-wire). Bulk bits shifts out the top
+    bits of the byte that follows and answers 0x01 to both. Bulk ticks answers 0x01.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_BULK_WRITE      = 0x10;
+    static constexpr uint8_t CMD_BULK_TICKS      = 0x20;
+    static constexpr uint8_t CMD_BULK_BITS       = 0x30;
+    static constexpr uint8_t MSK_BULK_COUNT      = 0x0F;
+    static constexpr size_t BULK_WRITE_MAX_LEN   = 16;
+    static constexpr size_t BULK_TICKS_MAX_COUNT = 16;
+
+    /*------------------------------------------------
+    Board Configuration Options
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_PERIPH     = 0x40;
+    static constexpr uint8_t MSK_CFG_PERIPH     = 0x0F;
+    static constexpr uint8_t CFG_PERIPH_POWER   = ( 1u << 3 );
+    static constexpr uint8_t CFG_PERIPH_PULLUP  = ( 1u << 2 );
+    static constexpr uint8_t CFG_PERIPH_AUX_PIN = ( 1u << 1 );
+    static constexpr uint8_t CFG_PERIPH_CS_PIN  = ( 1u << 0 );
+
+    static constexpr uint8_t CMD_CFG_SPEED = 0x60;
+    static constexpr uint8_t MSK_CFG_SPEED = 0x03;
+
+    static constexpr std::array<uint32_t, 4> sortedWireSpeeds = { RAW_WIRE_SPEED_5kHz, RAW_WIRE_SPEED_50kHz,
+                                                                  RAW_WIRE_SPEED_100kHz, RAW_WIRE_SPEED_400kHz };
+
+    static constexpr uint8_t CMD_CFG_WIRE        = 0x80;
+    static constexpr uint8_t MSK_CFG_WIRE        = 0x0E;
+    static constexpr uint8_t CFG_WIRE_PIN_OUTPUT = ( 1u << 3 );
+    static constexpr uint8_t CFG_WIRE_3WIRE      = ( 1u << 2 );
+    static constexpr uint8_t CFG_WIRE_LSB_FIRST  = ( 1u << 1 );
+
+    /*------------------------------------------------
+    Widest field readBits() and writeBits() take
+    ------------------------------------------------*/
+    static constexpr size_t MAX_FIELD_BITS = 32;
+
+    /*------------------------------------------------
+    How long to let the target settle after the supplies switch on
+    ------------------------------------------------*/
+    static constexpr uint32_t DEFAULT_POWER_UP_DELAY_MS = 100;
+
+    /*------------------------------------------------
+    Converts between bytes and the order their bits appear on the wire
+    ------------------------------------------------*/
+    static void appendWireBits( std::vector<bool> &wire, const uint32_t value, const size_t count, const bool lsbFirst )
+    {
+      for ( size_t x = 0; x < count; x++ )
+      {
+        const size_t bit = lsbFirst ? x : ( count - 1 - x );
+        wire.push_back( ( value >> bit ) & 0x01 );
+      }
+    }
+
+    static uint32_t fromWireBits( const std::vector<bool> &wire, const size_t offset, const size_t count, const bool lsbFirst )
+    {
+      uint32_t value = 0;
+
+      for ( size_t x = 0; x < count; x++ )
+      {
+        const size_t bit = lsbFirst ? x : ( count - 1 - x );
+        value |= static_cast<uint32_t>( wire[ offset + x ] ) << bit;
+      }
+
+      return value;
+    }
+
+    /*-------------------------------------------------------------------------------
+    RawWireSequence
+    -------------------------------------------------------------------------------*/
+    RawWireSequence &RawWireSequence::start()
+    {
+      return add( Op::START );
+    }
+
+    RawWireSequence &RawWireSequence::stop()
+    {
+      return add( Op::STOP );
+    }
+
+    RawWireSequence &RawWireSequence::chipSelect( const bool level )
+    {
+      return add( level ? Op::CS_HIGH : Op::CS_LOW );
+    }
+
+    RawWireSequence &RawWireSequence::clockLevel( const bool level )
+    {
+      return add( level ? Op::CLOCK_HIGH : Op::CLOCK_LOW );
+    }
+
+    RawWireSequence &RawWireSequence::dataLevel( const bool level )
+    {
+      return add( level ? Op::DATA_HIGH : Op::DATA_LOW );
+    }
+
+    RawWireSequence &RawWireSequence::tick( const size_t count )
+    {
+      valid &= ( count > 0 );
+      return add( Op::TICK, 0, count );
+    }
+
+    RawWireSequence &RawWireSequence::writeBits( const uint32_t value, const size_t count )
+    {
+      valid &= ( count > 0 ) && ( count <= MAX_FIELD_BITS );
+      return add( Op::WRITE_BITS, value, count );
+    }
+
+    RawWireSequence &RawWireSequence::writeBytes( const uint8_t *const data, const size_t length )
+    {
+      if ( !data || !length )
+      {
+        valid = false;
+        return *this;
+      }
+
+      const auto offset = static_cast<uint32_t>( writeData.size() );
+      writeData.insert( writeData.end(), data, data + length );
+
+      return add( Op::WRITE_BYTES, offset, length );
+    }
+
+    RawWireSequence &RawWireSequence::readBits( const size_t count )
+    {
+      valid &= ( count > 0 ) && ( count <= MAX_FIELD_BITS );
+      return add( Op::READ_BITS, 0, count );
+    }
+
+    RawWireSequence &RawWireSequence::readBytes( const size_t length )
+    {
+      valid &= ( length > 0 );
+      return add( Op::READ_BYTES, 0, length );
+    }
+
+    RawWireSequence &RawWireSequence::peek()
+    {
+      return add( Op::PEEK, 0, 1 );
+    }
+
+    void RawWireSequence::clear()
+    {
+      steps.clear();
+      writeData.clear();
+      bitResults.clear();
+      byteResults.clear();
+      batch.clear();
+      captures.clear();
+      ackedReplies.clear();
+
+      valid          = true;
+      compiled       = false;
+      busBitsPerByte = 0;
+    }
+
+    bool RawWireSequence::empty() const
+    {
+      return steps.empty();
+    }
+
+    const std::vector<uint32_t> &RawWireSequence::bits() const
+    {
+      return bitResults;
+    }
+
+    const std::vector<uint8_t> &RawWireSequence::bytes() const
+    {
+      return byteResults;
+    }
+
+    size_t RawWireSequence::txBytes() const
+    {
+      return compiled ? batch.txBytes() : 0;
+    }
+
+    RawWireSequence &RawWireSequence::add( const Op op, const uint32_t value, const size_t count )
+    {
+      steps.push_back( { op, value, count } );
+      compiled = false;
+
+      return *this;
+    }
+
+    /*-------------------------------------------------------------------------------
+    BinaryRawWire
+    -------------------------------------------------------------------------------*/
+    BinaryRawWire::BinaryRawWire( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+
+      /*------------------------------------------------
+      Initialize the virtual registers
+      ------------------------------------------------*/
+      reg_PeriphCfg = { CMD_CFG_PERIPH, MSK_CFG_PERIPH, 0, 0, false };
+      reg_WireSpeed = { CMD_CFG_SPEED, MSK_CFG_SPEED, 0, 0, false };
+      reg_WireCfg   = { CMD_CFG_WIRE, MSK_CFG_WIRE, 0, 0, false };
+      stagingConfig = false;
+
+      powerUpDelay_mS = DEFAULT_POWER_UP_DELAY_MS;
+    }
+
+    Chimera::Status_t BinaryRawWire::init( const RawWireSetup &setupStruct ) noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      CommandBatch batch;
+      size_t entry = 0;
+
+      /*------------------------------------------------
+      Skip the mode switch if the board is already in raw-wire mode, otherwise queue
+      it up to go out together with the configuration
+      ------------------------------------------------*/
+      bool inRawWireMode =
+          ( busPirate.state->currentMode == OperationalModes::BP_MODE_RAW_WIRE_BIT_BANG ) && busPirate.resyncFraming();
+
+      if ( !inRawWireMode
+           && ( ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) || busPirate.bbInit() ) )
+      {
+        entry = batch.add( { BitBangCommands::enterRawWire }, BitBangCommands::rawWireSuccess.size(), false );
+
+        /*------------------------------------------------
+        Entering raw-wire mode resets the firmware's configuration
+        ------------------------------------------------*/
+        invalidateShadowRegisters( { &reg_PeriphCfg, &reg_WireSpeed, &reg_WireCfg } );
+      }
+
+      if ( inRawWireMode || batch.size() )
+      {
+        const bool powered  = reg_PeriphCfg.valid && ( reg_PeriphCfg.applied & CFG_PERIPH_POWER );
+        bool entryConfirmed = inRawWireMode;
+
+        /*------------------------------------------------
+        The mode switch answers once whichever batch carries it has gone out
+        ------------------------------------------------*/
+        auto confirmEntry = [ this, &batch, &entry, &entryConfirmed ]() -> Chimera::Status_t {
+          if ( entryConfirmed )
+          {
+            return Status::OK;
+          }
+
+          const std::string &expected = BitBangCommands::rawWireSuccess;
+          auto reply                  = batch.reply( entry );
+
+          entryConfirmed = true;
+          if ( ( reply.length == expected.size() ) && std::equal( expected.begin(), expected.end(), reply.data ) )
+          {
+            busPirate.state->currentMode = OperationalModes::BP_MODE_RAW_WIRE_BIT_BANG;
+            return Status::OK;
+          }
+
+          return Status::FAIL;
+        };
+
+        stageConfig();
+
+        /*------------------------------------------------
+        Switching the supplies on goes out first and gets its delay, so the pin drivers
+        and pull-ups set up below only ever see a powered target
+        ------------------------------------------------*/
+        result = cfgPowerSupplies( true );
+
+        if ( !powered && powerUpDelay_mS )
+        {
+          result |= commitConfig( batch );
+          result |= confirmEntry();
+          batch.clear();
+
+          if ( reg_PeriphCfg.applied & CFG_PERIPH_POWER )
+          {
+            Chimera::delayMilliseconds( powerUpDelay_mS );
+          }
+
+          stageConfig();
+        }
+
+        result |= cfgPullups( setupStruct.pullups );
+        result |= cfgPinOutput( setupStruct.pinOutput );
+        result |= cfgThreeWire( setupStruct.threeWire );
+        result |= cfgBitOrder( setupStruct.lsbFirst );
+        result |= setClockFrequency( setupStruct.clockFrequency, 0 );
+        result |= commitConfig( batch );
+        result |= confirmEntry();
+      }
+
+      if ( result == Status::OK )
+      {
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed raw-wire initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryRawWire::deInit() noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      busPirate.close();
+      result            = Status::OK;
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryRawWire::run( RawWireSequence &sequence ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      Chimera::Status_t result = compile( sequence );
+
+      if ( result == Status::OK )
+      {
+        result = busPirate.stream( sequence.batch, streamWindow( sequence ) );
+      }
+
+      for ( size_t x = 0; ( x < sequence.ackedReplies.size() ) && ( result == Status::OK ); x++ )
+      {
+        auto reply = sequence.batch.reply( sequence.ackedReplies[ x ] );
+
+        if ( std::any_of( reply.data, reply.data + reply.length, []( uint8_t ack ) { return ack != BitBangCommands::success; } ) )
+        {
+          result = Status::FAIL;
+        }
+      }
+
+      if ( result == Status::OK )
+      {
+        collectResults( sequence );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryRawWire::compile( RawWireSequence &sequence ) noexcept
+    {
+      using Op = RawWireSequence::Op;
+
+      if ( !sequence.valid )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      const uint8_t format = reg_WireCfg.applied;
+
+      if ( sequence.compiled && ( sequence.compiledFormat == format ) )
+      {
+        return Status::OK;
+      }
+
+      const bool threeWire = format & CFG_WIRE_3WIRE;
+      const bool lsbFirst  = format & CFG_WIRE_LSB_FIRST;
+
+      auto &batch = sequence.batch;
+      batch.clear();
+      sequence.captures.clear();
+      sequence.ackedReplies.clear();
+      sequence.busBitsPerByte = 0;
+
+      auto queue = [ & ]( const std::vector<uint8_t> &cmd, const size_t busBits, const bool expectAck ) {
+        sequence.busBitsPerByte = std::max( sequence.busBitsPerByte, ( busBits + cmd.size() - 1 ) / cmd.size() );
+        return batch.add( cmd, cmd.size(), expectAck );
+      };
+
+      /*------------------------------------------------
+      Runs of clock ticks, and of bits written and read, are held back and merged, then
+      packed into as few command bytes as will carry them. Bits to read are held as
+      ones, which leaves an open drain data pin released while they are clocked in.
+      ------------------------------------------------*/
+      std::vector<bool> pendingBits;
+      std::vector<bool> pendingReads;
+      size_t pendingTicks = 0;
+      std::vector<uint8_t> cmd;
+
+      auto flushTicks = [ & ]() {
+        while ( pendingTicks )
+        {
+          const size_t count = std::min( pendingTicks, BULK_TICKS_MAX_COUNT );
+          queue( { static_cast<uint8_t>( CMD_BULK_TICKS | ( count - 1 ) ) }, count, true );
+          pendingTicks -= count;
+        }
+      };
+
+      auto flushBits = [ & ]() {
+        const size_t total = pendingBits.size();
+        size_t offset      = 0;
+
+        /*------------------------------------------------
+        Whole bytes go out as bulk writes, in the configured bit order. In 3-wire mode
+        each one clocks in a byte too, so reads ride along with the writes around them.
+        2-wire mode has no data input and reads a byte at a time.
+        ------------------------------------------------*/
+        while ( total - offset >= 8 )
+        {
+          if ( !threeWire && pendingReads[ offset ] )
+          {
+            sequence.captures.push_back( { queue( { CMD_READ_BYTE }, 8, false ), 0, 0xFF, true } );
+            offset += 8;
+            continue;
+          }
+
+          const size_t length = std::min( BULK_WRITE_MAX_LEN, ( total - offset ) / 8 );
+          const size_t first  = offset;
+
+          cmd.assign( 1, static_cast<uint8_t>( CMD_BULK_WRITE | ( ( length - 1 ) & MSK_BULK_COUNT ) ) );
+          for ( size_t x = 0; x < length; x++, offset += 8 )
+          {
+            cmd.push_back( static_cast<uint8_t>( fromWireBits( pendingBits, offset, 8, lsbFirst ) ) );
+          }
+
+          const size_t index = queue( cmd, 8 * length, true );
+
+          if ( !threeWire )
+          {
+            sequence.ackedReplies.push_back( index );
+          }
+
+          for ( size_t x = 0; x < length; x++ )
+          {
+            const auto mask = static_cast<uint8_t>( fromWireBits( pendingReads, first + 8 * x, 8, true ) );
+            if ( mask )
+            {
+              sequence.captures.push_back( { index, x + 1, mask, true } );
+            }
+          }
+        }
+
+        /*------------------------------------------------
+        The odd bits left over are written from the top of a bulk bits byte, which
+        doesn't clock anything in, so reads among them go a bit at a time
+        ------------------------------------------------*/
+        while ( offset < total )
+        {
+          if ( pendingReads[ offset ] )
+          {
+            sequence.captures.push_back( { queue( { CMD_READ_BIT }, 1, false ), 0, 0x01, false } );
+            offset++;
+            continue;
+          }
+
+          size_t count = 1;
+          while ( ( offset + count < total ) && !pendingReads[ offset + count ] )
+          {
+            count++;
+          }
+
+          cmd.assign( 1, static_cast<uint8_t>( CMD_BULK_BITS | ( ( count - 1 ) & MSK_BULK_COUNT ) ) );
+          cmd.push_back( static_cast<uint8_t>( fromWireBits( pendingBits, offset, count, false ) << ( 8 - count ) ) );
+
+          sequence.ackedReplies.push_back( queue( cmd, count, true ) );
+          offset += count;
+        }
+
+        pendingBits.clear();
+        pendingReads.clear();
+      };
+
+      auto flush = [ & ]() {
+        flushTicks();
+        flushBits();
+      };
+
+      auto append = [ & ]( const uint32_t value, const size_t count, const bool read ) {
+        if ( pendingTicks || ( !threeWire && !pendingReads.empty() && ( pendingReads.back() != read ) ) )
+        {
+          flush();
+        }
+
+        appendWireBits( pendingBits, read ? ~0u : value, count, lsbFirst );
+        pendingReads.insert( pendingReads.end(), count, read );
+      };
+
+      for ( const auto &step : sequence.steps )
+      {
+        switch ( step.op )
+        {
+          case Op::TICK:
+            if ( pendingBits.size() )
+            {
+              flush();
+            }
+
+            pendingTicks += step.count;
+            break;
+
+          case Op::WRITE_BITS:
+            append( step.value, step.count, false );
+            break;
+
+          case Op::WRITE_BYTES:
+            for ( size_t x = 0; x < step.count; x++ )
+            {
+              append( sequence.writeData[ step.value + x ], 8, false );
+            }
+            break;
+
+          case Op::READ_BITS:
+            append( 0, step.count, true );
+            break;
+
+          case Op::READ_BYTES:
+            for ( size_t x = 0; x < step.count; x++ )
+            {
+              append( 0, 8, true );
+            }
+            break;
+
+          case Op::PEEK:
+            flush();
+            sequence.captures.push_back( { queue( { CMD_PEEK }, 0, false ), 0, 0x01, false } );
+            break;
+
+          default:
+            flush();
+            queue( { pinCommands[ static_cast<size_t>( step.op ) ] }, 2, true );
+            break;
+        }
+      }
+
+      flush();
+
+      sequence.compiled       = true;
+      sequence.compiledFormat = format;
+
+      return Status::OK;
+    }
+
+    Chimera::Status_t BinaryRawWire::write( const uint8_t *const txBuffer, const size_t length ) noexcept
+    {
+      if ( !txBuffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      RawWireSequence sequence;
+      sequence.writeBytes( txBuffer, length );
+
+      return run( sequence );
+    }
+
+    Chimera::Status_t BinaryRawWire::read( uint8_t *const rxBuffer, const size_t length ) noexcept
+    {
+      if ( !rxBuffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      RawWireSequence sequence;
+      sequence.readBytes( length );
+
+      Chimera::Status_t result = run( sequence );
+
+      if ( result == Status::OK )
+      {
+        memcpy( rxBuffer, sequence.bytes().data(), length );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryRawWire::setClockFrequency( const uint32_t freq, const uint32_t tolerance ) noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      /*------------------------------------------------
+      Find the lowest error clock
+      ------------------------------------------------*/
+      auto iter = std::min_element( sortedWireSpeeds.begin(), sortedWireSpeeds.end(), [freq]( uint32_t a, uint32_t b ) {
+        return std::labs( static_cast<long>( a ) - static_cast<long>( freq ) ) <
+               std::labs( static_cast<long>( b ) - static_cast<long>( freq ) );
+      } );
+
+      auto bitVals = static_cast<uint8_t>( std::distance( sortedWireSpeeds.begin(), iter ) );
+
+      if ( writeShadowRegister( busPirate, reg_WireSpeed, bitVals, stagingConfig ) == Status::OK )
+      {
+        result = Status::OK;
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryRawWire::getClockFrequency( uint32_t &freq ) noexcept
+    {
+      Chimera::Status_t result = Status::OK;
+
+      freq = sortedWireSpeeds[ reg_WireSpeed.staged & MSK_CFG_SPEED ];
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgPowerSupplies( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_POWER, state );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgPullups( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_PULLUP, state );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgAuxPin( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_AUX_PIN, state );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgChipSelect( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_CS_PIN, state );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgPinOutput( const bool state )
+    {
+      return cfgField( reg_WireCfg, CFG_WIRE_PIN_OUTPUT, state );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgThreeWire( const bool state )
+    {
+      return cfgField( reg_WireCfg, CFG_WIRE_3WIRE, state );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgBitOrder( const bool lsbFirst )
+    {
+      return cfgField( reg_WireCfg, CFG_WIRE_LSB_FIRST, lsbFirst );
+    }
+
+    void BinaryRawWire::stageConfig()
+    {
+      stagingConfig = true;
+    }
+
+    Chimera::Status_t BinaryRawWire::commitConfig()
+    {
+      CommandBatch batch;
+      return commitConfig( batch );
+    }
+
+    void BinaryRawWire::setPowerUpDelay( const uint32_t delay_mS )
+    {
+      powerUpDelay_mS = delay_mS;
+    }
+
+    Chimera::Status_t BinaryRawWire::commitConfig( CommandBatch &batch )
+    {
+      stagingConfig = false;
+      return commitShadowRegisters( busPirate, batch, { &reg_PeriphCfg, &reg_WireSpeed, &reg_WireCfg } );
+    }
+
+    Chimera::Status_t BinaryRawWire::cfgField( ShadowRegister &reg, const uint8_t field, const bool state )
+    {
+      return writeShadowRegister( busPirate, reg, reg.withField( field, state ), stagingConfig );
+    }
+
+    void BinaryRawWire::collectResults( RawWireSequence &sequence )
+    {
+      using Op = RawWireSequence::Op;
+
+      const bool lsbFirst = sequence.compiledFormat & CFG_WIRE_LSB_FIRST;
+
+      /*------------------------------------------------
+      Put every bit read back into wire order, then hand it out to the read steps in
+      the order they were made
+      ------------------------------------------------*/
+      std::vector<bool> wire;
+
+      std::vector<bool> byteBits;
+
+      for ( const auto &capture : sequence.captures )
+      {
+        const uint8_t value = sequence.batch.reply( capture.entry ).data[ capture.offset ];
+
+        if ( !capture.wholeByte )
+        {
+          wire.push_back( value & 0x01 );
+          continue;
+        }
+
+        byteBits.clear();
+        appendWireBits( byteBits, value, 8, lsbFirst );
+
+        for ( size_t x = 0; x < 8; x++ )
+        {
+          if ( capture.mask & ( 1u << x ) )
+          {
+            wire.push_back( byteBits[ x ] );
+          }
+        }
+      }
+
+      size_t offset = 0;
+      sequence.bitResults.clear();
+      sequence.byteResults.clear();
+
+      for ( const auto &step : sequence.steps )
+      {
+        if ( ( step.op == Op::READ_BITS ) || ( step.op == Op::PEEK ) )
+        {
+          sequence.bitResults.push_back( fromWireBits( wire, offset, step.count, lsbFirst ) );
+          offset += step.count;
+        }
+        else if ( step.op == Op::READ_BYTES )
+        {
+          for ( size_t x = 0; x < step.count; x++, offset += 8 )
+          {
+            sequence.byteResults.push_back( static_cast<uint8_t>( fromWireBits( wire, offset, 8, lsbFirst ) ) );
+          }
+        }
+      }
+    }
+
+    size_t BinaryRawWire::streamWindow( const RawWireSequence &sequence ) const
+    {
+      if ( !reg_WireSpeed.valid )
+      {
+        return 1;
+      }
+
+      /*------------------------------------------------
+      Sized for the command byte that keeps the bus busy the longest. That's a full
+      bulk tick if the sequence has one.
+      ------------------------------------------------*/
+      return busPirate.streamWindow( ( sequence.busBitsPerByte * 1000000000ull ) / sortedWireSpeeds[ reg_WireSpeed.applied ] );
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,409 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_rawwire.hpp
+ *
+ *   Description:
+ *       Provides an interface to the raw 2-wire/3-wire hardware on the Bus Pirate.
+ *       Follows the conventions of the Chimera HAL drivers.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_RAW_WIRE_DRIVER_HPP
+#define BUS_PIRATE_CPP_RAW_WIRE_DRIVER_HPP
+
+/* C++ Includes */
+#include <memory>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  Supported Bus Pirate raw-wire clock speeds
+     */
+    enum RawWireSpeed
+    {
+      RAW_WIRE_SPEED_5kHz   = 5000,
+      RAW_WIRE_SPEED_50kHz  = 50000,
+      RAW_WIRE_SPEED_100kHz = 100000,
+      RAW_WIRE_SPEED_400kHz = 400000,
+    };
+
+    /**
+     *  Settings applied by BinaryRawWire::init()
+     */
+    struct RawWireSetup
+    {
+      uint32_t clockFrequency; /**< Desired clock, rounded to the nearest supported speed */
+      bool threeWire;          /**< Separate data in and out pins (true) or one bidirectional data pin (false) */
+      bool lsbFirst;           /**< Shift bytes out and in least significant bit first */
+      bool pinOutput;          /**< Drive the pins at 3.3V (true) or open drain (false) */
+      bool pullups;            /**< Enables the on-board pullups, which need a supply on the Vpu pin */
+
+      RawWireSetup()
+      {
+        clockFrequency = RAW_WIRE_SPEED_100kHz;
+        threeWire      = true;
+        lsbFirst       = false;
+        pinOutput      = true;
+        pullups        = false;
+      }
+    };
+
+    /**
+     *  A bit level description of bus activity, built up by chaining calls and then
+     *  handed to BinaryRawWire::run(). Bit fields are shifted in the driver's
+     *  configured bit order, the same as whole bytes, so a field split across several
+     *  calls goes out exactly as if it were written in one.
+     *
+     *  The sequence keeps its compiled form, so running it again costs nothing to
+     *  prepare unless it was changed or the bus configuration was.
+     */
+    class RawWireSequence
+    {
+    public:
+      RawWireSequence()  = default;
+      ~RawWireSequence() = default;
+
+      /**
+       *  I2C style start condition: data falls while the clock is high
+       */
+      RawWireSequence &start();
+
+      /**
+       *  I2C style stop condition: data rises while the clock is high
+       */
+      RawWireSequence &stop();
+
+      RawWireSequence &chipSelect( const bool level );
+
+      RawWireSequence &clockLevel( const bool level );
+
+      RawWireSequence &dataLevel( const bool level );
+
+      /**
+       *  Pulses the clock without changing the data pin
+       *
+       *  @param[in]  count     Number of clock cycles
+       */
+      RawWireSequence &tick( const size_t count = 1 );
+
+      /**
+       *  Clocks out a bit field
+       *
+       *  @param[in]  value     Holds the field in its low bits
+       *  @param[in]  count     Field width, 1 to 32 bits
+       */
+      RawWireSequence &writeBits( const uint32_t value, const size_t count );
+
+      RawWireSequence &writeBytes( const uint8_t *const data, const size_t length );
+
+      /**
+       *  Clocks in a bit field. The result is added to bits().
+       *
+       *  @param[in]  count     Field width, 1 to 32 bits
+       */
+      RawWireSequence &readBits( const size_t count );
+
+      /**
+       *  Clocks in bytes. The result is added to bytes().
+       *
+       *  @param[in]  length    Number of bytes
+       */
+      RawWireSequence &readBytes( const size_t length );
+
+      /**
+       *  Samples the data input without clocking. The result is added to bits().
+       */
+      RawWireSequence &peek();
+
+      /**
+       *	Removes every step and result
+       *
+       *	@return void
+       */
+      void clear();
+
+      bool empty() const;
+
+      /**
+       *	Results of readBits() and peek(), one per call in the order they were made
+       *
+       *	@return const std::vector<uint32_t>&
+       */
+      const std::vector<uint32_t> &bits() const;
+
+      /**
+       *	Results of every readBytes() call, joined together
+       *
+       *	@return const std::vector<uint8_t>&
+       */
+      const std::vector<uint8_t> &bytes() const;
+
+      /**
+       *	Size of the compiled command stream, 0 if the sequence hasn't been compiled
+       *
+       *	@return size_t
+       */
+      size_t txBytes() const;
+
+    private:
+      friend class BinaryRawWire;
+
+      enum class Op : uint8_t
+      {
+        START,
+        STOP,
+        CS_LOW,
+        CS_HIGH,
+        CLOCK_LOW,
+        CLOCK_HIGH,
+        DATA_LOW,
+        DATA_HIGH,
+        TICK,
+        WRITE_BITS,
+        WRITE_BYTES,
+        READ_BITS,
+        READ_BYTES,
+        PEEK
+      };
+
+      struct Step
+      {
+        Op op;
+        uint32_t value; /**< Field to write, or offset into writeData */
+        size_t count;   /**< Bits, bytes or ticks */
+      };
+
+      /**
+       *  Where a reply holds read data: a byte clocked in, in the configured bit order,
+       *  or a single bit returned as 0x00/0x01
+       */
+      struct Capture
+      {
+        size_t entry;
+        size_t offset;
+        uint8_t mask;   /**< Bits of the byte that were reads, bit 0 being the first clocked */
+        bool wholeByte; /**< False for a single bit reply */
+      };
+
+      std::vector<Step> steps;
+      std::vector<uint8_t> writeData;
+      bool valid = true;
+
+      std::vector<uint32_t> bitResults;
+      std::vector<uint8_t> byteResults;
+
+      /*------------------------------------------------
+      Compiled form
+      ------------------------------------------------*/
+      bool compiled = false;
+      uint8_t compiledFormat;
+      CommandBatch batch;
+      std::vector<Capture> captures;
+      std::vector<size_t> ackedReplies; /**< Entries whose whole reply must be acks, not just the first byte */
+      size_t busBitsPerByte = 0;        /**< Most clock cycles any single command byte causes */
+
+      RawWireSequence &add( const Op op, const uint32_t value = 0, const size_t count = 0 );
+    };
+
+    class BinaryRawWire;
+    using BinaryRawWire_sPtr = std::shared_ptr<BinaryRawWire>;
+    using BinaryRawWire_uPtr = std::unique_ptr<BinaryRawWire>;
+
+    /**
+     *  Bit level 2-wire/3-wire master for proprietary serial protocols. Callers describe
+     *  what happens on the pins with a RawWireSequence, and the driver packs it into the
+     *  densest raw-wire commands: runs of clock ticks, bits and bytes are merged no matter
+     *  how they were split up, whole bytes go out as bulk writes and only the odd bits
+     *  left over use bit commands. In 3-wire mode a bulk write clocks in a byte for each
+     *  one it sends, so reads share bulk writes with the writes around them, which
+     *  makes a half duplex exchange on an open drain data pin as cheap as a write. The
+     *  compiled stream goes out in a single pipelined write, so the bus runs at link
+     *  speed rather than a round trip per bit.
+     */
+    class BinaryRawWire
+    {
+    public:
+      /**
+       *  Primary constructor for creating the raw-wire interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      BinaryRawWire( Device &device );
+
+      BinaryRawWire()  = default;
+      ~BinaryRawWire() = default;
+
+      Chimera::Status_t init( const RawWireSetup &setupStruct ) noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Runs a sequence, compiling it first if needed. The read results are available
+       *  from the sequence afterwards.
+       *
+       *	@param[in]	sequence      Sequence to run
+       *	@return Chimera::Status_t: INVAL_FUNC_PARAM if a step was given bad arguments
+       */
+      Chimera::Status_t run( RawWireSequence &sequence ) noexcept;
+
+      /**
+       *	Packs a sequence into commands for the current configuration without sending
+       *  anything. run() does this itself when needed.
+       *
+       *	@param[in]	sequence      Sequence to compile
+       *	@return Chimera::Status_t: INVAL_FUNC_PARAM if a step was given bad arguments
+       */
+      Chimera::Status_t compile( RawWireSequence &sequence ) noexcept;
+
+      /**
+       *	Clocks out a block of data
+       *
+       *	@param[in]	txBuffer      Data to write
+       *	@param[in]	length        Number of bytes to write
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t write( const uint8_t *const txBuffer, const size_t length ) noexcept;
+
+      /**
+       *	Clocks in a block of data
+       *
+       *	@param[out]	rxBuffer      Receives the data
+       *	@param[in]	length        Number of bytes to read
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t read( uint8_t *const rxBuffer, const size_t length ) noexcept;
+
+      Chimera::Status_t setClockFrequency( const uint32_t freq, const uint32_t tolerance ) noexcept;
+
+      Chimera::Status_t getClockFrequency( uint32_t &freq ) noexcept;
+
+      /**
+       *	Enables or disables the on-board power supplies
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPowerSupplies( const bool state );
+
+      /**
+       *	Enables or disables the pullups on the bus pins
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPullups( const bool state );
+
+      /**
+       *	Enables or disables the Auxiliary pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgAuxPin( const bool state );
+
+      /**
+       *	Enables or disables the chip select pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgChipSelect( const bool state );
+
+      /**
+       *	Selects how the pins are driven
+       *
+       *	@param[in]	state         True (3.3V), false (HiZ, open drain)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPinOutput( const bool state );
+
+      /**
+       *	Selects between a bidirectional data pin and separate data in and out pins
+       *
+       *	@param[in]	state         3-wire (true), 2-wire (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgThreeWire( const bool state );
+
+      /**
+       *	Selects the bit order for bytes and bit fields
+       *
+       *	@param[in]	lsbFirst      LSB first (true), MSB first (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgBitOrder( const bool lsbFirst );
+
+      /**
+       *	Starts staging configuration changes. Until commitConfig() is called, the cfg
+       *  functions and setClockFrequency() only update the shadow registers.
+       *
+       *	@return void
+       */
+      void stageConfig();
+
+      /**
+       *	Writes every register that was changed while staging and stops staging
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t commitConfig();
+
+      /**
+       *	Sets how long init() waits for the target to settle after switching the
+       *  power supplies on. There is no wait if the supplies were already on.
+       *
+       *	@param[in]	delay_mS      Settling time in milliseconds, 0 to skip it
+       *	@return void
+       */
+      void setPowerUpDelay( const uint32_t delay_mS );
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized;
+      bool stagingConfig;
+      uint32_t powerUpDelay_mS;
+
+      ShadowRegister reg_PeriphCfg;
+      ShadowRegister reg_WireSpeed;
+      ShadowRegister reg_WireCfg;
+
+      Chimera::Status_t cfgField( ShadowRegister &reg, const uint8_t field, const bool state );
+
+      Chimera::Status_t commitConfig( CommandBatch &batch );
+
+      /**
+       *	Splits the results of a run back out to the read steps of its sequence
+       *
+       *	@param[in]	sequence      Sequence that was just run
+       *	@return void
+       */
+      void collectResults( RawWireSequence &sequence );
+
+      /**
+       *	Works out how far a sequence's command stream can run ahead of the replies
+       *  without overrunning the Bus Pirate's UART FIFO
+       *
+       *	@param[in]	sequence      Compiled sequence
+       *	@return size_t: Window in bytes, 0 if the stream doesn't need throttling
+       */
+      size_t streamWindow( const RawWireSequence &sequence ) const;
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_RAW_WIRE_DRIVER_HPP */
@@ -13,6 +13,9 @@
 
 /* C++ Includes */
 #include <array>
+#include <chrono>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <string>
 #include <algorithm>
@@ -57,14 +60,9 @@ namespace HWInterface
     static constexpr uint8_t CMD_CFG_SPI = 0x80;
     static constexpr uint8_t MSK_CFG_SPI = 0x0F;
 
-    static constexpr uint8_t CFG_SPI_PIN_3V3 = ( 1u << 3 );
-    static constexpr uint8_t CFG_SPI_PIN_HIZ = ~CFG_SPI_PIN_3V3;
-
-    static constexpr uint8_t CFG_SPI_CPOL_1 = ( 1u << 2 );
-    static constexpr uint8_t CFG_SPI_CPOL_0 = ~CFG_SPI_CPOL_1;
-
+    static constexpr uint8_t CFG_SPI_PIN_3V3          = ( 1u << 3 );
+    static constexpr uint8_t CFG_SPI_CPOL_1           = ( 1u << 2 );
     static constexpr uint8_t CFG_SPI_CPHA_ACT_TO_IDLE = ( 1u << 1 );
-    static constexpr uint8_t CFG_SPI_CPHA_IDLE_TO_ACT = ~CFG_SPI_CPHA_ACT_TO_IDLE;
 
     /*------------------------------------------------
     SPI Speed Configuration & Lookup Options
@@ -98,6 +96,44 @@ namespace HWInterface
     static constexpr uint8_t CMD_TX_THEN_RX_MAN_CS   = 0x05;
     static constexpr uint8_t CMD_TX_THEN_RX_AUTO_CS  = 0x04;
 
+    /*------------------------------------------------
+    Write-then-read limits. The firmware buffers up to 4096 bytes in each direction.
+    Below the minimum length the 5 byte preamble costs more than bulk chunks do.
+    ------------------------------------------------*/
+    static constexpr size_t TX_THEN_RX_MAX_LEN = 4096;
+    static constexpr size_t TX_THEN_RX_MIN_LEN = 16;
+
+    /*------------------------------------------------
+    Write-then-read clocks 0xFF while it reads, so bulk reads send the same
+    ------------------------------------------------*/
+    static constexpr uint8_t READ_FILL_BYTE = 0xFF;
+
+    /*------------------------------------------------
+    How long to let a target settle after the supplies switch on
+    ------------------------------------------------*/
+    static constexpr uint32_t DEFAULT_POWER_UP_DELAY_MS = 100;
+
+    /*------------------------------------------------
+    Sniffer stream. A '[' or ']' marks chip select going active or inactive, and
+    every byte clocked on the bus comes as the escape followed by MOSI then MISO.
+    Any byte from the host stops the sniffer, and the firmware answers 0x01 once
+    it is back in SPI mode.
+    ------------------------------------------------*/
+    static constexpr uint8_t SNIFF_FRAME_START = 0x5B;
+    static constexpr uint8_t SNIFF_FRAME_END   = 0x5D;
+    static constexpr uint8_t SNIFF_ESCAPE      = 0x5C;
+    static constexpr uint8_t CMD_SNIFF_STOP    = 0xFF;
+    static constexpr uint8_t SNIFF_STOP_ACK    = 0x01;
+
+    /*------------------------------------------------
+    Sniffer decoding: how long each read of the ring waits, which is also how long
+    the line has to be quiet after stopping before the last of the stream is taken
+    to have arrived, and how long to wait for that overall
+    ------------------------------------------------*/
+    static constexpr size_t SNIFF_CHUNK_SIZE        = 4096;
+    static constexpr uint32_t SNIFF_QUIET_MS        = 20;
+    static constexpr uint32_t SNIFF_STOP_TIMEOUT_MS = 500;
+
 
     BinarySPI::BinarySPI( Device &device ) : busPirate( device )
     {
@@ -109,22 +145,112 @@ namespace HWInterface
       Initialize the virtual registers
       ------------------------------------------------*/
       reg_CS        = 0;
-      reg_SPICfg    = 0;
-      reg_PeriphCfg = 0;
-      reg_SPISpeed  = 0;
+      reg_SPICfg    = { CMD_CFG_SPI, MSK_CFG_SPI, 0, 0, false };
+      reg_PeriphCfg = { CMD_CFG_PERIPH, MSK_CFG_PERIPH, 0, 0, false };
+      reg_SPISpeed  = { CMD_CFG_SPEED, MSK_CFG_SPEED, 0, 0, false };
+      stagingConfig = false;
+
+      powerUpDelay_mS = DEFAULT_POWER_UP_DELAY_MS;
+      initLatency_uS  = 0;
+
+      sniffing          = false;
+      snifferStopping   = false;
+      sniffStreamBytes  = 0;
+      sniffTransactions = 0;
+      sniffDecodeErrors = 0;
+      captureOK         = true;
+      sniffInFrame      = false;
+      sniffEscape       = 0;
+      sniffMOSI         = 0;
+      sniffStopAcked    = false;
+    }
+
+    BinarySPI::~BinarySPI()
+    {
+      /*------------------------------------------------
+      The decoder thread can't outlive the driver it decodes for
+      ------------------------------------------------*/
+      stopSniffer();
     }
 
     Chimera::Status_t BinarySPI::init( const Chimera::SPI::Setup &setupStruct ) noexcept
     {
       Chimera::Status_t result = SPI::Status::NOT_INITIALIZED;
+      const auto start         = std::chrono::steady_clock::now();
+
+      stopSniffer();
+
+      CommandBatch batch;
+      size_t entry = 0;
+
+      /*------------------------------------------------
+      Already sitting in SPI mode? A single version query confirms it and the
+      configuration it holds is still good. Otherwise get to the bit bang root,
+      resetting only if it isn't already there, and queue up the mode switch to
+      go out together with the configuration.
+      ------------------------------------------------*/
+      bool inSPIMode = ( busPirate.state->currentMode == OperationalModes::BP_MODE_SPI_BIT_BANG ) && busPirate.resyncFraming();
 
-      if ( busPirate.bbInit() && busPirate.bbEnterSPI() )
+      if ( !inSPIMode && ( ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) || busPirate.bbInit() ) )
       {
+        entry = batch.add( { CMD_ENTER_RAW_SPI }, BitBangCommands::spiSuccess.size(), false );
+
+        /*------------------------------------------------
+        Entering SPI mode resets the firmware's configuration
+        ------------------------------------------------*/
+        invalidateShadowRegisters( { &reg_PeriphCfg, &reg_SPICfg, &reg_SPISpeed } );
+      }
+
+      if ( inSPIMode || batch.size() )
+      {
+        const bool powered  = reg_PeriphCfg.valid && ( reg_PeriphCfg.applied & CFG_PERIPH_POWER );
+        bool entryConfirmed = inSPIMode;
+
         /*------------------------------------------------
-        Power on the ouptut and wait a bit to let whatever is connected stabilize
+        The mode switch answers with its version string once whichever batch carries
+        it has gone out
+        ------------------------------------------------*/
+        auto confirmEntry = [ this, &batch, &entry, &entryConfirmed ]() -> Chimera::Status_t {
+          if ( entryConfirmed )
+          {
+            return SPI::Status::OK;
+          }
+
+          const std::string &expected = BitBangCommands::spiSuccess;
+          auto reply                  = batch.reply( entry );
+
+          entryConfirmed = true;
+          if ( ( reply.length == expected.size() ) && std::equal( expected.begin(), expected.end(), reply.data ) )
+          {
+            busPirate.state->currentMode = OperationalModes::BP_MODE_SPI_BIT_BANG;
+            return SPI::Status::OK;
+          }
+
+          return SPI::Status::FAIL;
+        };
+
+        stageConfig();
+
+        /*------------------------------------------------
+        Power on the output. Switching the supplies on goes out ahead of everything
+        else, so whatever is connected has a moment to stabilize before the pins
+        start driving it.
         ------------------------------------------------*/
         result = cfgPowerSupplies( true );
-        Chimera::delayMilliseconds( 100 );
+
+        if ( !powered && powerUpDelay_mS )
+        {
+          result |= commitConfig( batch );
+          result |= confirmEntry();
+          batch.clear();
+
+          if ( reg_PeriphCfg.applied & CFG_PERIPH_POWER )
+          {
+            Chimera::delayMilliseconds( powerUpDelay_mS );
+          }
+
+          stageConfig();
+        }
 
         /*------------------------------------------------
         Enable all the pins as outputs
@@ -145,7 +271,6 @@ namespace HWInterface
         The chip select line follows whatever configuration is set by cfgSPIPinOut.
         ------------------------------------------------*/
         result |= cfgChipSelect( true );
-        result |= setChipSelect( State::HI );
 
         switch ( setupStruct.clockMode )
         {
@@ -185,15 +310,31 @@ namespace HWInterface
         else
         {
           result |= SPI::Status::FAIL;
-          spdlog::error( "Failed SPI initialization" );
         }
 
-        if ( result == SPI::Status::OK )
-        {
-          systemInitialized = true;
-        }
+        /*------------------------------------------------
+        Everything else that changed goes out in one round trip, along with the mode
+        switch if the supplies didn't need it to go out first
+        ------------------------------------------------*/
+        result |= commitConfig( batch );
+        result |= confirmEntry();
+
+        result |= setChipSelect( State::HI );
+      }
+
+      if ( result == SPI::Status::OK )
+      {
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed SPI initialization" );
       }
 
+      initLatency_uS = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count() );
+      spdlog::info( "SPI initialization took {} us", initLatency_uS );
+
       return result;
     }
 
@@ -201,6 +342,7 @@ namespace HWInterface
     {
       Chimera::Status_t result = SPI::Status::FAIL;
 
+      stopSniffer();
       busPirate.close();
       result            = SPI::Status::OK;
       systemInitialized = false;
@@ -210,6 +352,11 @@ namespace HWInterface
 
     Chimera::Status_t BinarySPI::setChipSelect( const Chimera::GPIO::State &value ) noexcept
     {
+      if ( sniffing )
+      {
+        return SPI::Status::NOT_READY;
+      }
+
       Chimera::Status_t result = SPI::Status::FAILED_CHIP_SELECT_WRITE;
 
       uint8_t bitVals = reg_CS;
@@ -254,13 +401,24 @@ namespace HWInterface
       }
 
       TXRXPacket_t transfer;
+      transfer.writeData = std::vector<uint8_t>( txBuffer, txBuffer + length );
 
-      transfer.command       = CMD_BULK_SPI_TXFR;
-      transfer.numWriteBytes = static_cast<uint16_t>( length );
-      transfer.numReadBytes  = static_cast<uint16_t>( length );
-      transfer.writeData     = std::vector<uint8_t>( txBuffer, txBuffer + length );
+      /*------------------------------------------------
+      Nothing needs to come back, so larger writes skip the echoed bytes entirely
+      ------------------------------------------------*/
+      if ( length < TX_THEN_RX_MIN_LEN )
+      {
+        transfer.command       = CMD_BULK_SPI_TXFR;
+        transfer.numWriteBytes = static_cast<uint16_t>( length );
+        transfer.numReadBytes  = static_cast<uint16_t>( length );
+
+        return bulkTransfer( transfer );
+      }
 
-      return bulkTransfer( transfer );
+      transfer.command      = CMD_TX_THEN_RX_AUTO_CS;
+      transfer.numReadBytes = 0;
+
+      return writeThenRead( transfer );
     }
 
     Chimera::Status_t BinarySPI::readBytes( uint8_t *const rxBuffer, const size_t length, const uint32_t timeoutMS ) noexcept
@@ -271,16 +429,31 @@ namespace HWInterface
       }
 
       Chimera::Status_t result = SPI::Status::FAIL;
+      Chimera::Status_t error  = SPI::Status::FAIL;
       TXRXPacket_t transfer;
 
-      transfer.command       = CMD_BULK_SPI_TXFR;
-      transfer.numWriteBytes = static_cast<uint16_t>( length );
-      transfer.numReadBytes  = static_cast<uint16_t>( length );
-      transfer.writeData     = std::vector<uint8_t>( length );
+      /*------------------------------------------------
+      Larger reads only send the preamble and let the firmware clock out the
+      dummy bytes, leaving the link free to carry the data coming back
+      ------------------------------------------------*/
+      if ( length < TX_THEN_RX_MIN_LEN )
+      {
+        transfer.command       = CMD_BULK_SPI_TXFR;
+        transfer.numWriteBytes = static_cast<uint16_t>( length );
+        transfer.numReadBytes  = static_cast<uint16_t>( length );
+        transfer.writeData.assign( length, READ_FILL_BYTE );
 
-      transfer.writeData.assign( length, 0 );
+        error = bulkTransfer( transfer );
+      }
+      else
+      {
+        transfer.command      = CMD_TX_THEN_RX_AUTO_CS;
+        transfer.numReadBytes = length;
 
-      if ( bulkTransfer( transfer ) == SPI::Status::OK )
+        error = writeThenRead( transfer );
+      }
+
+      if ( error == SPI::Status::OK )
       {
         auto rxLen = std::min( length, transfer.readData.size() );
         memcpy( rxBuffer, transfer.readData.data(), rxLen );
@@ -346,23 +519,14 @@ namespace HWInterface
         iter = sortedSPISpeeds.begin();
       }
 
-      /*------------------------------------------------
-      Build the command
-      ------------------------------------------------*/
-      auto bitVals = mapSpeedtoBits.left.find( *iter )->second;
-      uint8_t command = CMD_CFG_SPEED | ( bitVals & MSK_CFG_SPEED );
-
       /*------------------------------------------------
       Send and verify
       ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      auto bitVals = mapSpeedtoBits.left.find( *iter )->second;
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+      if ( writeRegister( reg_SPISpeed, bitVals ) == SPI::Status::OK )
       {
-        reg_SPISpeed = bitVals;
-
-        uint32_t actualClock = mapSpeedtoBits.right.find( reg_SPISpeed )->second;
+        uint32_t actualClock = mapSpeedtoBits.right.find( reg_SPISpeed.staged )->second;
 
         if (actualClock == freq )
         {
@@ -385,369 +549,694 @@ namespace HWInterface
     {
       Chimera::Status_t result = SPI::Status::OK;
 
-      freq = mapSpeedtoBits.right.find( reg_SPISpeed )->second;
+      freq = mapSpeedtoBits.right.find( reg_SPISpeed.staged )->second;
 
       return result;
     }
 
     Chimera::Status_t BinarySPI::cfgPowerSupplies( const bool state )
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_POWER, state );
+    }
 
-      /*------------------------------------------------
-      Build the command
-      ------------------------------------------------*/
-      uint8_t bitVals = reg_PeriphCfg;
-      if ( state )
+    Chimera::Status_t BinarySPI::cfgPullups( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_PULLUP, state );
+    }
+
+    Chimera::Status_t BinarySPI::cfgAuxPin( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_AUX_PIN, state );
+    }
+
+    Chimera::Status_t BinarySPI::cfgChipSelect( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_CS_PIN, state );
+    }
+
+    Chimera::Status_t BinarySPI::cfgSPIPinOut( const bool state )
+    {
+      /* True is 3.3V, false is HiZ */
+      return cfgField( reg_SPICfg, CFG_SPI_PIN_3V3, state );
+    }
+
+    Chimera::Status_t BinarySPI::cfgSPIClkIdle( const bool state )
+    {
+      /* True is CPOL 1, false is CPOL 0 */
+      return cfgField( reg_SPICfg, CFG_SPI_CPOL_1, state );
+    }
+
+    Chimera::Status_t BinarySPI::cfgSPIClkEdge( const bool direction )
+    {
+      /* True is active to idle, false is idle to active */
+      return cfgField( reg_SPICfg, CFG_SPI_CPHA_ACT_TO_IDLE, direction );
+    }
+
+    void BinarySPI::stageConfig()
+    {
+      stagingConfig = true;
+    }
+
+    Chimera::Status_t BinarySPI::commitConfig()
+    {
+      CommandBatch batch;
+      return commitConfig( batch );
+    }
+
+    void BinarySPI::setPowerUpDelay( const uint32_t delay_mS )
+    {
+      powerUpDelay_mS = delay_mS;
+    }
+
+    uint64_t BinarySPI::getInitLatency_uS() const
+    {
+      return initLatency_uS;
+    }
+
+    Chimera::Status_t BinarySPI::startSniffer( const SnifferSetup &setup )
+    {
+      using namespace std::chrono;
+
+      if ( !systemInitialized )
       {
-        bitVals |= CFG_PERIPH_POWER;
+        return SPI::Status::NOT_INITIALIZED;
       }
-      else
+
+      if ( sniffing )
       {
-        bitVals &= ~CFG_PERIPH_POWER;
+        return SPI::Status::OK;
       }
 
-      uint8_t command = CMD_CFG_PERIPH | ( bitVals & MSK_CFG_PERIPH );
+      if ( !setup.ringSize )
+      {
+        return SPI::Status::INVAL_FUNC_PARAM;
+      }
 
-      /*------------------------------------------------
-      Send and verify
-      ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      const auto serial   = busPirate.serial;
+      const auto epoch_uS = duration_cast<microseconds>( system_clock::now().time_since_epoch() ).count();
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+      if ( !setup.capturePath.empty() && !captureWriter.open( setup.capturePath, setup.mode, epoch_uS ) )
       {
-        reg_PeriphCfg = bitVals;
-        result        = SPI::Status::OK;
+        spdlog::error( "Failed creating SPI capture file {}", setup.capturePath );
+        return SPI::Status::FAIL;
       }
 
-      return result;
-    }
-
-    Chimera::Status_t BinarySPI::cfgPullups( const bool state )
-    {
-      Chimera::Status_t result = SPI::Status::FAIL;
+      serial->setRxBufferSize( setup.ringSize );
+      Chimera::Status_t result = serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::INTERRUPT );
 
       /*------------------------------------------------
-      Build the command
+      The ack arrives through the ring, right in front of the stream
       ------------------------------------------------*/
-      uint8_t bitVals = reg_PeriphCfg;
-      if ( state )
+      if ( result == SPI::Status::OK )
       {
-        bitVals |= CFG_PERIPH_PULLUP;
+        const uint8_t cmd = setup.mode;
+        uint8_t ack       = 0;
+        size_t received   = 0;
+
+        busPirate.resyncSerial();
+        result = serial->write( &cmd, 1 );
+
+        if ( ( result == SPI::Status::OK ) &&
+             ( ( serial->readSome( &ack, 1, received ) != SPI::Status::OK ) || ( ack != BitBangCommands::success ) ) )
+        {
+          result = SPI::Status::FAIL;
+        }
       }
-      else
+
+      if ( result != SPI::Status::OK )
       {
-        bitVals &= ~CFG_PERIPH_PULLUP;
-      }
+        spdlog::error( "Failed starting SPI sniffer" );
 
-      uint8_t command = CMD_CFG_PERIPH | ( bitVals & MSK_CFG_PERIPH );
+        captureWriter.close();
+        serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::BLOCKING );
+        busPirate.resyncFraming();
 
-      /*------------------------------------------------
-      Send and verify
-      ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+        return SPI::Status::FAIL;
+      }
+
+      sniffSetup        = setup;
+      sniffStart        = steady_clock::now();
+      sniffStreamBytes  = 0;
+      sniffTransactions = 0;
+      sniffDecodeErrors = 0;
+      captureOK         = true;
+      sniffFrame        = SPITransaction();
+      sniffInFrame      = false;
+      sniffEscape       = 0;
+      sniffStopAcked    = false;
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
       {
-        reg_PeriphCfg = bitVals;
-        result        = SPI::Status::OK;
+        std::lock_guard<std::mutex> lock( sniffMutex );
+        sniffQueue.clear();
       }
 
+      snifferStopping = false;
+      sniffing        = true;
+      snifferThread   = std::thread( [ this ]() { sniffLoop(); } );
+
       return result;
     }
 
-    Chimera::Status_t BinarySPI::cfgAuxPin( const bool state )
+    Chimera::Status_t BinarySPI::stopSniffer()
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
+      if ( !sniffing )
+      {
+        return SPI::Status::OK;
+      }
+
+      Chimera::Status_t result = SPI::Status::OK;
+      const auto serial        = busPirate.serial;
+      const uint8_t cmd        = CMD_SNIFF_STOP;
 
       /*------------------------------------------------
-      Build the command
+      The decoder keeps going until everything already on its way has arrived,
+      expecting the stop to be acked at the end of it
       ------------------------------------------------*/
-      uint8_t bitVals = reg_PeriphCfg;
-      if ( state )
-      {
-        bitVals |= CFG_PERIPH_AUX_PIN;
-      }
-      else
+      snifferStopping = true;
+      serial->write( &cmd, 1 );
+
+      if ( snifferThread.joinable() )
       {
-        bitVals &= ~CFG_PERIPH_AUX_PIN;
+        snifferThread.join();
       }
 
-      uint8_t command = CMD_CFG_PERIPH | ( bitVals & MSK_CFG_PERIPH );
+      sniffing = false;
+      serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::BLOCKING );
 
-      /*------------------------------------------------
-      Send and verify
-      ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      if ( !captureWriter.close() || !captureOK )
+      {
+        spdlog::error( "Failed writing SPI capture file {}", sniffSetup.capturePath );
+        result = SPI::Status::FAIL;
+      }
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+      if ( !busPirate.resyncFraming() )
       {
-        reg_PeriphCfg = bitVals;
-        result        = SPI::Status::OK;
+        spdlog::error( "Failed stopping SPI sniffer" );
+        result = SPI::Status::FAIL;
       }
 
       return result;
     }
 
-    Chimera::Status_t BinarySPI::cfgChipSelect( const bool state )
+    bool BinarySPI::isSniffing() const
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
+      return sniffing;
+    }
 
-      /*------------------------------------------------
-      Build the command
-      ------------------------------------------------*/
-      uint8_t bitVals = reg_PeriphCfg;
-      if ( state )
-      {
-        bitVals |= CFG_PERIPH_CS_PIN;
-      }
-      else
+    size_t BinarySPI::readTransactions( std::vector<SPITransaction> &transactions )
+    {
+      std::lock_guard<std::mutex> lock( sniffMutex );
+
+      transactions.assign( std::make_move_iterator( sniffQueue.begin() ), std::make_move_iterator( sniffQueue.end() ) );
+      sniffQueue.clear();
+
+      return transactions.size();
+    }
+
+    SnifferStats BinarySPI::getSnifferStats() const
+    {
+      SnifferStats stats;
+
+      stats.streamBytes   = sniffStreamBytes;
+      stats.transactions  = sniffTransactions;
+      stats.decodeErrors  = sniffDecodeErrors;
+      stats.overflowBytes = busPirate.serial ? busPirate.serial->getRxOverflowCount() : 0;
+
+      return stats;
+    }
+
+    Chimera::Status_t BinarySPI::commitConfig( CommandBatch &batch )
+    {
+      if ( sniffing )
       {
-        bitVals &= ~CFG_PERIPH_CS_PIN;
+        return SPI::Status::NOT_READY;
       }
 
-      uint8_t command = CMD_CFG_PERIPH | ( bitVals & MSK_CFG_PERIPH );
+      stagingConfig = false;
+      return commitShadowRegisters( busPirate, batch, { &reg_PeriphCfg, &reg_SPICfg, &reg_SPISpeed } );
+    }
 
-      /*------------------------------------------------
-      Send and verify
-      ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+    Chimera::Status_t BinarySPI::cfgField( ShadowRegister &reg, const uint8_t field, const bool state )
+    {
+      return writeRegister( reg, reg.withField( field, state ) );
+    }
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+    Chimera::Status_t BinarySPI::writeRegister( ShadowRegister &reg, const uint8_t value )
+    {
+      if ( sniffing )
       {
-        reg_PeriphCfg = bitVals;
-        result        = SPI::Status::OK;
+        return SPI::Status::NOT_READY;
       }
 
-      return result;
+      return writeShadowRegister( busPirate, reg, value, stagingConfig );
     }
 
-    Chimera::Status_t BinarySPI::cfgSPIPinOut( const bool state )
+    Chimera::Status_t BinarySPI::reserve( const uint32_t timeout_ms )
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
+      return SPI::Status::NOT_SUPPORTED;
+    }
+
+    Chimera::Status_t BinarySPI::release( const uint32_t timeout_ms )
+    {
+      return SPI::Status::NOT_SUPPORTED;
+    }
+
+    Chimera::Status_t BinarySPI::bulkTransfer( TXRXPacket_t &transfer )
+    {
+      if ( sniffing )
+      {
+        return SPI::Status::NOT_READY;
+      }
+
+      Chimera::Status_t result = SPI::Status::OK;
+      static constexpr uint8_t BULK_TRANSFER_MAX_LEN = 16;
+
+      CommandBatch batch;
+      std::vector<size_t> chunks;
+      std::vector<uint8_t> chunk;
+
+      const uint8_t csLow  = CMD_SET_CS | ( reg_CS & MSK_SET_CS & ~SET_CS );
+      const uint8_t csHigh = CMD_SET_CS | ( ( reg_CS | SET_CS ) & MSK_SET_CS );
 
       /*------------------------------------------------
-      Build the command
+      Queue up the whole transfer so it streams out back to back. Each bulk command
+      carries its data right behind it and is answered by the ack plus one byte
+      per byte clocked out, so every byte sent gets exactly one byte back.
       ------------------------------------------------*/
-      uint8_t bitVals = reg_SPICfg;
-      if ( state )
+      if ( csMode != ChipSelectMode::MANUAL )
       {
-        bitVals |= CFG_SPI_PIN_3V3;
+        batch.add( { csLow }, 1 );
       }
-      else
+
+      for ( size_t offset = 0; offset < transfer.writeData.size(); offset += BULK_TRANSFER_MAX_LEN )
       {
-        bitVals &= CFG_SPI_PIN_HIZ;
+        const size_t len = std::min<size_t>( BULK_TRANSFER_MAX_LEN, transfer.writeData.size() - offset );
+
+        /*------------------------------------------------
+        Let the Bus Pirate know how many bytes we want to transfer.
+        0 == 1 byte TX
+        ------------------------------------------------*/
+        chunk.assign( 1, static_cast<uint8_t>( transfer.command | ( ( len - 1 ) & MSK_BULK_SPI_TXFR_BYTES ) ) );
+        chunk.insert( chunk.end(), transfer.writeData.begin() + offset, transfer.writeData.begin() + offset + len );
+        chunks.push_back( batch.add( chunk, len + 1 ) );
+
+        /*------------------------------------------------
+        Handle chip select options if enabled
+        ------------------------------------------------*/
+        if ( ( csMode == ChipSelectMode::AUTO_BETWEEN_TRANSFER ) && ( offset + len < transfer.writeData.size() ) )
+        {
+          batch.add( { csHigh }, 1 );
+          batch.add( { csLow }, 1 );
+        }
       }
 
-      uint8_t command = CMD_CFG_SPI | ( bitVals & MSK_CFG_SPI );
+      /*------------------------------------------------
+      Any state besides manual must disable the chip select line after the transfer
+      ------------------------------------------------*/
+      if ( csMode != ChipSelectMode::MANUAL )
+      {
+        batch.add( { csHigh }, 1 );
+      }
+
+      busPirate.stream( batch, streamWindow() );
 
       /*------------------------------------------------
-      Send and verify
+      Pull out the data clocked in, stopping at the first chunk that failed
       ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      for ( auto index : chunks )
+      {
+        auto reply = batch.reply( index );
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+        if ( reply.status != SPI::Status::OK )
+        {
+          result = SPI::Status::FAILED_READ;
+          break;
+        }
+
+        transfer.readData.insert( transfer.readData.end(), reply.data + 1, reply.data + reply.length );
+      }
+
+      if ( ( csMode != ChipSelectMode::MANUAL ) && batch.reply( batch.size() - 1 ).status == SPI::Status::OK )
       {
-        reg_SPICfg = bitVals;
-        result     = SPI::Status::OK;
+        reg_CS |= SET_CS;
       }
 
       return result;
     }
 
-    Chimera::Status_t BinarySPI::cfgSPIClkIdle( const bool state )
+    size_t BinarySPI::streamWindow() const
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
+      const auto clock = mapSpeedtoBits.right.find( reg_SPISpeed.applied );
+
+      if ( clock == mapSpeedtoBits.right.end() )
+      {
+        return 1;
+      }
+
+      return busPirate.streamWindow( ( 8ull * 1000000000ull ) / clock->second );
+    }
+
+    Chimera::Status_t BinarySPI::writeThenRead( TXRXPacket_t &transfer )
+    {
+      if ( sniffing )
+      {
+        return SPI::Status::NOT_READY;
+      }
+
+      Chimera::Status_t result = SPI::Status::OK;
+
+      CommandBatch batch;
+      std::vector<size_t> segments;
+      std::vector<uint8_t> data;
+
+      const size_t numWrite = transfer.writeData.size();
+      const size_t numRead  = transfer.numReadBytes;
+      const size_t numSegs  = std::max<size_t>( 1, std::max( ( numWrite + TX_THEN_RX_MAX_LEN - 1 ) / TX_THEN_RX_MAX_LEN,
+                                                            ( numRead + TX_THEN_RX_MAX_LEN - 1 ) / TX_THEN_RX_MAX_LEN ) );
 
       /*------------------------------------------------
-      Build the command
+      The auto CS command wraps each segment in its own chip select cycle. That's
+      only right if there is one segment or CS is meant to toggle between them.
+      Otherwise hold CS low across all of them manually.
       ------------------------------------------------*/
-      uint8_t bitVals = reg_SPICfg;
-      if ( state )
+      uint8_t command      = CMD_TX_THEN_RX_AUTO_CS;
+      const bool holdCS    = ( csMode == ChipSelectMode::AUTO_AFTER_TRANSFER ) && ( numSegs > 1 );
+      const uint8_t csLow  = CMD_SET_CS | ( reg_CS & MSK_SET_CS & ~SET_CS );
+      const uint8_t csHigh = CMD_SET_CS | ( ( reg_CS | SET_CS ) & MSK_SET_CS );
+
+      if ( ( csMode == ChipSelectMode::MANUAL ) || holdCS )
       {
-        bitVals |= CFG_SPI_CPOL_1;
+        command = CMD_TX_THEN_RX_MAN_CS;
       }
-      else
+
+      if ( holdCS )
       {
-        bitVals &= CFG_SPI_CPOL_0;
+        batch.add( { csLow }, 1 );
       }
 
-      uint8_t command = CMD_CFG_SPI | ( bitVals & MSK_CFG_SPI );
+      for ( size_t x = 0; x < numSegs; x++ )
+      {
+        const size_t wrOffset = std::min( numWrite, x * TX_THEN_RX_MAX_LEN );
+        const size_t rdOffset = std::min( numRead, x * TX_THEN_RX_MAX_LEN );
+        const size_t wrLen    = std::min( TX_THEN_RX_MAX_LEN, numWrite - wrOffset );
+        const size_t rdLen    = std::min( TX_THEN_RX_MAX_LEN, numRead - rdOffset );
+
+        /*------------------------------------------------
+        Command preamble, then the data to write. The Bus Pirate answers once the
+        whole segment has been clocked out: 0x01 followed by the bytes read.
+        ------------------------------------------------*/
+        data = std::vector<uint8_t>{ command,
+                                     static_cast<uint8_t>( ( wrLen >> 8 ) & 0xFF ),
+                                     static_cast<uint8_t>( ( wrLen & 0xFF ) ),
+                                     static_cast<uint8_t>( ( rdLen >> 8 ) & 0xFF ),
+                                     static_cast<uint8_t>( ( rdLen & 0xFF ) ) };
+        data.insert( data.end(), transfer.writeData.begin() + wrOffset, transfer.writeData.begin() + wrOffset + wrLen );
+
+        segments.push_back( batch.add( data, rdLen + 1 ) );
+      }
+
+      if ( holdCS )
+      {
+        batch.add( { csHigh }, 1 );
+      }
 
       /*------------------------------------------------
-      Send and verify
+      The firmware can't accept more data while it is clocking a segment out, so
+      each command gets a wave of its own
       ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      busPirate.execute( batch, 1 );
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+      transfer.readData.clear();
+      transfer.readData.reserve( numRead );
+
+      for ( auto index : segments )
+      {
+        auto reply = batch.reply( index );
+
+        if ( reply.status != SPI::Status::OK )
+        {
+          result = SPI::Status::FAILED_READ;
+          break;
+        }
+
+        /* Remove the success byte from the returned data (0x01) */
+        transfer.readData.insert( transfer.readData.end(), reply.data + 1, reply.data + reply.length );
+      }
+
+      if ( holdCS && ( batch.reply( batch.size() - 1 ).status == SPI::Status::OK ) )
       {
-        reg_SPICfg = bitVals;
-        result     = SPI::Status::OK;
+        reg_CS |= SET_CS;
       }
 
       return result;
     }
 
-    Chimera::Status_t BinarySPI::cfgSPIClkEdge( const bool direction )
+    Chimera::Status_t BinarySPI::transferFrames( std::vector<SPIFrame> &frames )
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
-
-      /*------------------------------------------------
-      Build the command
-      ------------------------------------------------*/
-      uint8_t bitVals = reg_SPICfg;
-      if ( direction )
+      if ( sniffing )
       {
-        bitVals |= CFG_SPI_CPHA_ACT_TO_IDLE;
+        return SPI::Status::NOT_READY;
       }
-      else
+
+      if ( frames.empty() )
       {
-        bitVals &= CFG_SPI_CPHA_IDLE_TO_ACT;
+        return SPI::Status::INVAL_FUNC_PARAM;
       }
 
-      uint8_t command = CMD_CFG_SPI | ( bitVals & MSK_CFG_SPI );
+      for ( auto &frame : frames )
+      {
+        if ( ( frame.write.size() > TX_THEN_RX_MAX_LEN ) || ( frame.readLength > TX_THEN_RX_MAX_LEN ) )
+        {
+          return SPI::Status::INVAL_FUNC_PARAM;
+        }
+
+        frame.status = SPI::Status::FAIL;
+        frame.read.clear();
+      }
 
       /*------------------------------------------------
-      Send and verify
+      Once a frame's data is in, the firmware stops reading the UART until it has
+      clocked the frame and sent back the reply. Whatever arrives meanwhile waits in
+      the FIFO, so the next frame can follow straight away only if that fits.
       ------------------------------------------------*/
-      std::vector<uint8_t> cmd = { command };
-      auto rx                  = busPirate.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      const auto serial    = busPirate.serial;
+      const auto clock     = mapSpeedtoBits.right.find( reg_SPISpeed.applied );
+      uint64_t spiByte_nS  = 0;
+      uint64_t uartByte_nS = 0;
 
-      if ( rx.size() && rx[ 0 ] == BitBangCommands::success )
+      if ( serial && ( clock != mapSpeedtoBits.right.end() ) )
       {
-        reg_SPICfg = bitVals;
-        result     = SPI::Status::OK;
+        spiByte_nS  = ( 8ull * 1000000000ull ) / clock->second + BULK_BYTE_OVERHEAD_nS;
+        uartByte_nS = serial->wireTime_uS( 1000 );
       }
 
-      return result;
-    }
+      Chimera::Status_t result = SPI::Status::OK;
+      CommandBatch batch;
+      std::vector<uint8_t> data;
+      size_t first = 0;
 
-    Chimera::Status_t BinarySPI::reserve( const uint32_t timeout_ms )
-    {
-      return SPI::Status::NOT_SUPPORTED;
+      for ( size_t x = 0; x < frames.size(); x++ )
+      {
+        const auto &frame   = frames[ x ];
+        const size_t wrLen  = frame.write.size();
+        const size_t rdLen  = frame.readLength;
+        const uint64_t busy = ( wrLen + rdLen ) * spiByte_nS + ( rdLen + 1 ) * uartByte_nS;
+
+        data = std::vector<uint8_t>{ CMD_TX_THEN_RX_AUTO_CS,
+                                     static_cast<uint8_t>( ( wrLen >> 8 ) & 0xFF ),
+                                     static_cast<uint8_t>( ( wrLen & 0xFF ) ),
+                                     static_cast<uint8_t>( ( rdLen >> 8 ) & 0xFF ),
+                                     static_cast<uint8_t>( ( rdLen & 0xFF ) ) };
+        data.insert( data.end(), frame.write.begin(), frame.write.end() );
+        batch.add( data, rdLen + 1 );
+
+        if ( ( x + 1 < frames.size() ) && spiByte_nS && ( busy <= BULK_UART_FIFO_DEPTH * uartByte_nS ) )
+        {
+          continue;
+        }
+
+        /*------------------------------------------------
+        Send the wave and wait for its replies before going on
+        ------------------------------------------------*/
+        busPirate.execute( batch );
+
+        for ( size_t y = first; y <= x; y++ )
+        {
+          auto reply = batch.reply( y - first );
+
+          if ( reply.status != SPI::Status::OK )
+          {
+            result = SPI::Status::FAILED_READ;
+            break;
+          }
+
+          frames[ y ].read.assign( reply.data + 1, reply.data + reply.length );
+          frames[ y ].status = SPI::Status::OK;
+        }
+
+        if ( result != SPI::Status::OK )
+        {
+          break;
+        }
+
+        batch.clear();
+        first = x + 1;
+      }
+
+      return result;
     }
 
-    Chimera::Status_t BinarySPI::release( const uint32_t timeout_ms )
+    uint64_t BinarySPI::linkTime_uS( const size_t bytes ) const
     {
-      return SPI::Status::NOT_SUPPORTED;
+      return busPirate.serial ? busPirate.serial->wireTime_uS( bytes ) : 0;
     }
 
-    Chimera::Status_t BinarySPI::bulkTransfer( TXRXPacket_t &transfer )
+    void BinarySPI::sniffLoop()
     {
-      Chimera::Status_t result = SPI::Status::OK;
-      static constexpr uint8_t BULK_TRANSFER_MAX_LEN = 16;
+      using namespace std::chrono;
 
-      auto bytesWritten = 0;
-      auto bytesLeft    = transfer.writeData.size();
+      const auto serial = busPirate.serial;
+      std::vector<uint8_t> chunk( SNIFF_CHUNK_SIZE );
+      steady_clock::time_point deadline;
+      bool draining   = false;
+      uint64_t now_uS = 0;
 
-      if ( csMode != ChipSelectMode::MANUAL )
+      while ( true )
       {
-        setChipSelect( Chimera::GPIO::State::LOW );
-      }
+        size_t received   = 0;
+        const auto status = serial->readSome( chunk.data(), chunk.size(), received, SNIFF_QUIET_MS );
+        const auto now    = steady_clock::now();
 
-      while ( bytesLeft && ( result == SPI::Status::OK ) )
-      {
-        /*------------------------------------------------
-        Extract as many bytes as possible into the sub-transfer
-        ------------------------------------------------*/
-        std::vector<uint8_t> subTransfer;
-        if ( bytesLeft > BULK_TRANSFER_MAX_LEN )
+        now_uS = duration_cast<microseconds>( now - sniffStart ).count();
+
+        if ( status == SPI::Status::OK )
         {
-          /* Transfer the max number of bytes the bus pirate supports at once */
-          subTransfer = std::vector<uint8_t>( transfer.writeData.begin() + bytesWritten,
-                                              transfer.writeData.begin() + bytesWritten + BULK_TRANSFER_MAX_LEN );
+          sniffDecode( chunk.data(), received, now_uS );
         }
-        else
+        else if ( status != SPI::Status::EMPTY )
         {
-          /* Transfer only the remaining bytes (less than bus pirate max) */
-          subTransfer = std::vector<uint8_t>( transfer.writeData.begin() + bytesWritten,
-                                              transfer.writeData.begin() + bytesWritten + bytesLeft );
+          spdlog::error( "SPI sniffer lost the serial stream" );
+          break;
         }
 
         /*------------------------------------------------
-        Let the Bus Pirate know how many bytes we want to transfer.
-        0 == 1 byte TX
+        Once stopped, the ack or the first quiet read means the stream has ended
         ------------------------------------------------*/
-        uint8_t command = transfer.command | ( ( subTransfer.size() - 1 ) & MSK_BULK_SPI_TXFR_BYTES );
-        auto data       = std::vector<uint8_t>{ command };
-        auto out        = busPirate.sendResponsiveCommand( data, static_cast<uint32_t>( data.size() ) );
+        if ( draining && ( sniffStopAcked || ( status == SPI::Status::EMPTY ) || ( now >= deadline ) ) )
+        {
+          break;
+        }
+        else if ( !draining && snifferStopping )
+        {
+          draining = true;
+          deadline = now + milliseconds( SNIFF_STOP_TIMEOUT_MS );
+        }
+      }
+
+      if ( sniffInFrame )
+      {
+        sniffEmit( now_uS, false );
+      }
+    }
+
+    void BinarySPI::sniffDecode( const uint8_t *const data, const size_t length, const uint64_t now_uS )
+    {
+      for ( size_t x = 0; x < length; x++ )
+      {
+        const uint8_t byte = data[ x ];
 
         /*------------------------------------------------
-        If BP responds with a success, it's prepared to do the transfer. Send the data.
+        Inside a pair every byte is data, including ones that look like markers
         ------------------------------------------------*/
-        if ( out.size() && out[ 0 ] == BitBangCommands::success )
+        if ( sniffEscape == 2 )
         {
-          auto output = busPirate.sendResponsiveCommand( subTransfer, static_cast<uint32_t>( subTransfer.size() ) );
+          sniffMOSI   = byte;
+          sniffEscape = 1;
+          continue;
+        }
 
+        if ( sniffEscape == 1 )
+        {
           /*------------------------------------------------
-          Did we receive anything back?
+          Data with no frame open means the start was missed, so the frame
+          can't be complete
           ------------------------------------------------*/
-          if ( output.size() )
+          if ( !sniffInFrame )
           {
-            transfer.readData.insert(transfer.readData.end(), output.begin(), output.end());
-
-            bytesLeft -= output.size();
-            bytesWritten += output.size();
-          }
-          else
-          {
-            result = SPI::Status::FAILED_READ;
+            sniffFrame.start_uS = now_uS;
+            sniffFrame.complete = false;
+            sniffInFrame        = true;
           }
 
-          /*------------------------------------------------
-          Handle chip select options if enabled
-          ------------------------------------------------*/
-          if ( csMode == ChipSelectMode::AUTO_BETWEEN_TRANSFER )
-          {
-            setChipSelect( Chimera::GPIO::State::HIGH );
-            setChipSelect( Chimera::GPIO::State::LOW );
-          }
+          sniffFrame.mosi.push_back( sniffMOSI );
+          sniffFrame.miso.push_back( byte );
+          sniffEscape = 0;
+          continue;
         }
-      }
 
-      /*------------------------------------------------
-      Any state besides manual must disable the chip select line after the transfer
-      ------------------------------------------------*/
-      if ( csMode != ChipSelectMode::MANUAL )
-      {
-        setChipSelect( Chimera::GPIO::State::HIGH );
+        switch ( byte )
+        {
+          case SNIFF_ESCAPE:
+            sniffEscape = 2;
+            break;
+
+          case SNIFF_FRAME_START:
+            if ( sniffInFrame )
+            {
+              sniffEmit( now_uS, false );
+            }
+
+            sniffFrame.start_uS = now_uS;
+            sniffFrame.complete = true;
+            sniffInFrame        = true;
+            break;
+
+          case SNIFF_FRAME_END:
+            if ( sniffInFrame )
+            {
+              sniffEmit( now_uS, true );
+            }
+            break;
+
+          case SNIFF_STOP_ACK:
+            if ( snifferStopping && !sniffStopAcked )
+            {
+              sniffStopAcked = true;
+            }
+            else
+            {
+              sniffDecodeErrors++;
+            }
+            break;
+
+          default:
+            sniffDecodeErrors++;
+            break;
+        }
       }
 
-      return result;
+      sniffStreamBytes += length;
     }
 
-    Chimera::Status_t BinarySPI::writeThenRead( TXRXPacket_t &transfer )
+    void BinarySPI::sniffEmit( const uint64_t now_uS, const bool closed )
     {
-      Chimera::Status_t result = SPI::Status::FAIL;
-      std::vector<uint8_t> data;
-
-      /*------------------------------------------------
-      Send the command preamble
-      ------------------------------------------------*/
-      data = std::vector<uint8_t>{ transfer.command, static_cast<uint8_t>( ( transfer.numWriteBytes >> 8 ) & 0xFF ),
-                                   static_cast<uint8_t>( ( transfer.numWriteBytes & 0xFF ) ),
-                                   static_cast<uint8_t>( ( transfer.numReadBytes >> 8 ) & 0xFF ),
-                                   static_cast<uint8_t>( ( transfer.numReadBytes & 0xFF ) ) };
-      busPirate.sendCommand( data );
+      sniffFrame.end_uS   = now_uS;
+      sniffFrame.complete = sniffFrame.complete && closed;
 
-      /*------------------------------------------------
-      Send the actual data
-      ------------------------------------------------*/
-      auto out = busPirate.sendResponsiveCommand( transfer.writeData, transfer.numReadBytes + 1 );
+      if ( captureWriter.isOpen() && !captureWriter.append( sniffFrame ) )
+      {
+        captureOK = false;
+      }
 
-      if ( out.size() && out[ 0 ] == BitBangCommands::success )
+      if ( sniffSetup.queueTransactions )
       {
-        /* Remove the success byte from the returned data (0x01) */
-        transfer.readData = std::vector<uint8_t>( out.begin() + 1, out.end() );
+        std::lock_guard<std::mutex> lock( sniffMutex );
+        sniffQueue.push_back( std::move( sniffFrame ) );
       }
 
-      return result;
+      sniffTransactions++;
+      sniffFrame   = SPITransaction();
+      sniffInFrame = false;
     }
 
   }  // namespace BusPirate
@@ -14,13 +14,21 @@
 #define BUS_PIRATE_CPP_SPI_DRIVER_HPP
 
 /* C++ Includes */
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 /* Chimera Includes */
 #include <Chimera/interface.hpp>
 
 /* BusPirate Includes */
 #include "bus_pirate.hpp"
+#include "spi_capture.hpp"
 
 
 namespace HWInterface
@@ -43,6 +51,70 @@ namespace HWInterface
       SPEED_NOT_SUPPORTED = 9999999,
     };
 
+    /**
+     *  Which frames the sniffer reports, by the state of the chip select line
+     */
+    enum SniffMode : uint8_t
+    {
+      SNIFF_ALL     = 0x0D,
+      SNIFF_CS_LOW  = 0x0E,
+      SNIFF_CS_HIGH = 0x0F
+    };
+
+    struct SnifferSetup
+    {
+      SniffMode mode;          /**< Which frames to capture */
+      std::string capturePath; /**< Capture file to write, or empty for none */
+      bool queueTransactions;  /**< Keep transactions for readTransactions(), or only write them to the file */
+      size_t ringSize;         /**< Bytes of escaped stream the host can hold until the decoder gets to them */
+
+      SnifferSetup()
+      {
+        mode              = SNIFF_CS_LOW;
+        capturePath       = "";
+        queueTransactions = true;
+        ringSize          = 1024 * 1024;
+      }
+    };
+
+    struct SnifferStats
+    {
+      uint64_t streamBytes;   /**< Escaped stream bytes decoded */
+      uint64_t transactions;  /**< Transactions decoded */
+      uint64_t decodeErrors;  /**< Bytes that didn't fit the stream format and were skipped */
+      uint64_t overflowBytes; /**< Stream bytes lost because the ring filled up */
+    };
+
+    /**
+     *  One chip select cycle: bytes written, then bytes read
+     */
+    struct SPIFrame
+    {
+      std::vector<uint8_t> write; /**< Bytes clocked out first, up to 4096 */
+      size_t readLength;          /**< Bytes to clock in afterwards, up to 4096 */
+      std::vector<uint8_t> read;  /**< Receives the bytes read */
+      Chimera::Status_t status;   /**< OK once the frame ran */
+
+      SPIFrame() : readLength( 0 ), status( Chimera::CommonStatusCodes::FAIL )
+      {
+      }
+
+      SPIFrame( const std::vector<uint8_t> &write, const size_t readLength ) :
+          write( write ), readLength( readLength ), status( Chimera::CommonStatusCodes::FAIL )
+      {
+      }
+
+      /**
+       *	Bytes the frame costs on the serial link, both directions together
+       *
+       *	@return size_t
+       */
+      size_t linkBytes() const
+      {
+        return 5 + write.size() + 1 + readLength;
+      }
+    };
+
     class BinarySPI;
     using BinarySPI_sPtr = std::shared_ptr<BinarySPI>;
     using BinarySPI_uPtr = std::unique_ptr<BinarySPI>;
@@ -57,8 +129,8 @@ namespace HWInterface
        */
       BinarySPI( Device &device );
 
-      BinarySPI()  = default;
-      ~BinarySPI() = default;
+      BinarySPI() = default;
+      ~BinarySPI();
 
       Chimera::Status_t init( const Chimera::SPI::Setup &setupStruct ) noexcept override;
 
@@ -71,6 +143,9 @@ namespace HWInterface
       Chimera::Status_t writeBytes( const uint8_t *const txBuffer, const size_t length,
                                     const uint32_t timeoutMS = 10 ) noexcept override;
 
+      /**
+       *  Reads any number of bytes, clocking out 0xFF while doing so
+       */
       Chimera::Status_t readBytes( uint8_t *const rxBuffer, const size_t length,
                                    const uint32_t timeoutMS = 10 ) noexcept override;
 
@@ -145,6 +220,91 @@ namespace HWInterface
        */
       Chimera::Status_t cfgSPIClkEdge( const bool direction );
 
+      /**
+       *	Starts staging configuration changes. Until commitConfig() is called, the cfg
+       *  functions and setClockFrequency() only update the shadow registers, so that
+       *  several fields of a register can change with a single write.
+       *
+       *	@return void
+       */
+      void stageConfig();
+
+      /**
+       *	Writes every register that was changed while staging and stops staging.
+       *  Registers that didn't change aren't written at all.
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t commitConfig();
+
+      /**
+       *	Sets how long init() waits for the target to settle after switching the
+       *  power supplies on. There is no wait if the supplies were already on.
+       *
+       *	@param[in]	delay_mS      Settling time in milliseconds, 0 to skip it
+       *	@return void
+       */
+      void setPowerUpDelay( const uint32_t delay_mS );
+
+      /**
+       *	Gets how long the last call to init() took, from start to ready for traffic
+       *
+       *	@return uint64_t          Init latency in microseconds
+       */
+      uint64_t getInitLatency_uS() const;
+
+      /**
+       *	Puts the Bus Pirate into sniffer mode. It stops driving the bus and reports
+       *  every byte clocked on it as an escaped stream, which collects in the serial
+       *  port's background ring and is decoded into transactions on a separate thread.
+       *  Nothing else can be done on the bus until the sniffer is stopped.
+       *
+       *	@param[in]	setup         How to capture
+       *	@return Chimera::Status_t: FAIL if the board didn't enter the sniffer or the file couldn't be created
+       */
+      Chimera::Status_t startSniffer( const SnifferSetup &setup );
+
+      /**
+       *	Stops the sniffer, decodes whatever was still on its way and closes the
+       *  capture file. A frame cut off by stopping is kept, marked incomplete.
+       *
+       *	@return Chimera::Status_t: FAIL if the file couldn't be finished or the link brought back into step
+       */
+      Chimera::Status_t stopSniffer();
+
+      bool isSniffing() const;
+
+      /**
+       *	Takes the transactions decoded since the last call, oldest first
+       *
+       *	@param[out]	transactions  Receives the transactions, replacing its contents
+       *	@return size_t: Number of transactions
+       */
+      size_t readTransactions( std::vector<SPITransaction> &transactions );
+
+      SnifferStats getSnifferStats() const;
+
+      /**
+       *	Runs a sequence of frames, each in its own chip select cycle whatever the chip
+       *  select mode. A frame the firmware gets through before its UART FIFO could fill
+       *  up is sent back to back with the next, so a run of short frames costs a single
+       *  round trip. Only a frame that keeps the firmware busy for longer makes the host
+       *  wait for its reply before sending more.
+       *
+       *	@param[in]	frames        Frames to run, in order. Their read and status fields are
+       *                            filled in on return.
+       *	@return Chimera::Status_t: FAILED_READ if a frame failed, in which case none after it ran
+       */
+      Chimera::Status_t transferFrames( std::vector<SPIFrame> &frames );
+
+      /**
+       *	Time the serial link takes to carry a number of bytes at its current speed
+       *
+       *	@param[in]	bytes         Number of bytes
+       *	@return uint64_t          Wire time in microseconds
+       */
+      uint64_t linkTime_uS( const size_t bytes ) const;
+
     protected:
     private:
       Device busPirate;
@@ -152,23 +312,87 @@ namespace HWInterface
 
       bool systemInitialized;
 
-      uint8_t reg_PeriphCfg;
-      uint8_t reg_SPICfg;
+      bool stagingConfig;
+      uint32_t powerUpDelay_mS;
+      uint64_t initLatency_uS;
+
+      ShadowRegister reg_PeriphCfg;
+      ShadowRegister reg_SPICfg;
       uint8_t reg_CS;
-      uint8_t reg_SPISpeed;
+      ShadowRegister reg_SPISpeed;
 
       struct TXRXPacket_t
       {
         uint8_t command;
         uint16_t numWriteBytes;
-        uint16_t numReadBytes;
+        size_t numReadBytes; /**< Write-then-read splits anything over its 4096 byte limit */
         std::vector<uint8_t> writeData;
         std::vector<uint8_t> readData;
       };
 
+      Chimera::Status_t cfgField( ShadowRegister &reg, const uint8_t field, const bool state );
+
+      Chimera::Status_t writeRegister( ShadowRegister &reg, const uint8_t value );
+
+      Chimera::Status_t commitConfig( CommandBatch &batch );
+
       Chimera::Status_t bulkTransfer( TXRXPacket_t &transfer );
 
+      /**
+       *	Works out how far a bulk transfer can stream ahead of the replies at the current
+       *  SPI clock and baud rate without overrunning the Bus Pirate's UART FIFO
+       *
+       *	@return size_t: Window in bytes, 0 if the stream doesn't need throttling
+       */
+      size_t streamWindow() const;
+
       Chimera::Status_t writeThenRead( TXRXPacket_t &transfer );
+
+      /*------------------------------------------------
+      Sniffer state. The decoder thread owns the writer and the frame in progress.
+      ------------------------------------------------*/
+      std::thread snifferThread;
+      std::atomic<bool> sniffing;
+      std::atomic<bool> snifferStopping;
+      std::atomic<uint64_t> sniffStreamBytes;
+      std::atomic<uint64_t> sniffTransactions;
+      std::atomic<uint64_t> sniffDecodeErrors;
+
+      SnifferSetup sniffSetup;
+      SPICaptureWriter captureWriter;
+      bool captureOK;
+      std::chrono::steady_clock::time_point sniffStart;
+
+      SPITransaction sniffFrame;
+      bool sniffInFrame;
+      uint8_t sniffEscape; /**< Bytes of a MOSI/MISO pair still to come */
+      uint8_t sniffMOSI;
+      bool sniffStopAcked; /**< The 0x01 answering the stop command has been seen */
+
+      std::mutex sniffMutex;
+      std::deque<SPITransaction> sniffQueue;
+
+      void sniffLoop();
+
+      /**
+       *	Decodes a piece of the escaped stream, carrying a frame or pair that is split
+       *  across pieces over to the next call
+       *
+       *	@param[in]	data          Stream bytes
+       *	@param[in]	length        Number of bytes
+       *	@param[in]	now_uS        Host time the bytes were read, from the start of the capture
+       *	@return void
+       */
+      void sniffDecode( const uint8_t *const data, const size_t length, const uint64_t now_uS );
+
+      /**
+       *	Hands the frame in progress to the capture file and the queue
+       *
+       *	@param[in]	now_uS        Host time the frame ended, from the start of the capture
+       *	@param[in]	closed        The frame ended on its chip select edge rather than being cut off
+       *	@return void
+       */
+      void sniffEmit( const uint64_t now_uS, const bool closed );
     };
 
   }  // namespace BusPirate
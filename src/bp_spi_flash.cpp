@@ -0,0 +1,747 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_spi_flash.cpp
+ *
+ *   Description:
+ *       Implements the SPI NOR flash host on top of the binary SPI interface
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_spi_flash.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Commands every SPI NOR flash understands
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_WRITE_ENABLE  = 0x06;
+    static constexpr uint8_t CMD_READ_STATUS   = 0x05;
+    static constexpr uint8_t CMD_PAGE_PROGRAM  = 0x02;
+    static constexpr uint8_t CMD_FAST_READ     = 0x0B;
+    static constexpr uint8_t CMD_READ_JEDEC_ID = 0x9F;
+    static constexpr uint8_t CMD_READ_SFDP     = 0x5A;
+
+    static constexpr uint8_t STATUS_WIP = ( 1u << 0 );
+    static constexpr uint8_t STATUS_WEL = ( 1u << 1 );
+
+    /*------------------------------------------------
+    Fast reads and SFDP reads take 8 dummy clocks after the address
+    ------------------------------------------------*/
+    static constexpr size_t ADDRESS_BYTES = 3;
+    static constexpr size_t DUMMY_BYTES   = 1;
+    static constexpr uint32_t MAX_SIZE    = ( 1u << ( 8 * ADDRESS_BYTES ) );
+
+    /*------------------------------------------------
+    Most the firmware reads in one frame, and how much of a read or program goes
+    through transferFrames() at once
+    ------------------------------------------------*/
+    static constexpr size_t READ_FRAME_SIZE     = 4096;
+    static constexpr size_t READ_FRAMES_PER_RUN = 16;
+    static constexpr size_t PAGES_PER_RUN       = 64;
+
+    /*------------------------------------------------
+    Status polls per round trip while waiting on the flash, the most polls sent
+    ahead of a page program, and how many times a page or erase is tried before
+    giving up on the flash ever enabling writes
+    ------------------------------------------------*/
+    static constexpr size_t READY_POLLS_PER_RUN   = 8;
+    static constexpr size_t MAX_SPECULATIVE_POLLS = 8;
+    static constexpr size_t MAX_ATTEMPTS          = 3;
+
+    /*------------------------------------------------
+    SFDP header and the basic flash parameter table (JESD216)
+    ------------------------------------------------*/
+    static constexpr uint32_t SFDP_SIGNATURE      = 0x50444653; /**< "SFDP" */
+    static constexpr size_t SFDP_HEADER_SIZE      = 8;
+    static constexpr size_t SFDP_MIN_BASIC_DWORDS = 9;
+    static constexpr size_t SFDP_MAX_BASIC_DWORDS = 16;
+    static constexpr uint8_t SFDP_BASIC_ID_LSB    = 0x00;
+    static constexpr uint8_t SFDP_BASIC_ID_MSB    = 0xFF;
+
+    static constexpr uint32_t BFPT_4K_ERASE_MASK    = 0x00000003;
+    static constexpr uint32_t BFPT_4K_ERASE_OK      = 0x00000001;
+    static constexpr uint32_t BFPT_ADDRESS_MASK     = 0x00060000;
+    static constexpr uint32_t BFPT_ADDRESS_4_ONLY   = 0x00040000;
+    static constexpr uint32_t BFPT_DENSITY_EXPONENT = 0x80000000;
+
+    /*------------------------------------------------
+    What to assume for a flash without SFDP
+    ------------------------------------------------*/
+    static constexpr uint32_t DEFAULT_PAGE_SIZE       = 256;
+    static constexpr uint32_t DEFAULT_PAGE_PROGRAM_US = 700;
+    static constexpr FlashEraseType DEFAULT_SECTOR    = { 4096, 0x20 };
+    static constexpr FlashEraseType DEFAULT_BLOCK     = { 65536, 0xD8 };
+
+    static void putAddress( std::vector<uint8_t> &cmd, const uint32_t address )
+    {
+      cmd.push_back( static_cast<uint8_t>( address >> 16 ) );
+      cmd.push_back( static_cast<uint8_t>( address >> 8 ) );
+      cmd.push_back( static_cast<uint8_t>( address ) );
+    }
+
+    static uint32_t getDword( const uint8_t *const data )
+    {
+      return static_cast<uint32_t>( data[ 0 ] ) | ( static_cast<uint32_t>( data[ 1 ] ) << 8 )
+             | ( static_cast<uint32_t>( data[ 2 ] ) << 16 ) | ( static_cast<uint32_t>( data[ 3 ] ) << 24 );
+    }
+
+    /*------------------------------------------------
+    A busy flash keeps WEL set until its last program or erase finishes, so a write
+    enable only took if the status read after it shows WEL on an idle flash
+    ------------------------------------------------*/
+    static bool writeEnabled( const uint8_t status )
+    {
+      return ( status & ( STATUS_WIP | STATUS_WEL ) ) == STATUS_WEL;
+    }
+
+    static uint64_t elapsed_uS( const std::chrono::steady_clock::time_point &start )
+    {
+      using namespace std::chrono;
+      return static_cast<uint64_t>( duration_cast<microseconds>( steady_clock::now() - start ).count() );
+    }
+
+
+    SPIFlash::SPIFlash( Device &device ) : spi( device )
+    {
+      systemInitialized = false;
+      eraseTimeout_mS   = SPIFlashSetup().eraseTimeout_mS;
+      speculativePolls  = 0;
+
+      resetPhaseStats();
+    }
+
+    Chimera::Status_t SPIFlash::init( const SPIFlashSetup &setupStruct ) noexcept
+    {
+      eraseTimeout_mS = setupStruct.eraseTimeout_mS;
+
+      Chimera::Status_t result = spi.init( setupStruct.spi );
+
+      if ( result == Status::OK )
+      {
+        systemInitialized = true;
+        result            = discover();
+      }
+
+      systemInitialized = ( result == Status::OK );
+
+      if ( !systemInitialized )
+      {
+        spdlog::error( "Failed SPI flash initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::deInit() noexcept
+    {
+      systemInitialized = false;
+      return spi.deInit();
+    }
+
+    Chimera::Status_t SPIFlash::discover() noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      std::array<uint8_t, 3> id;
+      Chimera::Status_t result = readJEDECID( id );
+
+      if ( result != Status::OK )
+      {
+        return result;
+      }
+
+      if ( std::all_of( id.begin(), id.end(), []( uint8_t b ) { return b == 0xFF; } )
+           || std::all_of( id.begin(), id.end(), []( uint8_t b ) { return b == 0x00; } ) )
+      {
+        spdlog::error( "No SPI flash answered the JEDEC ID command" );
+        return Status::NOT_SUPPORTED;
+      }
+
+      geometry         = FlashGeometry();
+      geometry.jedecID = id;
+
+      /*------------------------------------------------
+      Without SFDP, the capacity byte is log2 of the size on nearly every part
+      ------------------------------------------------*/
+      if ( parseSFDP() != Status::OK )
+      {
+        geometry.size           = ( id[ 2 ] < 32 ) ? ( 1u << id[ 2 ] ) : 0;
+        geometry.pageSize       = DEFAULT_PAGE_SIZE;
+        geometry.eraseTypes     = { { DEFAULT_SECTOR, DEFAULT_BLOCK } };
+        geometry.pageProgram_uS = DEFAULT_PAGE_PROGRAM_US;
+      }
+
+      if ( !geometry.size || ( geometry.size > MAX_SIZE ) )
+      {
+        spdlog::error( "SPI flash {:02X} {:02X} {:02X} needs 4 byte addresses", id[ 0 ], id[ 1 ], id[ 2 ] );
+        return Status::NOT_SUPPORTED;
+      }
+
+      /*------------------------------------------------
+      Start out polling for about the typical program time after every page
+      ------------------------------------------------*/
+      const SPIFrame poll( { CMD_READ_STATUS }, 1 );
+      const uint64_t poll_uS = std::max<uint64_t>( 1, spi.linkTime_uS( poll.linkBytes() ) );
+
+      speculativePolls = std::min<size_t>( MAX_SPECULATIVE_POLLS, ( geometry.pageProgram_uS + poll_uS - 1 ) / poll_uS );
+
+      spdlog::info( "SPI flash {:02X} {:02X} {:02X}: {} KB, {} byte pages, layout from {}", id[ 0 ], id[ 1 ], id[ 2 ],
+                    geometry.size / 1024, geometry.pageSize, geometry.sfdp ? "SFDP" : "the JEDEC ID" );
+
+      return Status::OK;
+    }
+
+    const FlashGeometry &SPIFlash::getGeometry() const noexcept
+    {
+      return geometry;
+    }
+
+    Chimera::Status_t SPIFlash::readJEDECID( std::array<uint8_t, 3> &id ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      std::vector<SPIFrame> frames = { SPIFrame( { CMD_READ_JEDEC_ID }, id.size() ) };
+      Chimera::Status_t result     = run( nullptr, frames );
+
+      if ( result == Status::OK )
+      {
+        std::copy( frames[ 0 ].read.begin(), frames[ 0 ].read.end(), id.begin() );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::readSFDP( const uint32_t address, uint8_t *const data, const size_t length ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( !data || !length || ( length > READ_FRAME_SIZE ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      std::vector<uint8_t> cmd = { CMD_READ_SFDP };
+      putAddress( cmd, address );
+      cmd.resize( cmd.size() + DUMMY_BYTES, 0 );
+
+      std::vector<SPIFrame> frames = { SPIFrame( cmd, length ) };
+      Chimera::Status_t result     = run( nullptr, frames );
+
+      if ( result == Status::OK )
+      {
+        memcpy( data, frames[ 0 ].read.data(), length );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::read( const uint32_t address, uint8_t *const data, const size_t length ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( !data || !length || ( address + length > geometry.size ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      Chimera::Status_t result = Status::OK;
+      FlashPhaseStats &charge  = stats[ FLASH_PHASE_READ ];
+      const auto before        = charge;
+      const auto start         = std::chrono::steady_clock::now();
+
+      std::vector<SPIFrame> frames;
+      std::vector<uint8_t> cmd;
+
+      for ( size_t offset = 0; ( offset < length ) && ( result == Status::OK ); )
+      {
+        frames.clear();
+
+        for ( size_t x = 0; ( x < READ_FRAMES_PER_RUN ) && ( offset + x * READ_FRAME_SIZE < length ); x++ )
+        {
+          const size_t at = offset + x * READ_FRAME_SIZE;
+
+          cmd.assign( 1, CMD_FAST_READ );
+          putAddress( cmd, static_cast<uint32_t>( address + at ) );
+          cmd.resize( cmd.size() + DUMMY_BYTES, 0 );
+
+          frames.emplace_back( cmd, std::min( READ_FRAME_SIZE, length - at ) );
+        }
+
+        result = run( &charge, frames );
+
+        for ( size_t x = 0; ( x < frames.size() ) && ( result == Status::OK ); x++ )
+        {
+          memcpy( data + offset, frames[ x ].read.data(), frames[ x ].read.size() );
+          offset += frames[ x ].read.size();
+        }
+      }
+
+      charge.bytes += ( result == Status::OK ) ? length : 0;
+      charge.elapsed_uS += elapsed_uS( start );
+      report( FLASH_PHASE_READ, before );
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::erase( const uint32_t address, const size_t length ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      const uint32_t smallest = geometry.eraseTypes[ 0 ].size;
+
+      if ( !length || !smallest || ( address % smallest ) || ( length % smallest ) || ( address + length > geometry.size ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      FlashPhaseStats &charge  = stats[ FLASH_PHASE_ERASE ];
+      const auto before        = charge;
+      const auto start         = std::chrono::steady_clock::now();
+      Chimera::Status_t result = pollReady( &charge, eraseTimeout_mS );
+
+      std::vector<SPIFrame> frames;
+      std::vector<uint8_t> cmd;
+      size_t attempts = 0;
+
+      for ( size_t offset = 0; ( offset < length ) && ( result == Status::OK ); )
+      {
+        const uint32_t at   = static_cast<uint32_t>( address + offset );
+        FlashEraseType type = geometry.eraseTypes[ 0 ];
+
+        for ( const auto &candidate : geometry.eraseTypes )
+        {
+          if ( candidate.size && !( at % candidate.size ) && ( length - offset >= candidate.size )
+               && ( candidate.size > type.size ) )
+          {
+            type = candidate;
+          }
+        }
+
+        /*------------------------------------------------
+        The status read in the middle shows whether the write enable took
+        ------------------------------------------------*/
+        cmd.assign( 1, type.opcode );
+        putAddress( cmd, at );
+
+        frames = { SPIFrame( { CMD_WRITE_ENABLE }, 0 ), SPIFrame( { CMD_READ_STATUS }, 1 ), SPIFrame( cmd, 0 ) };
+        result = run( &charge, frames );
+
+        if ( ( result == Status::OK ) && !writeEnabled( frames[ 1 ].read[ 0 ] ) )
+        {
+          charge.retries++;
+
+          if ( ++attempts == MAX_ATTEMPTS )
+          {
+            spdlog::error( "SPI flash won't enable writes" );
+            result = Status::FAIL;
+          }
+          else
+          {
+            result = pollReady( &charge, eraseTimeout_mS );
+          }
+
+          continue;
+        }
+
+        result   = pollReady( &charge, eraseTimeout_mS );
+        attempts = 0;
+        offset += type.size;
+      }
+
+      charge.bytes += ( result == Status::OK ) ? length : 0;
+      charge.elapsed_uS += elapsed_uS( start );
+      report( FLASH_PHASE_ERASE, before );
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::program( const uint32_t address, const uint8_t *const data, const size_t length ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( !data || !length || ( address + length > geometry.size ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      struct Page
+      {
+        uint32_t address;
+        size_t offset;
+        size_t length;
+        size_t attempts;
+      };
+
+      FlashPhaseStats &charge  = stats[ FLASH_PHASE_PROGRAM ];
+      const auto before        = charge;
+      const auto start         = std::chrono::steady_clock::now();
+      Chimera::Status_t result = pollReady( &charge, eraseTimeout_mS );
+
+      /*------------------------------------------------
+      Split the range on page boundaries, since a program wraps around within its page
+      ------------------------------------------------*/
+      std::vector<Page> pages;
+
+      for ( size_t offset = 0; offset < length; )
+      {
+        const uint32_t at  = static_cast<uint32_t>( address + offset );
+        const size_t chunk = std::min<size_t>( geometry.pageSize - ( at % geometry.pageSize ), length - offset );
+
+        pages.push_back( { at, offset, chunk, 0 } );
+        offset += chunk;
+      }
+
+      std::vector<SPIFrame> frames;
+      std::vector<Page> retry;
+      std::vector<uint8_t> cmd;
+
+      for ( size_t next = 0; ( next < pages.size() || !retry.empty() ) && ( result == Status::OK ); )
+      {
+        /*------------------------------------------------
+        Pages that didn't take go first, then the next lot of new ones
+        ------------------------------------------------*/
+        std::vector<Page> batch;
+        batch.swap( retry );
+
+        while ( ( batch.size() < PAGES_PER_RUN ) && ( next < pages.size() ) )
+        {
+          batch.push_back( pages[ next++ ] );
+        }
+
+        /*------------------------------------------------
+        Each page: status polls to cover the last program, a write enable, a status
+        read to check it took, then the program itself
+        ------------------------------------------------*/
+        const size_t framesPerPage = speculativePolls + 3;
+        frames.clear();
+
+        for ( const auto &page : batch )
+        {
+          for ( size_t x = 0; x < speculativePolls; x++ )
+          {
+            frames.emplace_back( std::vector<uint8_t>{ CMD_READ_STATUS }, 1 );
+          }
+
+          cmd.assign( 1, CMD_PAGE_PROGRAM );
+          putAddress( cmd, page.address );
+          cmd.insert( cmd.end(), data + page.offset, data + page.offset + page.length );
+
+          frames.emplace_back( std::vector<uint8_t>{ CMD_WRITE_ENABLE }, 0 );
+          frames.emplace_back( std::vector<uint8_t>{ CMD_READ_STATUS }, 1 );
+          frames.emplace_back( cmd, 0 );
+        }
+
+        result = run( &charge, frames );
+
+        if ( result != Status::OK )
+        {
+          break;
+        }
+
+        /*------------------------------------------------
+        Tune the polls: more if a page had to wait, fewer if even the first poll
+        of every page found the flash idle
+        ------------------------------------------------*/
+        bool pollsToSpare = ( speculativePolls > 0 );
+
+        for ( size_t x = 0; x < batch.size(); x++ )
+        {
+          const SPIFrame *const page = &frames[ x * framesPerPage ];
+
+          if ( speculativePolls && ( page[ 0 ].read[ 0 ] & STATUS_WIP ) && x )
+          {
+            pollsToSpare = false;
+          }
+
+          const uint8_t status = page[ speculativePolls + 1 ].read[ 0 ];
+
+          if ( writeEnabled( status ) )
+          {
+            continue;
+          }
+
+          /*------------------------------------------------
+          Still busy with the page before just means the polls fell short. Only
+          an idle flash refusing the enable counts against the page.
+          ------------------------------------------------*/
+          if ( !( status & STATUS_WIP ) && ( ++batch[ x ].attempts == MAX_ATTEMPTS ) )
+          {
+            spdlog::error( "SPI flash won't enable writes" );
+            result = Status::FAIL;
+            break;
+          }
+
+          retry.push_back( batch[ x ] );
+        }
+
+        if ( !retry.empty() )
+        {
+          charge.retries += retry.size();
+          speculativePolls = std::min( MAX_SPECULATIVE_POLLS, speculativePolls + 1 );
+          pollsToSpare     = false;
+        }
+
+        if ( pollsToSpare )
+        {
+          speculativePolls--;
+        }
+
+        if ( result == Status::OK )
+        {
+          result = pollReady( &charge, eraseTimeout_mS );
+        }
+      }
+
+      charge.bytes += ( result == Status::OK ) ? length : 0;
+      charge.elapsed_uS += elapsed_uS( start );
+      report( FLASH_PHASE_PROGRAM, before );
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::waitReady( const uint32_t timeout_mS ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      return pollReady( nullptr, timeout_mS );
+    }
+
+    void SPIFlash::setSpeculativePolls( const size_t polls ) noexcept
+    {
+      speculativePolls = std::min( MAX_SPECULATIVE_POLLS, polls );
+    }
+
+    FlashPhaseStats SPIFlash::getPhaseStats( const FlashPhase phase ) const noexcept
+    {
+      return ( phase < FLASH_PHASE_NUM_OPTIONS ) ? stats[ phase ] : FlashPhaseStats();
+    }
+
+    void SPIFlash::resetPhaseStats() noexcept
+    {
+      stats.fill( FlashPhaseStats() );
+    }
+
+    Chimera::Status_t SPIFlash::run( FlashPhaseStats *const charge, std::vector<SPIFrame> &frames )
+    {
+      Chimera::Status_t result = spi.transferFrames( frames );
+
+      if ( charge )
+      {
+        size_t bytes = 0;
+
+        for ( const auto &frame : frames )
+        {
+          bytes += frame.linkBytes();
+        }
+
+        charge->linkBytes += bytes;
+        charge->linkTime_uS += spi.linkTime_uS( bytes );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t SPIFlash::pollReady( FlashPhaseStats *const charge, const uint32_t timeout_mS )
+    {
+      using namespace std::chrono;
+
+      const auto deadline          = steady_clock::now() + milliseconds( timeout_mS );
+      std::vector<SPIFrame> frames = std::vector<SPIFrame>( READY_POLLS_PER_RUN, SPIFrame( { CMD_READ_STATUS }, 1 ) );
+
+      while ( true )
+      {
+        Chimera::Status_t result = run( charge, frames );
+
+        if ( result != Status::OK )
+        {
+          return result;
+        }
+
+        for ( const auto &frame : frames )
+        {
+          if ( !( frame.read[ 0 ] & STATUS_WIP ) )
+          {
+            return Status::OK;
+          }
+        }
+
+        if ( steady_clock::now() >= deadline )
+        {
+          spdlog::error( "SPI flash stayed busy for over {} ms", timeout_mS );
+          return Status::TIMEOUT;
+        }
+      }
+    }
+
+    Chimera::Status_t SPIFlash::parseSFDP()
+    {
+      std::array<uint8_t, SFDP_HEADER_SIZE> header;
+
+      if ( ( readSFDP( 0, header.data(), header.size() ) != Status::OK )
+           || ( getDword( header.data() ) != SFDP_SIGNATURE ) )
+      {
+        return Status::NOT_SUPPORTED;
+      }
+
+      /*------------------------------------------------
+      Find the basic flash parameter table among the parameter headers
+      ------------------------------------------------*/
+      const size_t numHeaders = header[ 6 ] + 1u;
+      std::vector<uint8_t> params( numHeaders * SFDP_HEADER_SIZE );
+
+      if ( readSFDP( SFDP_HEADER_SIZE, params.data(), params.size() ) != Status::OK )
+      {
+        return Status::NOT_SUPPORTED;
+      }
+
+      uint32_t pointer = 0;
+      size_t dwords    = 0;
+
+      for ( size_t x = 0; x < numHeaders; x++ )
+      {
+        const uint8_t *const param = &params[ x * SFDP_HEADER_SIZE ];
+
+        if ( ( param[ 0 ] == SFDP_BASIC_ID_LSB ) && ( param[ 7 ] == SFDP_BASIC_ID_MSB ) )
+        {
+          dwords  = param[ 3 ];
+          pointer = param[ 4 ] | ( param[ 5 ] << 8 ) | ( param[ 6 ] << 16 );
+          break;
+        }
+      }
+
+      if ( dwords < SFDP_MIN_BASIC_DWORDS )
+      {
+        return Status::NOT_SUPPORTED;
+      }
+
+      dwords = std::min( dwords, SFDP_MAX_BASIC_DWORDS );
+      std::vector<uint8_t> table( dwords * 4 );
+
+      if ( readSFDP( pointer, table.data(), table.size() ) != Status::OK )
+      {
+        return Status::NOT_SUPPORTED;
+      }
+
+      const auto dword = [ &table ]( const size_t number ) { return getDword( &table[ ( number - 1 ) * 4 ] ); };
+
+      /*------------------------------------------------
+      Density is in bits, either as the count less one or as a power of two
+      ------------------------------------------------*/
+      const uint32_t density = dword( 2 );
+      uint64_t bits          = 0;
+
+      if ( density & BFPT_DENSITY_EXPONENT )
+      {
+        const uint32_t exponent = density & ~BFPT_DENSITY_EXPONENT;
+        bits                    = ( exponent < 64 ) ? ( 1ull << exponent ) : 0;
+      }
+      else
+      {
+        bits = static_cast<uint64_t>( density ) + 1;
+      }
+
+      geometry.size = ( ( dword( 1 ) & BFPT_ADDRESS_MASK ) == BFPT_ADDRESS_4_ONLY ) || ( bits / 8 > MAX_SIZE )
+                          ? 0
+                          : static_cast<uint32_t>( bits / 8 );
+
+      /*------------------------------------------------
+      Up to four erase types, each a size exponent and an opcode
+      ------------------------------------------------*/
+      size_t numErase = 0;
+
+      for ( size_t x = 0; x < geometry.eraseTypes.size(); x++ )
+      {
+        const uint32_t pair = ( dword( 8 + x / 2 ) >> ( 16 * ( x % 2 ) ) ) & 0xFFFF;
+        const uint8_t size  = pair & 0xFF;
+
+        if ( size && ( size < 32 ) )
+        {
+          geometry.eraseTypes[ numErase++ ] = { 1u << size, static_cast<uint8_t>( pair >> 8 ) };
+        }
+      }
+
+      if ( !numErase && ( ( dword( 1 ) & BFPT_4K_ERASE_MASK ) == BFPT_4K_ERASE_OK ) )
+      {
+        geometry.eraseTypes[ numErase++ ] = { DEFAULT_SECTOR.size, static_cast<uint8_t>( dword( 1 ) >> 8 ) };
+      }
+
+      std::sort( geometry.eraseTypes.begin(), geometry.eraseTypes.begin() + numErase,
+                 []( const FlashEraseType &a, const FlashEraseType &b ) { return a.size < b.size; } );
+
+      /*------------------------------------------------
+      JESD216B added the page size and program times
+      ------------------------------------------------*/
+      geometry.pageSize       = DEFAULT_PAGE_SIZE;
+      geometry.pageProgram_uS = DEFAULT_PAGE_PROGRAM_US;
+
+      if ( dwords >= 11 )
+      {
+        const uint32_t timing = dword( 11 );
+        const uint32_t units  = ( timing & ( 1u << 13 ) ) ? 64 : 8;
+
+        geometry.pageSize       = 1u << ( ( timing >> 4 ) & 0x0F );
+        geometry.pageProgram_uS = ( ( ( timing >> 8 ) & 0x1F ) + 1 ) * units;
+      }
+
+      if ( !numErase )
+      {
+        return Status::NOT_SUPPORTED;
+      }
+
+      geometry.sfdp = true;
+
+      return Status::OK;
+    }
+
+    void SPIFlash::report( const FlashPhase phase, const FlashPhaseStats &before ) const
+    {
+      static const std::array<const char *, FLASH_PHASE_NUM_OPTIONS> names = { { "Read", "Erased", "Programmed" } };
+
+      const auto &after    = stats[ phase ];
+      const uint64_t bytes = after.bytes - before.bytes;
+      const uint64_t time  = std::max<uint64_t>( 1, after.elapsed_uS - before.elapsed_uS );
+      const uint64_t link  = after.linkTime_uS - before.linkTime_uS;
+      const uint64_t rate  = ( bytes * 1000000 ) / time;
+      const uint64_t usage = ( link * 100 ) / time;
+
+      spdlog::info( "{} {} bytes in {} ms: {} B/s, link busy {}% of the time, {} retries", names[ phase ], bytes,
+                    time / 1000, rate, usage, after.retries - before.retries );
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
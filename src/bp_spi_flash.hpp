@@ -0,0 +1,269 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_spi_flash.hpp
+ *
+ *   Description:
+ *       Reads, erases and programs SPI NOR flash through the Bus Pirate's binary
+ *       SPI mode
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_SPI_FLASH_HPP
+#define BUS_PIRATE_CPP_SPI_FLASH_HPP
+
+/* C++ Includes */
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+#include "bp_spi.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  An erase size the flash supports and the command for it
+     */
+    struct FlashEraseType
+    {
+      uint32_t size; /**< Bytes erased, 0 if the slot is unused */
+      uint8_t opcode;
+    };
+
+    /**
+     *  What the flash is and how it is laid out, as discovered by SPIFlash::discover()
+     */
+    struct FlashGeometry
+    {
+      std::array<uint8_t, 3> jedecID;           /**< Manufacturer, memory type, capacity */
+      uint32_t size;                            /**< Bytes */
+      uint32_t pageSize;                        /**< Most bytes one page program can write */
+      std::array<FlashEraseType, 4> eraseTypes; /**< Smallest first */
+      uint32_t pageProgram_uS;                  /**< Typical page program time */
+      bool sfdp;                                /**< Read from the SFDP tables rather than guessed from the ID */
+
+      FlashGeometry()
+      {
+        jedecID        = {};
+        size           = 0;
+        pageSize       = 0;
+        eraseTypes     = {};
+        pageProgram_uS = 0;
+        sfdp           = false;
+      }
+    };
+
+    /**
+     *  The parts of a flash job throughput is reported for
+     */
+    enum FlashPhase : uint8_t
+    {
+      FLASH_PHASE_READ,
+      FLASH_PHASE_ERASE,
+      FLASH_PHASE_PROGRAM,
+
+      FLASH_PHASE_NUM_OPTIONS
+    };
+
+    struct FlashPhaseStats
+    {
+      uint64_t bytes;       /**< Flash bytes read, erased or programmed */
+      uint64_t linkBytes;   /**< Serial bytes it took, both directions together */
+      uint64_t linkTime_uS; /**< Time the link needs to carry those bytes */
+      uint64_t elapsed_uS;  /**< Time it actually took */
+      uint64_t retries;     /**< Pages or erases sent again because the flash was still busy */
+    };
+
+    struct SPIFlashSetup
+    {
+      Chimera::SPI::Setup spi;  /**< Bus settings, mode 0 or 3 */
+      uint32_t eraseTimeout_mS; /**< Longest a single erase may take */
+
+      SPIFlashSetup()
+      {
+        spi.clockMode      = Chimera::SPI::ClockMode::MODE0;
+        spi.clockFrequency = SPEED_1MHz;
+        eraseTimeout_mS    = 2000;
+      }
+    };
+
+    class SPIFlash;
+    using SPIFlash_sPtr = std::shared_ptr<SPIFlash>;
+    using SPIFlash_uPtr = std::unique_ptr<SPIFlash>;
+
+    /**
+     *  Host for SPI NOR flash using 3 byte addresses, so up to 16MB.
+     *
+     *  Everything goes out as write-then-read frames through BinarySPI::transferFrames(),
+     *  which sends the short ones back to back. Page programs are speculative: each page
+     *  goes out as a few status polls, a write enable, a status read and the program
+     *  itself, all in one stream. The flash ignores a write enable while it is busy and
+     *  a program without one, so if the status read shows the enable didn't take, the
+     *  page is just sent again later. The polls are tuned as it goes so that hardly ever
+     *  happens, leaving the serial link as the limit.
+     */
+    class SPIFlash
+    {
+    public:
+      /**
+       *  Primary constructor for creating the flash interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      SPIFlash( Device &device );
+
+      SPIFlash()  = default;
+      ~SPIFlash() = default;
+
+      /**
+       *  Sets up SPI mode and discovers the flash
+       */
+      Chimera::Status_t init( const SPIFlashSetup &setupStruct ) noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Reads the JEDEC ID and then the SFDP tables, falling back on the ID's capacity
+       *  byte and the usual 4KB/64KB erases if the flash has none
+       *
+       *	@return Chimera::Status_t: NOT_SUPPORTED if nothing answered or the flash needs 4 byte addresses
+       */
+      Chimera::Status_t discover() noexcept;
+
+      const FlashGeometry &getGeometry() const noexcept;
+
+      /**
+       *	Reads the manufacturer, memory type and capacity bytes
+       *
+       *	@param[out]	id            Receives the three bytes
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t readJEDECID( std::array<uint8_t, 3> &id ) noexcept;
+
+      /**
+       *	Reads from the SFDP address space
+       *
+       *	@param[in]	address       SFDP address
+       *	@param[out]	data          Receives the bytes
+       *	@param[in]	length        Number of bytes, up to 4096
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t readSFDP( const uint32_t address, uint8_t *const data, const size_t length ) noexcept;
+
+      /**
+       *	Reads with the fast read command, as many whole frames as the firmware takes
+       *
+       *	@param[in]	address       Flash address
+       *	@param[out]	data          Receives the bytes
+       *	@param[in]	length        Number of bytes
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t read( const uint32_t address, uint8_t *const data, const size_t length ) noexcept;
+
+      /**
+       *	Erases a range with the largest erases that fit it
+       *
+       *	@param[in]	address       Flash address, aligned to the smallest erase
+       *	@param[in]	length        Number of bytes, a multiple of the smallest erase
+       *	@return Chimera::Status_t: TIMEOUT if an erase didn't finish in time
+       */
+      Chimera::Status_t erase( const uint32_t address, const size_t length ) noexcept;
+
+      /**
+       *	Programs a range, which must already be erased
+       *
+       *	@param[in]	address       Flash address
+       *	@param[in]	data          Bytes to program
+       *	@param[in]	length        Number of bytes
+       *	@return Chimera::Status_t: TIMEOUT if the flash stayed busy
+       */
+      Chimera::Status_t program( const uint32_t address, const uint8_t *const data, const size_t length ) noexcept;
+
+      /**
+       *	Polls the status register until the flash isn't busy
+       *
+       *	@param[in]	timeout_mS    How long to keep polling
+       *	@return Chimera::Status_t: TIMEOUT if it stayed busy
+       */
+      Chimera::Status_t waitReady( const uint32_t timeout_mS ) noexcept;
+
+      /**
+       *	Overrides how many status polls go ahead of each page's write enable. Tuning
+       *  carries on from there during the next program.
+       *
+       *	@param[in]	polls         Polls per page, capped at the most the tuning would use
+       *	@return void
+       */
+      void setSpeculativePolls( const size_t polls ) noexcept;
+
+      /**
+       *	Gets the totals for a phase since the stats were last reset
+       *
+       *	@param[in]	phase         Which phase
+       *	@return FlashPhaseStats
+       */
+      FlashPhaseStats getPhaseStats( const FlashPhase phase ) const noexcept;
+
+      void resetPhaseStats() noexcept;
+
+    protected:
+    private:
+      BinarySPI spi;
+
+      bool systemInitialized = false;
+      uint32_t eraseTimeout_mS;
+
+      FlashGeometry geometry;
+      std::array<FlashPhaseStats, FLASH_PHASE_NUM_OPTIONS> stats;
+
+      size_t speculativePolls; /**< Status polls sent ahead of each page's write enable */
+
+      /**
+       *	Runs frames and adds their cost on the link to a phase's stats
+       *
+       *	@param[in]	charge        Stats to add to, or nullptr for none
+       *	@param[in]	frames        Frames to run, filled in on return
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t run( FlashPhaseStats *const charge, std::vector<SPIFrame> &frames );
+
+      /**
+       *	Polls the status register until the flash isn't busy
+       *
+       *	@param[in]	charge        Stats to add the polls to, or nullptr for none
+       *	@param[in]	timeout_mS    How long to keep polling
+       *	@return Chimera::Status_t: TIMEOUT if it stayed busy
+       */
+      Chimera::Status_t pollReady( FlashPhaseStats *const charge, const uint32_t timeout_mS );
+
+      /**
+       *	Works out the layout from the basic flash parameter table
+       *
+       *	@return Chimera::Status_t: NOT_SUPPORTED if the flash has no usable table
+       */
+      Chimera::Status_t parseSFDP();
+
+      /**
+       *	Logs the throughput of the operation that just finished
+       *
+       *	@param[in]	phase         The operation's phase
+       *	@param[in]	before        The phase's stats before the operation started
+       *	@return void
+       */
+      void report( const FlashPhase phase, const FlashPhaseStats &before ) const;
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_SPI_FLASH_HPP */
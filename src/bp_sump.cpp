@@ -0,0 +1,314 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_sump.cpp
+ *
+ *   Description:
+ *       Implements the SUMP logic analyzer interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_sump.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+#include <exception>
+
+/* Boost Includes */
+#include <boost/iostreams/device/mapped_file.hpp>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Long Commands. Each is followed by a 32-bit argument, least significant byte
+    first, and none of them are answered.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_DIVIDER        = 0x80;
+    static constexpr uint8_t CMD_CAPTURE_SIZE   = 0x81;
+    static constexpr uint8_t CMD_FLAGS          = 0x82;
+    static constexpr uint8_t CMD_TRIGGER_MASK   = 0xC0;
+    static constexpr uint8_t CMD_TRIGGER_VALUES = 0xC1;
+    static constexpr uint8_t CMD_TRIGGER_CONFIG = 0xC2;
+    static constexpr size_t LONG_COMMAND_LENGTH = 5;
+
+    /*------------------------------------------------
+    The sample rate is set as a divider of the protocol's 100MHz reference clock
+    ------------------------------------------------*/
+    static constexpr uint32_t SUMP_CLOCK_HZ = 100000000;
+
+    /*------------------------------------------------
+    Capture sizes are given in units of four samples
+    ------------------------------------------------*/
+    static constexpr size_t SAMPLE_GRANULARITY = 4;
+
+    /*------------------------------------------------
+    Only the first channel group is used, which makes every sample a single byte
+    ------------------------------------------------*/
+    static constexpr uint32_t FLAGS_GROUP_0_ONLY = 0x38;
+
+    /*------------------------------------------------
+    Starts the first trigger stage. Without it the capture starts right away.
+    ------------------------------------------------*/
+    static constexpr uint32_t TRIGGER_CONFIG_START = 0x08000000;
+
+    static constexpr uint8_t CHANNEL_MASK = ( 1u << SUMP_NUM_CHANNELS ) - 1;
+
+    /*------------------------------------------------
+    Slack on top of the expected capture time, for the firmware to get going
+    ------------------------------------------------*/
+    static constexpr uint32_t CAPTURE_MARGIN_MS = 250;
+
+    static void appendLongCommand( std::vector<uint8_t> &cmd, const uint8_t command, const uint32_t argument )
+    {
+      cmd.push_back( command );
+
+      for ( size_t x = 0; x < LONG_COMMAND_LENGTH - 1; x++ )
+      {
+        cmd.push_back( static_cast<uint8_t>( argument >> ( 8 * x ) ) );
+      }
+    }
+
+    /*------------------------------------------------
+    Transposes an 8x8 bit matrix held one row per byte, so bit c of byte s ends up as
+    bit s of byte c. Three rounds of swapping ever larger blocks across the diagonal.
+    ------------------------------------------------*/
+    static uint64_t transpose8x8( uint64_t x )
+    {
+      uint64_t t;
+
+      t = ( x ^ ( x >> 7 ) ) & 0x00AA00AA00AA00AAull;
+      x = x ^ t ^ ( t << 7 );
+      t = ( x ^ ( x >> 14 ) ) & 0x0000CCCC0000CCCCull;
+      x = x ^ t ^ ( t << 14 );
+      t = ( x ^ ( x >> 28 ) ) & 0x00000000F0F0F0F0ull;
+      x = x ^ t ^ ( t << 28 );
+
+      return x;
+    }
+
+    /*-------------------------------------------------------------------------------
+    Public Functions
+    -------------------------------------------------------------------------------*/
+    LogicAnalyzer::LogicAnalyzer( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+    }
+
+    Chimera::Status_t LogicAnalyzer::init() noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      if ( busPirate.sumpInit() )
+      {
+        result            = Status::OK;
+        systemInitialized = true;
+      }
+      else
+      {
+        spdlog::error( "Failed logic analyzer initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t LogicAnalyzer::deInit() noexcept
+    {
+      Chimera::Status_t result = Status::FAIL;
+
+      busPirate.close();
+      result            = Status::OK;
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t LogicAnalyzer::capture( const SUMPConfig &config, uint8_t *const buffer, const size_t length ) noexcept
+    {
+      const auto serial = busPirate.serial;
+
+      if ( !systemInitialized || !serial )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( !buffer || ( length < config.samples ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      Chimera::Status_t result = validate( config );
+
+      if ( result != Status::OK )
+      {
+        return result;
+      }
+
+      /*------------------------------------------------
+      The last capture left the board in the terminal
+      ------------------------------------------------*/
+      if ( ( busPirate.state->currentMode != OperationalModes::BP_MODE_LOGIC_ANALYZER ) && !busPirate.sumpInit() )
+      {
+        return Status::FAIL;
+      }
+
+      /*------------------------------------------------
+      Capture everything after the trigger. With no trigger set that's from the
+      moment the analyzer is armed.
+      ------------------------------------------------*/
+      const uint32_t divider   = ( SUMP_CLOCK_HZ / config.sampleRate ) - 1;
+      const uint32_t units     = static_cast<uint32_t>( config.samples / SAMPLE_GRANULARITY ) - 1;
+      const uint32_t trigStart = config.triggerMask ? TRIGGER_CONFIG_START : 0;
+
+      std::vector<uint8_t> cmd;
+      cmd.reserve( 6 * LONG_COMMAND_LENGTH + 1 );
+
+      appendLongCommand( cmd, CMD_DIVIDER, divider );
+      appendLongCommand( cmd, CMD_CAPTURE_SIZE, ( units << 16 ) | units );
+      appendLongCommand( cmd, CMD_FLAGS, FLAGS_GROUP_0_ONLY );
+      appendLongCommand( cmd, CMD_TRIGGER_MASK, config.triggerMask );
+      appendLongCommand( cmd, CMD_TRIGGER_VALUES, config.triggerValues );
+      appendLongCommand( cmd, CMD_TRIGGER_CONFIG, trigStart );
+      cmd.push_back( SUMPCommands::run );
+
+      /*------------------------------------------------
+      Nothing comes back until the trigger fires and the capture is complete, then
+      all of it at once. Give the read the trigger timeout plus however long sampling
+      and sending should take.
+      ------------------------------------------------*/
+      const uint64_t sample_mS = ( static_cast<uint64_t>( config.samples ) * 1000u + config.sampleRate - 1 ) / config.sampleRate;
+      const uint64_t wire_mS   = ( serial->wireTime_uS( config.samples ) + 999u ) / 1000u;
+      const uint32_t timeout   = static_cast<uint32_t>( config.timeout_mS + sample_mS + wire_mS + CAPTURE_MARGIN_MS );
+
+      busPirate.resyncSerial();
+      serial->write( cmd.data(), cmd.size() );
+
+      if ( serial->read( buffer, config.samples, timeout ) == Status::OK )
+      {
+        std::reverse( buffer, buffer + config.samples );
+        busPirate.state->currentMode = OperationalModes::BP_MODE_HiZ;
+      }
+      else
+      {
+        /*------------------------------------------------
+        Still armed, or part way through sending. Either way the reset stops it.
+        ------------------------------------------------*/
+        result = Status::TIMEOUT;
+        busPirate.reset();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t LogicAnalyzer::capture( const SUMPConfig &config, const std::string &path ) noexcept
+    {
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      Chimera::Status_t result = validate( config );
+
+      if ( result != Status::OK )
+      {
+        return result;
+      }
+
+      boost::iostreams::mapped_file_params params( path );
+      params.new_file_size = static_cast<boost::iostreams::stream_offset>( config.samples );
+
+      boost::iostreams::mapped_file_sink file;
+
+      try
+      {
+        file.open( params );
+      }
+      catch ( const std::exception &e )
+      {
+        spdlog::error( "Could not map capture file {}: {}", path, e.what() );
+        return Status::FAIL;
+      }
+
+      result = capture( config, reinterpret_cast<uint8_t *>( file.data() ), file.size() );
+      file.close();
+
+      return result;
+    }
+
+    Chimera::Status_t LogicAnalyzer::unpackBitplanes( const uint8_t *const samples, const size_t count,
+                                                      SUMPBitplanes &planes ) noexcept
+    {
+      if ( !samples && count )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      const size_t planeBytes = ( count + 7 ) / 8;
+
+      for ( auto &plane : planes )
+      {
+        plane.resize( planeBytes );
+      }
+
+      /*------------------------------------------------
+      Eight samples make an 8x8 bit matrix, a sample per row. Transposed, each row
+      is a channel, which is one byte of its plane.
+      ------------------------------------------------*/
+      for ( size_t x = 0; x < planeBytes; x++ )
+      {
+        const uint8_t *block   = samples + ( 8 * x );
+        const size_t blockSize = std::min<size_t>( 8, count - ( 8 * x ) );
+        uint64_t matrix        = 0;
+
+        for ( size_t y = 0; y < blockSize; y++ )
+        {
+          matrix |= static_cast<uint64_t>( block[ y ] ) << ( 8 * y );
+        }
+
+        matrix = transpose8x8( matrix );
+
+        for ( size_t channel = 0; channel < SUMP_NUM_CHANNELS; channel++ )
+        {
+          planes[ channel ][ x ] = static_cast<uint8_t>( matrix >> ( 8 * channel ) );
+        }
+      }
+
+      return Status::OK;
+    }
+
+    /*-------------------------------------------------------------------------------
+    Private Functions
+    -------------------------------------------------------------------------------*/
+    Chimera::Status_t LogicAnalyzer::validate( const SUMPConfig &config )
+    {
+      if ( !config.sampleRate || ( config.sampleRate > MAX_SAMPLE_RATE ) )
+      {
+        spdlog::error( "Sample rate must be between 1Hz and {}Hz", MAX_SAMPLE_RATE );
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( !config.samples || ( config.samples > MAX_SAMPLES ) || ( config.samples % SAMPLE_GRANULARITY ) )
+      {
+        spdlog::error( "Capture depth must be a multiple of {} up to {} samples", SAMPLE_GRANULARITY, MAX_SAMPLES );
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( ( config.triggerMask & ~CHANNEL_MASK ) || ( config.triggerValues & ~config.triggerMask ) )
+      {
+        spdlog::error( "Trigger may only use the {} bus channels", static_cast<size_t>( SUMP_NUM_CHANNELS ) );
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      return Status::OK;
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,162 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_sump.hpp
+ *
+ *   Description:
+ *       Provides a logic analyzer through the Bus Pirate's SUMP mode. Captures go
+ *       straight into a caller supplied buffer or a memory mapped file.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_SUMP_DRIVER_HPP
+#define BUS_PIRATE_CPP_SUMP_DRIVER_HPP
+
+/* C++ Includes */
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  Bit positions of the bus pins in each captured sample
+     */
+    enum SUMPChannel : uint8_t
+    {
+      SUMP_CH_CS = 0,
+      SUMP_CH_MISO,
+      SUMP_CH_CLK,
+      SUMP_CH_MOSI,
+      SUMP_CH_AUX,
+
+      SUMP_NUM_CHANNELS
+    };
+
+    /**
+     *  One packed bit array per channel. Bit n of a plane (bit n % 8 of byte n / 8) is
+     *  that channel's level in sample n.
+     */
+    using SUMPBitplanes = std::array<std::vector<uint8_t>, SUMP_NUM_CHANNELS>;
+
+    /**
+     *  Settings for a single capture
+     */
+    struct SUMPConfig
+    {
+      uint32_t sampleRate;   /**< Samples per second, up to LogicAnalyzer::MAX_SAMPLE_RATE */
+      size_t samples;        /**< Capture depth, a multiple of 4 up to LogicAnalyzer::MAX_SAMPLES */
+      uint8_t triggerMask;   /**< Channels the trigger looks at, one bit per SUMPChannel. 0 starts right away. */
+      uint8_t triggerValues; /**< Levels the masked channels must have to start the capture */
+      uint32_t timeout_mS;   /**< How long to wait for the trigger */
+
+      SUMPConfig()
+      {
+        sampleRate    = 1000000;
+        samples       = 4096;
+        triggerMask   = 0;
+        triggerValues = 0;
+        timeout_mS    = 1000;
+      }
+    };
+
+    class LogicAnalyzer;
+    using LogicAnalyzer_sPtr = std::shared_ptr<LogicAnalyzer>;
+    using LogicAnalyzer_uPtr = std::unique_ptr<LogicAnalyzer>;
+
+    /**
+     *  Runs captures with the firmware's SUMP logic analyzer, so they can be scripted
+     *  without a GUI client. The whole configuration and the arm command go out in one
+     *  write, and the capture is read from the port straight into its destination in a
+     *  single call. The firmware sends the newest sample first; the samples are put
+     *  back in time order in place.
+     *
+     *  Samples are one byte each with a bit per SUMPChannel. The firmware holds the
+     *  capture in its terminal buffer, which limits the depth to MAX_SAMPLES, and it
+     *  returns to the terminal once the capture has been sent.
+     */
+    class LogicAnalyzer
+    {
+    public:
+      static constexpr uint32_t MAX_SAMPLE_RATE = 1000000;
+      static constexpr size_t MAX_SAMPLES       = 4096;
+
+      /**
+       *  Primary constructor for creating the logic analyzer interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      LogicAnalyzer( Device &device );
+
+      LogicAnalyzer()  = default;
+      ~LogicAnalyzer() = default;
+
+      /**
+       *  Enters SUMP mode. capture() enters it again whenever the board has dropped
+       *  back to the terminal.
+       */
+      Chimera::Status_t init() noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Runs a capture into memory
+       *
+       *	@param[in]	config        Capture settings
+       *	@param[out]	buffer        Receives config.samples samples, oldest first
+       *	@param[in]	length        Size of the buffer
+       *	@return Chimera::Status_t: TIMEOUT if the trigger didn't fire in time
+       */
+      Chimera::Status_t capture( const SUMPConfig &config, uint8_t *const buffer, const size_t length ) noexcept;
+
+      /**
+       *	Runs a capture into a file. The file is created or resized to hold exactly the
+       *  samples, one byte each and oldest first, and is written through a memory
+       *  mapping rather than a copy.
+       *
+       *	@param[in]	config        Capture settings
+       *	@param[in]	path          File to write
+       *	@return Chimera::Status_t: TIMEOUT if the trigger didn't fire in time
+       */
+      Chimera::Status_t capture( const SUMPConfig &config, const std::string &path ) noexcept;
+
+      /**
+       *	Splits samples into one bit array per channel, eight samples at a time
+       *
+       *	@param[in]	samples       Samples to unpack
+       *	@param[in]	count         Number of samples
+       *	@param[out]	planes        Receives the bit arrays, sized to fit
+       *	@return Chimera::Status_t
+       */
+      static Chimera::Status_t unpackBitplanes( const uint8_t *const samples, const size_t count, SUMPBitplanes &planes ) noexcept;
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized;
+
+      /**
+       *	Checks the settings against what the firmware can do
+       *
+       *	@param[in]	config        Capture settings
+       *	@return Chimera::Status_t: INVAL_FUNC_PARAM if the firmware can't do it
+       */
+      static Chimera::Status_t validate( const SUMPConfig &config );
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_SUMP_DRIVER_HPP */
@@ -0,0 +1,559 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_swd.cpp
+ *
+ *   Description:
+ *       Implements Serial Wire Debug over the Bus Pirate's raw 3-wire mode
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_swd.hpp"
+
+/* C++ Includes */
+#include <algorithm>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    Request packet fields, sent LSB first: start, APnDP, RnW, A[2:3], parity, stop, park
+    ------------------------------------------------*/
+    static constexpr uint8_t REQ_START  = ( 1u << 0 );
+    static constexpr uint8_t REQ_AP     = ( 1u << 1 );
+    static constexpr uint8_t REQ_READ   = ( 1u << 2 );
+    static constexpr uint8_t REQ_A2     = ( 1u << 3 );
+    static constexpr uint8_t REQ_A3     = ( 1u << 4 );
+    static constexpr uint8_t REQ_PARITY = ( 1u << 5 );
+    static constexpr uint8_t REQ_PARK   = ( 1u << 7 );
+
+    /*------------------------------------------------
+    Bits in each phase of a transaction. The idle cycles pad both kinds out to 48 bits,
+    so a batch stays byte aligned and goes out entirely as bulk writes.
+    ------------------------------------------------*/
+    static constexpr size_t REQUEST_BITS     = 8;
+    static constexpr size_t TRN_ACK_BITS     = 4; /**< Turnaround, then the 3 bit ACK */
+    static constexpr size_t DATA_BITS        = 32;
+    static constexpr size_t PARITY_TRN_BITS  = 2; /**< Read parity, then turnaround back to the host */
+    static constexpr size_t TRN_ACK_TRN_BITS = 5; /**< Write: turnaround, ACK, turnaround */
+    static constexpr size_t IDLE_CYCLES      = 2;
+
+    /*------------------------------------------------
+    Line reset and the JTAG to SWD switch sequence
+    ------------------------------------------------*/
+    static constexpr size_t LINE_RESET_BITS   = 56;
+    static constexpr uint32_t JTAG_TO_SWD     = 0xE79E;
+    static constexpr size_t JTAG_TO_SWD_BITS  = 16;
+    static constexpr size_t RESET_IDLE_CYCLES = 8;
+
+    /*------------------------------------------------
+    DP register fields
+    ------------------------------------------------*/
+    static constexpr uint32_t ABORT_STKCMPCLR  = ( 1u << 1 );
+    static constexpr uint32_t ABORT_STKERRCLR  = ( 1u << 2 );
+    static constexpr uint32_t ABORT_WDERRCLR   = ( 1u << 3 );
+    static constexpr uint32_t ABORT_ORUNERRCLR = ( 1u << 4 );
+    static constexpr uint32_t ABORT_CLEAR_ALL  = ABORT_STKCMPCLR | ABORT_STKERRCLR | ABORT_WDERRCLR | ABORT_ORUNERRCLR;
+
+    static constexpr uint32_t CTRL_ORUNDETECT   = ( 1u << 0 );
+    static constexpr uint32_t CTRL_STICKYERR    = ( 1u << 5 );
+    static constexpr uint32_t CTRL_CDBGPWRUPREQ = ( 1u << 28 );
+    static constexpr uint32_t CTRL_CDBGPWRUPACK = ( 1u << 29 );
+    static constexpr uint32_t CTRL_CSYSPWRUPREQ = ( 1u << 30 );
+    static constexpr uint32_t CTRL_CSYSPWRUPACK = ( 1u << 31 );
+
+    static constexpr uint32_t SELECT_APSEL_POS   = 24;
+    static constexpr uint32_t SELECT_APBANKSEL   = 0xF0;
+    static constexpr uint8_t AP_REGISTER_ADDRESS = 0x0C;
+
+    /*------------------------------------------------
+    How many times connect() checks for the power up acknowledgements
+    ------------------------------------------------*/
+    static constexpr size_t POWER_UP_POLLS = 10;
+
+    /*------------------------------------------------
+    MEM-AP registers. CSW selects 32-bit accesses with single auto-increment, with the
+    privileged data access protection bits debuggers normally use.
+    ------------------------------------------------*/
+    static constexpr uint8_t MEM_AP              = 0;
+    static constexpr uint8_t MEM_AP_CSW          = 0x00;
+    static constexpr uint8_t MEM_AP_TAR          = 0x04;
+    static constexpr uint8_t MEM_AP_DRW          = 0x0C;
+    static constexpr uint32_t CSW_SIZE_WORD      = 0x00000002;
+    static constexpr uint32_t CSW_ADDRINC_SINGLE = 0x00000010;
+    static constexpr uint32_t CSW_PROT_DEFAULT   = 0x23000000;
+    static constexpr uint32_t CSW_BLOCK_ACCESS   = CSW_PROT_DEFAULT | CSW_ADDRINC_SINGLE | CSW_SIZE_WORD;
+
+    /*------------------------------------------------
+    TAR only auto-increments within a 1KB block
+    ------------------------------------------------*/
+    static constexpr uint32_t TAR_INCREMENT_SPAN = 1024;
+
+    static bool parity( uint32_t value )
+    {
+      value ^= value >> 16;
+      value ^= value >> 8;
+      value ^= value >> 4;
+      value ^= value >> 2;
+      value ^= value >> 1;
+
+      return value & 0x01;
+    }
+
+    static uint8_t request( const SWDTransfer &transfer )
+    {
+      uint8_t req = REQ_START | REQ_PARK;
+
+      req |= transfer.ap ? REQ_AP : 0;
+      req |= transfer.read ? REQ_READ : 0;
+      req |= ( transfer.address & 0x04 ) ? REQ_A2 : 0;
+      req |= ( transfer.address & 0x08 ) ? REQ_A3 : 0;
+
+      if ( parity( req & ( REQ_AP | REQ_READ | REQ_A2 | REQ_A3 ) ) )
+      {
+        req |= REQ_PARITY;
+      }
+
+      return req;
+    }
+
+    static void lineResetBits( RawWireSequence &sequence )
+    {
+      sequence.writeBits( ~0u, 32 ).writeBits( ~0u, LINE_RESET_BITS - 32 );
+    }
+
+
+    BinarySWD::BinarySWD( Device &device ) : rawWire( device )
+    {
+      systemInitialized = false;
+      waitRetries       = SWDSetup().waitRetries;
+      selectCache       = 0;
+      selectValid       = false;
+      cswCache          = 0;
+      cswValid          = false;
+    }
+
+    Chimera::Status_t BinarySWD::init( const SWDSetup &setupStruct ) noexcept
+    {
+      RawWireSetup wire;
+      wire.clockFrequency = setupStruct.clockFrequency;
+      wire.threeWire      = true;
+      wire.lsbFirst       = true;
+      wire.pinOutput      = false;
+      wire.pullups        = true;
+
+      waitRetries = setupStruct.waitRetries;
+
+      Chimera::Status_t result = rawWire.init( wire );
+
+      if ( result == Status::OK )
+      {
+        uint32_t idcode = 0;
+        result          = connect( idcode );
+      }
+
+      systemInitialized = ( result == Status::OK );
+
+      if ( !systemInitialized )
+      {
+        spdlog::error( "Failed SWD initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::deInit() noexcept
+    {
+      systemInitialized = false;
+      return rawWire.deInit();
+    }
+
+    Chimera::Status_t BinarySWD::connect( uint32_t &idcode ) noexcept
+    {
+      RawWireSequence sequence;
+      std::vector<SWDTransfer> transfers = {
+        SWDTransfer( false, true, SWD_DP_IDCODE ),
+        SWDTransfer( false, false, SWD_DP_ABORT, ABORT_CLEAR_ALL ),
+        SWDTransfer( false, false, SWD_DP_SELECT, 0 ),
+        SWDTransfer( false, false, SWD_DP_CTRL_STAT, CTRL_CSYSPWRUPREQ | CTRL_CDBGPWRUPREQ | CTRL_ORUNDETECT ),
+        SWDTransfer( false, true, SWD_DP_CTRL_STAT ),
+      };
+
+      /*------------------------------------------------
+      Line reset, the JTAG to SWD switch, another line reset, then the IDCODE read that
+      has to follow it. The rest of the setup joins the same stream.
+      ------------------------------------------------*/
+      lineResetBits( sequence );
+      sequence.writeBits( JTAG_TO_SWD, JTAG_TO_SWD_BITS );
+      lineResetBits( sequence );
+      sequence.writeBits( 0, RESET_IDLE_CYCLES );
+
+      selectValid = false;
+      cswValid    = false;
+
+      Chimera::Status_t result = exchange( sequence, transfers );
+      idcode                   = transfers[ 0 ].data;
+
+      /*------------------------------------------------
+      Give the target a little while to power up the debug and system domains
+      ------------------------------------------------*/
+      const uint32_t powerAcks = CTRL_CDBGPWRUPACK | CTRL_CSYSPWRUPACK;
+      uint32_t ctrl            = transfers.back().data;
+
+      for ( size_t x = 0; ( result == Status::OK ) && ( ( ctrl & powerAcks ) != powerAcks ); x++ )
+      {
+        if ( x == POWER_UP_POLLS )
+        {
+          spdlog::error( "SWD target didn't power up its debug domain" );
+          result = Status::TIMEOUT;
+          break;
+        }
+
+        result = readDP( SWD_DP_CTRL_STAT, ctrl );
+      }
+
+      if ( result == Status::OK )
+      {
+        spdlog::info( "SWD target IDCODE 0x{:08X}", idcode );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::lineReset() noexcept
+    {
+      RawWireSequence sequence;
+
+      lineResetBits( sequence );
+      sequence.writeBits( 0, RESET_IDLE_CYCLES );
+
+      return rawWire.run( sequence );
+    }
+
+    Chimera::Status_t BinarySWD::transfer( std::vector<SWDTransfer> &transfers ) noexcept
+    {
+      RawWireSequence sequence;
+      return exchange( sequence, transfers );
+    }
+
+    Chimera::Status_t BinarySWD::exchange( RawWireSequence &sequence, std::vector<SWDTransfer> &transfers )
+    {
+      if ( transfers.empty() )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      /*------------------------------------------------
+      Every transaction is 48 bits. The host writes ones wherever the target drives the
+      line, which the open drain pins turn into reads.
+      ------------------------------------------------*/
+      for ( const auto &t : transfers )
+      {
+        sequence.writeBits( request( t ), REQUEST_BITS );
+
+        if ( t.read )
+        {
+          sequence.readBits( TRN_ACK_BITS ).readBits( DATA_BITS ).readBits( PARITY_TRN_BITS );
+        }
+        else
+        {
+          sequence.readBits( TRN_ACK_TRN_BITS ).writeBits( t.data, DATA_BITS ).writeBits( parity( t.data ), 1 );
+        }
+
+        sequence.writeBits( 0, IDLE_CYCLES );
+      }
+
+      Chimera::Status_t result = rawWire.run( sequence );
+
+      if ( result != Status::OK )
+      {
+        return result;
+      }
+
+      /*------------------------------------------------
+      Check every ACK and parity bit in one pass. The first bad ACK decides the result,
+      since everything after it failed because of it.
+      ------------------------------------------------*/
+      const auto &bits = sequence.bits();
+      size_t index     = 0;
+
+      for ( auto &t : transfers )
+      {
+        t.ack = static_cast<uint8_t>( ( bits[ index ] >> 1 ) & 0x07 );
+
+        if ( t.read )
+        {
+          t.data = bits[ index + 1 ];
+
+          if ( ( t.ack == SWD_ACK_OK ) && ( ( bits[ index + 2 ] & 0x01 ) != parity( t.data ) ) )
+          {
+            spdlog::error( "SWD read parity error" );
+            result = Status::FAIL;
+          }
+
+          index += 3;
+        }
+        else
+        {
+          index += 1;
+        }
+
+        if ( ( t.ack != SWD_ACK_OK ) && ( result == Status::OK ) )
+        {
+          result = ( t.ack == SWD_ACK_WAIT ) ? Status::NOT_READY : Status::FAIL;
+        }
+      }
+
+      /*------------------------------------------------
+      A write to SELECT that went through changes which AP and bank are selected
+      ------------------------------------------------*/
+      for ( const auto &t : transfers )
+      {
+        if ( !t.ap && !t.read && ( t.address == SWD_DP_SELECT ) )
+        {
+          selectValid = ( t.ack == SWD_ACK_OK );
+          selectCache = t.data;
+        }
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::readDP( const uint8_t address, uint32_t &value ) noexcept
+    {
+      std::vector<SWDTransfer> transfers = { SWDTransfer( false, true, address ) };
+
+      Chimera::Status_t result = transfer( transfers );
+      value                    = transfers[ 0 ].data;
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::writeDP( const uint8_t address, const uint32_t value ) noexcept
+    {
+      std::vector<SWDTransfer> transfers = { SWDTransfer( false, false, address, value ) };
+
+      return transfer( transfers );
+    }
+
+    Chimera::Status_t BinarySWD::readAP( const uint8_t apsel, const uint8_t address, uint32_t &value ) noexcept
+    {
+      std::vector<SWDTransfer> transfers;
+
+      select( transfers, apsel, address );
+      transfers.emplace_back( true, true, address & AP_REGISTER_ADDRESS );
+      transfers.emplace_back( false, true, SWD_DP_RDBUFF );
+
+      Chimera::Status_t result = transfer( transfers );
+      value                    = transfers.back().data;
+
+      if ( result != Status::OK )
+      {
+        clearErrors();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::writeAP( const uint8_t apsel, const uint8_t address, const uint32_t value ) noexcept
+    {
+      std::vector<SWDTransfer> transfers;
+
+      select( transfers, apsel, address );
+      transfers.emplace_back( true, false, address & AP_REGISTER_ADDRESS, value );
+      transfers.emplace_back( false, true, SWD_DP_RDBUFF );
+
+      Chimera::Status_t result = transfer( transfers );
+
+      if ( ( apsel == MEM_AP ) && ( address == MEM_AP_CSW ) )
+      {
+        cswValid = ( result == Status::OK );
+        cswCache = value;
+      }
+
+      if ( result != Status::OK )
+      {
+        clearErrors();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::readMemory( const uint32_t address, uint32_t *const data, const size_t words ) noexcept
+    {
+      if ( !data || !words || ( address & 0x03 ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      Chimera::Status_t result = Status::OK;
+      std::vector<SWDTransfer> transfers;
+      size_t done = 0;
+
+      while ( ( done < words ) && ( result == Status::OK ) )
+      {
+        const uint32_t tar  = address + static_cast<uint32_t>( 4 * done );
+        const size_t length = std::min<size_t>( words - done, ( TAR_INCREMENT_SPAN - ( tar % TAR_INCREMENT_SPAN ) ) / 4 );
+
+        /*------------------------------------------------
+        The first DRW read returns stale data and each later one the word before it, so
+        the last word comes from RDBUFF
+        ------------------------------------------------*/
+        transfers.clear();
+        select( transfers, MEM_AP, MEM_AP_CSW );
+
+        if ( !cswValid || ( cswCache != CSW_BLOCK_ACCESS ) )
+        {
+          transfers.emplace_back( true, false, MEM_AP_CSW, CSW_BLOCK_ACCESS );
+        }
+
+        transfers.emplace_back( true, false, MEM_AP_TAR, tar );
+        const size_t first = transfers.size();
+        transfers.insert( transfers.end(), length, SWDTransfer( true, true, MEM_AP_DRW ) );
+        transfers.emplace_back( false, true, SWD_DP_RDBUFF );
+
+        result = runBlock( transfers );
+
+        if ( result == Status::OK )
+        {
+          cswCache = CSW_BLOCK_ACCESS;
+          cswValid = true;
+
+          for ( size_t x = 0; x < length; x++ )
+          {
+            data[ done + x ] = transfers[ first + x + 1 ].data;
+          }
+
+          done += length;
+        }
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::writeMemory( const uint32_t address, const uint32_t *const data, const size_t words ) noexcept
+    {
+      if ( !data || !words || ( address & 0x03 ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      Chimera::Status_t result = Status::OK;
+      std::vector<SWDTransfer> transfers;
+      size_t done = 0;
+
+      while ( ( done < words ) && ( result == Status::OK ) )
+      {
+        const uint32_t tar  = address + static_cast<uint32_t>( 4 * done );
+        const size_t length = std::min<size_t>( words - done, ( TAR_INCREMENT_SPAN - ( tar % TAR_INCREMENT_SPAN ) ) / 4 );
+
+        /*------------------------------------------------
+        Writes are posted too. The closing RDBUFF read holds off until the last one
+        has finished, so the sticky error check after it covers the whole block.
+        ------------------------------------------------*/
+        transfers.clear();
+        select( transfers, MEM_AP, MEM_AP_CSW );
+
+        if ( !cswValid || ( cswCache != CSW_BLOCK_ACCESS ) )
+        {
+          transfers.emplace_back( true, false, MEM_AP_CSW, CSW_BLOCK_ACCESS );
+        }
+
+        transfers.emplace_back( true, false, MEM_AP_TAR, tar );
+        for ( size_t x = 0; x < length; x++ )
+        {
+          transfers.emplace_back( true, false, MEM_AP_DRW, data[ done + x ] );
+        }
+        transfers.emplace_back( false, true, SWD_DP_RDBUFF );
+
+        result = runBlock( transfers );
+
+        if ( result == Status::OK )
+        {
+          cswCache = CSW_BLOCK_ACCESS;
+          cswValid = true;
+          done += length;
+        }
+      }
+
+      return result;
+    }
+
+    void BinarySWD::select( std::vector<SWDTransfer> &transfers, const uint8_t apsel, const uint8_t address )
+    {
+      const uint32_t value = ( static_cast<uint32_t>( apsel ) << SELECT_APSEL_POS ) | ( address & SELECT_APBANKSEL );
+
+      if ( !selectValid || ( selectCache != value ) )
+      {
+        transfers.emplace_back( false, false, SWD_DP_SELECT, value );
+      }
+    }
+
+    Chimera::Status_t BinarySWD::runBlock( std::vector<SWDTransfer> &transfers )
+    {
+      Chimera::Status_t result = Status::NOT_READY;
+
+      /*------------------------------------------------
+      The access that faults is still acknowledged, only the ones after it aren't, so
+      the block ends by checking the sticky error flag
+      ------------------------------------------------*/
+      transfers.emplace_back( false, true, SWD_DP_CTRL_STAT );
+
+      /*------------------------------------------------
+      A block is safe to repeat from the start since it sets TAR itself. Once the
+      sticky overrun flag is cleared, the target takes requests again.
+      ------------------------------------------------*/
+      for ( size_t attempt = 0; ( attempt <= waitRetries ) && ( result == Status::NOT_READY ); attempt++ )
+      {
+        result = transfer( transfers );
+
+        if ( ( result == Status::OK ) && ( transfers.back().data & CTRL_STICKYERR ) )
+        {
+          result = Status::FAIL;
+        }
+
+        if ( result != Status::OK )
+        {
+          clearErrors();
+        }
+      }
+
+      transfers.pop_back();
+
+      if ( result == Status::NOT_READY )
+      {
+        spdlog::error( "SWD target stayed busy" );
+        result = Status::TIMEOUT;
+      }
+      else if ( result != Status::OK )
+      {
+        spdlog::error( "SWD memory access failed" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinarySWD::clearErrors()
+    {
+      return writeDP( SWD_DP_ABORT, ABORT_CLEAR_ALL );
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,255 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_swd.hpp
+ *
+ *   Description:
+ *       ARM Serial Wire Debug over the Bus Pirate's raw 3-wire mode
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_SWD_DRIVER_HPP
+#define BUS_PIRATE_CPP_SWD_DRIVER_HPP
+
+/* C++ Includes */
+#include <memory>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+#include "bp_rawwire.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  Responses a target gives to a transaction request
+     */
+    enum SWDAck : uint8_t
+    {
+      SWD_ACK_OK    = 0x1,
+      SWD_ACK_WAIT  = 0x2,
+      SWD_ACK_FAULT = 0x4,
+      SWD_ACK_NONE  = 0x7, /**< Nothing drove the line */
+    };
+
+    /**
+     *  Debug port register addresses
+     */
+    enum SWDDebugPort : uint8_t
+    {
+      SWD_DP_IDCODE    = 0x0, /**< Read only */
+      SWD_DP_ABORT     = 0x0, /**< Write only */
+      SWD_DP_CTRL_STAT = 0x4,
+      SWD_DP_SELECT    = 0x8,
+      SWD_DP_RDBUFF    = 0xC,
+    };
+
+    /**
+     *  Settings applied by BinarySWD::init()
+     */
+    struct SWDSetup
+    {
+      uint32_t clockFrequency; /**< Desired SWCLK, rounded to the nearest raw-wire speed */
+      size_t waitRetries;      /**< How many times a block transfer is retried while the target answers WAIT */
+
+      SWDSetup()
+      {
+        clockFrequency = RAW_WIRE_SPEED_400kHz;
+        waitRetries    = 8;
+      }
+    };
+
+    /**
+     *  A single debug or access port transaction
+     */
+    struct SWDTransfer
+    {
+      bool ap;         /**< Access port (true) or debug port (false) */
+      bool read;       /**< Read (true) or write (false) */
+      uint8_t address; /**< Register address. Only bits 2 and 3 go on the wire, the AP bank comes from SELECT */
+      uint32_t data;   /**< Value to write, or the value read */
+      uint8_t ack;     /**< The target's response, one of SWDAck */
+
+      SWDTransfer()
+      {
+        ap      = false;
+        read    = false;
+        address = 0;
+        data    = 0;
+        ack     = SWD_ACK_NONE;
+      }
+
+      SWDTransfer( const bool ap, const bool read, const uint8_t address, const uint32_t data = 0 ) :
+          ap( ap ), read( read ), address( address ), data( data ), ack( SWD_ACK_NONE )
+      {
+      }
+    };
+
+    class BinarySWD;
+    using BinarySWD_sPtr = std::shared_ptr<BinarySWD>;
+    using BinarySWD_uPtr = std::unique_ptr<BinarySWD>;
+
+    /**
+     *  SWD host for Cortex-M targets, wired with SWDIO on both MOSI and MISO and SWCLK
+     *  on CLK. The pins run open drain with the pullups on, so a bit the host reads is
+     *  just a one it writes, and every transaction is padded with idle cycles to exactly
+     *  six bytes. A whole batch of transactions then goes out as bulk writes, with the
+     *  request, turnaround, ACK, data and parity of each one read back in the same
+     *  stream and checked on the host afterwards.
+     *
+     *  Overrun detection is turned on when connecting, so a target that answers WAIT or
+     *  FAULT part way through a batch keeps the data phases in step and the rest of the
+     *  batch fails cleanly rather than being misread as requests.
+     */
+    class BinarySWD
+    {
+    public:
+      /**
+       *  Primary constructor for creating the SWD interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      BinarySWD( Device &device );
+
+      BinarySWD()  = default;
+      ~BinarySWD() = default;
+
+      /**
+       *  Sets up raw-wire mode for SWD and connects to the target
+       */
+      Chimera::Status_t init( const SWDSetup &setupStruct ) noexcept;
+
+      Chimera::Status_t deInit() noexcept;
+
+      /**
+       *	Switches the target from JTAG to SWD, reads its ID, clears any sticky errors and
+       *  powers up the debug and system domains. All of it is one round trip unless the
+       *  power up takes a while.
+       *
+       *	@param[out]	idcode        Receives the debug port's IDCODE
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t connect( uint32_t &idcode ) noexcept;
+
+      /**
+       *	Sends at least 50 clocks with SWDIO high followed by idle cycles
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t lineReset() noexcept;
+
+      /**
+       *	Runs a batch of raw transactions in one stream. AP reads are posted, so each one
+       *  returns the result of the AP read before it; follow the last with a read of
+       *  RDBUFF.
+       *
+       *	@param[in]	transfers     Transactions to run, in order. Their data and ack fields are
+       *                            filled in on return.
+       *	@return Chimera::Status_t: OK if every transaction was acknowledged with good parity
+       */
+      Chimera::Status_t transfer( std::vector<SWDTransfer> &transfers ) noexcept;
+
+      Chimera::Status_t readDP( const uint8_t address, uint32_t &value ) noexcept;
+
+      Chimera::Status_t writeDP( const uint8_t address, const uint32_t value ) noexcept;
+
+      /**
+       *	Reads an access port register, selecting it first if needed
+       *
+       *	@param[in]	apsel         Access port number
+       *	@param[in]	address       Register address, including the bank in bits 4-7
+       *	@param[out]	value         Receives the register value
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t readAP( const uint8_t apsel, const uint8_t address, uint32_t &value ) noexcept;
+
+      /**
+       *	Writes an access port register, selecting it first if needed
+       *
+       *	@param[in]	apsel         Access port number
+       *	@param[in]	address       Register address, including the bank in bits 4-7
+       *	@param[in]	value         Value to write
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t writeAP( const uint8_t apsel, const uint8_t address, const uint32_t value ) noexcept;
+
+      /**
+       *	Reads a block of words through MEM-AP 0 with address auto-increment. Each 1KB
+       *  of the address space takes one stream: a TAR write, a DRW read per word and a
+       *  closing RDBUFF read.
+       *
+       *	@param[in]	address       Word aligned target address
+       *	@param[out]	data          Receives the words read
+       *	@param[in]	words         Number of words to read
+       *	@return Chimera::Status_t: FAIL on a FAULT or bad parity, TIMEOUT if the target stayed busy
+       */
+      Chimera::Status_t readMemory( const uint32_t address, uint32_t *const data, const size_t words ) noexcept;
+
+      /**
+       *	Writes a block of words through MEM-AP 0 with address auto-increment
+       *
+       *	@param[in]	address       Word aligned target address
+       *	@param[in]	data          Words to write
+       *	@param[in]	words         Number of words to write
+       *	@return Chimera::Status_t: FAIL on a FAULT or bad parity, TIMEOUT if the target stayed busy
+       */
+      Chimera::Status_t writeMemory( const uint32_t address, const uint32_t *const data, const size_t words ) noexcept;
+
+    protected:
+    private:
+      BinaryRawWire rawWire;
+
+      bool systemInitialized = false;
+      size_t waitRetries;
+
+      uint32_t selectCache; /**< Last value written to SELECT */
+      bool selectValid;     /**< SELECT may have changed without selectCache knowing */
+      uint32_t cswCache;    /**< Last value written to the CSW of MEM-AP 0 */
+      bool cswValid;
+
+      /**
+       *	Queues a SELECT write if the AP and bank aren't already selected
+       *
+       *	@param[in]	transfers     Batch to add to
+       *	@param[in]	apsel         Access port number
+       *	@param[in]	address       AP register address, including the bank
+       *	@return void
+       */
+      void select( std::vector<SWDTransfer> &transfers, const uint8_t apsel, const uint8_t address );
+
+      /**
+       *	Appends a batch of transactions to a sequence, runs it and checks the replies
+       *
+       *	@param[in]	sequence      Sequence to append to. Anything already in it must not read.
+       *	@param[in]	transfers     Transactions to run, filled in on return
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t exchange( RawWireSequence &sequence, std::vector<SWDTransfer> &transfers );
+
+      /**
+       *	Runs one block of a memory transfer, retrying while the target answers WAIT
+       *
+       *	@param[in]	transfers     The block's transactions
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t runBlock( std::vector<SWDTransfer> &transfers );
+
+      /**
+       *	Clears the sticky error flags after a FAULT or WAIT
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t clearErrors();
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_SWD_DRIVER_HPP */
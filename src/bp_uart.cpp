@@ -0,0 +1,866 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_uart.cpp
+ *
+ *   Description:
+ *       Implements the UART interface to the Bus Pirate hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bp_uart.hpp"
+
+/* C++ Includes */
+#include <array>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using Status = Chimera::CommonStatusCodes;
+
+    /*------------------------------------------------
+    RX Echo and Bridge Commands. The echo commands are answered with 0x01, the
+    bridge isn't answered at all.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_ECHO_START = 0x02;
+    static constexpr uint8_t CMD_ECHO_STOP  = 0x03;
+    static constexpr uint8_t CMD_BRIDGE     = 0x0F;
+
+    /*------------------------------------------------
+    Board Configuration Options
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_PERIPH     = 0x40;
+    static constexpr uint8_t MSK_CFG_PERIPH     = 0x0F;
+    static constexpr uint8_t CFG_PERIPH_POWER   = ( 1u << 3 );
+    static constexpr uint8_t CFG_PERIPH_PULLUP  = ( 1u << 2 );
+    static constexpr uint8_t CFG_PERIPH_AUX_PIN = ( 1u << 1 );
+    static constexpr uint8_t CFG_PERIPH_CS_PIN  = ( 1u << 0 );
+
+    /*------------------------------------------------
+    UART Configuration Options
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_UART         = 0x80;
+    static constexpr uint8_t MSK_CFG_UART         = 0x1F;
+    static constexpr uint8_t CFG_UART_PIN_OUTPUT  = ( 1u << 4 );
+    static constexpr uint8_t MSK_UART_PARITY      = ( 3u << 2 );
+    static constexpr uint8_t CFG_UART_8N          = ( 0u << 2 );
+    static constexpr uint8_t CFG_UART_8E          = ( 1u << 2 );
+    static constexpr uint8_t CFG_UART_8O          = ( 2u << 2 );
+    static constexpr uint8_t CFG_UART_2_STOP_BITS = ( 1u << 1 );
+    static constexpr uint8_t CFG_UART_RX_INVERTED = ( 1u << 0 );
+
+    /*------------------------------------------------
+    UART Speed Configuration. Bauds without a preset are programmed into the baud
+    rate generator: 16MHz instruction clock, high speed mode, so each count is four
+    cycles. The BRG command and both of its data bytes are answered with 0x01.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_CFG_SPEED = 0x60;
+    static constexpr uint8_t MSK_CFG_SPEED = 0x0F;
+    static constexpr uint8_t CMD_SET_BRG   = 0x07;
+
+    static constexpr uint32_t BRG_CLOCK_HZ        = 16000000 / 4;
+    static constexpr uint32_t BRG_MAX             = 0xFFFF;
+    static constexpr uint32_t BRG_TOLERANCE_PPT   = 20;
+    static constexpr uint32_t DEFAULT_TARGET_BAUD = 115200;
+
+    struct SpeedPreset
+    {
+      uint32_t baud;
+      uint8_t code;
+    };
+
+    static constexpr std::array<SpeedPreset, 10> speedPresets = { { { 300, 0x00 },
+                                                                    { 1200, 0x01 },
+                                                                    { 2400, 0x02 },
+                                                                    { 4800, 0x03 },
+                                                                    { 9600, 0x04 },
+                                                                    { 19200, 0x05 },
+                                                                    { 31250, 0x06 },
+                                                                    { 38400, 0x07 },
+                                                                    { 57600, 0x08 },
+                                                                    { 115200, 0x0A } } };
+
+    /*------------------------------------------------
+    UART Write Commands. A bulk write is answered with 0x01 and then another 0x01 for
+    each byte, once it has been handed to the target UART.
+    ------------------------------------------------*/
+    static constexpr uint8_t CMD_BULK_UART_WRITE       = 0x10;
+    static constexpr uint8_t MSK_BULK_UART_WRITE_BYTES = 0x0F;
+    static constexpr size_t BULK_WRITE_MAX_LEN         = 16;
+
+    /*------------------------------------------------
+    Stopping the echo: how long the line has to be quiet before the last byte is
+    taken to be the ack, and how long to wait overall
+    ------------------------------------------------*/
+    static constexpr uint32_t ECHO_QUIET_MS        = 20;
+    static constexpr uint32_t ECHO_STOP_TIMEOUT_MS = 500;
+
+    static constexpr size_t DEFAULT_RX_BUFFER_SIZE     = 64 * 1024;
+    static constexpr uint32_t DEFAULT_POWER_UP_DELAY_MS = 100;
+
+
+    BinaryUART::BinaryUART( Device &device ) : busPirate( device )
+    {
+      busPirate.open();
+      systemInitialized = false;
+
+      /*------------------------------------------------
+      Initialize the virtual registers
+      ------------------------------------------------*/
+      reg_PeriphCfg = { CMD_CFG_PERIPH, MSK_CFG_PERIPH, 0, 0, false };
+      reg_UARTSpeed = { CMD_CFG_SPEED, MSK_CFG_SPEED, 0, 0, false };
+      reg_UARTCfg   = { CMD_CFG_UART, MSK_CFG_UART, 0, 0, false };
+      reg_BRG       = 0;
+      brgPending    = false;
+      appliedBaud   = 0;
+      stagingConfig = false;
+
+      stageBaud( DEFAULT_TARGET_BAUD );
+
+      powerUpDelay_mS = DEFAULT_POWER_UP_DELAY_MS;
+      rxBufferSize    = DEFAULT_RX_BUFFER_SIZE;
+    }
+
+    BinaryUART::~BinaryUART()
+    {
+      /*------------------------------------------------
+      Leave the link framed for whoever resets the board
+      ------------------------------------------------*/
+      stopEcho();
+    }
+
+    Chimera::Status_t BinaryUART::begin( const Chimera::Serial::Modes txMode, const Chimera::Serial::Modes rxMode ) noexcept
+    {
+      Chimera::Status_t result = Status::NOT_INITIALIZED;
+
+      CommandBatch batch;
+      size_t entry = 0;
+
+      if ( bridgeActive )
+      {
+        spdlog::error( "UART bridge is running, unplug the Bus Pirate to leave it" );
+        return Status::NOT_SUPPORTED;
+      }
+
+      stopEcho();
+
+      /*------------------------------------------------
+      Skip the mode switch if the board is already in UART mode, otherwise queue it
+      up to go out together with the configuration
+      ------------------------------------------------*/
+      bool inUARTMode =
+          ( busPirate.state->currentMode == OperationalModes::BP_MODE_UART_BIT_BANG ) && busPirate.resyncFraming();
+
+      if ( !inUARTMode
+           && ( ( busPirate.state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT ) || busPirate.bbInit() ) )
+      {
+        entry = batch.add( { BitBangCommands::enterUART }, BitBangCommands::uartSuccess.size(), false );
+
+        /*------------------------------------------------
+        Entering UART mode resets the firmware's configuration
+        ------------------------------------------------*/
+        invalidateConfig();
+      }
+
+      if ( inUARTMode || batch.size() )
+      {
+        const bool powered = reg_PeriphCfg.valid && ( reg_PeriphCfg.applied & CFG_PERIPH_POWER );
+
+        stageConfig();
+
+        result = cfgPowerSupplies( true );
+        result |= commitConfig( batch );
+
+        if ( !inUARTMode )
+        {
+          const std::string &expected = BitBangCommands::uartSuccess;
+          auto reply                  = batch.reply( entry );
+
+          if ( ( reply.length == expected.size() ) && std::equal( expected.begin(), expected.end(), reply.data ) )
+          {
+            busPirate.state->currentMode = OperationalModes::BP_MODE_UART_BIT_BANG;
+          }
+          else
+          {
+            result |= Status::FAIL;
+          }
+        }
+
+        if ( !powered && ( reg_PeriphCfg.applied & CFG_PERIPH_POWER ) && powerUpDelay_mS )
+        {
+          Chimera::delayMilliseconds( powerUpDelay_mS );
+        }
+      }
+
+      if ( result == Status::OK )
+      {
+        systemInitialized = true;
+
+        if ( rxMode != Chimera::Serial::Modes::BLOCKING )
+        {
+          result = startEcho();
+        }
+      }
+      else
+      {
+        spdlog::error( "Failed UART initialization" );
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::configure( const uint32_t baud, const Chimera::Serial::CharWid width,
+                                             const Chimera::Serial::Parity parity, const Chimera::Serial::StopBits stop,
+                                             const Chimera::Serial::FlowControl flow ) noexcept
+    {
+      using namespace Chimera::Serial;
+
+      if ( ( width != CharWid::CW_8BIT ) || ( stop == StopBits::SBITS_ONE_POINT_FIVE ) || ( flow != FlowControl::FCTRL_NONE ) )
+      {
+        return Status::NOT_SUPPORTED;
+      }
+
+      uint8_t bitVals = reg_UARTCfg.staged & ~( MSK_UART_PARITY | CFG_UART_2_STOP_BITS );
+
+      switch ( parity )
+      {
+        case Parity::PAR_EVEN:
+          bitVals |= CFG_UART_8E;
+          break;
+
+        case Parity::PAR_ODD:
+          bitVals |= CFG_UART_8O;
+          break;
+
+        case Parity::PAR_NONE:
+        default:
+          bitVals |= CFG_UART_8N;
+          break;
+      }
+
+      if ( stop == StopBits::SBITS_TWO )
+      {
+        bitVals |= CFG_UART_2_STOP_BITS;
+      }
+
+      /*------------------------------------------------
+      Baud and frame format go out together
+      ------------------------------------------------*/
+      const bool staging = stagingConfig;
+      stageConfig();
+
+      Chimera::Status_t result = stageBaud( baud );
+
+      if ( result == Status::OK )
+      {
+        result = writeRegister( reg_UARTCfg, bitVals );
+      }
+
+      stagingConfig = staging;
+
+      if ( ( result == Status::OK ) && !stagingConfig && systemInitialized )
+      {
+        result = commitConfig();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::end() noexcept
+    {
+      Chimera::Status_t result = stopEcho();
+
+      busPirate.close();
+      systemInitialized = false;
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::setBaud( const uint32_t baud ) noexcept
+    {
+      Chimera::Status_t result = stageBaud( baud );
+
+      if ( ( result == Status::OK ) && !stagingConfig && systemInitialized )
+      {
+        result = commitConfig();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::setMode( const Chimera::Serial::SubPeripheral periph,
+                                           const Chimera::Serial::Modes mode ) noexcept
+    {
+      Chimera::Status_t result = Status::OK;
+      const bool receive       = ( mode != Chimera::Serial::Modes::BLOCKING );
+
+      if ( periph == Chimera::Serial::SubPeripheral::TX )
+      {
+        result = Status::NOT_SUPPORTED;
+      }
+      else if ( bridgeActive )
+      {
+        result = receive ? Status::OK : Status::NOT_SUPPORTED;
+      }
+      else if ( !systemInitialized )
+      {
+        result = Status::NOT_INITIALIZED;
+      }
+      else if ( receive != echoActive )
+      {
+        result = receive ? startEcho() : stopEcho();
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::write( const uint8_t *const buffer, const size_t length, const uint32_t timeout_mS ) noexcept
+    {
+      if ( !buffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( bridgeActive )
+      {
+        return bridgeWrite( buffer, length, timeout_mS );
+      }
+
+      if ( echoActive )
+      {
+        spdlog::error( "Can't write to the UART while RX echo is on, the acks would mix with the received data" );
+        return Status::NOT_READY;
+      }
+
+      /*------------------------------------------------
+      Every bulk write is answered byte for byte, so the whole block streams out in
+      one go, throttled by the acks coming back at the target's pace
+      ------------------------------------------------*/
+      CommandBatch batch;
+      std::vector<uint8_t> chunk;
+
+      for ( size_t offset = 0; offset < length; offset += BULK_WRITE_MAX_LEN )
+      {
+        const size_t len = std::min( BULK_WRITE_MAX_LEN, length - offset );
+
+        chunk.assign( 1, static_cast<uint8_t>( CMD_BULK_UART_WRITE | ( ( len - 1 ) & MSK_BULK_UART_WRITE_BYTES ) ) );
+        chunk.insert( chunk.end(), buffer + offset, buffer + offset + len );
+        batch.add( chunk, len + 1 );
+      }
+
+      Chimera::Status_t result = busPirate.stream( batch, streamWindow() );
+
+      for ( size_t x = 0; ( x < batch.size() ) && ( result == Status::OK ); x++ )
+      {
+        auto reply = batch.reply( x );
+
+        if ( std::any_of( reply.data, reply.data + reply.length, []( uint8_t ack ) { return ack != BitBangCommands::success; } ) )
+        {
+          result = Status::FAIL;
+        }
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::read( uint8_t *const buffer, const size_t length, const uint32_t timeout_mS ) noexcept
+    {
+      using namespace std::chrono;
+
+      if ( !buffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      const auto deadline = steady_clock::now() + milliseconds( timeout_mS );
+      const auto serial   = busPirate.serial;
+      size_t copied       = takeHeld( buffer, length );
+
+      while ( ( copied < length ) && isReceiving() )
+      {
+        const auto remaining = std::max<int64_t>( 0, duration_cast<milliseconds>( deadline - steady_clock::now() ).count() );
+        size_t received      = 0;
+
+        if ( serial->readSome( buffer + copied, length - copied, received, static_cast<uint32_t>( remaining ) ) != Status::OK )
+        {
+          break;
+        }
+
+        copied += received;
+      }
+
+      if ( copied == length )
+      {
+        return Status::OK;
+      }
+
+      /*------------------------------------------------
+      Hold on to what did arrive for the next read
+      ------------------------------------------------*/
+      rxHeld.insert( rxHeld.begin(), buffer, buffer + copied );
+      return copied ? Status::TIMEOUT : Status::EMPTY;
+    }
+
+    Chimera::Status_t BinaryUART::readSome( uint8_t *const buffer, const size_t length, size_t &received,
+                                            const uint32_t timeout_mS ) noexcept
+    {
+      received = 0;
+
+      if ( !buffer || !length )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      received = takeHeld( buffer, length );
+
+      if ( !received && isReceiving() )
+      {
+        return busPirate.serial->readSome( buffer, length, received, timeout_mS );
+      }
+
+      return received ? Status::OK : Status::EMPTY;
+    }
+
+    Chimera::Status_t BinaryUART::startBridge() noexcept
+    {
+      if ( bridgeActive )
+      {
+        return Status::OK;
+      }
+
+      if ( !systemInitialized )
+      {
+        return Status::NOT_INITIALIZED;
+      }
+
+      const auto serial        = busPirate.serial;
+      Chimera::Status_t result = stopEcho();
+
+      if ( result == Status::OK )
+      {
+        serial->setRxBufferSize( rxBufferSize );
+        result = serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::INTERRUPT );
+      }
+
+      if ( result == Status::OK )
+      {
+        const uint8_t cmd = CMD_BRIDGE;
+        result            = serial->write( &cmd, 1 );
+      }
+
+      if ( result == Status::OK )
+      {
+        bridgeActive          = true;
+        bridgeDrainTime       = std::chrono::steady_clock::now();
+        busPirate.state->currentMode = OperationalModes::BP_MODE_UART_BRIDGE;
+
+        spdlog::info( "UART bridge started at {} baud. Unplug the Bus Pirate to leave it.", getBaud() );
+      }
+      else
+      {
+        serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::BLOCKING );
+        spdlog::error( "Failed starting the UART bridge" );
+      }
+
+      return result;
+    }
+
+    bool BinaryUART::isReceiving() const noexcept
+    {
+      return echoActive || bridgeActive;
+    }
+
+    void BinaryUART::setRxBufferSize( const size_t bytes ) noexcept
+    {
+      rxBufferSize = bytes;
+    }
+
+    size_t BinaryUART::getRxOverflowCount() const noexcept
+    {
+      return busPirate.serial ? busPirate.serial->getRxOverflowCount() : 0;
+    }
+
+    uint32_t BinaryUART::getBaud() const noexcept
+    {
+      return appliedBaud ? appliedBaud : stagedBaud;
+    }
+
+    Chimera::Status_t BinaryUART::cfgPowerSupplies( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_POWER, state );
+    }
+
+    Chimera::Status_t BinaryUART::cfgPullups( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_PULLUP, state );
+    }
+
+    Chimera::Status_t BinaryUART::cfgAuxPin( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_AUX_PIN, state );
+    }
+
+    Chimera::Status_t BinaryUART::cfgChipSelect( const bool state )
+    {
+      return cfgField( reg_PeriphCfg, CFG_PERIPH_CS_PIN, state );
+    }
+
+    Chimera::Status_t BinaryUART::cfgPinOutput( const bool state )
+    {
+      return cfgField( reg_UARTCfg, CFG_UART_PIN_OUTPUT, state );
+    }
+
+    Chimera::Status_t BinaryUART::cfgRxPolarity( const bool inverted )
+    {
+      return cfgField( reg_UARTCfg, CFG_UART_RX_INVERTED, inverted );
+    }
+
+    void BinaryUART::stageConfig()
+    {
+      stagingConfig = true;
+    }
+
+    Chimera::Status_t BinaryUART::commitConfig()
+    {
+      CommandBatch batch;
+      return commitConfig( batch );
+    }
+
+    void BinaryUART::setPowerUpDelay( const uint32_t delay_mS )
+    {
+      powerUpDelay_mS = delay_mS;
+    }
+
+    Chimera::Status_t BinaryUART::commitConfig( CommandBatch &batch )
+    {
+      Chimera::Status_t result = Status::OK;
+      stagingConfig            = false;
+
+      if ( bridgeActive )
+      {
+        spdlog::error( "UART bridge is running, its configuration can't change" );
+        return Status::NOT_SUPPORTED;
+      }
+
+      /*------------------------------------------------
+      The acks would be lost among the echoed data, so the echo pauses meanwhile
+      ------------------------------------------------*/
+      const bool resumeEcho = echoActive;
+      if ( resumeEcho )
+      {
+        result = stopEcho();
+      }
+
+      if ( result == Status::OK )
+      {
+        /*------------------------------------------------
+        A speed preset would undo the baud rate generator value, so only one of the
+        two is written
+        ------------------------------------------------*/
+        std::vector<ShadowRegister *> registers = { &reg_PeriphCfg, &reg_UARTCfg };
+        const bool speedWritten                 = !brgPending && reg_UARTSpeed.dirty();
+        size_t brgIndex                         = 0;
+
+        if ( brgPending )
+        {
+          const std::vector<uint8_t> cmd = { CMD_SET_BRG, static_cast<uint8_t>( ( reg_BRG >> 8 ) & 0xFF ),
+                                             static_cast<uint8_t>( reg_BRG & 0xFF ) };
+          brgIndex = batch.add( cmd, cmd.size() );
+        }
+        else
+        {
+          registers.push_back( &reg_UARTSpeed );
+        }
+
+        result = commitShadowRegisters( busPirate, batch, registers );
+
+        if ( batch.size() )
+        {
+          bool baudApplied = !speedWritten || reg_UARTSpeed.valid;
+
+          if ( brgPending )
+          {
+            auto reply       = batch.reply( brgIndex );
+            const auto isAck = []( uint8_t ack ) { return ack == BitBangCommands::success; };
+
+            if ( ( reply.status == Status::OK ) && std::all_of( reply.data, reply.data + reply.length, isAck ) )
+            {
+              /*------------------------------------------------
+              The preset no longer matches what the Bus Pirate has
+              ------------------------------------------------*/
+              reg_UARTSpeed.valid = false;
+            }
+            else
+            {
+              result      = Status::FAIL;
+              baudApplied = false;
+            }
+
+            brgPending = false;
+          }
+
+          if ( baudApplied )
+          {
+            appliedBaud = stagedBaud;
+          }
+          else
+          {
+            stagedBaud = appliedBaud;
+          }
+        }
+      }
+
+      if ( resumeEcho )
+      {
+        result |= startEcho();
+      }
+
+      return result;
+    }
+
+    void BinaryUART::invalidateConfig()
+    {
+      invalidateShadowRegisters( { &reg_PeriphCfg, &reg_UARTSpeed, &reg_UARTCfg } );
+
+      /*------------------------------------------------
+      A baud rate generator value has to be written again too
+      ------------------------------------------------*/
+      stageBaud( stagedBaud );
+      appliedBaud = 0;
+    }
+
+    Chimera::Status_t BinaryUART::cfgField( ShadowRegister &reg, const uint8_t field, const bool state )
+    {
+      return writeRegister( reg, reg.withField( field, state ) );
+    }
+
+    Chimera::Status_t BinaryUART::writeRegister( ShadowRegister &reg, const uint8_t value )
+    {
+      reg.stage( value );
+
+      /*------------------------------------------------
+      Before begin() the board isn't in UART mode yet, so the change waits to go out
+      with the mode switch
+      ------------------------------------------------*/
+      if ( !stagingConfig && systemInitialized && reg.dirty() )
+      {
+        return commitConfig();
+      }
+
+      return Status::OK;
+    }
+
+    Chimera::Status_t BinaryUART::stageBaud( const uint32_t baud )
+    {
+      if ( !baud )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      auto preset = std::find_if( speedPresets.begin(), speedPresets.end(), [baud]( const SpeedPreset &p ) { return p.baud == baud; } );
+
+      if ( preset != speedPresets.end() )
+      {
+        reg_UARTSpeed.staged = preset->code & MSK_CFG_SPEED;
+        brgPending           = false;
+        stagedBaud           = baud;
+        return Status::OK;
+      }
+
+      /*------------------------------------------------
+      Closest baud rate generator setting, which has to land within 2% for the
+      target to make sense of it
+      ------------------------------------------------*/
+      const uint32_t divisor = ( BRG_CLOCK_HZ + ( baud / 2 ) ) / baud;
+
+      if ( !divisor || ( divisor - 1 > BRG_MAX ) )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      const uint32_t actual = BRG_CLOCK_HZ / divisor;
+
+      if ( static_cast<uint64_t>( std::labs( static_cast<long>( actual ) - static_cast<long>( baud ) ) ) * 1000 >
+           static_cast<uint64_t>( baud ) * BRG_TOLERANCE_PPT )
+      {
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      reg_BRG    = static_cast<uint16_t>( divisor - 1 );
+      brgPending = true;
+      stagedBaud = actual;
+
+      return Status::OK;
+    }
+
+    Chimera::Status_t BinaryUART::startEcho()
+    {
+      const auto serial = busPirate.serial;
+
+      serial->setRxBufferSize( rxBufferSize );
+      Chimera::Status_t result = serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::INTERRUPT );
+
+      /*------------------------------------------------
+      The ack goes out before the first echoed byte can
+      ------------------------------------------------*/
+      if ( result == Status::OK )
+      {
+        uint8_t ack       = 0;
+        const uint8_t cmd = CMD_ECHO_START;
+
+        serial->write( &cmd, 1 );
+        result     = serial->read( &ack, 1 );
+        echoActive = true;
+
+        if ( ( result != Status::OK ) || ( ack != BitBangCommands::success ) )
+        {
+          spdlog::error( "Failed starting UART RX echo" );
+          stopEcho();
+          result = Status::FAIL;
+        }
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::stopEcho()
+    {
+      using namespace std::chrono;
+
+      if ( !echoActive )
+      {
+        return Status::OK;
+      }
+
+      Chimera::Status_t result = Status::OK;
+      const auto serial        = busPirate.serial;
+      const auto deadline      = steady_clock::now() + milliseconds( ECHO_STOP_TIMEOUT_MS );
+      const size_t start       = rxHeld.size();
+      const uint8_t cmd        = CMD_ECHO_STOP;
+
+      serial->write( &cmd, 1 );
+      echoActive = false;
+
+      /*------------------------------------------------
+      Nothing follows the ack, so collect until the line goes quiet
+      ------------------------------------------------*/
+      std::array<uint8_t, 256> chunk;
+      size_t received = 0;
+
+      while ( ( serial->readSome( chunk.data(), chunk.size(), received, ECHO_QUIET_MS ) == Status::OK ) &&
+              ( steady_clock::now() < deadline ) )
+      {
+        rxHeld.insert( rxHeld.end(), chunk.begin(), chunk.begin() + received );
+      }
+
+      serial->setMode( Chimera::Serial::SubPeripheral::RX, Chimera::Serial::Modes::BLOCKING );
+
+      if ( ( rxHeld.size() > start ) && ( rxHeld.back() == BitBangCommands::success ) )
+      {
+        rxHeld.pop_back();
+      }
+      else if ( !busPirate.resyncFraming() )
+      {
+        spdlog::error( "Failed stopping UART RX echo" );
+        result = Status::FAIL;
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t BinaryUART::bridgeWrite( const uint8_t *const buffer, const size_t length, const uint32_t timeout_mS )
+    {
+      using namespace std::chrono;
+
+      const auto serial     = busPirate.serial;
+      const uint64_t byte_nS = targetByteTime_nS();
+
+      if ( byte_nS <= serial->wireTime_uS( 1000 ) )
+      {
+        return serial->write( buffer, length, timeout_mS );
+      }
+
+      /*------------------------------------------------
+      The firmware hands bytes across as fast as the target UART takes them and drops
+      whatever doesn't fit in its FIFO. Hold each chunk back until there's room.
+      ------------------------------------------------*/
+      Chimera::Status_t result = Status::OK;
+      const auto deadline      = steady_clock::now() + milliseconds( timeout_mS );
+      const auto fifoTime      = nanoseconds( byte_nS * BULK_UART_FIFO_DEPTH );
+
+      for ( size_t offset = 0; ( offset < length ) && ( result == Status::OK ); offset += BULK_UART_FIFO_DEPTH )
+      {
+        const size_t len = std::min( BULK_UART_FIFO_DEPTH, length - offset );
+        const auto room  = bridgeDrainTime - fifoTime;
+
+        if ( room > deadline )
+        {
+          result = Status::TIMEOUT;
+          break;
+        }
+
+        std::this_thread::sleep_until( room );
+
+        result          = serial->write( buffer + offset, len, timeout_mS );
+        bridgeDrainTime = std::max( bridgeDrainTime, steady_clock::now() ) + nanoseconds( byte_nS * len );
+      }
+
+      return result;
+    }
+
+    size_t BinaryUART::takeHeld( uint8_t *const buffer, const size_t length )
+    {
+      const size_t copied = std::min( length, rxHeld.size() );
+
+      memcpy( buffer, rxHeld.data(), copied );
+      rxHeld.erase( rxHeld.begin(), rxHeld.begin() + copied );
+
+      return copied;
+    }
+
+    uint64_t BinaryUART::targetByteTime_nS() const
+    {
+      /*------------------------------------------------
+      Start bit, eight data bits, parity and stop bits
+      ------------------------------------------------*/
+      uint64_t bits = 10;
+
+      if ( reg_UARTCfg.staged & MSK_UART_PARITY )
+      {
+        bits++;
+      }
+
+      if ( reg_UARTCfg.staged & CFG_UART_2_STOP_BITS )
+      {
+        bits++;
+      }
+
+      return ( bits * 1000000000ull ) / getBaud();
+    }
+
+    size_t BinaryUART::streamWindow() const
+    {
+      if ( !appliedBaud )
+      {
+        return 1;
+      }
+
+      return busPirate.streamWindow( targetByteTime_nS() );
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,332 @@
+/********************************************************************************
+ *   File Name:
+ *       bp_uart.hpp
+ *
+ *   Description:
+ *       Provides an interface to the UART hardware on the Bus Pirate. Conforms with
+ *       the Chimera HAL serial interface.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#pragma once
+#ifndef BUS_PIRATE_CPP_UART_DRIVER_HPP
+#define BUS_PIRATE_CPP_UART_DRIVER_HPP
+
+/* C++ Includes */
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/* Chimera Includes */
+#include <Chimera/interface.hpp>
+
+/* BusPirate Includes */
+#include "bus_pirate.hpp"
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    class BinaryUART;
+    using BinaryUART_sPtr = std::shared_ptr<BinaryUART>;
+    using BinaryUART_uPtr = std::unique_ptr<BinaryUART>;
+
+    /**
+     *  Talks to a target UART through the Bus Pirate. There are three ways to use it:
+     *
+     *  - Command mode, the default. write() sends the data as bulk write commands of up
+     *    to 16 bytes, streamed back to back and paced to the target's baud rate. Nothing
+     *    the target sends is received.
+     *
+     *  - RX echo, selected by passing anything other than Modes::BLOCKING for the RX
+     *    path to begin() or setMode(). The firmware forwards everything the target sends
+     *    and a background thread collects it into a ring buffer for read(). The firmware
+     *    mixes its command acks into the echoed data, so write() is refused while echo is
+     *    on. Changing the configuration pauses echo for the duration.
+     *
+     *  - Bridge mode, entered with startBridge(). The Bus Pirate becomes a transparent
+     *    link to the target, full duplex and with no command overhead. It can only be left
+     *    by unplugging the board.
+     */
+    class BinaryUART : public Chimera::Serial::Interface
+    {
+    public:
+      /**
+       *  Primary constructor for creating the UART interface
+       *
+       *  @param[in]  device    An instance of the low level hardware interface to the Bus Pirate
+       */
+      BinaryUART( Device &device );
+
+      BinaryUART() = default;
+      ~BinaryUART();
+
+      /**
+       *  Enters UART mode, together with any configuration staged beforehand, and switches
+       *  the power supplies on. Passing anything other than Modes::BLOCKING for rxMode
+       *  starts the RX echo.
+       */
+      Chimera::Status_t begin( const Chimera::Serial::Modes txMode = Chimera::Serial::Modes::BLOCKING,
+                               const Chimera::Serial::Modes rxMode = Chimera::Serial::Modes::BLOCKING ) noexcept override;
+
+      /**
+       *  Sets the target's frame format and baud rate. Bauds the firmware has a preset for
+       *  are used as is, anything else is programmed into the baud rate generator
+       *  directly. Only 8 data bits and no flow control are supported.
+       */
+      Chimera::Status_t configure(
+          const uint32_t baud = 115200, const Chimera::Serial::CharWid width = Chimera::Serial::CharWid::CW_8BIT,
+          const Chimera::Serial::Parity parity    = Chimera::Serial::Parity::PAR_NONE,
+          const Chimera::Serial::StopBits stop    = Chimera::Serial::StopBits::SBITS_ONE,
+          const Chimera::Serial::FlowControl flow = Chimera::Serial::FlowControl::FCTRL_NONE ) noexcept override;
+
+      /**
+       *  Stops the RX echo and closes the connection to the Bus Pirate
+       */
+      Chimera::Status_t end() noexcept override;
+
+      Chimera::Status_t setBaud( const uint32_t baud ) noexcept override;
+
+      /**
+       *  Starts (anything but Modes::BLOCKING) or stops (Modes::BLOCKING) the RX echo
+       *
+       *  @param[in]  periph    Must be SubPeripheral::RX or SubPeripheral::TXRX
+       *  @param[in]  mode      Modes::BLOCKING to stop the echo, anything else to start it
+       *  @return Chimera::Status_t
+       */
+      Chimera::Status_t setMode( const Chimera::Serial::SubPeripheral periph,
+                                 const Chimera::Serial::Modes mode ) noexcept override;
+
+      /**
+       *  Sends data to the target. Writes never outrun the target: in command mode the
+       *  stream of bulk writes is throttled by their acks, and in bridge mode the data
+       *  is held back on the host until the target's baud rate has made room for it.
+       *
+       *  @return Chimera::Status_t: NOT_READY while RX echo is on, TIMEOUT if bridge mode
+       *          pacing couldn't send everything in time
+       */
+      Chimera::Status_t write( const uint8_t *const buffer, const size_t length,
+                               const uint32_t timeout_mS = 500 ) noexcept override;
+
+      /**
+       *  Reads exactly length bytes received from the target, with RX echo or bridge
+       *  mode active. Data that arrived before a timeout isn't lost, it is returned by
+       *  the next read.
+       *
+       *  @return Chimera::Status_t: OK, TIMEOUT if only part arrived, EMPTY if nothing did
+       */
+      Chimera::Status_t read( uint8_t *const buffer, const size_t length, const uint32_t timeout_mS = 500 ) noexcept override;
+
+      /**
+       *	Reads whatever the target has sent, up to length bytes, returning as soon as
+       *  anything is available. Meant for streaming logs and other unframed data.
+       *
+       *	@param[out]	buffer        Receives the data
+       *	@param[in]	length        Maximum number of bytes to read
+       *	@param[out]	received      Number of bytes actually read
+       *	@param[in]	timeout_mS    How long to wait for data to arrive
+       *	@return Chimera::Status_t: OK if anything was read, EMPTY if not
+       */
+      Chimera::Status_t readSome( uint8_t *const buffer, const size_t length, size_t &received,
+                                  const uint32_t timeout_mS = 500 ) noexcept;
+
+      /**
+       *	Turns the Bus Pirate into a transparent bridge to the target with the current
+       *  configuration. Stops RX echo first and starts background RX on the host.
+       *  There is no way back short of unplugging the board.
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t startBridge() noexcept;
+
+      /**
+       *	Checks if the firmware is forwarding received data, through RX echo or the bridge
+       *
+       *	@return bool
+       */
+      bool isReceiving() const noexcept;
+
+      /**
+       *	Sets the size of the host side ring buffer that holds received data until it is
+       *  read. Only takes effect the next time receiving starts. Size it to cover however
+       *  long the application may go without reading at the target's baud rate.
+       *
+       *	@param[in]	bytes         Ring size, rounded up to a power of two
+       *	@return void
+       */
+      void setRxBufferSize( const size_t bytes ) noexcept;
+
+      /**
+       *	Number of received bytes dropped because the application didn't read them in
+       *  time, since receiving last started
+       *
+       *	@return size_t
+       */
+      size_t getRxOverflowCount() const noexcept;
+
+      /**
+       *	Gets the baud rate actually produced for the target, which for bauds without a
+       *  preset can differ slightly from the one asked for
+       *
+       *	@return uint32_t
+       */
+      uint32_t getBaud() const noexcept;
+
+      /**
+       *	Enables or disables the on-board power supplies
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPowerSupplies( const bool state );
+
+      /**
+       *	Enables or disables the pullups on the UART pins
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPullups( const bool state );
+
+      /**
+       *	Enables or disables the Auxiliary pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgAuxPin( const bool state );
+
+      /**
+       *	Enables or disables the chip select pin
+       *
+       *	@param[in]	state         Enabled (true), disabled (false)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgChipSelect( const bool state );
+
+      /**
+       *	Selects how the TX pin is driven
+       *
+       *	@param[in]	state         True (3.3V), false (HiZ, open drain)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgPinOutput( const bool state );
+
+      /**
+       *	Selects the idle level of the RX line
+       *
+       *	@param[in]	inverted      Idles high (false), idles low (true)
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t cfgRxPolarity( const bool inverted );
+
+      /**
+       *	Starts staging configuration changes. Until commitConfig() is called, the cfg
+       *  functions, configure() and setBaud() only update the shadow registers.
+       *
+       *	@return void
+       */
+      void stageConfig();
+
+      /**
+       *	Writes every register that was changed while staging and stops staging
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t commitConfig();
+
+      /**
+       *	Sets how long begin() waits for the target to settle after switching the
+       *  power supplies on. There is no wait if the supplies were already on.
+       *
+       *	@param[in]	delay_mS      Settling time in milliseconds, 0 to skip it
+       *	@return void
+       */
+      void setPowerUpDelay( const uint32_t delay_mS );
+
+    protected:
+    private:
+      Device busPirate;
+
+      bool systemInitialized = false;
+      bool stagingConfig     = false;
+      bool echoActive        = false;
+      bool bridgeActive      = false;
+      uint32_t powerUpDelay_mS;
+      size_t rxBufferSize;
+
+      ShadowRegister reg_PeriphCfg;
+      ShadowRegister reg_UARTSpeed;
+      ShadowRegister reg_UARTCfg;
+      uint16_t reg_BRG;     /**< Baud rate generator value, used when no speed preset fits */
+      bool brgPending;      /**< reg_BRG has to be written instead of reg_UARTSpeed */
+      uint32_t stagedBaud;  /**< Baud the staged registers produce */
+      uint32_t appliedBaud; /**< Baud the Bus Pirate was last configured for */
+
+      std::vector<uint8_t> rxHeld; /**< Received data handed back by a read that timed out */
+      std::chrono::steady_clock::time_point bridgeDrainTime;
+
+      Chimera::Status_t cfgField( ShadowRegister &reg, const uint8_t field, const bool state );
+
+      Chimera::Status_t writeRegister( ShadowRegister &reg, const uint8_t value );
+
+      Chimera::Status_t commitConfig( CommandBatch &batch );
+
+      /**
+       *	Forgets the register settings along with the baud rate generator value, so
+       *  the next commit writes all of them
+       *
+       *	@return void
+       */
+      void invalidateConfig();
+
+      /**
+       *	Works out the register settings for a baud rate and stages them
+       *
+       *	@param[in]	baud          Desired baud rate
+       *	@return Chimera::Status_t: INVAL_FUNC_PARAM if the baud rate generator can't get within tolerance
+       */
+      Chimera::Status_t stageBaud( const uint32_t baud );
+
+      Chimera::Status_t startEcho();
+
+      /**
+       *	Stops the RX echo. The echo stops once the firmware handles the command, so
+       *  everything up to the ack is target data and is kept for the next read.
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t stopEcho();
+
+      /**
+       *	Writes data through the bridge, holding it back so that no more than the
+       *  firmware's FIFO can absorb is ever ahead of the target
+       *
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t bridgeWrite( const uint8_t *const buffer, const size_t length, const uint32_t timeout_mS );
+
+      size_t takeHeld( uint8_t *const buffer, const size_t length );
+
+      /**
+       *	Time to clock one byte out to the target with the applied configuration
+       *
+       *	@return uint64_t          Byte time in nanoseconds
+       */
+      uint64_t targetByteTime_nS() const;
+
+      /**
+       *	Works out how far a stream of bulk writes can run ahead of the acks at the
+       *  target's baud rate without overrunning the Bus Pirate's UART FIFO
+       *
+       *	@return size_t: Window in bytes, 0 if the stream doesn't need throttling
+       */
+      size_t streamWindow() const;
+    };
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_UART_DRIVER_HPP */
@@ -1,625 +1,1340 @@
-/********************************************************************************
- *   File Name:
- *      bus_pirate.cpp
- *
- *   Description:
- *      Implements the interface to the BusPirate test hardware
- *
- *   2019 | Brandon Braun | brandonbraun653@gmail.com
- ********************************************************************************/
-
-/* Driver Includes */
-#include "bus_pirate.hpp"
-
-/* Library Includes */
-#include <strtk/strtk.hpp>
-#include <spdlog/spdlog.h>
-
-/* Chimera Includes */
-#include <Chimera/serial.hpp>
-
-/* C++ Includes */
-#include <algorithm>
-#include <deque>
-#include <string>
-#include <regex>
-
-/* Boost Includes */
-#include <boost/thread.hpp>
-#include <boost/chrono.hpp>
-
-using namespace Chimera::Serial;
-
-
-namespace HWInterface
-{
-  namespace BusPirate
-  {
-    /*------------------------------------------------
-    Track which versions of BusPirates are known to work with this software.
-    ------------------------------------------------*/
-    static std::vector<std::string> knownBoardVer      = { "v3b" };
-    static std::vector<std::string> knownFirmwareVer   = { "v5.10" };
-    static std::vector<std::string> knownBootloaderVer = { "v4.4" };
-
-    /*------------------------------------------------
-    Version limits for various feature support
-    ------------------------------------------------*/
-    static constexpr uint32_t minResetFirmwareMajorVer = 2; /**< Minimum firmware version needed to support reset '#' command */
-
-    /*------------------------------------------------
-    Various class static variable initializers
-    ------------------------------------------------*/
-    const std::string MenuCommands::info    = "i\n";
-    const std::string MenuCommands::reset   = "#\n";
-    const std::string MenuCommands::busMode = "m\n";
-    const std::string MenuCommands::ping    = "\n";
-
-    const std::string BitBangCommands::initSuccess = "BBIO";
-
-
-    Device::Device( std::string &devicePort )
-    {
-      serial = std::make_shared<SerialDriver>( devicePort );
-
-      connectedToSerial = false;
-      currentMode       = OperationalModes::BP_INVALID_MODE;
-    }
-
-    bool Device::open()
-    {
-      bool opened = false;
-
-      if ( !serial->isOpen() )
-      {
-        serial->begin();
-        Chimera::Status_t error = serial->configure( 115200, CharWid::CW_8BIT, Parity::PAR_NONE, StopBits::SBITS_ONE,
-                                                     FlowControl::FCTRL_NONE );
-
-        /*------------------------------------------------
-        This flag controls whether or not the Bus Pirate will work. All
-        functions should be checking this variable before execution.
-        ------------------------------------------------*/
-        connectedToSerial = ( error == Status::OK );
-
-        /*------------------------------------------------
-        Immediately reset the board, which places the board into Terminal mode
-        ------------------------------------------------*/
-        if ( connect() )
-        {
-          opened      = true;
-          currentMode = OperationalModes::BP_MODE_HiZ;
-        }
-        else
-        {
-          spdlog::error( "Failed opening Bus Pirate device" );
-        }
-      }
-      else
-      {
-        opened = true;
-      }
-
-      return opened;
-    }
-
-    void Device::close()
-    {
-      /*------------------------------------------------
-      In-case the user is not powering off the board, disconnect in a HiZ state
-      ------------------------------------------------*/
-      reset();
-
-      /*------------------------------------------------
-      Power off low level platform serial driver
-      ------------------------------------------------*/
-      serial->flush();
-      connectedToSerial = !( serial->end() == Status::OK );
-    }
-
-    bool Device::reset()
-    {
-      bool devReset = false;
-
-      if ( isOpen() )
-      {
-        devReset = resetTerminal();
-
-        if ( !devReset )
-        {
-          devReset = resetBitBangRoot();
-
-          if ( !devReset )
-          {
-            devReset = resetBitBangHWMode();
-          }
-        }
-
-        if ( !devReset )
-        {
-          spdlog::error( "Failed resetting Bus Pirate device" );
-        }
-
-        /*------------------------------------------------
-        The above commands don't read out all the serial data, so make sure other
-        functions don't accidentally get interpret it as part of their response.
-        ------------------------------------------------*/
-        serial->flush();
-      }
-
-      return devReset;
-    }
-
-    bool Device::connect()
-    {
-      bool connected = false;
-
-      /*------------------------------------------------
-      Make sure that we can talk to the device correctly. Occasionally there will be old data in the system serial buffer that
-      hasn't been cleared out yet. Boost does not provide a way to flush this, so the simple fix is just to try and read
-      things out again.
-      ------------------------------------------------*/
-      if ( reset() )
-      {
-        for ( auto x = 0; x < MAX_CONNECT_ATTEMPTS; x++ )
-        {
-          if ( getInfo().isValid )
-          {
-            connected = true;
-            break;
-          }
-          else
-          {
-            spdlog::info( "Retrying connection..." );
-            Chimera::delayMilliseconds( 500 );
-          }
-        }
-      }
-
-      return connected;
-    }
-
-    bool Device::isOpen()
-    {
-      return connectedToSerial;
-    }
-
-    void Device::clearTerminal()
-    {
-      auto dataField = reinterpret_cast<const uint8_t *>( MenuCommands::ping.data() );
-      auto dataSize  = MenuCommands::ping.size();
-
-      for ( auto x = 0; x < 3; x++ )
-      {
-        serial->write( dataField, dataSize );
-        Chimera::delayMilliseconds( 75 );
-      }
-    }
-
-    Info Device::getInfo()
-    {
-      Info info;
-
-      if ( isOpen() && serial->flush() )
-      {
-        Chimera::delayMilliseconds(100);
-        serial->flush();
-
-        std::regex numberOnlyRegex = std::regex( R"([\D])" );
-        std::string cmd            = MenuCommands::info;
-        std::string rawOutput      = sendResponsiveCommand( cmd );
-        auto split_opt             = strtk::split_options::compress_delimiters;
-
-        /*------------------------------------------------
-        Split the string by new lines
-        ------------------------------------------------*/
-        std::deque<std::string> tokenList;
-        strtk::multiple_char_delimiter_predicate predicate( "\r\n" );
-        strtk::split( predicate, rawOutput, strtk::range_to_type_back_inserter( tokenList ), split_opt );
-
-        if ( tokenList.size() )
-        {
-          /*------------------------------------------------
-          Pull out the Board version
-          ------------------------------------------------*/
-          /* Get the version as a string */
-          std::string line1 = tokenList.front();
-          std::deque<std::string> l1Tokens;
-          strtk::split( ' ', line1, strtk::range_to_type_back_inserter( l1Tokens ), split_opt );
-
-          info.hwVer = l1Tokens[ 2 ];
-          tokenList.pop_front();
-
-          /* Get the version as a number, expected format: vXXX */
-          std::string boardVerStr = std::regex_replace( info.hwVer, numberOnlyRegex, "" );
-          info.hwVerNum           = static_cast<uint32_t>( std::stoi( boardVerStr ) );
-          info.hwVerNumMajor      = static_cast<uint32_t>( std::stoi( info.hwVer.substr( 1, 1 ) ) );
-
-          /*------------------------------------------------
-          Pull out the Firmware and Bootloader Versions
-          ------------------------------------------------*/
-          /* Get the values as strings */
-          std::string line2 = tokenList.front();
-          std::deque<std::string> l2Tokens;
-          strtk::split( ' ', line2, strtk::range_to_type_back_inserter( l2Tokens ), split_opt );
-
-          info.firmwareVer   = l2Tokens[ 1 ];
-          info.bootLoaderVer = l2Tokens[ 4 ];
-          tokenList.pop_front();
-
-          /* Get the values as numbers: Convert to representation expecting vX.X */
-          std::string firmwareVerStr = std::regex_replace( info.firmwareVer, numberOnlyRegex, "" );
-          info.firmwareVerNum        = static_cast<uint32_t>( std::stoi( firmwareVerStr ) );
-          info.firmwareVerNumMajor   = static_cast<uint32_t>( std::stoi( info.firmwareVer.substr( 1, 1 ) ) );
-          info.firmwareVerNumMinor   = static_cast<uint32_t>( std::stoi( info.firmwareVer.substr( 3, 1 ) ) );
-
-          std::string bootloaderVerStr = std::regex_replace( info.bootLoaderVer, numberOnlyRegex, "" );
-          info.bootloaderVerNum        = static_cast<uint32_t>( std::stoi( bootloaderVerStr ) );
-          info.bootloaderVerNumMajor   = static_cast<uint32_t>( std::stoi( info.bootLoaderVer.substr( 1, 1 ) ) );
-          info.bootloaderVerNumMinor   = static_cast<uint32_t>( std::stoi( info.bootLoaderVer.substr( 3, 1 ) ) );
-
-          /*------------------------------------------------
-          Pull out the Device ID, Revision ID, and MCU Type
-          ------------------------------------------------*/
-          std::string line3 = tokenList.front();
-          std::deque<std::string> l3Tokens;
-          strtk::split( ' ', line3, strtk::range_to_type_back_inserter( l3Tokens ), split_opt );
-          tokenList.pop_front();
-
-          /*------------------------------------------------
-          Handle Device ID separately
-          ------------------------------------------------*/
-          std::string rawDevID = l3Tokens[ 0 ];
-          std::deque<std::string> devIDTokens;
-          strtk::split( ':', rawDevID, strtk::range_to_type_back_inserter( devIDTokens ), split_opt );
-
-          info.deviceID = devIDTokens[ 1 ];
-
-          /*------------------------------------------------
-          Handle Revision ID separately
-          ------------------------------------------------*/
-          std::string rawRevID = l3Tokens[ 1 ];
-          std::deque<std::string> revIDTokens;
-          strtk::split( ':', rawRevID, strtk::range_to_type_back_inserter( revIDTokens ), split_opt );
-
-          info.revID = revIDTokens[ 1 ];
-
-          /*------------------------------------------------
-          Handle MCU type separately
-          ------------------------------------------------*/
-          std::string mcu = l3Tokens[ 2 ] + ' ' + l3Tokens[ 3 ];
-          mcu.erase( std::remove( mcu.begin(), mcu.end(), '(' ), mcu.end() );
-          mcu.erase( std::remove( mcu.begin(), mcu.end(), ')' ), mcu.end() );
-
-          info.mcuVer = mcu;
-
-          /*------------------------------------------------
-          Validate the Board Version
-          ------------------------------------------------*/
-          /* Assume everything is OK and then negate if not. */
-          info.isValid = true;
-
-          if ( !std::any_of( knownBoardVer.begin(), knownBoardVer.end(),
-                             [info]( std::string &i ) { return i == info.hwVer; } ) )
-          {
-            std::cout << "Unknown board version: " << info.hwVer << std::endl;
-            info.isValid = false;
-          }
-
-          /*------------------------------------------------
-          Validate the Firmware Version
-          ------------------------------------------------*/
-          if ( !std::any_of( knownFirmwareVer.begin(), knownFirmwareVer.end(),
-                             [info]( std::string &f ) { return f == info.firmwareVer; } ) )
-          {
-            std::cout << "Unknown firmware version: " << info.firmwareVer << std::endl;
-            info.isValid = false;
-          }
-
-          /*------------------------------------------------
-          Validate the Bootloader Version
-          ------------------------------------------------*/
-          if ( !std::any_of( knownBootloaderVer.begin(), knownBootloaderVer.end(),
-                             [info]( std::string &b ) { return b == info.bootLoaderVer; } ) )
-          {
-            std::cout << "Unknown bootloader version: " << info.bootLoaderVer << std::endl;
-            info.isValid = false;
-          }
-        }
-      }
-      else
-      {
-        std::cout << "Could not send command. Bus Pirate not connected." << std::endl;
-      }
-
-      this->deviceInfo = info;
-      return info;
-    }
-
-    void Device::sendCommand( const std::string &cmd ) noexcept
-    {
-      sendResponsiveCommand( cmd );
-      serial->flush();
-    }
-
-    void Device::sendCommand( const std::vector<uint8_t> &cmd ) noexcept
-    {
-      sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
-      serial->flush();
-    }
-
-    std::string Device::sendResponsiveCommand( const std::string &cmd, const boost::regex &delimiter ) noexcept
-    {
-      std::vector<uint8_t> readBuffer;
-      std::string response;
-
-      /*------------------------------------------------
-      Flush the serial port as we don't need data from the
-      previous command straying into the response from this one.
-      ------------------------------------------------*/
-      if ( isOpen() )
-      {
-        serial->write( reinterpret_cast<const uint8_t *>( cmd.c_str() ), cmd.length() );
-
-        if ( delimiter.empty() )
-        {
-          serial->readUntil( readBuffer, terminalModeRegex );
-        }
-        else
-        {
-          serial->readUntil( readBuffer, delimiter );
-        }
-
-        /*------------------------------------------------
-        BusPirate emulates a terminal, which means our command is printed
-        back to us + that little 'HiZ>' string that we all know means
-        'enter more things here'. (What's the proper name for that anyways?)
-        Neither are part of the actual output so they are removed.
-
-
-        HiZ><our_command>\r\n
-        <actual output we want>\r\n
-        HiZ>
-        ------------------------------------------------*/
-        if ( readBuffer.size() )
-        {
-          constexpr size_t newline_char_len = 2;
-
-          /* Remove our command from the front. Expects it to have a '\n' appended on. */
-          readBuffer.erase( readBuffer.begin(), ( readBuffer.begin() + cmd.length() - 1 ) + newline_char_len );
-
-          response = std::string( readBuffer.begin(), readBuffer.end() );
-        }
-      }
-      else
-      {
-        spdlog::error( "Could not send command. There was a problem with the serial port." );
-      }
-
-      return response;
-    }
-
-    std::vector<uint8_t> Device::sendResponsiveCommand( const std::vector<uint8_t> &cmd,
-                                                        const boost::regex &delimiter ) noexcept
-    {
-      std::vector<uint8_t> readBuffer;
-
-      if ( isOpen() )
-      {
-        serial->flush();
-        Chimera::delayMilliseconds( 25 );
-        serial->flush();
-
-        serial->write( cmd.data(), cmd.size() );
-
-        if ( delimiter.empty() )
-        {
-          serial->readUntil( readBuffer, terminalModeRegex );
-        }
-        else
-        {
-          serial->readUntil( readBuffer, delimiter );
-        }
-      }
-      else
-      {
-        spdlog::error( "Could not send command. There was a problem with the serial port." );
-      }
-
-      return readBuffer;
-    }
-
-    std::vector<boost::uint8_t> Device::sendResponsiveCommand( const std::vector<uint8_t> &cmd, const uint32_t length ) noexcept
-    {
-      std::vector<uint8_t> readBuffer( length );
-
-      if ( isOpen() )
-      {
-        serial->flush();
-        Chimera::delayMilliseconds( 25 );
-        serial->flush();
-
-
-        serial->write( cmd.data(), cmd.size() );
-        serial->read( readBuffer.data(), length );
-      }
-      else
-      {
-        spdlog::error( "Could not send command. There was a problem with the serial port." );
-      }
-
-      return readBuffer;
-    }
-
-    bool Device::terminalInit()
-    {
-      return reset();
-    }
-
-    bool Device::bbInit()
-    {
-      bool result                        = false;
-      const std::string expectedResponse = "BBIO1";
-
-      if ( terminalInit() )
-      {
-        std::vector<uint8_t> output;
-        std::vector<uint8_t> initCmd;
-
-        initCmd.assign( 20, BitBangCommands::init );
-        output = sendResponsiveCommand( initCmd, boost::regex{ "BBIO1" } );
-        std::string actualResponse( output.begin(), output.end() );
-
-        if ( actualResponse.find( expectedResponse ) != std::string::npos )
-        {
-          result      = true;
-          currentMode = OperationalModes::BP_MODE_BIT_BANG_ROOT;
-        }
-      }
-      else
-      {
-        spdlog::error( "Failed entering Bit Bang mode" );
-      }
-
-      return result;
-    }
-
-    bool Device::bbEnterSPI()
-    {
-      bool modeEntered = false;
-
-      if ( isOpen() )
-      {
-        /*------------------------------------------------
-        Automatically transition the device to BitBang mode if not there
-        ------------------------------------------------*/
-        if ( currentMode != OperationalModes::BP_MODE_BIT_BANG_ROOT )
-        {
-          bbInit();
-        }
-
-        /*------------------------------------------------
-        Transition into raw BitBang SPI mode. Success is indicated by the
-        Bus Pirate returning "SPIx" where x is the current SPI version number.
-        ------------------------------------------------*/
-        if ( currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT )
-        {
-          std::vector<uint8_t> cmd = { BitBangCommands::enterSPI };
-          auto response            = sendResponsiveCommand( cmd, boost::regex{ "(SPI)." } );
-
-          std::string strOut( response.begin(), response.end() );
-          std::string substr = "SPI";
-
-          if ( strOut.find( substr ) != std::string::npos )
-          {
-            modeEntered = true;
-            currentMode = OperationalModes::BP_MODE_SPI_BIT_BANG;
-          }
-        }
-
-        if ( !modeEntered )
-        {
-          spdlog::error( "Failed entering Bit Bang SPI mode" );
-        }
-      }
-      else
-      {
-        spdlog::error( "Could not send command. There was a problem with the serial port." );
-      }
-
-      return modeEntered;
-    }
-
-    bool Device::bbI2C()
-    {
-      return false;
-    }
-
-    bool Device::bbUART()
-    {
-      return false;
-    }
-
-    bool Device::bb1Wire()
-    {
-      return false;
-    }
-
-    bool Device::bbRawWire()
-    {
-      return false;
-    }
-
-    bool Device::bbJTAG()
-    {
-      return false;
-    }
-
-    bool Device::bbExitHWMode()
-    {
-      return resetBitBangHWMode();
-    }
-
-    bool Device::resetTerminal()
-    {
-      bool devReset = false;
-      std::vector<uint8_t> termCmd;
-      std::vector<uint8_t> termOut;
-      std::string termStr;
-
-      clearTerminal();
-      serial->flush();
-
-      termCmd = std::vector<uint8_t>( MenuCommands::reset.begin(), MenuCommands::reset.end() );
-      termOut = sendResponsiveCommand( termCmd, 10 );
-      termStr = std::string( termOut.begin(), termOut.end() );
-
-      if ( termStr.find( "RESET" ) != std::string::npos )
-      {
-        devReset = true;
-      }
-
-      return devReset;
-    }
-
-    bool Device::resetBitBangRoot()
-    {
-      bool devReset = false;
-      std::vector<uint8_t> bbCmd;
-      std::vector<uint8_t> bbOut;
-
-      serial->flush();
-      bbCmd = { BitBangCommands::reset };
-      bbOut = sendResponsiveCommand( bbCmd, sizeof( BitBangCommands::reset ) );
-
-      if ( !devReset && bbOut.size() && ( bbOut[ 0 ] == BitBangCommands::success ) )
-      {
-        devReset = true;
-      }
-
-      return devReset;
-    }
-
-    bool Device::resetBitBangHWMode()
-    {
-      bool devReset = false;
-      std::vector<uint8_t> bbCmd;
-      std::vector<uint8_t> bbOut;
-      std::string bbStr;
-
-      serial->flush();
-      bbCmd = { BitBangCommands::init };
-      bbOut = sendResponsiveCommand( bbCmd, static_cast<uint32_t>( BitBangCommands::initSuccess.size() ) );
-      bbStr = std::string( bbOut.begin(), bbOut.end() );
-
-      if ( bbStr.find( BitBangCommands::initSuccess ) != std::string::npos )
-      {
-        devReset = resetBitBangRoot();
-      }
-
-      return devReset;
-    }
-
-  }  // namespace BusPirate
-
-}  // namespace HWInterface
+/********************************************************************************
+ *   File Name:
+ *      bus_pirate.cpp
+ *
+ *   Description:
+ *      Implements the interface to the BusPirate test hardware
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "bus_pirate.hpp"
+#include "info_cache.hpp"
+#include "info_parser.hpp"
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+/* Chimera Includes */
+#include <Chimera/serial.hpp>
+
+/* C++ Includes */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/* Boost Includes */
+#include <boost/thread.hpp>
+#include <boost/chrono.hpp>
+
+using namespace Chimera::Serial;
+
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /*------------------------------------------------
+    Track which versions of BusPirates are known to work with this software.
+    ------------------------------------------------*/
+    static std::vector<std::string> knownBoardVer      = { "v3b" };
+    static std::vector<std::string> knownFirmwareVer   = { "v5.10" };
+    static std::vector<std::string> knownBootloaderVer = { "v4.4" };
+
+    /*------------------------------------------------
+    Version limits for various feature support
+    ------------------------------------------------*/
+    static constexpr uint32_t minResetFirmwareMajorVer         = 2; /**< Minimum firmware version needed to support reset '#' command */
+    static constexpr uint32_t minBitBangFirmwareMajorVer       = 2; /**< Minimum firmware version with the binary bit bang modes */
+    static constexpr uint32_t minWriteThenReadFirmwareMajorVer = 5; /**< Minimum firmware version with SPI write-then-read */
+
+    /*------------------------------------------------
+    Various class static variable initializers
+    ------------------------------------------------*/
+    const std::string MenuCommands::info    = "i\n";
+    const std::string MenuCommands::reset   = "#\n";
+    const std::string MenuCommands::busMode = "m\n";
+    const std::string MenuCommands::ping    = "\n";
+
+    const std::string BitBangCommands::initSuccess    = "BBIO";
+    const std::string BitBangCommands::spiSuccess     = "SPI1";
+    const std::string BitBangCommands::i2cSuccess     = "I2C1";
+    const std::string BitBangCommands::uartSuccess    = "ART1";
+    const std::string BitBangCommands::oneWireSuccess = "1W01";
+    const std::string BitBangCommands::rawWireSuccess = "RAW1";
+    const std::string BitBangCommands::openOCDSuccess = "OCD1";
+
+    const std::string SUMPCommands::idSuccess = "1ALS";
+
+    const Delimiter Delimiters::terminalPrompt = Delimiter::prompt();
+    const Delimiter Delimiters::bitBangRoot    = Delimiter( "BBIO1" );
+    const Delimiter Delimiters::spiMode        = Delimiter( BitBangCommands::spiSuccess );
+    const Delimiter Delimiters::i2cMode        = Delimiter( BitBangCommands::i2cSuccess );
+    const Delimiter Delimiters::uartMode       = Delimiter( BitBangCommands::uartSuccess );
+    const Delimiter Delimiters::oneWireMode    = Delimiter( BitBangCommands::oneWireSuccess );
+    const Delimiter Delimiters::rawWireMode    = Delimiter( BitBangCommands::rawWireSuccess );
+    const Delimiter Delimiters::openOCDMode    = Delimiter( BitBangCommands::openOCDSuccess );
+    const Delimiter Delimiters::sumpMode       = Delimiter( SUMPCommands::idSuccess );
+
+    /*------------------------------------------------
+    Every binary mode answers a fixed query with its version string without
+    changing any settings. Strict framing uses these to check the link is in step.
+    ------------------------------------------------*/
+    struct FramingProbe
+    {
+      OperationalModes mode;
+      uint8_t query;
+      const char *reply;
+    };
+
+    static const FramingProbe framingProbes[] = {
+      { OperationalModes::BP_MODE_BIT_BANG_ROOT, BitBangCommands::init, "BBIO1" },
+      { OperationalModes::BP_MODE_SPI_BIT_BANG, BitBangCommands::modeVersion, "SPI1" },
+      { OperationalModes::BP_MODE_I2C_BIT_BANG, BitBangCommands::modeVersion, "I2C1" },
+      { OperationalModes::BP_MODE_UART_BIT_BANG, BitBangCommands::modeVersion, "ART1" },
+      { OperationalModes::BP_MODE_1WIRE_BIT_BANG, BitBangCommands::modeVersion, "1W01" },
+      { OperationalModes::BP_MODE_RAW_WIRE_BIT_BANG, BitBangCommands::modeVersion, "RAW1" },
+      { OperationalModes::BP_MODE_JTAG_BIT_BANG, BitBangCommands::enterOpenOCD, "OCD1" },
+    };
+
+    static const FramingProbe *findFramingProbe( const OperationalModes mode )
+    {
+      for ( const auto &probe : framingProbes )
+      {
+        if ( probe.mode == mode )
+        {
+          return &probe;
+        }
+      }
+
+      return nullptr;
+    }
+
+    /*------------------------------------------------
+    How many 0x00 the terminal needs before it switches to bit bang mode, and how
+    long probeMode() lets the line stay quiet before taking it to be drained
+    ------------------------------------------------*/
+    static constexpr size_t bbEntryLength   = 20;
+    static constexpr uint32_t probeQuiet_mS = 10;
+
+    /*------------------------------------------------
+    How long attach() waits on the SPI version query. Only a board in the terminal
+    leaves it unanswered, and that case is about to pay for a full reset anyway.
+    ------------------------------------------------*/
+    static constexpr uint32_t attachTimeout_mS = 50;
+
+    /*------------------------------------------------
+    Longest probeMode() waits for the line to go quiet. A board that keeps talking
+    past this is streaming and can't be in the state being probed for.
+    ------------------------------------------------*/
+    static constexpr uint32_t probeDrainLimit_mS = 250;
+
+
+    /*------------------------------------------------
+    CommandBatch
+    ------------------------------------------------*/
+    size_t CommandBatch::add( const std::vector<uint8_t> &cmd, const size_t responseLength, const bool expectAck )
+    {
+      return add( cmd.data(), cmd.size(), responseLength, expectAck );
+    }
+
+    size_t CommandBatch::add( const uint8_t *const cmd, const size_t length, const size_t responseLength, const bool expectAck )
+    {
+      Entry entry;
+      entry.txOffset  = txData.size();
+      entry.txLength  = length;
+      entry.rxOffset  = rxData.size();
+      entry.rxLength  = responseLength;
+      entry.expectAck = expectAck;
+      entry.status    = Status::FAIL;
+
+      txData.insert( txData.end(), cmd, cmd + length );
+      rxData.resize( rxData.size() + responseLength );
+      entries.push_back( entry );
+
+      return entries.size() - 1;
+    }
+
+    CommandBatch::Reply CommandBatch::reply( const size_t index ) const
+    {
+      Reply result = { Status::INVAL_FUNC_PARAM, nullptr, 0 };
+
+      if ( index < entries.size() )
+      {
+        const auto &entry = entries[ index ];
+
+        result.status = entry.status;
+        result.data   = rxData.data() + entry.rxOffset;
+        result.length = entry.rxLength;
+      }
+
+      return result;
+    }
+
+    bool CommandBatch::ok() const noexcept
+    {
+      return std::all_of( entries.begin(), entries.end(), []( const Entry &e ) { return e.status == Status::OK; } );
+    }
+
+    void CommandBatch::clear() noexcept
+    {
+      txData.clear();
+      rxData.clear();
+      entries.clear();
+    }
+
+    size_t CommandBatch::size() const noexcept
+    {
+      return entries.size();
+    }
+
+    size_t CommandBatch::txBytes() const noexcept
+    {
+      return txData.size();
+    }
+
+    size_t CommandBatch::rxBytes() const noexcept
+    {
+      return rxData.size();
+    }
+
+    /*------------------------------------------------
+    ShadowRegister
+    ------------------------------------------------*/
+    Chimera::Status_t writeShadowRegister( Device &device, ShadowRegister &reg, const uint8_t value, const bool deferred )
+    {
+      reg.stage( value );
+
+      /*------------------------------------------------
+      Only talk to the Bus Pirate when it would actually change something
+      ------------------------------------------------*/
+      if ( deferred || !reg.dirty() )
+      {
+        return Status::OK;
+      }
+
+      std::vector<uint8_t> cmd = { reg.command() };
+      auto rx                  = device.sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      const bool success       = rx.size() && ( rx[ 0 ] == BitBangCommands::success );
+
+      reg.acknowledge( success );
+      return success ? Status::OK : Status::FAIL;
+    }
+
+    Chimera::Status_t commitShadowRegisters( Device &device, CommandBatch &batch,
+                                             const std::vector<ShadowRegister *> &registers )
+    {
+      Chimera::Status_t result = Status::OK;
+      std::vector<ShadowRegister *> written;
+      std::vector<size_t> index;
+
+      for ( auto reg : registers )
+      {
+        if ( reg->dirty() )
+        {
+          written.push_back( reg );
+          index.push_back( batch.add( { reg->command() }, 1 ) );
+        }
+      }
+
+      if ( batch.size() )
+      {
+        device.execute( batch );
+
+        for ( size_t x = 0; x < written.size(); x++ )
+        {
+          const bool success = ( batch.reply( index[ x ] ).status == Status::OK );
+
+          written[ x ]->acknowledge( success );
+          if ( !success )
+          {
+            result = Status::FAIL;
+          }
+        }
+      }
+
+      return result;
+    }
+
+    void invalidateShadowRegisters( const std::vector<ShadowRegister *> &registers )
+    {
+      for ( auto reg : registers )
+      {
+        reg->valid = false;
+      }
+    }
+
+    /*------------------------------------------------
+    Device
+    ------------------------------------------------*/
+    Device::Device( std::string &devicePort )
+    {
+      serial = std::make_shared<SerialDriver>( devicePort );
+    }
+
+    bool Device::open()
+    {
+      bool opened = false;
+
+      if ( !serial->isOpen() )
+      {
+        serial->begin();
+        Chimera::Status_t error = serial->configure( 115200, CharWid::CW_8BIT, Parity::PAR_NONE, StopBits::SBITS_ONE,
+                                                     FlowControl::FCTRL_NONE );
+
+        /*------------------------------------------------
+        This flag controls whether or not the Bus Pirate will work. All
+        functions should be checking this variable before execution.
+        ------------------------------------------------*/
+        state->connectedToSerial = ( error == Status::OK );
+
+        /*------------------------------------------------
+        Immediately reset the board, which places the board into Terminal mode
+        ------------------------------------------------*/
+        if ( connect() )
+        {
+          opened      = true;
+          state->currentMode = OperationalModes::BP_MODE_HiZ;
+        }
+        else
+        {
+          spdlog::error( "Failed opening Bus Pirate device" );
+        }
+      }
+      else
+      {
+        opened = true;
+      }
+
+      return opened;
+    }
+
+    bool Device::attach()
+    {
+      bool attached = false;
+
+      if ( !serial->isOpen() )
+      {
+        serial->begin();
+        Chimera::Status_t error = serial->configure( 115200, CharWid::CW_8BIT, Parity::PAR_NONE, StopBits::SBITS_ONE,
+                                                     FlowControl::FCTRL_NONE );
+
+        state->connectedToSerial = ( error == Status::OK );
+
+        /*------------------------------------------------
+        The SPI version query is harmless if the board is already in SPI mode. If it
+        isn't, the byte most likely landed in the terminal's line buffer, so end the
+        line to clear it before falling back to a full connect.
+        ------------------------------------------------*/
+        if ( probeMode( OperationalModes::BP_MODE_SPI_BIT_BANG, attachTimeout_mS ) )
+        {
+          attached    = true;
+          state->currentMode = OperationalModes::BP_MODE_SPI_BIT_BANG;
+          spdlog::info( "Attached to a Bus Pirate already in binary SPI mode" );
+        }
+        else if ( isOpen() )
+        {
+          auto dataField = reinterpret_cast<const uint8_t *>( MenuCommands::ping.data() );
+          serial->write( dataField, MenuCommands::ping.size() );
+
+          state->currentMode = OperationalModes::BP_INVALID_MODE;
+          attached    = connect();
+
+          if ( attached )
+          {
+            state->currentMode = OperationalModes::BP_MODE_HiZ;
+          }
+          else
+          {
+            spdlog::error( "Failed opening Bus Pirate device" );
+          }
+        }
+      }
+      else
+      {
+        attached = true;
+      }
+
+      return attached;
+    }
+
+    void Device::detach()
+    {
+      serial->flush();
+      state->connectedToSerial = !( serial->end() == Status::OK );
+    }
+
+    void Device::close()
+    {
+      /*------------------------------------------------
+      In-case the user is not powering off the board, disconnect in a HiZ state
+      ------------------------------------------------*/
+      reset();
+
+      /*------------------------------------------------
+      Power off low level platform serial driver
+      ------------------------------------------------*/
+      serial->flush();
+      state->connectedToSerial = !( serial->end() == Status::OK );
+    }
+
+    bool Device::reset()
+    {
+      bool devReset = false;
+
+      if ( state->currentMode == OperationalModes::BP_MODE_UART_BRIDGE )
+      {
+        /*------------------------------------------------
+        Every byte sent now goes straight out to the target, so don't send any
+        ------------------------------------------------*/
+        spdlog::error( "Bus Pirate is in UART bridge mode. Unplug it to reset." );
+      }
+      else if ( isOpen() )
+      {
+        /*------------------------------------------------
+        Take the direct way out of the mode the board is known to be in. Only when
+        that doesn't work, or nobody knows where the board is, try every way out.
+        ------------------------------------------------*/
+        state->resetVersion = 0;
+        devReset     = resetTrackedMode();
+
+        if ( !devReset )
+        {
+          devReset = resetTerminal();
+        }
+
+        if ( !devReset )
+        {
+          devReset = resetBitBangRoot();
+
+          if ( !devReset )
+          {
+            devReset = resetBitBangHWMode();
+          }
+        }
+
+        if ( !devReset )
+        {
+          spdlog::error( "Failed resetting Bus Pirate device" );
+        }
+        else
+        {
+          state->currentMode = OperationalModes::BP_MODE_HiZ;
+        }
+
+        /*------------------------------------------------
+        The above commands don't read out all the serial data, so make sure other
+        functions don't accidentally get interpret it as part of their response.
+        ------------------------------------------------*/
+        serial->flush();
+      }
+
+      return devReset;
+    }
+
+    bool Device::connect()
+    {
+      bool connected = false;
+
+      /*------------------------------------------------
+      Make sure that we can talk to the device correctly. Occasionally there will be old data in the system serial buffer that
+      hasn't been cleared out yet. Boost does not provide a way to flush this, so the simple fix is just to try and read
+      things out again.
+      ------------------------------------------------*/
+      if ( reset() )
+      {
+        for ( auto x = 0; x < MAX_CONNECT_ATTEMPTS; x++ )
+        {
+          if ( getInfo().isValid )
+          {
+            connected = true;
+            break;
+          }
+          else
+          {
+            spdlog::info( "Retrying connection..." );
+            Chimera::delayMilliseconds( 500 );
+          }
+        }
+      }
+
+      return connected;
+    }
+
+    bool Device::isOpen()
+    {
+      /*------------------------------------------------
+      Copies of a device share its serial port, so one of them may have closed it
+      ------------------------------------------------*/
+      return state->connectedToSerial && serial && serial->isOpen();
+    }
+
+    void Device::clearTerminal()
+    {
+      auto dataField = reinterpret_cast<const uint8_t *>( MenuCommands::ping.data() );
+      auto dataSize  = MenuCommands::ping.size();
+
+      for ( auto x = 0; x < 3; x++ )
+      {
+        serial->write( dataField, dataSize );
+        Chimera::delayMilliseconds( 75 );
+      }
+    }
+
+    /*------------------------------------------------
+    Checks a parsed banner against the versions known to work
+    ------------------------------------------------*/
+    static bool validateInfo( const Info &info )
+    {
+      bool valid = info.isValid;
+
+      auto known = []( const std::vector<std::string> &list, const std::string &version ) {
+        return std::find( list.begin(), list.end(), version ) != list.end();
+      };
+
+      if ( !known( knownBoardVer, info.hwVer ) )
+      {
+        std::cout << "Unknown board version: " << info.hwVer << std::endl;
+        valid = false;
+      }
+
+      if ( !known( knownFirmwareVer, info.firmwareVer ) )
+      {
+        std::cout << "Unknown firmware version: " << info.firmwareVer << std::endl;
+        valid = false;
+      }
+
+      if ( !known( knownBootloaderVer, info.bootLoaderVer ) )
+      {
+        std::cout << "Unknown bootloader version: " << info.bootLoaderVer << std::endl;
+        valid = false;
+      }
+
+      return valid;
+    }
+
+    static Capabilities deriveCapabilities( const Info &info )
+    {
+      Capabilities caps;
+
+      caps.binaryModes      = ( info.firmwareVerNumMajor >= minBitBangFirmwareMajorVer );
+      caps.spiWriteThenRead = ( info.firmwareVerNumMajor >= minWriteThenReadFirmwareMajorVer );
+
+      return caps;
+    }
+
+    Info Device::getInfo()
+    {
+      Info info;
+
+      if ( isOpen() )
+      {
+        /*------------------------------------------------
+        A board seen before on this port, with this USB serial number, is taken from
+        the cache without asking. The banner of the last reset, if it printed one, has
+        to agree on the firmware. Without a serial number there is nothing to tell two
+        boards apart, and the parse is cheap enough to just do it.
+        ------------------------------------------------*/
+        const std::string usbSerial = serial->getUSBSerialNumber();
+        const std::string key       = usbSerial.empty() ? usbSerial : serial->getPortName() + "|" + usbSerial;
+        uint64_t version            = 0;
+        bool cached                 = false;
+
+        if ( !key.empty() && infoCache.lookup( key, info, state->capabilities, version ) )
+        {
+          cached = !state->resetVersion || ( state->resetVersion == version );
+        }
+
+        if ( !cached )
+        {
+          info = Info();
+
+          resyncSerial();
+
+          std::string cmd       = MenuCommands::info;
+          std::string rawOutput = sendResponsiveCommand( cmd );
+
+          if ( parseInfoBanner( rawOutput, info ) )
+          {
+            info.isValid = validateInfo( info );
+          }
+          else
+          {
+            spdlog::error( "Malformed info banner: {}", rawOutput );
+          }
+
+          state->capabilities = deriveCapabilities( info );
+
+          if ( info.isValid && !key.empty() )
+          {
+            infoCache.store( key, InfoCache::versionHash( rawOutput ), info, state->capabilities );
+          }
+        }
+      }
+      else
+      {
+        std::cout << "Could not send command. Bus Pirate not connected." << std::endl;
+      }
+
+      state->deviceInfo = info;
+      return info;
+    }
+
+    void Device::setInfoCache( const std::string &path )
+    {
+      infoCache = InfoCache( path );
+    }
+
+    Capabilities Device::getCapabilities() const
+    {
+      return state->capabilities;
+    }
+
+    void Device::sendCommand( const std::string &cmd ) noexcept
+    {
+      sendResponsiveCommand( cmd );
+      serial->flush();
+    }
+
+    void Device::sendCommand( const std::vector<uint8_t> &cmd ) noexcept
+    {
+      sendResponsiveCommand( cmd, static_cast<uint32_t>( cmd.size() ) );
+      serial->flush();
+    }
+
+    void Device::resyncSerial() noexcept
+    {
+      /*------------------------------------------------
+      A real flush discards everything in one call. Only when the platform can't
+      do that is there a need to wait for stray data to land and flush it again.
+      ------------------------------------------------*/
+      if ( !serial->flush() )
+      {
+        Chimera::delayMilliseconds( 25 );
+        serial->flush();
+      }
+    }
+
+    std::string Device::sendResponsiveCommand( const std::string &cmd, const Delimiter &delimiter ) noexcept
+    {
+      std::vector<uint8_t> readBuffer;
+      std::string response;
+
+      /*------------------------------------------------
+      Flush the serial port as we don't need data from the
+      previous command straying into the response from this one.
+      ------------------------------------------------*/
+      if ( isOpen() )
+      {
+        serial->write( reinterpret_cast<const uint8_t *>( cmd.c_str() ), cmd.length() );
+
+        if ( delimiter.empty() )
+        {
+          serial->readUntil( readBuffer, Delimiters::terminalPrompt );
+        }
+        else
+        {
+          serial->readUntil( readBuffer, delimiter );
+        }
+
+        /*------------------------------------------------
+        BusPirate emulates a terminal, which means our command is printed
+        back to us + that little 'HiZ>' string that we all know means
+        'enter more things here'. (What's the proper name for that anyways?)
+        Neither are part of the actual output so they are removed.
+
+
+        HiZ><our_command>\r\n
+        <actual output we want>\r\n
+        HiZ>
+        ------------------------------------------------*/
+        if ( readBuffer.size() )
+        {
+          constexpr size_t newline_char_len = 2;
+
+          /* Remove our command from the front. Expects it to have a '\n' appended on. */
+          readBuffer.erase( readBuffer.begin(), ( readBuffer.begin() + cmd.length() - 1 ) + newline_char_len );
+
+          response = std::string( readBuffer.begin(), readBuffer.end() );
+        }
+      }
+      else
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+      }
+
+      return response;
+    }
+
+    std::vector<uint8_t> Device::sendResponsiveCommand( const std::vector<uint8_t> &cmd,
+                                                        const Delimiter &delimiter ) noexcept
+    {
+      std::vector<uint8_t> readBuffer;
+
+      if ( isOpen() )
+      {
+        resyncSerial();
+
+        serial->write( cmd.data(), cmd.size() );
+
+        if ( delimiter.empty() )
+        {
+          serial->readUntil( readBuffer, Delimiters::terminalPrompt );
+        }
+        else
+        {
+          serial->readUntil( readBuffer, delimiter );
+        }
+      }
+      else
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+      }
+
+      return readBuffer;
+    }
+
+    std::vector<boost::uint8_t> Device::sendResponsiveCommand( const std::vector<uint8_t> &cmd, const uint32_t length ) noexcept
+    {
+      /*------------------------------------------------
+      Strict framing only works where every command has a known reply length, which
+      is not true in the terminal or when the current mode isn't known.
+      ------------------------------------------------*/
+      FramingMode mode = state->framingMode;
+
+      if ( !findFramingProbe( state->currentMode ) )
+      {
+        mode = FramingMode::DEFENSIVE;
+      }
+
+      return exchange( cmd, length, mode );
+    }
+
+    std::vector<uint8_t> Device::exchange( const std::vector<uint8_t> &cmd, const uint32_t length, const FramingMode mode ) noexcept
+    {
+      std::vector<uint8_t> readBuffer( length );
+
+      if ( isOpen() )
+      {
+        if ( mode == FramingMode::DEFENSIVE )
+        {
+          resyncSerial();
+        }
+
+        serial->write( cmd.data(), cmd.size() );
+        auto error = serial->read( readBuffer.data(), length );
+
+        if ( ( mode == FramingMode::STRICT ) && ( error != Status::OK ) )
+        {
+          state->framingErrors++;
+          spdlog::warn( "Lost framing: expected {} bytes in response to command 0x{:02X}", length,
+                        cmd.size() ? cmd[ 0 ] : 0 );
+          resyncFraming();
+        }
+      }
+      else
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+      }
+
+      return readBuffer;
+    }
+
+    Chimera::Status_t Device::execute( CommandBatch &batch, const size_t window ) noexcept
+    {
+      Chimera::Status_t result = Status::OK;
+
+      if ( !isOpen() )
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( ( state->framingMode == FramingMode::DEFENSIVE ) || !findFramingProbe( state->currentMode ) )
+      {
+        resyncSerial();
+      }
+
+      batch.rxData.assign( batch.rxData.size(), 0 );
+      for ( auto &entry : batch.entries )
+      {
+        entry.status = Status::FAIL;
+      }
+
+      /*------------------------------------------------
+      Send the batch in waves that fit the window, each one a single write
+      followed by a single read of all its replies
+      ------------------------------------------------*/
+      size_t first = 0;
+
+      while ( ( first < batch.entries.size() ) && ( result == Status::OK ) )
+      {
+        size_t last     = first;
+        size_t inFlight = 0;
+
+        do
+        {
+          inFlight += batch.entries[ last ].txLength + batch.entries[ last ].rxLength;
+          last++;
+        } while ( ( last < batch.entries.size() ) &&
+                  ( !window || ( inFlight + batch.entries[ last ].txLength + batch.entries[ last ].rxLength <= window ) ) );
+
+        const auto &head   = batch.entries[ first ];
+        const auto &tail   = batch.entries[ last - 1 ];
+        const size_t txLen = tail.txOffset + tail.txLength - head.txOffset;
+        const size_t rxLen = tail.rxOffset + tail.rxLength - head.rxOffset;
+
+        serial->write( batch.txData.data() + head.txOffset, txLen );
+
+        if ( rxLen && ( serial->read( batch.rxData.data() + head.rxOffset, rxLen ) != Status::OK ) )
+        {
+          result = Status::TIMEOUT;
+        }
+
+        for ( size_t x = first; x < last; x++ )
+        {
+          auto &entry = batch.entries[ x ];
+
+          if ( result != Status::OK )
+          {
+            entry.status = Status::TIMEOUT;
+          }
+          else if ( entry.expectAck && ( !entry.rxLength || ( batch.rxData[ entry.rxOffset ] != BitBangCommands::success ) ) )
+          {
+            entry.status = Status::FAIL;
+          }
+          else
+          {
+            entry.status = Status::OK;
+          }
+        }
+
+        first = last;
+      }
+
+      if ( result != Status::OK )
+      {
+        state->framingErrors++;
+        spdlog::warn( "Lost framing during a batch of {} commands", batch.entries.size() );
+        resyncFraming();
+      }
+      else if ( !batch.ok() )
+      {
+        result = Status::FAIL;
+      }
+
+      return result;
+    }
+
+    Chimera::Status_t Device::stream( CommandBatch &batch, const size_t window ) noexcept
+    {
+      Chimera::Status_t result = Status::OK;
+
+      if ( !isOpen() )
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+        return Status::NOT_INITIALIZED;
+      }
+
+      if ( batch.txBytes() != batch.rxBytes() )
+      {
+        spdlog::error( "Can't stream a batch that isn't answered byte for byte" );
+        return Status::INVAL_FUNC_PARAM;
+      }
+
+      if ( ( state->framingMode == FramingMode::DEFENSIVE ) || !findFramingProbe( state->currentMode ) )
+      {
+        resyncSerial();
+      }
+
+      batch.rxData.assign( batch.rxData.size(), 0 );
+
+      /*------------------------------------------------
+      Keep the command stream up to a window ahead of the replies. Reading half a
+      window at a time lets the next bytes go out while the rest are still in flight.
+      ------------------------------------------------*/
+      const size_t total = batch.txData.size();
+      const size_t step  = window ? std::max<size_t>( 1, window / 2 ) : total;
+      size_t written     = 0;
+      size_t received    = 0;
+
+      while ( ( received < total ) && ( result == Status::OK ) )
+      {
+        const size_t room  = window ? ( window - ( written - received ) ) : ( total - written );
+        const size_t txLen = std::min( room, total - written );
+
+        if ( txLen )
+        {
+          serial->write( batch.txData.data() + written, txLen );
+          written += txLen;
+        }
+
+        const size_t rxLen = std::min( step, written - received );
+
+        if ( serial->read( batch.rxData.data() + received, rxLen ) == Status::OK )
+        {
+          received += rxLen;
+        }
+        else
+        {
+          result = Status::TIMEOUT;
+        }
+      }
+
+      for ( auto &entry : batch.entries )
+      {
+        if ( entry.rxOffset + entry.rxLength > received )
+        {
+          entry.status = Status::TIMEOUT;
+        }
+        else if ( entry.expectAck && ( !entry.rxLength || ( batch.rxData[ entry.rxOffset ] != BitBangCommands::success ) ) )
+        {
+          entry.status = Status::FAIL;
+        }
+        else
+        {
+          entry.status = Status::OK;
+        }
+      }
+
+      if ( result != Status::OK )
+      {
+        state->framingErrors++;
+        spdlog::warn( "Lost framing while streaming {} of {} bytes", received, total );
+        resyncFraming();
+      }
+      else if ( !batch.ok() )
+      {
+        result = Status::FAIL;
+      }
+
+      return result;
+    }
+
+    void Device::setFramingMode( const FramingMode mode ) noexcept
+    {
+      state->framingMode = mode;
+    }
+
+    FramingMode Device::getFramingMode() const noexcept
+    {
+      return state->framingMode;
+    }
+
+    size_t Device::streamWindow( const uint64_t busByte_nS ) const noexcept
+    {
+      if ( !serial )
+      {
+        return 1;
+      }
+
+      const uint64_t byte_nS     = busByte_nS + BULK_BYTE_OVERHEAD_nS;
+      const uint64_t uartByte_nS = serial->wireTime_uS( 1000 );
+
+      if ( byte_nS <= uartByte_nS )
+      {
+        return 0;
+      }
+
+      return std::max<size_t>( 1, ( BULK_UART_FIFO_DEPTH * byte_nS ) / ( byte_nS - uartByte_nS ) );
+    }
+
+    size_t Device::getFramingErrors() const noexcept
+    {
+      return state->framingErrors;
+    }
+
+    bool Device::resyncFraming() noexcept
+    {
+      bool inSync = probeMode( state->currentMode );
+
+      if ( !inSync )
+      {
+        spdlog::error( "Could not restore framing with the Bus Pirate" );
+      }
+
+      return inSync;
+    }
+
+    bool Device::probeMode( const OperationalModes mode, const uint32_t timeout_mS ) noexcept
+    {
+      bool inMode = false;
+      auto probe  = findFramingProbe( mode );
+
+      if ( isOpen() && probe )
+      {
+        /*------------------------------------------------
+        Anything still in flight belongs to the command that lost framing. Wait for
+        the line to go quiet so it can't land after the flush.
+        ------------------------------------------------*/
+        std::array<uint8_t, 64> stale;
+        const auto drainDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( probeDrainLimit_mS );
+
+        serial->flush();
+        while ( serial->read( stale.data(), stale.size(), probeQuiet_mS ) != Status::EMPTY )
+        {
+          serial->flush();
+
+          if ( std::chrono::steady_clock::now() >= drainDeadline )
+          {
+            spdlog::warn( "Bus Pirate is still sending after {} ms, giving up on the probe", probeDrainLimit_mS );
+            return false;
+          }
+        }
+
+        /*------------------------------------------------
+        The version query must come back exactly, with nothing trailing it
+        ------------------------------------------------*/
+        const std::string expected = probe->reply;
+        std::vector<uint8_t> reply( expected.size() );
+
+        serial->write( &probe->query, 1 );
+        inMode = ( serial->read( reply.data(), reply.size(), timeout_mS ) == Status::OK ) &&
+                 std::equal( expected.begin(), expected.end(), reply.begin() ) &&
+                 ( serial->read( stale.data(), 1, probeQuiet_mS ) == Status::EMPTY );
+
+        if ( !inMode )
+        {
+          serial->flush();
+        }
+      }
+
+      return inMode;
+    }
+
+    bool Device::terminalInit()
+    {
+      return reset();
+    }
+
+    bool Device::bbInit()
+    {
+      bool result = false;
+      std::vector<uint8_t> output;
+
+      /*------------------------------------------------
+      Sends some number of 0x00 and checks for exactly one "BBIO1" coming back, so
+      nothing is left behind to throw off the framing of the next command
+      ------------------------------------------------*/
+      auto enterRoot = [&]( const size_t length ) {
+        const std::vector<uint8_t> initCmd( length, BitBangCommands::init );
+
+        output.clear();
+        resyncSerial();
+        serial->write( initCmd.data(), initCmd.size() );
+
+        return ( serial->readUntil( output, Delimiters::bitBangRoot ) == Status::OK ) &&
+               ( std::string( output.begin(), output.end() ).find( "BBIO1" ) != std::string::npos );
+      };
+
+      if ( !isOpen() )
+      {
+        spdlog::error( "Failed entering Bit Bang mode" );
+        return false;
+      }
+
+      /*------------------------------------------------
+      Bit bang root and every binary mode answer a single 0x00 with the root version
+      string, and the terminal prompt takes the usual twenty. Only when the board
+      isn't where it's tracked to be does it pay for a full reset first.
+      ------------------------------------------------*/
+      if ( findFramingProbe( state->currentMode ) )
+      {
+        result = enterRoot( 1 );
+      }
+      else if ( state->currentMode == OperationalModes::BP_MODE_HiZ )
+      {
+        result = enterRoot( bbEntryLength );
+      }
+
+      if ( !result )
+      {
+        result = terminalInit() && enterRoot( bbEntryLength );
+      }
+
+      if ( result )
+      {
+        state->currentMode = OperationalModes::BP_MODE_BIT_BANG_ROOT;
+      }
+      else
+      {
+        spdlog::error( "Failed entering Bit Bang mode" );
+      }
+
+      return result;
+    }
+
+    bool Device::bbEnterSPI()
+    {
+      return bbEnterMode( BitBangCommands::enterSPI, Delimiters::spiMode, OperationalModes::BP_MODE_SPI_BIT_BANG, "SPI" );
+    }
+
+    bool Device::bbI2C()
+    {
+      return bbEnterMode( BitBangCommands::enterI2C, Delimiters::i2cMode, OperationalModes::BP_MODE_I2C_BIT_BANG, "I2C" );
+    }
+
+    bool Device::bbUART()
+    {
+      return bbEnterMode( BitBangCommands::enterUART, Delimiters::uartMode, OperationalModes::BP_MODE_UART_BIT_BANG, "UART" );
+    }
+
+    bool Device::bb1Wire()
+    {
+      return bbEnterMode( BitBangCommands::enter1Wire, Delimiters::oneWireMode, OperationalModes::BP_MODE_1WIRE_BIT_BANG,
+                          "1-Wire" );
+    }
+
+    bool Device::bbRawWire()
+    {
+      return bbEnterMode( BitBangCommands::enterRawWire, Delimiters::rawWireMode,
+                          OperationalModes::BP_MODE_RAW_WIRE_BIT_BANG, "raw-wire" );
+    }
+
+    bool Device::bbJTAG()
+    {
+      return bbEnterMode( BitBangCommands::enterOpenOCD, Delimiters::openOCDMode, OperationalModes::BP_MODE_JTAG_BIT_BANG,
+                          "OpenOCD JTAG" );
+    }
+
+    bool Device::sumpInit()
+    {
+      bool modeEntered = false;
+
+      if ( isOpen() )
+      {
+        if ( ( state->currentMode != OperationalModes::BP_MODE_HiZ )
+             && ( state->currentMode != OperationalModes::BP_MODE_LOGIC_ANALYZER ) )
+        {
+          terminalInit();
+        }
+
+        /*------------------------------------------------
+        The firmware takes the ID command straight from the terminal. A few resets
+        ahead of it flush out any half sent long command, and in SUMP mode the first
+        of them drops back to the terminal, so this works from either.
+        ------------------------------------------------*/
+        if ( ( state->currentMode == OperationalModes::BP_MODE_HiZ )
+             || ( state->currentMode == OperationalModes::BP_MODE_LOGIC_ANALYZER ) )
+        {
+          std::vector<uint8_t> cmd( SUMPCommands::resetLength, SUMPCommands::reset );
+          cmd.push_back( SUMPCommands::id );
+
+          auto response = sendResponsiveCommand( cmd, Delimiters::sumpMode );
+          std::string strOut( response.begin(), response.end() );
+
+          if ( strOut.find( SUMPCommands::idSuccess ) != std::string::npos )
+          {
+            modeEntered = true;
+            state->currentMode = OperationalModes::BP_MODE_LOGIC_ANALYZER;
+          }
+        }
+
+        if ( !modeEntered )
+        {
+          spdlog::error( "Failed entering SUMP logic analyzer mode" );
+        }
+      }
+      else
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+      }
+
+      return modeEntered;
+    }
+
+    bool Device::bbExitHWMode()
+    {
+      return resetBitBangHWMode();
+    }
+
+    bool Device::resetTrackedMode()
+    {
+      bool devReset = false;
+      bool anywhere = false;
+      std::vector<uint8_t> cmd;
+      std::string expected;
+
+      /*------------------------------------------------
+      Work out the exit sequence and what its reply has to hold. A binary hardware
+      mode drops back to bit bang root first, all in the same write. The binary exits
+      are acknowledged up front, while the terminal announces the reset somewhere
+      after echoing the command. SUMP mode is left for the terminal the same way.
+      ------------------------------------------------*/
+      if ( state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT )
+      {
+        cmd      = { BitBangCommands::reset };
+        expected = std::string( 1, static_cast<char>( BitBangCommands::success ) );
+      }
+      else if ( findFramingProbe( state->currentMode ) )
+      {
+        cmd      = { BitBangCommands::init, BitBangCommands::reset };
+        expected = BitBangCommands::initSuccess + "1" + std::string( 1, static_cast<char>( BitBangCommands::success ) );
+      }
+      else if ( state->currentMode == OperationalModes::BP_MODE_LOGIC_ANALYZER )
+      {
+        cmd = { SUMPCommands::reset };
+        cmd.insert( cmd.end(), MenuCommands::reset.begin(), MenuCommands::reset.end() );
+        expected = "RESET";
+        anywhere = true;
+      }
+      else if ( state->currentMode <= OperationalModes::BP_MODE_LCD )
+      {
+        cmd      = std::vector<uint8_t>( MenuCommands::reset.begin(), MenuCommands::reset.end() );
+        expected = "RESET";
+        anywhere = true;
+      }
+      else
+      {
+        return false;
+      }
+
+      /*------------------------------------------------
+      Every exit ends with the firmware printing its banner and a fresh prompt.
+      Waiting for that prompt confirms the reset and leaves nothing behind.
+      ------------------------------------------------*/
+      std::vector<uint8_t> output;
+
+      resyncSerial();
+      serial->write( cmd.data(), cmd.size() );
+
+      if ( serial->readUntil( output, Delimiters::terminalPrompt ) == Status::OK )
+      {
+        std::string response( output.begin(), output.end() );
+        devReset = anywhere ? ( response.find( expected ) != std::string::npos )
+                            : ( response.compare( 0, expected.size(), expected ) == 0 );
+
+        if ( devReset )
+        {
+          state->resetVersion = InfoCache::versionHash( response );
+        }
+      }
+
+      return devReset;
+    }
+
+    bool Device::resetTerminal()
+    {
+      bool devReset = false;
+      std::vector<uint8_t> termCmd;
+      std::vector<uint8_t> termOut;
+      std::string termStr;
+
+      clearTerminal();
+      serial->flush();
+
+      termCmd = std::vector<uint8_t>( MenuCommands::reset.begin(), MenuCommands::reset.end() );
+      termOut = exchange( termCmd, 10, FramingMode::DEFENSIVE );
+      termStr = std::string( termOut.begin(), termOut.end() );
+
+      if ( termStr.find( "RESET" ) != std::string::npos )
+      {
+        /*------------------------------------------------
+        The board takes a while to reboot and print its banner. Wait for it here
+        rather than have it land in the middle of the next command.
+        ------------------------------------------------*/
+        std::vector<uint8_t> banner;
+        serial->readUntil( banner, Delimiters::terminalPrompt );
+
+        termStr.append( banner.begin(), banner.end() );
+        state->resetVersion = InfoCache::versionHash( termStr );
+        devReset     = true;
+      }
+
+      return devReset;
+    }
+
+    bool Device::resetBitBangRoot()
+    {
+      bool devReset = false;
+      std::vector<uint8_t> bbCmd;
+      std::vector<uint8_t> bbOut;
+
+      serial->flush();
+      bbCmd = { BitBangCommands::reset };
+      bbOut = exchange( bbCmd, sizeof( BitBangCommands::reset ), FramingMode::DEFENSIVE );
+
+      if ( !devReset && bbOut.size() && ( bbOut[ 0 ] == BitBangCommands::success ) )
+      {
+        /*------------------------------------------------
+        Like a terminal reset, the acknowledgement is followed by the banner
+        ------------------------------------------------*/
+        std::vector<uint8_t> banner;
+        serial->readUntil( banner, Delimiters::terminalPrompt );
+
+        state->resetVersion = InfoCache::versionHash( std::string( banner.begin(), banner.end() ) );
+        devReset     = true;
+      }
+
+      return devReset;
+    }
+
+    bool Device::resetBitBangHWMode()
+    {
+      bool devReset = false;
+      std::vector<uint8_t> bbCmd;
+      std::vector<uint8_t> bbOut;
+      std::string bbStr;
+
+      serial->flush();
+      bbCmd = { BitBangCommands::init };
+      bbOut = exchange( bbCmd, static_cast<uint32_t>( BitBangCommands::initSuccess.size() ), FramingMode::DEFENSIVE );
+      bbStr = std::string( bbOut.begin(), bbOut.end() );
+
+      if ( bbStr.find( BitBangCommands::initSuccess ) != std::string::npos )
+      {
+        devReset = resetBitBangRoot();
+      }
+
+      return devReset;
+    }
+
+    bool Device::bbEnterMode( const uint8_t command, const Delimiter &reply, const OperationalModes mode, const char *name )
+    {
+      bool modeEntered = false;
+
+      if ( isOpen() )
+      {
+        /*------------------------------------------------
+        Automatically transition the device to BitBang mode if not there
+        ------------------------------------------------*/
+        if ( state->currentMode != OperationalModes::BP_MODE_BIT_BANG_ROOT )
+        {
+          bbInit();
+        }
+
+        /*------------------------------------------------
+        Success is indicated by the Bus Pirate returning the mode's version string
+        ------------------------------------------------*/
+        if ( state->currentMode == OperationalModes::BP_MODE_BIT_BANG_ROOT )
+        {
+          std::vector<uint8_t> cmd = { command };
+          auto response            = sendResponsiveCommand( cmd, reply );
+          size_t end               = 0;
+
+          if ( reply.find( response.data(), response.size(), end ) )
+          {
+            modeEntered = true;
+            state->currentMode = mode;
+          }
+        }
+
+        if ( !modeEntered )
+        {
+          spdlog::error( "Failed entering Bit Bang {} mode", name );
+        }
+      }
+      else
+      {
+        spdlog::error( "Could not send command. There was a problem with the serial port." );
+      }
+
+      return modeEntered;
+    }
+
+  }  // namespace BusPirate
+
+}  // namespace HWInterface
@@ -24,6 +24,7 @@
 #include <regex>
 
 /* Module Includes */
+#include "info_cache.hpp"
 #include "serial_driver.hpp"
 
 namespace HWInterface
@@ -33,6 +34,15 @@ namespace HWInterface
     static constexpr uint8_t CMD_ENTER_RAW_BIT_BANG = 0x00;
     static constexpr uint8_t CMD_EXIT_RAW_BIT_BANG  = 0x0F;
 
+    /*------------------------------------------------
+    Flow control for streamed bulk transfers. The PIC's UART only has a 4 byte
+    receive FIFO, and the firmware handles bulk data one byte at a time: take it
+    from the FIFO, put it on the bus, send back the reply. The overhead is a rough
+    figure for that loop on top of the bus timing itself.
+    ------------------------------------------------*/
+    static constexpr size_t BULK_UART_FIFO_DEPTH    = 4;
+    static constexpr uint64_t BULK_BYTE_OVERHEAD_nS = 5000;
+
     class Device;
     using Device_sPtr = std::shared_ptr<Device>;
     using Device_uPtr = std::unique_ptr<Device>;
@@ -41,8 +51,13 @@ namespace HWInterface
     Forward declare for using as friends
     ------------------------------------------------*/
     class BinarySPI;
-    class I2C;
-    class UART;
+    class BinaryI2C;
+    class BinaryUART;
+    class Binary1Wire;
+    class BinaryRawWire;
+    class BinaryJTAG;
+    class LogicAnalyzer;
+    class BinaryADC;
 
     class MenuCommands
     {
@@ -61,9 +76,56 @@ namespace HWInterface
       static constexpr uint8_t success = 0x01; /**< Indicates that a command succeeded */
       static constexpr uint8_t reset   = 0x0F; /**< Resets the Bus Pirate and returns to the user terminal */
 
-      static constexpr uint8_t enterSPI = 0x01; /**< Enter SPI bit bang mode */
+      static constexpr uint8_t enterSPI     = 0x01; /**< Enter SPI bit bang mode */
+      static constexpr uint8_t enterI2C     = 0x02; /**< Enter I2C bit bang mode */
+      static constexpr uint8_t enterUART    = 0x03; /**< Enter UART bit bang mode */
+      static constexpr uint8_t enter1Wire   = 0x04; /**< Enter 1-Wire bit bang mode */
+      static constexpr uint8_t enterRawWire = 0x05; /**< Enter raw-wire bit bang mode */
+      static constexpr uint8_t enterOpenOCD = 0x06; /**< Enter OpenOCD JTAG mode. Repeating it inside the mode asks for its version string. */
+      static constexpr uint8_t modeVersion  = 0x01; /**< Inside a bit bang hardware mode, asks for its version string */
+      static constexpr uint8_t adcMeasure   = 0x14; /**< Takes one voltage probe measurement, answered with the 10-bit reading MSB first */
+      static constexpr uint8_t adcStream    = 0x15; /**< Measures the voltage probe over and over until any byte is received */
+
+      static const std::string initSuccess;    /**< Character sequence that indicates transition to Bit Bang root mode */
+      static const std::string spiSuccess;     /**< Version string returned on entering SPI bit bang mode */
+      static const std::string i2cSuccess;     /**< Version string returned on entering I2C bit bang mode */
+      static const std::string uartSuccess;    /**< Version string returned on entering UART bit bang mode */
+      static const std::string oneWireSuccess; /**< Version string returned on entering 1-Wire bit bang mode */
+      static const std::string rawWireSuccess; /**< Version string returned on entering raw-wire bit bang mode */
+      static const std::string openOCDSuccess; /**< Version string returned on entering OpenOCD JTAG mode */
+    };
 
-      static const std::string initSuccess; /**< Character sequence that indicates transition to Bit Bang root mode */
+    /**
+     *  Short commands of the SUMP logic analyzer protocol, which the firmware answers
+     *  straight from terminal mode
+     */
+    class SUMPCommands
+    {
+    public:
+      static constexpr uint8_t reset = 0x00; /**< Stops the analyzer and drops back to terminal mode */
+      static constexpr uint8_t run   = 0x01; /**< Arms the trigger. The capture is sent once it completes. */
+      static constexpr uint8_t id    = 0x02; /**< Asks for the protocol ID. Enters SUMP mode from the terminal. */
+
+      static constexpr size_t resetLength = 5; /**< Resets sent ahead of the ID to clear any half sent long command */
+
+      static const std::string idSuccess; /**< Protocol ID returned for SUMP mode */
+    };
+
+    /**
+     *  Response delimiters, compiled once and shared by every device
+     */
+    class Delimiters
+    {
+    public:
+      static const Delimiter terminalPrompt; /**< Any terminal mode prompt, ie "\r\nHiZ>" */
+      static const Delimiter bitBangRoot;    /**< Bit bang root mode version string */
+      static const Delimiter spiMode;        /**< Bit bang SPI mode version string */
+      static const Delimiter i2cMode;        /**< Bit bang I2C mode version string */
+      static const Delimiter uartMode;       /**< Bit bang UART mode version string */
+      static const Delimiter oneWireMode;    /**< Bit bang 1-Wire mode version string */
+      static const Delimiter rawWireMode;    /**< Bit bang raw-wire mode version string */
+      static const Delimiter openOCDMode;    /**< OpenOCD JTAG mode version string */
+      static const Delimiter sumpMode;       /**< SUMP logic analyzer protocol ID */
     };
 
     class ModeTracker
@@ -123,6 +185,21 @@ namespace HWInterface
       }
     };
 
+    /**
+     *  Features the connected board supports, derived from its Info
+     */
+    struct Capabilities
+    {
+      bool binaryModes;      /**< The binary bit bang modes are available */
+      bool spiWriteThenRead; /**< Binary SPI mode has the write-then-read commands */
+
+      Capabilities()
+      {
+        binaryModes      = true;
+        spiWriteThenRead = true;
+      }
+    };
+
     enum class OperationalModes : uint8_t
     {
       BP_MODE_HiZ = 0,
@@ -138,6 +215,13 @@ namespace HWInterface
 
       BP_MODE_BIT_BANG_ROOT,
       BP_MODE_SPI_BIT_BANG,
+      BP_MODE_I2C_BIT_BANG,
+      BP_MODE_UART_BIT_BANG,
+      BP_MODE_UART_BRIDGE, /**< Transparent UART bridge. Only a power cycle gets the board out again. */
+      BP_MODE_1WIRE_BIT_BANG,
+      BP_MODE_RAW_WIRE_BIT_BANG,
+      BP_MODE_JTAG_BIT_BANG, /**< The binary OpenOCD JTAG mode */
+      BP_MODE_LOGIC_ANALYZER, /**< SUMP logic analyzer mode. A finished capture drops back to the terminal. */
 
       BP_INVALID_MODE,
       BP_NUM_MODES
@@ -149,12 +233,199 @@ namespace HWInterface
       MODE_BIT_BANG
     };
 
+    /**
+     *  Selects how fixed length binary commands are framed on the serial link
+     */
+    enum class FramingMode : uint8_t
+    {
+      STRICT,   /**< Read exactly the bytes each command owes. No flushing or sleeping between commands. */
+      DEFENSIVE /**< Flush stale data before every command, as older firmware interactions needed */
+    };
+
+    /**
+     *  Queues up binary mode commands along with the number of bytes each one answers
+     *  with, so that Device::execute() can send them back to back and read all of the
+     *  replies in one pass instead of waiting out a round trip per command.
+     */
+    class CommandBatch
+    {
+    public:
+      /**
+       *  Result of a single queued command
+       */
+      struct Reply
+      {
+        Chimera::Status_t status; /**< OK, TIMEOUT if the reply never fully arrived, FAIL if rejected or not sent */
+        const uint8_t *data;      /**< Start of the reply bytes. Valid until the batch is modified. */
+        size_t length;            /**< Number of reply bytes */
+      };
+
+      CommandBatch()  = default;
+      ~CommandBatch() = default;
+
+      /**
+       *	Queues a command
+       *
+       *	@param[in]	cmd             Command bytes, including any payload
+       *	@param[in]	responseLength  Exact number of bytes the device answers with
+       *	@param[in]	expectAck       If true, the first reply byte must be BitBangCommands::success
+       *	@return size_t              Index of the command, used to look up its reply
+       */
+      size_t add( const std::vector<uint8_t> &cmd, const size_t responseLength, const bool expectAck = true );
+
+      /**
+       *	Queues a command
+       *
+       *	@param[in]	cmd             Command bytes, including any payload
+       *	@param[in]	length          Number of command bytes
+       *	@param[in]	responseLength  Exact number of bytes the device answers with
+       *	@param[in]	expectAck       If true, the first reply byte must be BitBangCommands::success
+       *	@return size_t              Index of the command, used to look up its reply
+       */
+      size_t add( const uint8_t *const cmd, const size_t length, const size_t responseLength, const bool expectAck = true );
+
+      /**
+       *	Gets the reply to a command once the batch has been executed
+       *
+       *	@param[in]	index           Index returned by add()
+       *	@return Reply
+       */
+      Reply reply( const size_t index ) const;
+
+      /**
+       *	Checks if every command in the batch succeeded
+       *
+       *	@return bool
+       */
+      bool ok() const noexcept;
+
+      /**
+       *	Drops all queued commands and replies
+       *
+       *	@return void
+       */
+      void clear() noexcept;
+
+      size_t size() const noexcept;
+
+      size_t txBytes() const noexcept;
+
+      size_t rxBytes() const noexcept;
+
+    private:
+      friend class Device;
+
+      struct Entry
+      {
+        size_t txOffset;
+        size_t txLength;
+        size_t rxOffset;
+        size_t rxLength;
+        bool expectAck;
+        Chimera::Status_t status;
+      };
+
+      std::vector<uint8_t> txData;
+      std::vector<uint8_t> rxData;
+      std::vector<Entry> entries;
+    };
+
+    /**
+     *  Mirrors one of the Bus Pirate's write-only configuration registers so that
+     *  writes which wouldn't change anything can be skipped
+     */
+    struct ShadowRegister
+    {
+      uint8_t cmd;     /**< Command that writes the register */
+      uint8_t mask;    /**< Bits of the command that hold the register value */
+      uint8_t staged;  /**< Value the register should have */
+      uint8_t applied; /**< Value last acknowledged by the Bus Pirate */
+      bool valid;      /**< False until applied is known to match the Bus Pirate */
+
+      uint8_t command() const
+      {
+        return cmd | ( staged & mask );
+      }
+
+      bool dirty() const
+      {
+        return !valid || ( staged != applied );
+      }
+
+      void stage( const uint8_t value )
+      {
+        staged = value & mask;
+      }
+
+      uint8_t withField( const uint8_t field, const bool state ) const
+      {
+        return state ? ( staged | field ) : ( staged & ~field );
+      }
+
+      /**
+       *  Records how the Bus Pirate answered a write of the staged value. A rejected
+       *  write leaves the register's actual state unknown.
+       */
+      void acknowledge( const bool success )
+      {
+        if ( success )
+        {
+          applied = staged;
+          valid   = true;
+        }
+        else
+        {
+          staged = applied;
+          valid  = false;
+        }
+      }
+    };
+
+    /**
+     *	Stages a new value for a register and, unless deferred, writes it straight away
+     *  if that would change anything
+     *
+     *	@param[in]	device      The Bus Pirate to write the register on
+     *	@param[in]	reg         The register to change
+     *	@param[in]	value       The new register value
+     *	@param[in]	deferred    Only stage the value, for a later commitShadowRegisters()
+     *	@return Chimera::Status_t
+     */
+    Chimera::Status_t writeShadowRegister( Device &device, ShadowRegister &reg, const uint8_t value, const bool deferred );
+
+    /**
+     *	Writes every register that changed, queued behind whatever is already in the
+     *  batch so that all of it costs a single round trip. The batch is executed even
+     *  if no register needs writing.
+     *
+     *	@param[in]	device      The Bus Pirate to write the registers on
+     *	@param[in]	batch       Commands to send along with the register writes
+     *	@param[in]	registers   The registers to bring up to date
+     *	@return Chimera::Status_t
+     */
+    Chimera::Status_t commitShadowRegisters( Device &device, CommandBatch &batch,
+                                             const std::vector<ShadowRegister *> &registers );
+
+    /**
+     *	Forgets what the Bus Pirate holds in the registers, so the next commit writes
+     *  all of them. Needed whenever the board may have reset them behind our back.
+     *
+     *	@param[in]	registers   The registers to forget
+     *	@return void
+     */
+    void invalidateShadowRegisters( const std::vector<ShadowRegister *> &registers );
+
     class Device
     {
     public:
       friend class BinarySPI;
-      friend class I2C;
-      friend class UART;
+      friend class BinaryI2C;
+      friend class BinaryUART;
+      friend class Binary1Wire;
+      friend class BinaryRawWire;
+      friend class BinaryJTAG;
+      friend class LogicAnalyzer;
+      friend class BinaryADC;
 
       Device( std::string &devicePort );
       Device() = default;
@@ -171,6 +442,27 @@ namespace HWInterface
        */
       bool open();
 
+      /**
+       *  Opens a connection to a device that may still be in binary SPI mode from an
+       *  earlier session. A single version query checks for it without disturbing the
+       *  board, and if it answers, the mode is adopted and commands can be issued
+       *  right away. Register settings aren't readable, so drivers rewrite them once.
+       *  Anything else falls back to the full reset performed by open().
+       *
+       *  A board sitting in bit bang root answers the query by entering SPI mode.
+       *
+       *  @return True if connected, false if not
+       */
+      bool attach();
+
+      /**
+       *  Closes the connection without resetting the board, so that the mode it is in
+       *  survives for a later attach().
+       *
+       *  @return void
+       */
+      void detach();
+
       /**
        *  Closes the connection to the device.
        *
@@ -180,7 +472,9 @@ namespace HWInterface
 
       /**
        *	Resets the Bus Pirate back to terminal mode and clears all settings.
-       *	Only firmware versions v2.0+ can do this.
+       *	Only firmware versions v2.0+ can do this. A board in the transparent UART
+       *  bridge passes everything through to the target, so this fails without
+       *  sending anything until the board has been unplugged.
        *
        *	@return True if success, false if not
        */
@@ -208,12 +502,31 @@ namespace HWInterface
       void clearTerminal();
 
       /**
-       *  Gets the device information by sending the 'i' command
+       *  Gets the device information by sending the 'i' command. A board already in the
+       *  cache under its port and USB serial number isn't queried at all, as long as the
+       *  firmware line of the last reset banner still matches.
        *
        *  @return struct containing the device info
        */
       Info getInfo();
 
+      /**
+       *	Selects where device identities are cached between sessions. Defaults to
+       *  InfoCache::defaultPath().
+       *
+       *	@param[in]	path        Cache file to use, empty to disable caching
+       *	@return void
+       */
+      void setInfoCache( const std::string &path );
+
+      /**
+       *	Gets the features of the connected board, as derived by the last getInfo().
+       *  Everything is assumed supported until then.
+       *
+       *	@return Capabilities
+       */
+      Capabilities getCapabilities() const;
+
       /**
        *	Sends a command to the device
        *
@@ -232,37 +545,129 @@ namespace HWInterface
 
       /**
        *	Sends a command to the device and returns the response. If a delimiter
-       *  is not specified, it internally uses a regex that matches the end sequence
-       *  of all modes currently supported.
+       *  is not specified, it internally uses Delimiters::terminalPrompt which matches
+       *  the end sequence of all modes currently supported.
        *
        *	@param[in]	cmd         Command to be sent that ends with '\n'.
        *  @param[in]  delimiter   Expected sequence that signals the end of the response.
        *	@return std::string
        */
-      std::string sendResponsiveCommand( const std::string &cmd, const boost::regex &delimiter = boost::regex{} ) noexcept;
+      std::string sendResponsiveCommand( const std::string &cmd, const Delimiter &delimiter = Delimiter{} ) noexcept;
 
       /**
        *	Send a series of bytes to the Bus Pirate, returning the response to the user.
-       *  Most typically this is used for terminal mode that uses a regex to figure out
+       *  Most typically this is used for terminal mode that uses a delimiter to figure out
        *  when the transfer has ended.
        *
        *	@param[in]	cmd         Command to be sent that ends with '\n'.
-       *  @param[in]  delimiter   Regex used to decide when reading the response is finished
+       *  @param[in]  delimiter   Sequence used to decide when reading the response is finished
        *	@return std::vector<uint8_t>
        */
       std::vector<uint8_t> sendResponsiveCommand( const std::vector<uint8_t> &cmd,
-                                                  const boost::regex &delimiter = boost::regex{} ) noexcept;
+                                                  const Delimiter &delimiter = Delimiter{} ) noexcept;
 
       /**
        *	Send a series of bytes to the Bus Pirate, returning the response to the user.
        *  This version is used primarily in Bit Bang mode where the response length is known.
        *
+       *  In FramingMode::STRICT while in a binary mode, the command is written and exactly
+       *  length bytes are read back. A short read means the link lost framing, which is
+       *  counted and recovered with resyncFraming() before returning.
+       *
        *	@param[in]	cmd         Command to be sent (does not need to end in '\n')
        *	@param[in]	length      How many bytes to read before returning
        *	@return std::vector<boost::uint8_t>
        */
       std::vector<uint8_t> sendResponsiveCommand( const std::vector<uint8_t> &cmd, const uint32_t length ) noexcept;
 
+      /**
+       *	Selects how fixed length binary commands are framed
+       *
+       *	@param[in]	mode        The framing mode to use
+       *	@return void
+       */
+      void setFramingMode( const FramingMode mode ) noexcept;
+
+      /**
+       *	Gets the current framing mode
+       *
+       *	@return FramingMode
+       */
+      FramingMode getFramingMode() const noexcept;
+
+      /**
+       *	Number of times strict framing detected that the command and response
+       *  streams fell out of step
+       *
+       *	@return size_t
+       */
+      size_t getFramingErrors() const noexcept;
+
+      /**
+       *	Brings the command and response streams back into step. Discards any stale
+       *  data, then sends the current binary mode's version query and checks that
+       *  exactly the expected reply comes back.
+       *
+       *	@return bool: true if framing was restored, false if not
+       */
+      bool resyncFraming() noexcept;
+
+      /**
+       *	Checks whether the board is in the given binary mode by discarding stale data
+       *  and sending the mode's version query. Only an exact reply with nothing
+       *  trailing it counts.
+       *
+       *	@param[in]	mode        The binary mode to check for
+       *	@param[in]	timeout_mS  How long to wait for the reply
+       *	@return bool: true if the board answered as expected, false if not
+       */
+      bool probeMode( const OperationalModes mode, const uint32_t timeout_mS = 500 ) noexcept;
+
+      /**
+       *	Sends a batch of binary mode commands and collects their replies. Commands are
+       *  written back to back and the replies read in one pass, so the link never idles
+       *  waiting on a round trip. The window limits how many bytes (command plus reply)
+       *  are outstanding at once, for commands the device is slower to consume than the
+       *  link can deliver them. A zero window sends the whole batch in one write.
+       *
+       *  Should a reply come up short, the remaining commands are not sent and framing is
+       *  recovered with resyncFraming().
+       *
+       *	@param[in]	batch       The commands to send. Holds the replies on return.
+       *	@param[in]	window      Maximum bytes in flight at once, 0 for no limit
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t execute( CommandBatch &batch, const size_t window = 0 ) noexcept;
+
+      /**
+       *	Streams a batch of commands that each answer with exactly one byte per byte
+       *  sent, like the SPI bulk transfer and chip select commands. Rather than waiting
+       *  for whole waves of replies, the command stream is kept running ahead of the
+       *  reply stream by up to window bytes, so every reply byte that comes back makes
+       *  room for another command byte to go out. Acks are checked once everything has
+       *  been received.
+       *
+       *  The window is what keeps the firmware's UART FIFO from overrunning when it
+       *  consumes bytes slower than the link delivers them. A zero window sends the
+       *  whole batch in one write.
+       *
+       *	@param[in]	batch       The commands to send. Holds the replies on return.
+       *	@param[in]	window      Maximum bytes sent but not yet answered, 0 for no limit
+       *	@return Chimera::Status_t
+       */
+      Chimera::Status_t stream( CommandBatch &batch, const size_t window = 0 ) noexcept;
+
+      /**
+       *	Works out the window for stream(). If the firmware gets through a byte faster
+       *  than the UART can deliver the next one, its FIFO never fills and the stream
+       *  can run unthrottled. Otherwise the FIFO fills at the difference of the two
+       *  rates, which bounds how far ahead of the replies the stream may run.
+       *
+       *	@param[in]	busByte_nS  Time the bus takes to move one byte
+       *	@return size_t: the window, 0 for no limit
+       */
+      size_t streamWindow( const uint64_t busByte_nS ) const noexcept;
+
       /**
        *  Resets the board and enters terminal mode
        *
@@ -318,7 +723,7 @@ namespace HWInterface
       bool bbRawWire();
 
       /**
-       *  Enters raw JTAG mode.
+       *  Enters the binary OpenOCD JTAG mode.
        *  Must have called bbInit() first or else this will fail.
        *
        *	@return bool: true if success, false if not
@@ -332,17 +737,49 @@ namespace HWInterface
        */
       bool bbExitHWMode();
 
+      /**
+       *  Enters the SUMP logic analyzer mode from the terminal, resetting the board
+       *  first if it is anywhere else
+       *
+       *	@return bool: true if success, false if not
+       */
+      bool sumpInit();
+
 
     protected:
+      /**
+       *  What is known about the board. Copies of a device, like the one every driver
+       *  holds, talk to the same board over the same serial port, so they share this
+       *  as well. A mode entered through any of them is the mode all of them see.
+       */
+      struct State
+      {
+        bool connectedToSerial       = false; /**< True if the device is connected and configured over serial, false if not */
+        OperationalModes currentMode = OperationalModes::BP_INVALID_MODE;
+
+        FramingMode framingMode = FramingMode::STRICT;
+        size_t framingErrors    = 0;
+
+        Info deviceInfo;
+        Capabilities capabilities;
+        uint64_t resetVersion = 0; /**< InfoCache::versionHash() of the banner the last reset printed, zero if none */
+      };
+
       SerialDriver_sPtr serial;
-      boost::regex terminalModeRegex{ "(\r\n).+(>)" };
+      std::shared_ptr<State> state = std::make_shared<State>();
       static constexpr uint8_t MAX_CONNECT_ATTEMPTS = 3;
 
-      Info deviceInfo;
+      InfoCache infoCache;
 
-      bool connectedToSerial; /**< True if the device is connected and configured over serial, false if not */
-      OperationalModes currentMode;
 
+      /**
+       *	Resets the device with the cheapest exit for the mode it is tracked to be in,
+       *  confirmed by waiting for the terminal prompt. Fails straight away if the mode
+       *  isn't known. The device will be in terminal mode after success.
+       *
+       *	@return bool: true if success, false if not
+       */
+      bool resetTrackedMode();
 
       /**
        *  Resets the device under the assumption we are in terminal mode.
@@ -368,6 +805,36 @@ namespace HWInterface
        */
       bool resetBitBangHWMode();
 
+      /**
+       *	Enters one of the binary hardware modes, going through bit bang root first if
+       *  the device isn't there already. The mode answers with its version string.
+       *
+       *	@param[in]	command     Bit bang command that enters the mode
+       *	@param[in]	reply       Version string the mode answers with
+       *	@param[in]	mode        The mode being entered
+       *	@param[in]	name        Name of the mode for logging
+       *	@return bool: true if success, false if not
+       */
+      bool bbEnterMode( const uint8_t command, const Delimiter &reply, const OperationalModes mode, const char *name );
+
+      /**
+       *	Discards any stale data in the serial port so it can't bleed into the
+       *  response of the next command
+       *
+       *	@return void
+       */
+      void resyncSerial() noexcept;
+
+      /**
+       *	Writes a command and reads back a fixed length response using the given framing
+       *
+       *	@param[in]	cmd         Command to be sent
+       *	@param[in]	length      How many bytes to read before returning
+       *	@param[in]	mode        Framing to use for this exchange
+       *	@return std::vector<uint8_t>
+       */
+      std::vector<uint8_t> exchange( const std::vector<uint8_t> &cmd, const uint32_t length, const FramingMode mode ) noexcept;
+
     private:
     };
   }  // namespace BusPirate
@@ -0,0 +1,292 @@
+/********************************************************************************
+ *   File Name:
+ *     delimiter.cpp
+ *
+ *   Description:
+ *     Implements the serial response delimiter matcher
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* C++ Includes */
+#include <algorithm>
+#include <cstring>
+
+/* Module Includes */
+#include "delimiter.hpp"
+
+namespace HWInterface
+{
+  static constexpr size_t npos = static_cast<size_t>( -1 );
+
+  /*------------------------------------------------
+  Delimiter
+  ------------------------------------------------*/
+  Delimiter::Delimiter() : matchType( Type::NONE ), anchor( 0 ), singleAnchor( false )
+  {
+    lastByte.fill( false );
+  }
+
+  Delimiter::Delimiter( const std::string &literal ) : Delimiter( std::vector<std::string>{ literal } )
+  {
+  }
+
+  Delimiter::Delimiter( const char *const literal ) : Delimiter( std::string( literal ) )
+  {
+  }
+
+  Delimiter::Delimiter( const std::vector<std::string> &literals ) : Delimiter()
+  {
+    matchType      = Type::LITERAL;
+    this->literals = literals;
+    compile();
+  }
+
+  Delimiter::Delimiter( const boost::regex &expr ) : Delimiter()
+  {
+    /*------------------------------------------------
+    An empty regex historically meant "use the default", so keep it empty
+    ------------------------------------------------*/
+    if ( !expr.empty() )
+    {
+      matchType  = Type::REGEX;
+      this->expr = expr;
+    }
+  }
+
+  Delimiter Delimiter::prompt()
+  {
+    Delimiter delimiter;
+    delimiter.matchType = Type::PROMPT;
+
+    return delimiter;
+  }
+
+  bool Delimiter::empty() const noexcept
+  {
+    return matchType == Type::NONE;
+  }
+
+  Delimiter::Type Delimiter::type() const noexcept
+  {
+    return matchType;
+  }
+
+  bool Delimiter::find( const uint8_t *const data, const size_t length, size_t &matchEnd ) const noexcept
+  {
+    Scanner scanner( *this );
+    return scanner.scan( data, length, matchEnd );
+  }
+
+  void Delimiter::compile()
+  {
+    /*------------------------------------------------
+    Empty literals would match everywhere, so drop them
+    ------------------------------------------------*/
+    literals.erase( std::remove_if( literals.begin(), literals.end(), []( const std::string &s ) { return s.empty(); } ),
+                    literals.end() );
+
+    if ( literals.empty() )
+    {
+      matchType = Type::NONE;
+      return;
+    }
+
+    /*------------------------------------------------
+    The search looks for the last byte of each literal and then checks backwards
+    for the rest of it. That way a literal split across two reads is still found
+    without ever revisiting old data. If every literal ends in the same byte, the
+    search collapses to a single memchr().
+    ------------------------------------------------*/
+    size_t distinct = 0;
+    lastByte.fill( false );
+
+    for ( const auto &literal : literals )
+    {
+      const uint8_t last = static_cast<uint8_t>( literal.back() );
+
+      if ( !lastByte[ last ] )
+      {
+        lastByte[ last ] = true;
+        anchor           = last;
+        distinct++;
+      }
+    }
+
+    singleAnchor = ( distinct == 1 );
+  }
+
+  /*------------------------------------------------
+  Delimiter::Scanner
+  ------------------------------------------------*/
+  Delimiter::Scanner::Scanner( const Delimiter &delimiter ) : delimiter( delimiter ), scanned( 0 ), lineStart( npos )
+  {
+  }
+
+  void Delimiter::Scanner::reset() noexcept
+  {
+    scanned   = 0;
+    lineStart = npos;
+  }
+
+  size_t Delimiter::Scanner::position() const noexcept
+  {
+    return scanned;
+  }
+
+  bool Delimiter::Scanner::scan( const uint8_t *const data, const size_t length, size_t &matchEnd ) noexcept
+  {
+    bool found = false;
+
+    switch ( delimiter.matchType )
+    {
+      case Type::LITERAL:
+        while ( scanned < length )
+        {
+          /*------------------------------------------------
+          Hop to the next byte that could end a literal
+          ------------------------------------------------*/
+          const uint8_t *candidate = nullptr;
+
+          if ( delimiter.singleAnchor )
+          {
+            candidate = static_cast<const uint8_t *>( memchr( data + scanned, delimiter.anchor, length - scanned ) );
+          }
+          else
+          {
+            candidate = std::find_if( data + scanned, data + length, [this]( const uint8_t b ) { return delimiter.lastByte[ b ]; } );
+            candidate = ( candidate == data + length ) ? nullptr : candidate;
+          }
+
+          if ( !candidate )
+          {
+            scanned = length;
+            break;
+          }
+
+          const size_t end = static_cast<size_t>( candidate - data ) + 1;
+          scanned          = end;
+
+          for ( const auto &literal : delimiter.literals )
+          {
+            if ( ( literal.size() <= end ) && ( static_cast<uint8_t>( literal.back() ) == *candidate ) &&
+                 ( memcmp( data + end - literal.size(), literal.data(), literal.size() ) == 0 ) )
+            {
+              found    = true;
+              matchEnd = end;
+              break;
+            }
+          }
+
+          if ( found )
+          {
+            break;
+          }
+        }
+        break;
+
+      case Type::PROMPT:
+        /*------------------------------------------------
+        Find the first "\r\n" and then the first '>' at least one character past it
+        ------------------------------------------------*/
+        while ( ( lineStart == npos ) && ( scanned < length ) )
+        {
+          const size_t from = std::max<size_t>( scanned, 1 );
+          auto newline      = static_cast<const uint8_t *>( memchr( data + from, '\n', length - from ) );
+
+          if ( !newline )
+          {
+            scanned = length;
+          }
+          else
+          {
+            scanned = static_cast<size_t>( newline - data ) + 1;
+
+            if ( *( newline - 1 ) == '\r' )
+            {
+              lineStart = scanned;
+            }
+          }
+        }
+
+        /*------------------------------------------------
+        The character right after the line start can't be the prompt. scanned never
+        goes past the data, so if it ends on the "\r\n" the next call skips it.
+        ------------------------------------------------*/
+        if ( lineStart != npos )
+        {
+          const size_t from     = std::max( scanned, lineStart + 1 );
+          const uint8_t *prompt = nullptr;
+
+          if ( from < length )
+          {
+            prompt = static_cast<const uint8_t *>( memchr( data + from, '>', length - from ) );
+          }
+
+          if ( prompt )
+          {
+            found    = true;
+            matchEnd = static_cast<size_t>( prompt - data ) + 1;
+            scanned  = matchEnd;
+          }
+          else
+          {
+            scanned = length;
+          }
+        }
+        break;
+
+      case Type::REGEX:
+      {
+        /*------------------------------------------------
+        Slow path: regex matches can't be resumed, so rescan everything
+        ------------------------------------------------*/
+        boost::match_results<const uint8_t *> match;
+
+        if ( boost::regex_search( data, data + length, match, delimiter.expr ) )
+        {
+          found    = true;
+          matchEnd = static_cast<size_t>( match[ 0 ].second - data );
+        }
+
+        scanned = length;
+      }
+      break;
+
+      case Type::NONE:
+      default:
+        scanned = length;
+        break;
+    }
+
+    return found;
+  }
+
+  /*------------------------------------------------
+  Delimiter::MatchCondition
+  ------------------------------------------------*/
+  Delimiter::MatchCondition::result_type Delimiter::MatchCondition::operator()( iterator begin, iterator end ) const noexcept
+  {
+    /*------------------------------------------------
+    Asio hands over only the part of the streambuf it hasn't searched yet, which
+    lines up with what the scanner has examined. The streambuf input sequence is
+    a single contiguous block, so the scanner can look back into the old data.
+    ------------------------------------------------*/
+    if ( begin == end )
+    {
+      return result_type( end, false );
+    }
+
+    const size_t offset = scanner->position();
+    const size_t length = offset + static_cast<size_t>( end - begin );
+    const auto data     = reinterpret_cast<const uint8_t *>( &*begin ) - offset;
+
+    size_t matchEnd = 0;
+    if ( scanner->scan( data, length, matchEnd ) )
+    {
+      return result_type( begin + ( matchEnd - offset ), true );
+    }
+
+    return result_type( end, false );
+  }
+}  // namespace HWInterface
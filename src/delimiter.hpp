@@ -0,0 +1,174 @@
+/********************************************************************************
+ *   File Name:
+ *     delimiter.hpp
+ *
+ *   Description:
+ *     Describes the sequence that marks the end of a serial response. Literal
+ *     patterns are precompiled into a multi-pattern matcher that only has to look
+ *     at newly received bytes, while regular expressions remain available as a
+ *     slower fallback.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+#pragma once
+#ifndef BUS_PIRATE_CPP_DELIMITER_HPP
+#define BUS_PIRATE_CPP_DELIMITER_HPP
+
+/* C++ Includes */
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Boost Includes */
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/regex.hpp>
+
+namespace HWInterface
+{
+  class Delimiter
+  {
+  public:
+    enum class Type : uint8_t
+    {
+      NONE,    /**< No delimiter, never matches */
+      LITERAL, /**< One or more fixed byte sequences */
+      PROMPT,  /**< A terminal prompt: "\r\n", at least one character, then '>' */
+      REGEX,   /**< Arbitrary regular expression. Rescans the whole buffer on every update. */
+    };
+
+    /**
+     *  Tracks how far a buffer has been searched so that each update only has to
+     *  look at the bytes that arrived since the last one. A scanner must be reset
+     *  whenever the buffer it is tracking is consumed from the front.
+     */
+    class Scanner
+    {
+    public:
+      explicit Scanner( const Delimiter &delimiter );
+
+      /**
+       *	Searches the buffer for the delimiter, skipping over bytes already examined
+       *  by a previous call. The buffer must start at the same place as it did on
+       *  the previous call, only growing at the end.
+       *
+       *	@param[in]	data          Start of the buffer
+       *	@param[in]	length        Number of valid bytes in the buffer
+       *	@param[out]	matchEnd      Offset one past the end of the match, if found
+       *	@return bool              True if the delimiter was found, false if not
+       */
+      bool scan( const uint8_t *const data, const size_t length, size_t &matchEnd ) noexcept;
+
+      /**
+       *	Forgets everything that has been scanned so far
+       *
+       *	@return void
+       */
+      void reset() noexcept;
+
+      /**
+       *	Number of bytes examined so far
+       *
+       *	@return size_t
+       */
+      size_t position() const noexcept;
+
+    private:
+      const Delimiter &delimiter;
+      size_t scanned;    /**< Offset of the first byte that hasn't been examined yet */
+      size_t lineStart;  /**< PROMPT only: offset just past the first "\r\n", or npos if not seen */
+    };
+
+    /**
+     *  Adapts a Scanner into a boost::asio match condition for async_read_until(). The
+     *  result_type typedef is what lets asio recognize it as one.
+     */
+    class MatchCondition
+    {
+    public:
+      using result_type = std::pair<boost::asio::buffers_iterator<boost::asio::streambuf::const_buffers_type>, bool>;
+      using iterator    = result_type::first_type;
+
+      explicit MatchCondition( Scanner &scanner ) : scanner( &scanner )
+      {
+      }
+
+      result_type operator()( iterator begin, iterator end ) const noexcept;
+
+    private:
+      Scanner *scanner;
+    };
+
+    /**
+     *  Default constructor, creates an empty delimiter
+     */
+    Delimiter();
+
+    /**
+     *  Matches a single literal sequence
+     *
+     *  @param[in]  literal     The exact sequence to match
+     */
+    Delimiter( const std::string &literal );
+    Delimiter( const char *const literal );
+
+    /**
+     *  Matches whichever of the literal sequences shows up first
+     *
+     *  @param[in]  literals    The exact sequences to match
+     */
+    Delimiter( const std::vector<std::string> &literals );
+
+    /**
+     *  Slow path that matches a regular expression
+     *
+     *  @param[in]  expr        The regex expression to be matched
+     */
+    Delimiter( const boost::regex &expr );
+
+    ~Delimiter() = default;
+
+    /**
+     *	Creates a delimiter that matches the terminal prompt printed by the Bus Pirate,
+     *  ie "\r\nHiZ>" or "\r\nSPI>". Equivalent to the regex "(\r\n).+(>)".
+     *
+     *	@return Delimiter
+     */
+    static Delimiter prompt();
+
+    /**
+     *	Checks if the delimiter will never match anything
+     *
+     *	@return True if empty, false if not
+     */
+    bool empty() const noexcept;
+
+    Type type() const noexcept;
+
+    /**
+     *	One shot search of a buffer
+     *
+     *	@param[in]	data          Start of the buffer
+     *	@param[in]	length        Number of valid bytes in the buffer
+     *	@param[out]	matchEnd      Offset one past the end of the match, if found
+     *	@return bool              True if the delimiter was found, false if not
+     */
+    bool find( const uint8_t *const data, const size_t length, size_t &matchEnd ) const noexcept;
+
+  private:
+    friend class Scanner;
+
+    Type matchType;
+    std::vector<std::string> literals;
+    std::array<bool, 256> lastByte; /**< Which bytes can end one of the literals */
+    uint8_t anchor;                 /**< The byte searched for with memchr() when all literals end the same way */
+    bool singleAnchor;
+    boost::regex expr;
+
+    void compile();
+  };
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_DELIMITER_HPP */
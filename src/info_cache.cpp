@@ -0,0 +1,271 @@
+/********************************************************************************
+ *   File Name:
+ *     info_cache.cpp
+ *
+ *   Description:
+ *     Implements the device identity cache, loaded from disk once and then kept
+ *     in memory
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* C++ Includes */
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+/* Boost Includes */
+#include <boost/filesystem.hpp>
+
+/* Library Includes */
+#include <spdlog/spdlog.h>
+
+/* Module Includes */
+#include "bus_pirate.hpp"
+#include "info_cache.hpp"
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /*------------------------------------------------
+    One device per line, fields separated by tabs. Bump the version whenever the
+    layout changes so old files are simply ignored.
+    ------------------------------------------------*/
+    static const std::string cacheHeader = "# bus_pirate_cpp device cache v3";
+    static constexpr size_t cacheFields  = 18;
+
+    static std::vector<std::string> splitFields( const std::string &line )
+    {
+      std::vector<std::string> fields;
+      std::istringstream stream( line );
+      std::string field;
+
+      while ( std::getline( stream, field, '\t' ) )
+      {
+        fields.push_back( field );
+      }
+
+      return fields;
+    }
+
+    InfoCache::InfoCache( const std::string &path ) : file( path )
+    {
+    }
+
+    bool InfoCache::lookup( const std::string &key, Info &info, Capabilities &caps, uint64_t &version ) const
+    {
+      if ( !enabled() )
+      {
+        return false;
+      }
+
+      load();
+
+      auto entry = entries.find( key );
+      if ( entry == entries.end() )
+      {
+        return false;
+      }
+
+      auto fields = splitFields( entry->second.fields );
+      auto number = [&fields]( const size_t x ) {
+        return static_cast<uint32_t>( std::strtoul( fields[ x ].c_str(), nullptr, 10 ) );
+      };
+
+      info.isValid               = true;
+      info.hwVer                 = fields[ 0 ];
+      info.firmwareVer           = fields[ 1 ];
+      info.bootLoaderVer         = fields[ 2 ];
+      info.deviceID              = fields[ 3 ];
+      info.revID                 = fields[ 4 ];
+      info.mcuVer                = fields[ 5 ];
+      info.hwVerNum              = number( 6 );
+      info.hwVerNumMajor         = number( 7 );
+      info.firmwareVerNum        = number( 8 );
+      info.firmwareVerNumMajor   = number( 9 );
+      info.firmwareVerNumMinor   = number( 10 );
+      info.bootloaderVerNum      = number( 11 );
+      info.bootloaderVerNumMajor = number( 12 );
+      info.bootloaderVerNumMinor = number( 13 );
+
+      caps.binaryModes      = ( fields[ 14 ] == "1" );
+      caps.spiWriteThenRead = ( fields[ 15 ] == "1" );
+
+      version = entry->second.version;
+      return true;
+    }
+
+    bool InfoCache::store( const std::string &key, const uint64_t version, const Info &info, const Capabilities &caps )
+    {
+      if ( !enabled() )
+      {
+        return false;
+      }
+
+      std::ostringstream fields;
+      fields << info.hwVer << '\t' << info.firmwareVer << '\t' << info.bootLoaderVer << '\t' << info.deviceID << '\t'
+             << info.revID << '\t' << info.mcuVer << '\t' << info.hwVerNum << '\t' << info.hwVerNumMajor << '\t'
+             << info.firmwareVerNum << '\t' << info.firmwareVerNumMajor << '\t' << info.firmwareVerNumMinor << '\t'
+             << info.bootloaderVerNum << '\t' << info.bootloaderVerNumMajor << '\t' << info.bootloaderVerNumMinor << '\t'
+             << caps.binaryModes << '\t' << caps.spiWriteThenRead;
+
+      /*------------------------------------------------
+      Pick up whatever other processes wrote since this one loaded, so that saving
+      doesn't throw their entries away
+      ------------------------------------------------*/
+      loaded = false;
+      load();
+
+      entries[ key ] = { version, fields.str() };
+      return save();
+    }
+
+    void InfoCache::load() const
+    {
+      if ( loaded )
+      {
+        return;
+      }
+
+      std::ifstream stream( file );
+      std::string line;
+
+      entries.clear();
+      loaded = true;
+
+      if ( !std::getline( stream, line ) || ( line != cacheHeader ) )
+      {
+        return;
+      }
+
+      while ( std::getline( stream, line ) )
+      {
+        /*------------------------------------------------
+        Key, version, then the fields lookup() unpacks
+        ------------------------------------------------*/
+        const auto keyEnd     = line.find( '\t' );
+        const auto versionEnd = line.find( '\t', keyEnd + 1 );
+
+        if ( ( keyEnd == std::string::npos ) || ( versionEnd == std::string::npos ) )
+        {
+          continue;
+        }
+
+        Entry entry;
+        entry.version = std::strtoull( line.substr( keyEnd + 1, versionEnd - keyEnd - 1 ).c_str(), nullptr, 16 );
+        entry.fields  = line.substr( versionEnd + 1 );
+
+        if ( splitFields( entry.fields ).size() == ( cacheFields - 2 ) )
+        {
+          entries[ line.substr( 0, keyEnd ) ] = entry;
+        }
+      }
+    }
+
+    bool InfoCache::save()
+    {
+      bool saved = false;
+
+      /*------------------------------------------------
+      Rewrite the whole file through a temporary so that a crash part way through, or
+      another process reading at the same time, never sees half an entry
+      ------------------------------------------------*/
+      boost::system::error_code error;
+      const auto parent = boost::filesystem::path( file ).parent_path();
+
+      if ( !parent.empty() )
+      {
+        boost::filesystem::create_directories( parent, error );
+      }
+
+      const std::string temp = file + ".tmp";
+      std::ofstream stream( temp, std::ios::trunc );
+
+      stream << cacheHeader << '\n';
+      for ( const auto &entry : entries )
+      {
+        stream << entry.first << '\t' << std::hex << entry.second.version << std::dec << '\t' << entry.second.fields << '\n';
+      }
+      stream.close();
+
+      if ( stream )
+      {
+        boost::filesystem::rename( temp, file, error );
+        saved = !error;
+      }
+
+      if ( !saved )
+      {
+        spdlog::warn( "Could not update the device cache at {}", file );
+        std::remove( temp.c_str() );
+      }
+
+      return saved;
+    }
+
+    bool InfoCache::enabled() const
+    {
+      return !file.empty();
+    }
+
+    const std::string &InfoCache::path() const
+    {
+      return file;
+    }
+
+    uint64_t InfoCache::versionHash( const std::string &banner )
+    {
+      /*------------------------------------------------
+      Only the firmware line counts, it is the one thing that changes under a known
+      port and serial number. The rest of the banner differs between 'i' and a reset.
+      ------------------------------------------------*/
+      const auto start = banner.find( "Firmware" );
+      if ( start == std::string::npos )
+      {
+        return 0;
+      }
+
+      const auto end = banner.find_first_of( "\r\n", start );
+      const std::string line = banner.substr( start, ( end == std::string::npos ) ? end : end - start );
+
+      /*------------------------------------------------
+      64 bit FNV-1a
+      ------------------------------------------------*/
+      uint64_t value = 0xcbf29ce484222325ull;
+
+      for ( const auto c : line )
+      {
+        value ^= static_cast<uint8_t>( c );
+        value *= 0x100000001b3ull;
+      }
+
+      return value;
+    }
+
+    std::string InfoCache::defaultPath()
+    {
+      std::string dir;
+
+#if defined( _WIN32 ) || defined( _WIN64 )
+      if ( const char *local = std::getenv( "LOCALAPPDATA" ) )
+      {
+        dir = std::string( local ) + "\\bus_pirate_cpp";
+      }
+#else
+      if ( const char *xdg = std::getenv( "XDG_CACHE_HOME" ) )
+      {
+        dir = std::string( xdg ) + "/bus_pirate_cpp";
+      }
+      else if ( const char *home = std::getenv( "HOME" ) )
+      {
+        dir = std::string( home ) + "/.cache/bus_pirate_cpp";
+      }
+#endif
+
+      return dir.empty() ? dir : ( boost::filesystem::path( dir ) / "devices.cache" ).string();
+    }
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,107 @@
+/********************************************************************************
+ *   File Name:
+ *     info_cache.hpp
+ *
+ *   Description:
+ *     Persists the identity and capabilities of each Bus Pirate seen, so that a
+ *     reconnect to the same board can skip querying and parsing its info banner.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+#pragma once
+#ifndef BUS_PIRATE_CPP_INFO_CACHE_HPP
+#define BUS_PIRATE_CPP_INFO_CACHE_HPP
+
+/* C++ Includes */
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    struct Info;
+    struct Capabilities;
+
+    class InfoCache
+    {
+    public:
+      /**
+       *  @param[in]  path        File the cache lives in. An empty path disables the cache.
+       */
+      explicit InfoCache( const std::string &path = defaultPath() );
+      ~InfoCache() = default;
+
+      /**
+       *	Looks up a device. The file is only read on the first lookup, everything after
+       *  that is served from memory.
+       *
+       *	@param[in]	key           Identifies the device, ie port and USB serial number
+       *	@param[out]	info          The cached device info
+       *	@param[out]	caps          The cached capabilities
+       *	@param[out]	version       versionHash() of the banner the entry was parsed from
+       *	@return bool              True if the cache held an entry, false if not
+       */
+      bool lookup( const std::string &key, Info &info, Capabilities &caps, uint64_t &version ) const;
+
+      /**
+       *	Adds or replaces the entry for a device
+       *
+       *	@param[in]	key           Identifies the device, ie port and USB serial number
+       *	@param[in]	version       versionHash() of the banner the entry was parsed from
+       *	@param[in]	info          The parsed device info
+       *	@param[in]	caps          The capabilities derived from the info
+       *	@return bool              True if the cache file was written, false if not
+       */
+      bool store( const std::string &key, const uint64_t version, const Info &info, const Capabilities &caps );
+
+      /**
+       *	Checks if the cache is backed by a file
+       *
+       *	@return bool
+       */
+      bool enabled() const;
+
+      /**
+       *	Gets the path of the cache file
+       *
+       *	@return const std::string &
+       */
+      const std::string &path() const;
+
+      /**
+       *	Hashes the firmware line of a banner, which the 'i' command and every reset
+       *  print alike. Stable across runs and platforms, unlike std::hash.
+       *
+       *	@param[in]	banner        The raw banner text
+       *	@return uint64_t          The hash, or zero if the banner has no firmware line
+       */
+      static uint64_t versionHash( const std::string &banner );
+
+      /**
+       *	Picks the per-user cache location: %LOCALAPPDATA% on Windows, otherwise
+       *  $XDG_CACHE_HOME or ~/.cache
+       *
+       *	@return std::string       The default cache file, or empty if there is no home to put it in
+       */
+      static std::string defaultPath();
+
+    private:
+      struct Entry
+      {
+        uint64_t version;
+        std::string fields; /**< Everything after the key and version, as written to the file */
+      };
+
+      std::string file;
+      mutable bool loaded = false;
+      mutable std::map<std::string, Entry> entries;
+
+      void load() const;
+      bool save();
+    };
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_INFO_CACHE_HPP */
@@ -0,0 +1,202 @@
+/********************************************************************************
+ *   File Name:
+ *     info_parser.cpp
+ *
+ *   Description:
+ *     Implements the info banner parser
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* C++ Includes */
+#include <algorithm>
+
+/* Module Includes */
+#include "bus_pirate.hpp"
+#include "info_parser.hpp"
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    using string_view = boost::string_view;
+
+    static bool isDigit( const char c )
+    {
+      return ( c >= '0' ) && ( c <= '9' );
+    }
+
+    static bool startsWith( const string_view text, const string_view prefix )
+    {
+      return ( text.size() >= prefix.size() ) && ( text.compare( 0, prefix.size(), prefix ) == 0 );
+    }
+
+    /*------------------------------------------------
+    Splits off the next space delimited token, skipping any run of spaces
+    ------------------------------------------------*/
+    static string_view nextToken( string_view &text )
+    {
+      while ( !text.empty() && ( text.front() == ' ' ) )
+      {
+        text.remove_prefix( 1 );
+      }
+
+      const size_t end = std::min( text.find( ' ' ), text.size() );
+      string_view token = text.substr( 0, end );
+      text.remove_prefix( end );
+
+      return token;
+    }
+
+    /*------------------------------------------------
+    Decodes a version token like "v5.10" or "v3b". The numeric value is every digit
+    of the leading "major.minor" part run together, so "v5.10" is 510 and "v3.5" is
+    35, matching what the terminal has always reported.
+    ------------------------------------------------*/
+    static bool parseVersion( const string_view token, uint32_t &number, uint32_t &major, uint32_t &minor )
+    {
+      if ( ( token.size() < 2 ) || ( token[ 0 ] != 'v' ) || !isDigit( token[ 1 ] ) )
+      {
+        return false;
+      }
+
+      number = 0;
+      major  = 0;
+      minor  = 0;
+
+      bool pastDot = false;
+
+      for ( size_t x = 1; x < token.size(); x++ )
+      {
+        const char c = token[ x ];
+
+        if ( isDigit( c ) )
+        {
+          const uint32_t digit = static_cast<uint32_t>( c - '0' );
+          number               = ( number * 10 ) + digit;
+          ( pastDot ? minor : major ) = ( ( pastDot ? minor : major ) * 10 ) + digit;
+        }
+        else if ( ( c == '.' ) && !pastDot )
+        {
+          pastDot = true;
+        }
+        else
+        {
+          break;
+        }
+      }
+
+      return true;
+    }
+
+    /*------------------------------------------------
+    Finds "<key>" followed by a version token anywhere in the line
+    ------------------------------------------------*/
+    static string_view findVersionAfter( string_view line, const string_view key )
+    {
+      while ( !line.empty() )
+      {
+        if ( nextToken( line ) == key )
+        {
+          string_view version = nextToken( line );
+
+          if ( startsWith( version, "v" ) )
+          {
+            return version;
+          }
+        }
+      }
+
+      return string_view();
+    }
+
+    bool parseInfoBanner( const string_view banner, Info &info ) noexcept
+    {
+      bool hwFound  = false;
+      bool fwFound  = false;
+      bool blFound  = false;
+      bool idsFound = false;
+
+      string_view remaining = banner;
+
+      while ( !remaining.empty() )
+      {
+        /*------------------------------------------------
+        Peel off one line, tolerating both "\r\n" and bare "\n"
+        ------------------------------------------------*/
+        const size_t eol = std::min( remaining.find( '\n' ), remaining.size() );
+        string_view line = remaining.substr( 0, eol );
+        remaining.remove_prefix( std::min( eol + 1, remaining.size() ) );
+
+        if ( !line.empty() && ( line.back() == '\r' ) )
+        {
+          line.remove_suffix( 1 );
+        }
+
+        if ( startsWith( line, "Bus Pirate " ) )
+        {
+          /*------------------------------------------------
+          Bus Pirate v3b
+          ------------------------------------------------*/
+          string_view rest  = line.substr( 11 );
+          string_view token = nextToken( rest );
+
+          uint32_t unused = 0;
+          if ( parseVersion( token, info.hwVerNum, info.hwVerNumMajor, unused ) )
+          {
+            info.hwVer.assign( token.data(), token.size() );
+            hwFound = true;
+          }
+        }
+        else if ( startsWith( line, "DEVID:" ) )
+        {
+          /*------------------------------------------------
+          DEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)
+          ------------------------------------------------*/
+          string_view rest  = line;
+          string_view devID = nextToken( rest ).substr( 6 );
+          string_view revID = nextToken( rest );
+
+          const size_t open  = rest.find( '(' );
+          const size_t close = rest.rfind( ')' );
+
+          if ( !devID.empty() && startsWith( revID, "REVID:" ) && ( revID.size() > 6 ) && ( open != string_view::npos ) &&
+               ( close != string_view::npos ) && ( close > open + 1 ) )
+          {
+            revID.remove_prefix( 6 );
+            string_view mcu = rest.substr( open + 1, close - open - 1 );
+
+            info.deviceID.assign( devID.data(), devID.size() );
+            info.revID.assign( revID.data(), revID.size() );
+            info.mcuVer.assign( mcu.data(), mcu.size() );
+            idsFound = true;
+          }
+        }
+        else
+        {
+          /*------------------------------------------------
+          Firmware v5.10 (r559)  Bootloader v4.4, though community builds put
+          some text before "Firmware" and a feature list after it
+          ------------------------------------------------*/
+          string_view firmware   = findVersionAfter( line, "Firmware" );
+          string_view bootloader = findVersionAfter( line, "Bootloader" );
+
+          if ( parseVersion( firmware, info.firmwareVerNum, info.firmwareVerNumMajor, info.firmwareVerNumMinor ) )
+          {
+            info.firmwareVer.assign( firmware.data(), firmware.size() );
+            fwFound = true;
+          }
+
+          if ( parseVersion( bootloader, info.bootloaderVerNum, info.bootloaderVerNumMajor, info.bootloaderVerNumMinor ) )
+          {
+            info.bootLoaderVer.assign( bootloader.data(), bootloader.size() );
+            blFound = true;
+          }
+        }
+      }
+
+      info.isValid = hwFound && fwFound && blFound && idsFound;
+      return info.isValid;
+    }
+  }  // namespace BusPirate
+}  // namespace HWInterface
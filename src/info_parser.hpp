@@ -0,0 +1,44 @@
+/********************************************************************************
+ *   File Name:
+ *     info_parser.hpp
+ *
+ *   Description:
+ *     Single pass parser for the banner the Bus Pirate prints in response to the
+ *     'i' command. Works directly on the receive buffer without allocating.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+#pragma once
+#ifndef BUS_PIRATE_CPP_INFO_PARSER_HPP
+#define BUS_PIRATE_CPP_INFO_PARSER_HPP
+
+/* Boost Includes */
+#include <boost/utility/string_view.hpp>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    struct Info;
+
+    /**
+     *	Pulls the hardware, firmware and bootloader versions plus the device and revision
+     *  IDs out of an info banner, ie:
+     *
+     *    Bus Pirate v3b
+     *    Firmware v5.10 (r559)  Bootloader v4.4
+     *    DEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)
+     *
+     *  Lines may come in any order and anything else in the banner is skipped. Only
+     *  the text fields of info are written, and they are short enough that strings
+     *  reuse their inline storage. Nothing is validated against the known versions.
+     *
+     *	@param[in]	banner        The raw banner text
+     *	@param[out]	info          Receives the parsed fields. isValid is set to the result.
+     *	@return bool              True if every field was found, false if the banner is malformed
+     */
+    bool parseInfoBanner( const boost::string_view banner, Info &info ) noexcept;
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_INFO_PARSER_HPP */
@@ -0,0 +1,147 @@
+/********************************************************************************
+ *   File Name:
+ *     ring_buffer.hpp
+ *
+ *   Description:
+ *     Lock-free single producer, single consumer ring buffer. One thread may push
+ *     while another thread pops without any locking.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+#pragma once
+#ifndef BUS_PIRATE_CPP_RING_BUFFER_HPP
+#define BUS_PIRATE_CPP_RING_BUFFER_HPP
+
+/* C++ Includes */
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace HWInterface
+{
+  template<typename T>
+  class SPSCRingBuffer
+  {
+  public:
+    /**
+     *  @param[in]  capacity    Minimum number of elements the buffer can hold. Rounded up to a power of two.
+     */
+    explicit SPSCRingBuffer( const size_t capacity ) : head( 0 ), tail( 0 )
+    {
+      size_t size = 1;
+      while ( size < capacity )
+      {
+        size <<= 1;
+      }
+
+      buffer.resize( size );
+      mask = size - 1;
+    }
+
+    ~SPSCRingBuffer() = default;
+
+    /**
+     *	Copies elements into the buffer. Only call from the producer thread.
+     *
+     *	@param[in]	data          Elements to copy in
+     *	@param[in]	count         Number of elements to copy in
+     *	@return size_t            Number of elements actually copied. Less than count if the buffer filled up.
+     */
+    size_t push( const T *const data, const size_t count ) noexcept
+    {
+      const size_t h     = head.load( std::memory_order_relaxed );
+      const size_t t     = tail.load( std::memory_order_acquire );
+      const size_t space = buffer.size() - ( h - t );
+      const size_t n     = std::min( count, space );
+
+      copyIn( h, data, n );
+      head.store( h + n, std::memory_order_release );
+
+      return n;
+    }
+
+    /**
+     *	Copies elements out of the buffer. Only call from the consumer thread.
+     *
+     *	@param[out]	data          Where to copy the elements to
+     *	@param[in]	count         Maximum number of elements to copy out
+     *	@return size_t            Number of elements actually copied
+     */
+    size_t pop( T *const data, const size_t count ) noexcept
+    {
+      const size_t t     = tail.load( std::memory_order_relaxed );
+      const size_t h     = head.load( std::memory_order_acquire );
+      const size_t avail = h - t;
+      const size_t n     = std::min( count, avail );
+
+      copyOut( t, data, n );
+      tail.store( t + n, std::memory_order_release );
+
+      return n;
+    }
+
+    /**
+     *	Drops everything currently in the buffer. Only call from the consumer thread.
+     *
+     *	@return void
+     */
+    void clear() noexcept
+    {
+      tail.store( head.load( std::memory_order_acquire ), std::memory_order_release );
+    }
+
+    /**
+     *	Number of elements waiting to be popped. Exact from the consumer thread,
+     *  a lower bound from anywhere else.
+     *
+     *	@return size_t
+     */
+    size_t size() const noexcept
+    {
+      return head.load( std::memory_order_acquire ) - tail.load( std::memory_order_acquire );
+    }
+
+    bool empty() const noexcept
+    {
+      return size() == 0;
+    }
+
+    size_t capacity() const noexcept
+    {
+      return buffer.size();
+    }
+
+  private:
+    std::vector<T> buffer;
+    size_t mask;
+
+    /*------------------------------------------------
+    Free running indices, wrapped with the mask on access. Kept on separate
+    cache lines so the producer and consumer don't thrash each other.
+    ------------------------------------------------*/
+    alignas( 64 ) std::atomic<size_t> head; /**< Next slot to write. Owned by the producer. */
+    alignas( 64 ) std::atomic<size_t> tail; /**< Next slot to read. Owned by the consumer. */
+
+    void copyIn( const size_t index, const T *const data, const size_t count ) noexcept
+    {
+      const size_t start = index & mask;
+      const size_t first = std::min( count, buffer.size() - start );
+
+      std::copy( data, data + first, buffer.begin() + start );
+      std::copy( data + first, data + count, buffer.begin() );
+    }
+
+    void copyOut( const size_t index, T *const data, const size_t count ) const noexcept
+    {
+      const size_t start = index & mask;
+      const size_t first = std::min( count, buffer.size() - start );
+
+      std::copy( buffer.begin() + start, buffer.begin() + start + first, data );
+      std::copy( buffer.begin(), buffer.begin() + ( count - first ), data + first );
+    }
+  };
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_RING_BUFFER_HPP */
@@ -15,10 +15,15 @@
 #include <spdlog/spdlog.h>
 
 /* C++ Includes */
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <numeric>
 
 /* Boost Includes */
 #include <boost/bind.hpp>
@@ -30,6 +35,16 @@
 #if defined( _WIN32 ) || defined( _WIN64 )
 #include <Windows.h>
 #include <Ntddser.h>
+#else
+/* POSIX Includes */
+#include <limits.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#if defined( __linux__ )
+#include <linux/serial.h>
+#endif
 #endif
 
 using namespace Chimera;
@@ -37,15 +52,69 @@ using namespace Chimera::Serial;
 
 namespace HWInterface
 {
+  /*------------------------------------------------
+  Default number of bytes PacingMode::ADAPTIVE lets queue up on the wire. Roughly
+  the size of a typical OS/USB-serial transmit buffer, so normal traffic never waits.
+  ------------------------------------------------*/
+  static constexpr size_t DFLT_MAX_TX_BACKLOG = 4096;
+
+  /*------------------------------------------------
+  Default frame format until configure() is called: 1 start, 8 data, 1 stop
+  ------------------------------------------------*/
+  static constexpr uint32_t DFLT_BAUD_RATE       = 115200;
+  static constexpr uint32_t DFLT_FRAME_HALF_BITS = 2 * ( 1 + 8 + 1 );
+
+  /*------------------------------------------------
+  Default size of the ring used by the background I/O thread
+  ------------------------------------------------*/
+  static constexpr size_t DFLT_RX_RING_SIZE = 64 * 1024;
+
+  /*------------------------------------------------
+  USB-serial latency timer tuning. The FT232 on the Bus Pirate v3 holds small
+  reads for up to 16 mS by default, 1 mS is the lowest it accepts.
+  ------------------------------------------------*/
+  static constexpr uint32_t DFLT_LATENCY_TIMER_MS = 1;
+  static const std::string DFLT_SYSFS_ROOT        = "/sys";
+
   SerialDriver::SerialDriver( std::string &device, const uint32_t delay_mS ) : io(), serialPort( io ), timer( io )
   {
-    serialDevice = device;
-    ioDelay_mS   = delay_mS;
+    serialDevice  = device;
+    maxTxBacklog  = DFLT_MAX_TX_BACKLOG;
+    baudRate      = DFLT_BAUD_RATE;
+    frameHalfBits = DFLT_FRAME_HALF_BITS;
+    byteTime_nS   = 0;
+    latency_uS    = 0;
+    txDrainTime   = boost::chrono::steady_clock::now();
+
+    lowLatencyActive = false;
+    latencyTimer_mS  = DFLT_LATENCY_TIMER_MS;
+    sysfsRoot        = DFLT_SYSFS_ROOT;
+
+    rxRingSize     = DFLT_RX_RING_SIZE;
+    rxRecordSize   = 1;
+    rxCarryLength  = 0;
+    rxBackground   = false;
+    ioThreadActive = false;
+    rxOverflow     = 0;
+
+    setPacing( delay_mS ? PacingMode::FIXED_DELAY : PacingMode::ADAPTIVE, delay_mS );
+  }
+
+  SerialDriver::~SerialDriver()
+  {
+    stopBackgroundRx();
   }
 
   Chimera::Status_t SerialDriver::begin( const Chimera::Serial::Modes txMode, const Chimera::Serial::Modes rxMode ) noexcept
   {
-    return open();
+    Status_t error = open();
+
+    if ( ( error == Status::OK ) && ( rxMode != Modes::BLOCKING ) )
+    {
+      error = startBackgroundRx();
+    }
+
+    return error;
   }
 
   Chimera::Status_t SerialDriver::configure( const uint32_t baud, const CharWid width, const Parity parity, const StopBits stop,
@@ -113,6 +182,33 @@ namespace HWInterface
 
         serial_port_base::flow_control FLOW( static_cast<serial_port_base::flow_control::type>( flow ) );
         serialPort.set_option( FLOW );
+
+        /*------------------------------------------------
+        Remember the frame format so the pacing engine knows the real wire time.
+        A new format invalidates any previous calibration.
+        ------------------------------------------------*/
+        uint32_t parityBits = ( parity == Parity::PAR_NONE ) ? 0 : 1;
+        uint32_t stopHalfBits = 2;
+
+        if ( stop == StopBits::SBITS_ONE_POINT_FIVE )
+        {
+          stopHalfBits = 3;
+        }
+        else if ( stop == StopBits::SBITS_TWO )
+        {
+          stopHalfBits = 4;
+        }
+
+        baudRate      = baud;
+        frameHalfBits = 2 * ( 1 + static_cast<uint32_t>( width ) + parityBits ) + stopHalfBits;
+        byteTime_nS   = 0;
+        latency_uS    = 0;
+
+        /*------------------------------------------------
+        Boost rewrites the whole termios structure on each option, so the
+        native settings have to go on last
+        ------------------------------------------------*/
+        error = configureNative();
       }
       catch ( const boost::system::system_error & )
       {
@@ -127,6 +223,9 @@ namespace HWInterface
   {
     Status_t error = Status::OK;
 
+    stopBackgroundRx();
+    releaseNative();
+
     try
     {
       io.reset();
@@ -151,18 +250,66 @@ namespace HWInterface
   Chimera::Status_t SerialDriver::setMode( const Chimera::Serial::SubPeripheral periph,
                                            const Chimera::Serial::Modes mode ) noexcept
   {
-    return Status::NOT_SUPPORTED;
+    Status_t error = Status::OK;
+
+    if ( periph == SubPeripheral::TX )
+    {
+      error = Status::NOT_SUPPORTED;
+    }
+    else if ( mode == Modes::BLOCKING )
+    {
+      stopBackgroundRx();
+    }
+    else if ( !rxBackground )
+    {
+      error = serialPort.is_open() ? startBackgroundRx() : Status::NOT_INITIALIZED;
+    }
+
+    return error;
   }
 
   Chimera::Status_t SerialDriver::write( const uint8_t *const buffer, const size_t length, const uint32_t timeout_mS ) noexcept
   {
-    boost::asio::write( serialPort, boost::asio::buffer( buffer, length ) );
-    boost::this_thread::sleep_for( boost::chrono::milliseconds( ioDelay_mS ) );
-    return Status::OK;
+    Status_t error = Status::OK;
+
+    if ( serialPort.is_open() )
+    {
+      boost::system::error_code ec;
+
+      paceBeforeWrite( length );
+
+      if ( rxBackground && ioThreadActive )
+      {
+        ec = backgroundWrite( buffer, length );
+      }
+      else
+      {
+        boost::asio::write( serialPort, boost::asio::buffer( buffer, length ), ec );
+      }
+
+      paceAfterWrite( length );
+
+      if ( ec )
+      {
+        spdlog::error( ec.message() );
+        error = Status::FAIL;
+      }
+    }
+    else
+    {
+      error = Status::NOT_INITIALIZED;
+    }
+
+    return error;
   }
 
   Chimera::Status_t SerialDriver::read( uint8_t *const buffer, const size_t length, const uint32_t timeout_mS ) noexcept
   {
+    if ( rxBackground )
+    {
+      return backgroundRead( buffer, length, timeout_mS );
+    }
+
     if ( serialPort.is_open() )
     {
       /*------------------------------------------------
@@ -232,9 +379,14 @@ namespace HWInterface
     return asyncResult;
   }
 
-  Chimera::Status_t SerialDriver::readUntil( std::vector<uint8_t> &buffer, const boost::regex &expr,
+  Chimera::Status_t SerialDriver::readUntil( std::vector<uint8_t> &buffer, const Delimiter &delimiter,
                                              const uint32_t timeout_mS ) noexcept
   {
+    if ( rxBackground )
+    {
+      return backgroundReadUntil( buffer, delimiter, timeout_mS );
+    }
+
     if ( serialPort.is_open() )
     {
       /*------------------------------------------------
@@ -244,9 +396,12 @@ namespace HWInterface
       io.restart();
 
       /*------------------------------------------------
-      Start the asynchronous read
+      Start the asynchronous read. The scanner remembers how far it got,
+      so each chunk that arrives only costs the new bytes to search.
       ------------------------------------------------*/
-      boost::asio::async_read_until( serialPort, inputStream, expr,
+      Delimiter::Scanner scanner( delimiter );
+
+      boost::asio::async_read_until( serialPort, inputStream, Delimiter::MatchCondition( scanner ),
                                      boost::bind( &SerialDriver::callback_readComplete, this, boost::asio::placeholders::error,
                                                   boost::asio::placeholders::bytes_transferred ) );
 
@@ -309,6 +464,33 @@ namespace HWInterface
     return asyncResult;
   }
 
+  Chimera::Status_t SerialDriver::readSome( uint8_t *const buffer, const size_t length, size_t &received,
+                                            const uint32_t timeout_mS ) noexcept
+  {
+    received = 0;
+
+    if ( !rxBackground )
+    {
+      return Status::NOT_READY;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeout_mS );
+
+    /*------------------------------------------------
+    Leftovers from a previous readUntil() come first, then straight out of the ring
+    ------------------------------------------------*/
+    received = std::min( length, rxPending.size() );
+    memcpy( buffer, rxPending.data(), received );
+    rxPending.erase( rxPending.begin(), rxPending.begin() + received );
+
+    do
+    {
+      received += rxRing->pop( buffer + received, length - received );
+    } while ( !received && waitForRxData( deadline ) );
+
+    return received ? Status::OK : Status::EMPTY;
+  }
+
   bool SerialDriver::isOpen() noexcept
   {
     return serialPort.is_open();
@@ -321,6 +503,12 @@ namespace HWInterface
     ------------------------------------------------*/
     inputStream.consume( inputStream.size() );
 
+    if ( rxBackground )
+    {
+      rxRing->clear();
+      rxPending.clear();
+    }
+
     /*------------------------------------------------
     Platform specific serial port driver buffer clearing
     ------------------------------------------------*/
@@ -328,16 +516,228 @@ namespace HWInterface
     HANDLE hSerial = serialPort.lowest_layer().native_handle();
     return static_cast<bool>( PurgeComm( hSerial, ( PURGE_RXCLEAR | PURGE_TXCLEAR ) ) );
 #else
-    return false;
+    return serialPort.is_open() && ( tcflush( serialPort.native_handle(), TCIOFLUSH ) == 0 );
 #endif
   }
 
   bool SerialDriver::reset() noexcept
   {
+    const bool restartRx = rxBackground;
+
+    stopBackgroundRx();
     serialPort.cancel();
     io.reset();
 
-    return open();
+    Status_t error = open();
+
+    if ( ( error == Status::OK ) && restartRx )
+    {
+      error = startBackgroundRx();
+    }
+
+    return ( error == Status::OK );
+  }
+
+  void SerialDriver::setPacing( const PacingMode mode, const uint32_t delay_mS ) noexcept
+  {
+    pacing     = mode;
+    ioDelay_mS = delay_mS;
+  }
+
+  void SerialDriver::setNativeOptions( const NativePortOptions &options ) noexcept
+  {
+    nativeOptions = options;
+  }
+
+  bool SerialDriver::isLowLatencyActive() const noexcept
+  {
+    return lowLatencyActive;
+  }
+
+  void SerialDriver::setLatencyTimer( const uint32_t timer_mS ) noexcept
+  {
+    latencyTimer_mS = timer_mS;
+  }
+
+  void SerialDriver::setSysfsRoot( const std::string &root ) noexcept
+  {
+    sysfsRoot = root;
+  }
+
+  const LatencyTimerReport &SerialDriver::getLatencyTimerReport() const noexcept
+  {
+    return latencyReport;
+  }
+
+  const std::string &SerialDriver::getPortName() const noexcept
+  {
+    return serialDevice;
+  }
+
+  void SerialDriver::setMaxTxBacklog( const size_t bytes ) noexcept
+  {
+    maxTxBacklog = bytes;
+  }
+
+  uint64_t SerialDriver::wireTime_uS( const size_t bytes ) const noexcept
+  {
+    if ( byteTime_nS )
+    {
+      return ( static_cast<uint64_t>( bytes ) * byteTime_nS ) / 1000u;
+    }
+
+    /*------------------------------------------------
+    frameHalfBits / ( 2 * baud ) seconds per byte, rounded up to the next microsecond
+    ------------------------------------------------*/
+    const uint64_t halfBits = static_cast<uint64_t>( bytes ) * frameHalfBits * 1000000u;
+    const uint64_t divisor  = 2u * static_cast<uint64_t>( baudRate ? baudRate : DFLT_BAUD_RATE );
+
+    return ( halfBits + divisor - 1 ) / divisor;
+  }
+
+  Chimera::Status_t SerialDriver::calibrate( const size_t length, const uint32_t timeout_mS ) noexcept
+  {
+    using namespace boost::chrono;
+
+    Status_t error = Status::OK;
+
+    if ( !serialPort.is_open() )
+    {
+      return Status::NOT_INITIALIZED;
+    }
+
+    if ( length < 2 )
+    {
+      return Status::INVAL_FUNC_PARAM;
+    }
+
+    /*------------------------------------------------
+    Time a single byte round trip and a long one. The difference is the real per-byte
+    cost of the link, the remainder of the short one is the fixed turnaround latency.
+    Each is measured a few times and the best result kept to filter out scheduler noise.
+    Pacing is disabled while measuring so it can't skew the results.
+    ------------------------------------------------*/
+    static constexpr size_t rounds = 3;
+
+    const PacingMode lastMode = pacing;
+    pacing                    = PacingMode::NONE;
+
+    std::vector<uint8_t> txData( length );
+    std::vector<uint8_t> rxData( length );
+    std::iota( txData.begin(), txData.end(), static_cast<uint8_t>( 0 ) );
+
+    auto roundTrip = [ & ]( const size_t bytes ) {
+      std::fill( rxData.begin(), rxData.end(), static_cast<uint8_t>( 0 ) );
+
+      auto start = steady_clock::now();
+      error |= write( txData.data(), bytes, timeout_mS );
+      error |= read( rxData.data(), bytes, timeout_mS );
+      auto stop = steady_clock::now();
+
+      if ( !std::equal( txData.begin(), txData.begin() + bytes, rxData.begin() ) )
+      {
+        error |= Status::FAIL;
+      }
+
+      return static_cast<uint64_t>( duration_cast<nanoseconds>( stop - start ).count() );
+    };
+
+    flush();
+    roundTrip( 1 );
+
+    uint64_t shortTime = std::numeric_limits<uint64_t>::max();
+    uint64_t longTime  = std::numeric_limits<uint64_t>::max();
+
+    for ( size_t x = 0; ( x < rounds ) && ( error == Status::OK ); x++ )
+    {
+      shortTime = std::min( shortTime, roundTrip( 1 ) );
+      longTime  = std::min( longTime, roundTrip( length ) );
+    }
+
+    pacing = lastMode;
+
+    if ( error == Status::OK )
+    {
+      /*------------------------------------------------
+      The link can't move bytes faster than the configured baud rate. A measurement
+      below that means a virtual port or timer noise, so fall back to the theory.
+      ------------------------------------------------*/
+      const uint64_t theoryByteTime = ( static_cast<uint64_t>( frameHalfBits ) * 1000000000u ) / ( 2u * baudRate );
+      const uint64_t measured       = ( longTime > shortTime ) ? ( longTime - shortTime ) / ( length - 1 ) : 0;
+
+      byteTime_nS = std::max( measured, theoryByteTime );
+      latency_uS  = static_cast<uint32_t>( ( shortTime > byteTime_nS ) ? ( shortTime - byteTime_nS ) / 1000u : 0 );
+
+      spdlog::info( "{} calibrated: {} nS/byte, {} uS latency", serialDevice, byteTime_nS, latency_uS );
+    }
+    else
+    {
+      spdlog::error( "{} calibration failed. Is the port in loopback?", serialDevice );
+      error = Status::FAIL;
+    }
+
+    return error;
+  }
+
+  uint32_t SerialDriver::getLatency_uS() const noexcept
+  {
+    return latency_uS;
+  }
+
+  void SerialDriver::setRxBufferSize( const size_t bytes ) noexcept
+  {
+    rxRingSize = bytes;
+  }
+
+  void SerialDriver::setRxRecordSize( const size_t bytes ) noexcept
+  {
+    rxRecordSize = std::max<size_t>( 1, std::min<size_t>( bytes, RX_MAX_RECORD_SIZE ) );
+  }
+
+  bool SerialDriver::isBackgroundRxActive() const noexcept
+  {
+    return rxBackground && ioThreadActive;
+  }
+
+  size_t SerialDriver::getRxOverflowCount() const noexcept
+  {
+    return rxOverflow;
+  }
+
+  void SerialDriver::paceBeforeWrite( const size_t length ) noexcept
+  {
+    using namespace boost::chrono;
+
+    if ( pacing != PacingMode::ADAPTIVE )
+    {
+      return;
+    }
+
+    /*------------------------------------------------
+    Only wait if this write would push more than the allowed backlog onto the wire
+    ------------------------------------------------*/
+    const auto now     = steady_clock::now();
+    const auto backlog = ( txDrainTime > now ) ? duration_cast<microseconds>( txDrainTime - now ) : microseconds( 0 );
+    const auto pending = backlog + microseconds( wireTime_uS( length ) );
+    const auto allowed = microseconds( wireTime_uS( maxTxBacklog ) );
+
+    if ( pending > allowed )
+    {
+      boost::this_thread::sleep_for( pending - allowed );
+    }
+  }
+
+  void SerialDriver::paceAfterWrite( const size_t length ) noexcept
+  {
+    using namespace boost::chrono;
+
+    const auto now = steady_clock::now();
+    txDrainTime    = std::max( txDrainTime, now ) + microseconds( wireTime_uS( length ) );
+
+    if ( ( pacing == PacingMode::FIXED_DELAY ) && ioDelay_mS )
+    {
+      boost::this_thread::sleep_for( milliseconds( ioDelay_mS ) );
+    }
   }
 
   Chimera::Status_t SerialDriver::open() noexcept
@@ -349,6 +749,16 @@ namespace HWInterface
       if ( !serialPort.is_open() )
       {
         serialPort.open( serialDevice );
+        error = configureNative();
+
+        if ( error == Status::OK )
+        {
+          tuneLatencyTimer();
+        }
+        else
+        {
+          serialPort.close();
+        }
       }
     }
     catch ( const boost::system::system_error & )
@@ -359,6 +769,477 @@ namespace HWInterface
     return error;
   }
 
+  Chimera::Status_t SerialDriver::configureNative() noexcept
+  {
+    Status_t error = Status::OK;
+
+#if !defined( _WIN32 ) && !defined( _WIN64 )
+    const int fd = serialPort.native_handle();
+
+    /*------------------------------------------------
+    Exclusive access. Another process poking at the port mid-transfer
+    would corrupt the binary protocols beyond recovery.
+    ------------------------------------------------*/
+    if ( nativeOptions.exclusive && ( ioctl( fd, TIOCEXCL ) != 0 ) )
+    {
+      spdlog::error( "Could not get exclusive access to {}: {}", serialDevice, strerror( errno ) );
+      error = Status::FAILED_OPEN;
+    }
+
+    /*------------------------------------------------
+    Raw mode. Character size, parity, stop bits and flow control are
+    left alone as configure() owns those. VMIN of zero makes a read with
+    nothing pending return 0, which asio reports as end of file.
+    ------------------------------------------------*/
+    termios tty;
+
+    if ( ( error == Status::OK ) && ( tcgetattr( fd, &tty ) == 0 ) )
+    {
+      tty.c_iflag &= ~( IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL );
+      tty.c_oflag &= ~OPOST;
+      tty.c_lflag &= ~( ECHO | ECHONL | ICANON | ISIG | IEXTEN );
+      tty.c_cflag |= ( CLOCAL | CREAD );
+      tty.c_cc[ VMIN ]  = std::max<uint8_t>( nativeOptions.vmin, 1 );
+      tty.c_cc[ VTIME ] = nativeOptions.vtime;
+
+      if ( tcsetattr( fd, TCSANOW, &tty ) != 0 )
+      {
+        error = Status::FAILED_CONFIGURE;
+      }
+    }
+    else if ( error == Status::OK )
+    {
+      error = Status::FAILED_CONFIGURE;
+    }
+
+    /*------------------------------------------------
+    Low latency is best effort. USB-serial drivers that support it stop batching
+    received data up for several milliseconds, others simply refuse the request.
+    ------------------------------------------------*/
+    lowLatencyActive = false;
+
+#if defined( __linux__ )
+    serial_struct serialInfo;
+
+    if ( ( error == Status::OK ) && nativeOptions.lowLatency && ( ioctl( fd, TIOCGSERIAL, &serialInfo ) == 0 ) )
+    {
+      serialInfo.flags |= ASYNC_LOW_LATENCY;
+      lowLatencyActive = ( ioctl( fd, TIOCSSERIAL, &serialInfo ) == 0 );
+    }
+#endif
+#endif
+
+    return error;
+  }
+
+  void SerialDriver::releaseNative() noexcept
+  {
+    restoreLatencyTimer();
+
+#if !defined( _WIN32 ) && !defined( _WIN64 )
+    if ( serialPort.is_open() && nativeOptions.exclusive )
+    {
+      ioctl( serialPort.native_handle(), TIOCNXCL );
+    }
+#endif
+
+    lowLatencyActive = false;
+  }
+
+  /*------------------------------------------------
+  Writes a decimal value to a sysfs attribute
+  ------------------------------------------------*/
+  static bool writeSysfsValue( const std::string &path, const uint32_t value )
+  {
+    std::ofstream file( path );
+    return static_cast<bool>( file << value << std::flush );
+  }
+
+#if defined( __linux__ )
+  /*------------------------------------------------
+  Reads a decimal value from a sysfs attribute
+  ------------------------------------------------*/
+  static bool readSysfsValue( const std::string &path, uint32_t &value )
+  {
+    std::ifstream file( path );
+    return static_cast<bool>( file >> value );
+  }
+
+  /*------------------------------------------------
+  Gets the kernel's name for a tty, which is what sysfs is keyed by. Resolves any
+  symlinks (ie /dev/serial/by-id/...) down to the real device first.
+  ------------------------------------------------*/
+  static std::string kernelTtyName( const std::string &device )
+  {
+    char resolved[ PATH_MAX ];
+    std::string ttyName = device;
+
+    if ( realpath( device.c_str(), resolved ) )
+    {
+      ttyName = resolved;
+    }
+
+    return ttyName.substr( ttyName.find_last_of( '/' ) + 1 );
+  }
+#endif
+
+  std::string SerialDriver::getUSBSerialNumber() const noexcept
+  {
+    std::string serialNumber;
+
+#if defined( __linux__ )
+    /*------------------------------------------------
+    The tty's device node is a USB interface. The serial number belongs to the USB
+    device a level or two above it, depending on the driver.
+    ------------------------------------------------*/
+    std::string path = sysfsRoot + "/class/tty/" + kernelTtyName( serialDevice ) + "/device";
+
+    for ( auto level = 0; ( level < 3 ) && serialNumber.empty(); level++ )
+    {
+      path += "/..";
+      std::ifstream file( path + "/serial" );
+      std::getline( file, serialNumber );
+    }
+#endif
+
+    return serialNumber;
+  }
+
+  void SerialDriver::tuneLatencyTimer() noexcept
+  {
+    latencyReport = LatencyTimerReport();
+
+#if defined( __linux__ )
+    if ( !latencyTimer_mS )
+    {
+      return;
+    }
+
+    const std::string ttyName = kernelTtyName( serialDevice );
+
+    const std::string candidates[] = { sysfsRoot + "/class/tty/" + ttyName + "/device/latency_timer",
+                                       sysfsRoot + "/bus/usb-serial/devices/" + ttyName + "/latency_timer" };
+
+    for ( const auto &path : candidates )
+    {
+      if ( readSysfsValue( path, latencyReport.original_mS ) )
+      {
+        latencyReport.found      = true;
+        latencyReport.path       = path;
+        latencyReport.current_mS = latencyReport.original_mS;
+        break;
+      }
+    }
+
+    if ( !latencyReport.found )
+    {
+      spdlog::debug( "{} has no USB-serial latency timer", serialDevice );
+    }
+    else if ( latencyReport.original_mS <= latencyTimer_mS )
+    {
+      spdlog::info( "{} latency timer already at {} mS", serialDevice, latencyReport.original_mS );
+    }
+    else if ( writeSysfsValue( latencyReport.path, latencyTimer_mS ) )
+    {
+      latencyReport.changed    = true;
+      latencyReport.current_mS = latencyTimer_mS;
+      spdlog::info( "{} latency timer lowered from {} mS to {} mS", serialDevice, latencyReport.original_mS,
+                    latencyTimer_mS );
+    }
+    else
+    {
+      /*------------------------------------------------
+      Usually a permissions problem. Not fatal, the port still works, just slower.
+      ------------------------------------------------*/
+      spdlog::warn( "{} latency timer left at {} mS, could not write {}", serialDevice, latencyReport.original_mS,
+                    latencyReport.path );
+    }
+#endif
+  }
+
+  void SerialDriver::restoreLatencyTimer() noexcept
+  {
+    if ( latencyReport.changed )
+    {
+      if ( writeSysfsValue( latencyReport.path, latencyReport.original_mS ) )
+      {
+        latencyReport.current_mS = latencyReport.original_mS;
+      }
+      else
+      {
+        spdlog::warn( "{} latency timer could not be restored to {} mS", serialDevice, latencyReport.original_mS );
+      }
+
+      latencyReport.changed = false;
+    }
+  }
+
+  Chimera::Status_t SerialDriver::startBackgroundRx() noexcept
+  {
+    Status_t error = Status::OK;
+
+    if ( !serialPort.is_open() )
+    {
+      error = Status::NOT_INITIALIZED;
+    }
+    else if ( !rxBackground )
+    {
+      /*------------------------------------------------
+      Anything still sitting in the stream buffer from a blocking readUntil() belongs in
+      front of whatever the thread will receive, so carry it over.
+      ------------------------------------------------*/
+      rxRing = std::make_unique<SPSCRingBuffer<uint8_t>>( rxRingSize );
+      rxPending.assign( boost::asio::buffers_begin( inputStream.data() ), boost::asio::buffers_end( inputStream.data() ) );
+      inputStream.consume( inputStream.size() );
+      rxOverflow    = 0;
+      rxCarryLength = 0;
+
+      timer.cancel();
+      io.restart();
+      rxBackground   = true;
+      ioThreadActive = true;
+      armBackgroundRead();
+
+      ioThread = std::thread( [ this ]() {
+        /*------------------------------------------------
+        The read handler re-arms itself, so this only returns once the port is
+        cancelled or the io_service is stopped.
+        ------------------------------------------------*/
+        boost::system::error_code ec;
+        io.run( ec );
+
+        ioThreadActive = false;
+        rxSignal.notify_all();
+      } );
+    }
+
+    return error;
+  }
+
+  void SerialDriver::stopBackgroundRx() noexcept
+  {
+    if ( ioThread.joinable() )
+    {
+      boost::system::error_code ec;
+      serialPort.cancel( ec );
+      io.stop();
+      ioThread.join();
+      io.restart();
+
+      /*------------------------------------------------
+      Hand any unread data back to the blocking path
+      ------------------------------------------------*/
+      drainRxRing();
+      inputStream.sputn( reinterpret_cast<const char *>( rxPending.data() ), rxPending.size() );
+      rxPending.clear();
+    }
+
+    rxBackground   = false;
+    ioThreadActive = false;
+  }
+
+  void SerialDriver::armBackgroundRead() noexcept
+  {
+    serialPort.async_read_some( boost::asio::buffer( rxChunk ),
+                                boost::bind( &SerialDriver::callback_backgroundRead, this, boost::asio::placeholders::error,
+                                             boost::asio::placeholders::bytes_transferred ) );
+  }
+
+  void SerialDriver::callback_backgroundRead( const boost::system::error_code &error, const size_t bytesTransferred ) noexcept
+  {
+    if ( bytesTransferred )
+    {
+      const size_t dropped = storeBackgroundRead( bytesTransferred );
+
+      if ( dropped )
+      {
+        if ( !rxOverflow )
+        {
+          spdlog::error( "{} RX ring overflow, dropping data", serialDevice );
+        }
+
+        rxOverflow += dropped;
+      }
+
+      /*------------------------------------------------
+      Taking the lock, even briefly, guarantees a consumer that just checked the
+      ring and is about to sleep can't miss this notification.
+      ------------------------------------------------*/
+      {
+        std::lock_guard<std::mutex> lock( rxMutex );
+      }
+      rxSignal.notify_all();
+    }
+
+    if ( !error )
+    {
+      armBackgroundRead();
+    }
+    else if ( error != boost::asio::error::operation_aborted )
+    {
+      spdlog::error( "{} background read stopped: {}", serialDevice, error.message() );
+    }
+  }
+
+  size_t SerialDriver::storeBackgroundRead( const size_t length ) noexcept
+  {
+    /*------------------------------------------------
+    Only whole records go into the ring, so a full ring drops whole records and the
+    data behind it stays aligned. The end of a record split across reads waits in
+    rxCarry for the rest of it.
+    ------------------------------------------------*/
+    const uint8_t *data = rxChunk.data();
+    size_t remaining    = length;
+    size_t dropped      = 0;
+
+    if ( rxCarryLength )
+    {
+      const size_t needed = std::min( rxRecordSize - rxCarryLength, remaining );
+
+      memcpy( rxCarry.data() + rxCarryLength, data, needed );
+      rxCarryLength += needed;
+      data += needed;
+      remaining -= needed;
+
+      if ( rxCarryLength < rxRecordSize )
+      {
+        return 0;
+      }
+
+      if ( ( rxRing->capacity() - rxRing->size() ) >= rxRecordSize )
+      {
+        rxRing->push( rxCarry.data(), rxRecordSize );
+      }
+      else
+      {
+        dropped += rxRecordSize;
+      }
+
+      rxCarryLength = 0;
+    }
+
+    /*------------------------------------------------
+    Free space only grows while this runs, so everything that fits now gets stored
+    ------------------------------------------------*/
+    const size_t whole  = remaining - ( remaining % rxRecordSize );
+    const size_t space  = rxRing->capacity() - rxRing->size();
+    const size_t stored = rxRing->push( data, std::min( whole, space - ( space % rxRecordSize ) ) );
+
+    dropped += whole - stored;
+    memcpy( rxCarry.data(), data + whole, remaining - whole );
+    rxCarryLength = remaining - whole;
+
+    return dropped;
+  }
+
+  boost::system::error_code SerialDriver::backgroundWrite( const uint8_t *const buffer, const size_t length ) noexcept
+  {
+    /*------------------------------------------------
+    The I/O thread has a read pending on the port and asio doesn't allow a second
+    thread on the same serial_port, so the write is started over there too.
+    ------------------------------------------------*/
+    std::promise<boost::system::error_code> done;
+    std::future<boost::system::error_code> result = done.get_future();
+
+    io.post( [ this, buffer, length, &done ]() {
+      boost::asio::async_write( serialPort, boost::asio::buffer( buffer, length ),
+                                [ &done ]( const boost::system::error_code &error, const size_t ) { done.set_value( error ); } );
+    } );
+
+    while ( result.wait_for( std::chrono::milliseconds( 10 ) ) != std::future_status::ready )
+    {
+      /*------------------------------------------------
+      A read error ends the thread without re-arming. Once it is out of the io_service,
+      nothing else touches the port and the write can be finished from here.
+      ------------------------------------------------*/
+      if ( !ioThreadActive )
+      {
+        boost::system::error_code ec;
+        io.restart();
+        io.run( ec );
+      }
+    }
+
+    return result.get();
+  }
+
+  bool SerialDriver::waitForRxData( const std::chrono::steady_clock::time_point &deadline ) noexcept
+  {
+    std::unique_lock<std::mutex> lock( rxMutex );
+    return rxSignal.wait_until( lock, deadline, [ this ]() { return !rxRing->empty() || !ioThreadActive; } )
+           && !rxRing->empty();
+  }
+
+  void SerialDriver::drainRxRing() noexcept
+  {
+    if ( !rxRing )
+    {
+      return;
+    }
+
+    const size_t available = rxRing->size();
+    const size_t offset    = rxPending.size();
+
+    rxPending.resize( offset + available );
+    rxPending.resize( offset + rxRing->pop( rxPending.data() + offset, available ) );
+  }
+
+  Chimera::Status_t SerialDriver::backgroundRead( uint8_t *const buffer, const size_t length, const uint32_t timeout_mS ) noexcept
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeout_mS );
+
+    /*------------------------------------------------
+    Leftovers from a previous readUntil() come first
+    ------------------------------------------------*/
+    size_t copied = std::min( length, rxPending.size() );
+    memcpy( buffer, rxPending.data(), copied );
+    rxPending.erase( rxPending.begin(), rxPending.begin() + copied );
+
+    while ( copied < length )
+    {
+      copied += rxRing->pop( buffer + copied, length - copied );
+
+      if ( ( copied < length ) && !waitForRxData( deadline ) )
+      {
+        break;
+      }
+    }
+
+    if ( copied == length )
+    {
+      return Status::OK;
+    }
+
+    return copied ? Status::TIMEOUT : Status::EMPTY;
+  }
+
+  Chimera::Status_t SerialDriver::backgroundReadUntil( std::vector<uint8_t> &buffer, const Delimiter &delimiter,
+                                                       const uint32_t timeout_mS ) noexcept
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeout_mS );
+    Delimiter::Scanner scanner( delimiter );
+
+    do
+    {
+      drainRxRing();
+
+      size_t matchEnd = 0;
+      if ( scanner.scan( rxPending.data(), rxPending.size(), matchEnd ) )
+      {
+        /*------------------------------------------------
+        Only hand back data up to and including the match. The rest stays
+        pending for the next read.
+        ------------------------------------------------*/
+        buffer.assign( rxPending.cbegin(), rxPending.cbegin() + matchEnd );
+        rxPending.erase( rxPending.cbegin(), rxPending.cbegin() + matchEnd );
+
+        return Status::OK;
+      }
+    } while ( waitForRxData( deadline ) );
+
+    return rxPending.empty() ? Status::EMPTY : Status::TIMEOUT;
+  }
+
   void SerialDriver::callback_readComplete( const boost::system::error_code &error, const size_t bytesTransferred ) noexcept
   {
     asyncResult = Status::UNKNOWN_ERROR;
@@ -376,10 +1257,10 @@ namespace HWInterface
       }
 
       /*------------------------------------------------
-      Error 995: The I/O operation has been aborted because of either a thread exit or an application request
-      Seems to not cause an issue?
+      Cancelling the port or timer aborts the outstanding operation (error 995 on Windows).
+      That's expected, so don't report it.
       ------------------------------------------------*/
-      if ( error.value() != 995 )
+      if ( error != boost::asio::error::operation_aborted )
       {
         spdlog::error( error.message() );
       }
@@ -395,10 +1276,10 @@ namespace HWInterface
     else
     {
       /*------------------------------------------------
-      Error 995: The I/O operation has been aborted because of either a thread exit or an application request
-      Seems to not cause an issue?
+      Cancelling the port or timer aborts the outstanding operation (error 995 on Windows).
+      That's expected, so don't report it.
       ------------------------------------------------*/
-      if (error.value() != 995 )
+      if ( error != boost::asio::error::operation_aborted )
       {
         spdlog::error( error.message() );
       }
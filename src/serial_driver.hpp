@@ -12,29 +12,91 @@
 #define BUS_PIRATE_CPP_SERIAL_DRIVER_HPP
 
 /* C++ Includes */
-#include <string>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 /* Boost Includes */
 #include <boost/asio.hpp>
 #include <boost/regex.hpp>
+#include <boost/chrono.hpp>
 
 /* Chimera Includes */
 #include <Chimera/interface.hpp>
 #include <Chimera/threading.hpp>
 
+/* Module Includes */
+#include "delimiter.hpp"
+#include "ring_buffer.hpp"
+
 namespace HWInterface
 {
   class SerialDriver;
   typedef std::shared_ptr<SerialDriver> SerialDriver_sPtr;
   typedef std::unique_ptr<SerialDriver> SerialDriver_uPtr;
 
+  /**
+   *  Selects how SerialDriver::write() paces outgoing data
+   */
+  enum class PacingMode : uint8_t
+  {
+    NONE,        /**< Never wait on a write */
+    ADAPTIVE,    /**< Wait only when the bytes queued on the wire exceed the allowed backlog */
+    FIXED_DELAY, /**< Sleep a fixed amount after every write. Compatibility setting for slow targets. */
+  };
+
+  /**
+   *  Settings applied directly to the OS serial driver after the port is opened. These
+   *  only take effect on POSIX systems, where they map onto termios and ioctl calls.
+   */
+  struct NativePortOptions
+  {
+    bool exclusive;  /**< Stop other processes from opening the port while it is in use (TIOCEXCL) */
+    bool lowLatency; /**< Ask the driver to hand received data up immediately (ASYNC_LOW_LATENCY) */
+    uint8_t vmin;    /**< Bytes that must arrive before the port reports readable (VMIN). Never less than 1. */
+    uint8_t vtime;   /**< Inter-byte timeout for a raw mode read, in tenths of a second (VTIME) */
+
+    NativePortOptions() : exclusive( true ), lowLatency( true ), vmin( 1 ), vtime( 0 )
+    {
+    }
+  };
+
+  /**
+   *  Describes what happened to the USB-serial latency timer when the port was opened
+   */
+  struct LatencyTimerReport
+  {
+    bool found;           /**< A latency_timer node exists for this port */
+    bool changed;         /**< The timer was lowered and will be restored by end() */
+    uint32_t original_mS; /**< Value before the port was opened */
+    uint32_t current_mS;  /**< Value now in effect */
+    std::string path;     /**< The sysfs node that was used */
+
+    LatencyTimerReport() : found( false ), changed( false ), original_mS( 0 ), current_mS( 0 )
+    {
+    }
+  };
+
   class SerialDriver : public Chimera::Serial::Interface
   {
   public:
-    SerialDriver( std::string &device, const uint32_t delay_mS = 25 );
-    ~SerialDriver() = default;
+    /**
+     *  @param[in]  device      Name of the system serial port
+     *  @param[in]  delay_mS    If non-zero, selects PacingMode::FIXED_DELAY with this delay
+     */
+    SerialDriver( std::string &device, const uint32_t delay_mS = 0 );
+    ~SerialDriver();
 
+    /**
+     *  Opens the serial port. Passing anything other than Modes::BLOCKING for rxMode
+     *  starts the background I/O thread, see setMode().
+     */
     Chimera::Status_t begin( const Chimera::Serial::Modes txMode = Chimera::Serial::Modes::BLOCKING,
                              const Chimera::Serial::Modes rxMode = Chimera::Serial::Modes::BLOCKING ) noexcept override;
 
@@ -48,6 +110,18 @@ namespace HWInterface
 
     Chimera::Status_t setBaud( const uint32_t buad ) noexcept override;
 
+    /**
+     *  Switches the RX path between blocking and background operation. In background
+     *  mode a dedicated thread keeps a read posted on the port at all times and stores
+     *  the data in a lock-free ring buffer. read() and readUntil() then only consume
+     *  from the ring, waiting on a condition variable until the data arrives or the
+     *  timeout expires. write() hands its data to that thread as well, so only one
+     *  thread ever touches the port.
+     *
+     *  @param[in]  periph    Must be SubPeripheral::RX or SubPeripheral::TXRX
+     *  @param[in]  mode      Modes::BLOCKING for the classic path, anything else for background RX
+     *  @return Chimera::Status_t
+     */
     Chimera::Status_t setMode( const Chimera::Serial::SubPeripheral periph,
                                const Chimera::Serial::Modes mode ) noexcept override;
 
@@ -58,18 +132,35 @@ namespace HWInterface
 
 
     /**
-     *	Reads data from the serial port buffer until the regex is matched or the timeout expires.
-     *  Should the regex be matched, only data up to and including the regex will be returned. Any
-     *  remaining data will be left in the internal stream buffer to be read out at a later time.
+     *	Reads data from the serial port buffer until the delimiter is matched or the timeout expires.
+     *  Literal and prompt delimiters only examine newly received bytes on each update. A boost::regex
+     *  converts implicitly into a Delimiter and is still supported, but rescans the whole buffer.
+     *
+     *  In blocking mode any data received past the delimiter is also returned. In background mode
+     *  only data up to and including the delimiter is returned and the rest is kept for later reads.
      *	
      *	@param[out]	buffer        The vector to read into
-     *	@param[in]	expr          The regex expression to be matched in the read stream
-     *	@param[in]	timeout_mS    How long to wait for the regex to match before aborting
+     *	@param[in]	delimiter     The sequence to be matched in the read stream
+     *	@param[in]	timeout_mS    How long to wait for the delimiter to match before aborting
      *	@return Chimera::Status_t
      */
-     Chimera::Status_t readUntil( std::vector<uint8_t> &buffer, const boost::regex &expr,
+    Chimera::Status_t readUntil( std::vector<uint8_t> &buffer, const Delimiter &delimiter,
                                  const uint32_t timeout_mS = 500 ) noexcept;
 
+    /**
+     *	Reads whatever data has been received, up to length bytes. Waits up to the timeout
+     *  for something to arrive, but returns as soon as anything has. Suits data streams
+     *  with no framing to wait for, like a target's log output. Needs background RX.
+     *
+     *	@param[out]	buffer        Receives the data
+     *	@param[in]	length        Maximum number of bytes to read
+     *	@param[out]	received      Number of bytes actually read
+     *	@param[in]	timeout_mS    How long to wait for data to arrive
+     *	@return Chimera::Status_t: OK if anything was read, EMPTY if not, NOT_READY without background RX
+     */
+    Chimera::Status_t readSome( uint8_t *const buffer, const size_t length, size_t &received,
+                                const uint32_t timeout_mS = 500 ) noexcept;
+
     /**
      *	Checks if the serial port is open or not
      *
@@ -78,7 +169,8 @@ namespace HWInterface
     bool isOpen() noexcept;
 
     /**
-     *	Flushes the system TX and RX serial port buffers
+     *	Flushes the system TX and RX serial port buffers. On Windows this is PurgeComm(),
+     *  on POSIX systems tcflush(). Either way it is a single call into the OS driver.
      *
      *	@return bool: True if success, false if not
      */
@@ -92,10 +184,161 @@ namespace HWInterface
      */
     bool reset() noexcept;
 
+    /**
+     *	Selects the pacing engine used by write()
+     *
+     *	@param[in]	mode          The pacing mode to use
+     *	@param[in]	delay_mS      Delay applied after each write in PacingMode::FIXED_DELAY
+     *	@return void
+     */
+    void setPacing( const PacingMode mode, const uint32_t delay_mS = 0 ) noexcept;
+
+    /**
+     *	Sets how many bytes may be queued on the wire before PacingMode::ADAPTIVE
+     *  makes write() wait for the line to drain.
+     *
+     *	@param[in]	bytes         Allowed backlog in bytes
+     *	@return void
+     */
+    void setMaxTxBacklog( const size_t bytes ) noexcept;
+
+    /**
+     *	Calculates how long it takes to clock the given number of bytes out on the wire
+     *  with the current baud rate and frame format. Uses the calibrated byte time if
+     *  calibrate() has succeeded.
+     *
+     *	@param[in]	bytes         Number of bytes to transfer
+     *	@return uint64_t          Wire time in microseconds
+     */
+    uint64_t wireTime_uS( const size_t bytes ) const noexcept;
+
+    /**
+     *	Measures the real per-byte time and fixed turnaround latency of the link. Expects
+     *  the port to be in loopback (TX/RX shorted together) so every byte written is read back.
+     *
+     *	@param[in]	length        Number of bytes used for the long measurement
+     *	@param[in]	timeout_mS    How long to wait for each measurement to complete
+     *	@return Chimera::Status_t
+     */
+    Chimera::Status_t calibrate( const size_t length = 256, const uint32_t timeout_mS = 1000 ) noexcept;
+
+    /**
+     *	Gets the fixed turnaround latency measured by calibrate()
+     *
+     *	@return uint32_t          Latency in microseconds, zero if not calibrated
+     */
+    uint32_t getLatency_uS() const noexcept;
+
+    /**
+     *	Sets the options applied to the OS serial driver. Takes effect the next time the
+     *  port is opened or configured.
+     *
+     *	@param[in]	options       The options to apply
+     *	@return void
+     */
+    void setNativeOptions( const NativePortOptions &options ) noexcept;
+
+    /**
+     *	Checks if the OS driver accepted the ASYNC_LOW_LATENCY request. Not every
+     *  driver supports it (pseudo terminals and CDC-ACM devices usually don't).
+     *
+     *	@return True if active, false if not
+     */
+    bool isLowLatencyActive() const noexcept;
+
+    /**
+     *	Sets the value the USB-serial latency timer is lowered to when the port is opened.
+     *  FTDI chips default to 16 mS, which dominates every short command/response round trip.
+     *  Only supported on Linux, where the timer is exposed through sysfs.
+     *
+     *	@param[in]	timer_mS      Latency timer value, 0 leaves the timer alone
+     *	@return void
+     */
+    void setLatencyTimer( const uint32_t timer_mS ) noexcept;
+
+    /**
+     *	Sets where sysfs is mounted. Mainly useful to point the latency timer
+     *  tuning at a fake directory tree.
+     *
+     *	@param[in]	root          Path to the sysfs mount, "/sys" by default
+     *	@return void
+     */
+    void setSysfsRoot( const std::string &root ) noexcept;
+
+    /**
+     *	Reports what the latency timer tuning did the last time the port was opened
+     *
+     *	@return const LatencyTimerReport &
+     */
+    const LatencyTimerReport &getLatencyTimerReport() const noexcept;
+
+    /**
+     *	Gets the name of the serial port the driver was created with
+     *
+     *	@return const std::string &
+     */
+    const std::string &getPortName() const noexcept;
+
+    /**
+     *	Looks up the serial number of the USB device behind the port. Only available
+     *  on Linux, through sysfs.
+     *
+     *	@return std::string       The serial number, or empty if it can't be found
+     */
+    std::string getUSBSerialNumber() const noexcept;
+
+    /**
+     *	Sets the size of the RX ring used by the background I/O thread. Only takes
+     *  effect the next time background RX is started.
+     *
+     *	@param[in]	bytes         Ring size, rounded up to a power of two
+     *	@return void
+     */
+    void setRxBufferSize( const size_t bytes ) noexcept;
+
+    /**
+     *	Sets the size of the fixed length records the data arrives in, so a full RX ring
+     *  drops whole records instead of splitting one. Only takes effect the next time
+     *  background RX is started.
+     *
+     *	@param[in]	bytes         Record size, 1 for a plain byte stream
+     *	@return void
+     */
+    void setRxRecordSize( const size_t bytes ) noexcept;
+
+    /**
+     *	Checks if the background I/O thread is servicing the RX path
+     *
+     *	@return True if running, false if not
+     */
+    bool isBackgroundRxActive() const noexcept;
+
+    /**
+     *	Number of bytes the background I/O thread had to drop because the ring was full
+     *
+     *	@return size_t
+     */
+    size_t getRxOverflowCount() const noexcept;
+
   private:
     std::string serialDevice;
 
-    uint32_t ioDelay_mS; /**< Inserts a delay into IO operations so slower devices can keep up */
+    PacingMode pacing;
+    uint32_t ioDelay_mS;     /**< Delay used by PacingMode::FIXED_DELAY so slower devices can keep up */
+    size_t maxTxBacklog;     /**< Bytes allowed on the wire before PacingMode::ADAPTIVE waits */
+    uint32_t baudRate;       /**< Currently configured baud rate */
+    uint32_t frameHalfBits;  /**< Bits per character frame (start + data + parity + stop), in half bits */
+    uint64_t byteTime_nS;    /**< Calibrated time per byte, zero if not calibrated */
+    uint32_t latency_uS;     /**< Calibrated turnaround latency */
+
+    boost::chrono::steady_clock::time_point txDrainTime; /**< When the bytes already written will have left the wire */
+
+    NativePortOptions nativeOptions;
+    bool lowLatencyActive;
+
+    uint32_t latencyTimer_mS; /**< Target latency timer value, 0 if tuning is disabled */
+    std::string sysfsRoot;
+    LatencyTimerReport latencyReport;
 
 
     boost::asio::io_service io;
@@ -105,7 +348,47 @@ namespace HWInterface
 
     boost::asio::streambuf inputStream;
 
+    /*------------------------------------------------
+    Background RX path
+    ------------------------------------------------*/
+    static constexpr size_t RX_CHUNK_SIZE      = 4096;
+    static constexpr size_t RX_MAX_RECORD_SIZE = 16;
+
+    size_t rxRingSize;
+    size_t rxRecordSize;                             /**< Overflow only ever drops whole records of this size */
+    std::array<uint8_t, RX_MAX_RECORD_SIZE> rxCarry; /**< Start of a record the last read split */
+    size_t rxCarryLength;
+    std::unique_ptr<SPSCRingBuffer<uint8_t>> rxRing; /**< Filled by the I/O thread, drained by read()/readUntil() */
+    std::vector<uint8_t> rxPending;                  /**< Bytes pulled from the ring but not yet returned to a caller */
+    std::array<uint8_t, RX_CHUNK_SIZE> rxChunk;      /**< Landing zone for the continuously armed read */
+    std::thread ioThread;
+    bool rxBackground;                               /**< True when read()/readUntil() are served from the ring */
+    std::atomic<bool> ioThreadActive;                /**< True while the I/O thread is alive */
+    std::atomic<size_t> rxOverflow;
+    std::mutex rxMutex;
+    std::condition_variable rxSignal;
+
+    Chimera::Status_t startBackgroundRx() noexcept;
+    void stopBackgroundRx() noexcept;
+    void armBackgroundRead() noexcept;
+    void callback_backgroundRead( const boost::system::error_code &error, const size_t bytesTransferred ) noexcept;
+    size_t storeBackgroundRead( const size_t length ) noexcept;
+    boost::system::error_code backgroundWrite( const uint8_t *const buffer, const size_t length ) noexcept;
+    bool waitForRxData( const std::chrono::steady_clock::time_point &deadline ) noexcept;
+    void drainRxRing() noexcept;
+
+    Chimera::Status_t backgroundRead( uint8_t *const buffer, const size_t length, const uint32_t timeout_mS ) noexcept;
+    Chimera::Status_t backgroundReadUntil( std::vector<uint8_t> &buffer, const Delimiter &delimiter,
+                                           const uint32_t timeout_mS ) noexcept;
+
     Chimera::Status_t open() noexcept;
+    Chimera::Status_t configureNative() noexcept;
+    void releaseNative() noexcept;
+    void tuneLatencyTimer() noexcept;
+    void restoreLatencyTimer() noexcept;
+
+    void paceBeforeWrite( const size_t length ) noexcept;
+    void paceAfterWrite( const size_t length ) noexcept;
 
     void callback_readComplete( const boost::system::error_code &error, const size_t bytesTransferred ) noexcept;
     void callback_timeoutExpired( const boost::system::error_code &error ) noexcept;
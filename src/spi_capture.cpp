@@ -0,0 +1,206 @@
+/********************************************************************************
+ *   File Name:
+ *     spi_capture.cpp
+ *
+ *   Description:
+ *     Reads and writes SPI sniffer capture files
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+/* Driver Includes */
+#include "spi_capture.hpp"
+
+/* C++ Includes */
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    static constexpr std::array<char, 4> CAPTURE_MAGIC = { { 'B', 'P', 'S', 'C' } };
+    static constexpr uint8_t CAPTURE_VERSION           = 1;
+    static constexpr size_t CAPTURE_HEADER_SIZE        = 16;
+
+    /*------------------------------------------------
+    LEB128: seven bits per byte, least significant group first, with the top bit
+    set on every byte but the last
+    ------------------------------------------------*/
+    static void putVarint( std::vector<uint8_t> &out, uint64_t value )
+    {
+      while ( value >= 0x80 )
+      {
+        out.push_back( static_cast<uint8_t>( value | 0x80 ) );
+        value >>= 7;
+      }
+
+      out.push_back( static_cast<uint8_t>( value ) );
+    }
+
+    static bool getVarint( const std::vector<uint8_t> &in, size_t &offset, uint64_t &value )
+    {
+      value = 0;
+
+      for ( size_t shift = 0; ( shift < 64 ) && ( offset < in.size() ); shift += 7 )
+      {
+        const uint8_t byte = in[ offset++ ];
+        value |= static_cast<uint64_t>( byte & 0x7F ) << shift;
+
+        if ( !( byte & 0x80 ) )
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    bool SPICaptureWriter::open( const std::string &path, const uint8_t mode, const uint64_t epoch_uS )
+    {
+      close();
+
+      file.open( path, std::ios::binary | std::ios::trunc );
+
+      if ( !file.is_open() )
+      {
+        return false;
+      }
+
+      std::array<uint8_t, CAPTURE_HEADER_SIZE> header = {};
+      memcpy( header.data(), CAPTURE_MAGIC.data(), CAPTURE_MAGIC.size() );
+      header[ 4 ] = CAPTURE_VERSION;
+      header[ 5 ] = mode;
+
+      for ( size_t x = 0; x < sizeof( epoch_uS ); x++ )
+      {
+        header[ 8 + x ] = static_cast<uint8_t>( epoch_uS >> ( 8 * x ) );
+      }
+
+      file.write( reinterpret_cast<const char *>( header.data() ), header.size() );
+      written   = header.size();
+      lastStart = 0;
+
+      return file.good();
+    }
+
+    bool SPICaptureWriter::append( const SPITransaction &transaction )
+    {
+      if ( !file.is_open() || ( transaction.mosi.size() != transaction.miso.size() ) )
+      {
+        return false;
+      }
+
+      /*------------------------------------------------
+      The varints go through a reused scratch buffer, the data straight to the file
+      ------------------------------------------------*/
+      const uint64_t delta    = ( transaction.start_uS > lastStart ) ? ( transaction.start_uS - lastStart ) : 0;
+      const uint64_t duration = ( transaction.end_uS > transaction.start_uS ) ? ( transaction.end_uS - transaction.start_uS ) : 0;
+      const uint64_t length   = transaction.mosi.size();
+
+      record.clear();
+      putVarint( record, delta );
+      putVarint( record, duration );
+      putVarint( record, ( length << 1 ) | ( transaction.complete ? 1u : 0u ) );
+
+      file.write( reinterpret_cast<const char *>( record.data() ), static_cast<std::streamsize>( record.size() ) );
+      file.write( reinterpret_cast<const char *>( transaction.mosi.data() ), static_cast<std::streamsize>( length ) );
+      file.write( reinterpret_cast<const char *>( transaction.miso.data() ), static_cast<std::streamsize>( length ) );
+
+      written += record.size() + 2 * length;
+      lastStart = transaction.start_uS;
+
+      return file.good();
+    }
+
+    bool SPICaptureWriter::close()
+    {
+      bool result = true;
+
+      if ( file.is_open() )
+      {
+        file.flush();
+        result = file.good();
+        file.close();
+      }
+
+      return result;
+    }
+
+    bool SPICaptureWriter::isOpen() const
+    {
+      return file.is_open();
+    }
+
+    uint64_t SPICaptureWriter::bytesWritten() const
+    {
+      return written;
+    }
+
+    bool loadSPICapture( const std::string &path, std::vector<SPITransaction> &transactions, uint64_t &epoch_uS )
+    {
+      transactions.clear();
+      epoch_uS = 0;
+
+      std::ifstream file( path, std::ios::binary );
+
+      if ( !file.is_open() )
+      {
+        return false;
+      }
+
+      const std::vector<uint8_t> data( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+
+      if ( ( data.size() < CAPTURE_HEADER_SIZE ) || memcmp( data.data(), CAPTURE_MAGIC.data(), CAPTURE_MAGIC.size() )
+           || ( data[ 4 ] != CAPTURE_VERSION ) )
+      {
+        return false;
+      }
+
+      for ( size_t x = 0; x < sizeof( epoch_uS ); x++ )
+      {
+        epoch_uS |= static_cast<uint64_t>( data[ 8 + x ] ) << ( 8 * x );
+      }
+
+      size_t offset  = CAPTURE_HEADER_SIZE;
+      uint64_t start = 0;
+
+      while ( offset < data.size() )
+      {
+        uint64_t delta    = 0;
+        uint64_t duration = 0;
+        uint64_t length   = 0;
+
+        if ( !getVarint( data, offset, delta ) || !getVarint( data, offset, duration ) || !getVarint( data, offset, length ) )
+        {
+          return false;
+        }
+
+        const bool complete = ( length & 0x01 );
+        length >>= 1;
+
+        if ( ( data.size() - offset ) / 2 < length )
+        {
+          return false;
+        }
+
+        SPITransaction transaction;
+        start += delta;
+
+        transaction.start_uS = start;
+        transaction.end_uS   = start + duration;
+        transaction.complete = complete;
+        transaction.mosi.assign( data.begin() + offset, data.begin() + offset + length );
+        transaction.miso.assign( data.begin() + offset + length, data.begin() + offset + 2 * length );
+
+        offset += 2 * length;
+        transactions.push_back( std::move( transaction ) );
+      }
+
+      return true;
+    }
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
@@ -0,0 +1,122 @@
+/********************************************************************************
+ *   File Name:
+ *     spi_capture.hpp
+ *
+ *   Description:
+ *     Compact file format for SPI transactions recorded by the sniffer. A small
+ *     header is followed by one variable length record per transaction, so long
+ *     captures can be appended to as they are decoded and replayed offline.
+ *
+ *   2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+#pragma once
+#ifndef BUS_PIRATE_CPP_SPI_CAPTURE_HPP
+#define BUS_PIRATE_CPP_SPI_CAPTURE_HPP
+
+/* C++ Includes */
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace HWInterface
+{
+  namespace BusPirate
+  {
+    /**
+     *  One chip select frame seen on the bus
+     */
+    struct SPITransaction
+    {
+      uint64_t start_uS; /**< Host time the frame started, from the start of the capture */
+      uint64_t end_uS;   /**< Host time the frame ended, from the start of the capture */
+      bool complete;     /**< Both chip select edges were seen, not just one end of the frame */
+
+      std::vector<uint8_t> mosi;
+      std::vector<uint8_t> miso; /**< Always the same length as mosi */
+
+      SPITransaction()
+      {
+        start_uS = 0;
+        end_uS   = 0;
+        complete = false;
+      }
+    };
+
+    /**
+     *  Writes a capture file. Records are buffered and only guaranteed to be on disk
+     *  once the writer is closed.
+     *
+     *  The file starts with the magic "BPSC", a version byte, the sniffer command the
+     *  capture was made with, two reserved bytes and the wall clock start time in
+     *  microseconds since the Unix epoch (64-bit, little endian). Each record is then:
+     *
+     *  - the microseconds since the previous record started, as a LEB128 varint
+     *  - the frame's duration in microseconds, as a varint
+     *  - the byte count shifted up by one with the complete flag in bit 0, as a varint
+     *  - the MOSI bytes, then the MISO bytes
+     *
+     *  A typical transaction costs four or five bytes on top of its data, where the
+     *  sniffer's escaped stream spends a byte on every MOSI/MISO pair.
+     */
+    class SPICaptureWriter
+    {
+    public:
+      SPICaptureWriter()  = default;
+      ~SPICaptureWriter() = default;
+
+      /**
+       *	Creates the file, replacing anything already there, and writes the header
+       *
+       *	@param[in]	path          File to write
+       *	@param[in]	mode          Sniffer command the capture is made with
+       *	@param[in]	epoch_uS      Wall clock time the capture started, in microseconds since the Unix epoch
+       *	@return bool              True if the file was created, false if not
+       */
+      bool open( const std::string &path, const uint8_t mode, const uint64_t epoch_uS );
+
+      /**
+       *	Appends a transaction. Transactions must be appended in the order they started.
+       *
+       *	@param[in]	transaction   The transaction to append
+       *	@return bool              True if it was written, false if the file isn't open or writing failed
+       */
+      bool append( const SPITransaction &transaction );
+
+      /**
+       *	Flushes everything to disk and closes the file
+       *
+       *	@return bool              True if every record made it to disk, false if not
+       */
+      bool close();
+
+      bool isOpen() const;
+
+      /**
+       *	Size of the file so far, header included
+       *
+       *	@return uint64_t
+       */
+      uint64_t bytesWritten() const;
+
+    private:
+      std::ofstream file;
+      uint64_t written   = 0;
+      uint64_t lastStart = 0;
+      std::vector<uint8_t> record;
+    };
+
+    /**
+     *	Reads back a capture file
+     *
+     *	@param[in]	path          File to read
+     *	@param[out]	transactions  Receives every transaction in the file
+     *	@param[out]	epoch_uS      Receives the wall clock start time of the capture
+     *	@return bool              True if the whole file was read, false if it is missing, damaged or cut short
+     */
+    bool loadSPICapture( const std::string &path, std::vector<SPITransaction> &transactions, uint64_t &epoch_uS );
+
+  }  // namespace BusPirate
+}  // namespace HWInterface
+
+#endif /* !BUS_PIRATE_CPP_SPI_CAPTURE_HPP */
@@ -0,0 +1,165 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_1wire.cpp
+ *
+ *  Description:
+ *    Tests the binary 1-Wire interface. Expects a bus of DS18B20 temperature
+ *    sensors, at least one of them with its alarm flag set.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+static constexpr uint8_t DS18B20_FAMILY       = 0x28;
+static constexpr uint8_t DS18B20_READ_SCRATCH = 0xBE;
+static constexpr size_t DS18B20_SCRATCH_LEN   = 9;
+
+TEST_F( BusPirateFixture, EnterBinary1Wire )
+{
+  EXPECT_EQ( true, busPirate->bb1Wire() );
+  EXPECT_EQ( true, busPirate->resyncFraming() );
+  EXPECT_EQ( true, busPirate->reset() );
+}
+
+TEST( Binary1WireTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::Binary1Wire oneWire( busPirate );
+
+  HWInterface::BusPirate::OneWireSetup setup;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, oneWire.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, oneWire.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, oneWire.deInit() );
+}
+
+TEST( Binary1WireTest, Crc8 )
+{
+  /*------------------------------------------------
+  Example ROM code from Maxim application note 27
+  ------------------------------------------------*/
+  const std::array<uint8_t, 8> rom = { 0x02, 0x1C, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xA2 };
+
+  EXPECT_EQ( 0xA2, Binary1Wire::crc8( rom.data(), 7 ) );
+  EXPECT_EQ( 0x00, Binary1Wire::crc8( rom.data(), rom.size() ) );
+  EXPECT_EQ( 0x00, Binary1Wire::crc8( rom.data(), 0 ) );
+}
+
+TEST_F( Binary1WireFixture, SearchROM )
+{
+  std::vector<RomCode> roms;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, oneWire->searchROM( roms ) );
+  ASSERT_FALSE( roms.empty() );
+
+  for ( const auto &rom : roms )
+  {
+    EXPECT_EQ( 0, Binary1Wire::crc8( rom.data(), rom.size() ) );
+    EXPECT_EQ( DS18B20_FAMILY, rom[ 0 ] );
+  }
+
+  EXPECT_EQ( roms.size(), std::set<RomCode>( roms.begin(), roms.end() ).size() );
+
+  /*------------------------------------------------
+  Framing survives the variable length reply
+  ------------------------------------------------*/
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, oneWire->reset() );
+}
+
+TEST_F( Binary1WireFixture, SearchAlarm )
+{
+  std::vector<RomCode> roms;
+  std::vector<RomCode> alarms;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, oneWire->searchROM( roms ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, oneWire->searchAlarm( alarms ) );
+
+  EXPECT_FALSE( alarms.empty() );
+  EXPECT_LT( alarms.size(), roms.size() );
+
+  for ( const auto &rom : alarms )
+  {
+    EXPECT_NE( roms.end(), std::find( roms.begin(), roms.end(), rom ) );
+  }
+}
+
+TEST_F( Binary1WireFixture, ReadEveryScratchpad )
+{
+  using namespace std::chrono;
+
+  std::vector<RomCode> roms;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, oneWire->searchROM( roms ) );
+
+  std::vector<OneWireTransfer> transfers( roms.size() );
+  for ( size_t x = 0; x < roms.size(); x++ )
+  {
+    transfers[ x ].rom      = roms[ x ];
+    transfers[ x ].tx       = { DS18B20_READ_SCRATCH };
+    transfers[ x ].rxLength = DS18B20_SCRATCH_LEN;
+  }
+
+  /*------------------------------------------------
+  One stream for the whole bus. Each transfer spends about 13mS on the wire, and a
+  USB round trip for each of its 20 commands would roughly double that.
+  ------------------------------------------------*/
+  const auto start = steady_clock::now();
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, oneWire->transfer( transfers ) );
+  const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start );
+
+  for ( const auto &t : transfers )
+  {
+    ASSERT_EQ( DS18B20_SCRATCH_LEN, t.rx.size() );
+    EXPECT_EQ( 0, Binary1Wire::crc8( t.rx.data(), t.rx.size() ) );
+    EXPECT_NE( std::vector<uint8_t>( DS18B20_SCRATCH_LEN, 0xFF ), t.rx );
+  }
+
+  EXPECT_LT( elapsed.count(), static_cast<long long>( 25 * roms.size() ) );
+}
+
+TEST_F( Binary1WireFixture, SingleTransfer )
+{
+  std::vector<RomCode> roms;
+  std::array<uint8_t, DS18B20_SCRATCH_LEN> scratch;
+  const uint8_t cmd = DS18B20_READ_SCRATCH;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, oneWire->searchROM( roms ) );
+  ASSERT_FALSE( roms.empty() );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, oneWire->transfer( roms[ 0 ], &cmd, 1, scratch.data(), scratch.size() ) );
+  EXPECT_EQ( 0, Binary1Wire::crc8( scratch.data(), scratch.size() ) );
+
+  /*------------------------------------------------
+  Nothing answers to an unknown ID, so the bus reads idle
+  ------------------------------------------------*/
+  RomCode missing = roms[ 0 ];
+  missing[ 6 ] ^= 0xFF;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, oneWire->transfer( missing, &cmd, 1, scratch.data(), scratch.size() ) );
+  EXPECT_EQ( 0xFF, *std::min_element( scratch.begin(), scratch.end() ) );
+}
+
+TEST_F( Binary1WireFixture, InvalidParameters )
+{
+  uint8_t data = 0;
+  RomCode rom;
+  std::vector<OneWireTransfer> transfers;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->write( nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->write( &data, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->read( nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->transfer( rom, nullptr, 1, &data, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->transfer( rom, &data, 1, nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->transfer( transfers ) );
+
+  transfers.resize( 1 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, oneWire->transfer( transfers ) );
+}
@@ -0,0 +1,144 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_adc.cpp
+ *
+ *  Description:
+ *    Tests the voltage probe ADC interface. Expects the ADC pin on the 3.3V supply
+ *    pin, with the power supplies left on by a previous test or switched on by hand.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+static constexpr float RAIL_VOLTS     = 3.3f;
+static constexpr float RAIL_TOLERANCE = 0.1f;
+
+TEST( BinaryADCTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryADC adc( busPirate );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, adc.init() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, adc.init() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, adc.deInit() );
+}
+
+TEST( BinaryADCTest, ConvertAndSummarize )
+{
+  const std::array<uint16_t, 3> counts = { 0, 512, 1023 };
+  std::array<float, 3> volts;
+
+  BinaryADC::toVolts( counts.data(), volts.data(), counts.size() );
+  EXPECT_FLOAT_EQ( 0.0f, volts[ 0 ] );
+  EXPECT_FLOAT_EQ( 3.3f, volts[ 1 ] );
+  EXPECT_FLOAT_EQ( 1023.0f * 6.6f / 1024.0f, volts[ 2 ] );
+
+  /*------------------------------------------------
+  Seven samples make two windows of three, with one left over
+  ------------------------------------------------*/
+  const std::array<float, 7> samples = { 1.0f, 2.0f, 3.0f, 4.0f, 6.0f, 5.0f, 9.0f };
+  std::array<float, 2> averages;
+  std::array<ADCWindow, 2> windows;
+
+  ASSERT_EQ( 2u, BinaryADC::decimate( samples.data(), samples.size(), 3, averages.data() ) );
+  EXPECT_FLOAT_EQ( 2.0f, averages[ 0 ] );
+  EXPECT_FLOAT_EQ( 5.0f, averages[ 1 ] );
+
+  ASSERT_EQ( 2u, BinaryADC::summarize( samples.data(), samples.size(), 3, windows.data() ) );
+  EXPECT_FLOAT_EQ( 1.0f, windows[ 0 ].min );
+  EXPECT_FLOAT_EQ( 3.0f, windows[ 0 ].max );
+  EXPECT_FLOAT_EQ( 2.0f, windows[ 0 ].mean );
+  EXPECT_FLOAT_EQ( 4.0f, windows[ 1 ].min );
+  EXPECT_FLOAT_EQ( 6.0f, windows[ 1 ].max );
+  EXPECT_FLOAT_EQ( 5.0f, windows[ 1 ].mean );
+
+  EXPECT_EQ( 0u, BinaryADC::decimate( samples.data(), samples.size(), 0, averages.data() ) );
+  EXPECT_EQ( 0u, BinaryADC::summarize( samples.data(), 2, 3, windows.data() ) );
+}
+
+TEST_F( BinaryADCFixture, OneShotMeasurement )
+{
+  float volts = 0.0f;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, adc->measure( volts ) );
+  EXPECT_NEAR( RAIL_VOLTS, volts, RAIL_TOLERANCE );
+}
+
+TEST_F( BinaryADCFixture, StreamAtLinkRate )
+{
+  using namespace std::chrono;
+
+  static constexpr size_t SAMPLES = 3000;
+
+  std::vector<uint16_t> counts( SAMPLES );
+  size_t total    = 0;
+  size_t received = 0;
+
+  /*------------------------------------------------
+  Odd sized reads split readings across calls, which must not shift the stream
+  ------------------------------------------------*/
+  const auto start = steady_clock::now();
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, adc->startStream() );
+
+  while ( total < SAMPLES )
+  {
+    const size_t chunk = std::min<size_t>( 37, SAMPLES - total );
+
+    ASSERT_EQ( Chimera::CommonStatusCodes::OK, adc->read( counts.data() + total, chunk, received ) );
+    total += received;
+  }
+
+  const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, adc->stopStream() );
+
+  /*------------------------------------------------
+  Two bytes a reading, so at 115200 baud the link carries under 6000 a second
+  ------------------------------------------------*/
+  EXPECT_LT( elapsed.count(), 1500 );
+  EXPECT_EQ( 0u, adc->getOverflowCount() );
+
+  std::vector<float> volts( SAMPLES );
+  std::vector<ADCWindow> windows( SAMPLES / 100 );
+
+  BinaryADC::toVolts( counts.data(), volts.data(), SAMPLES );
+  ASSERT_EQ( windows.size(), BinaryADC::summarize( volts.data(), SAMPLES, 100, windows.data() ) );
+
+  for ( const auto &window : windows )
+  {
+    EXPECT_NEAR( RAIL_VOLTS, window.mean, RAIL_TOLERANCE );
+    EXPECT_GT( window.min, RAIL_VOLTS - RAIL_TOLERANCE );
+    EXPECT_LT( window.max, RAIL_VOLTS + RAIL_TOLERANCE );
+  }
+
+  /*------------------------------------------------
+  The link is back in step for one-shot measurements afterwards
+  ------------------------------------------------*/
+  float single = 0.0f;
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, adc->measure( single ) );
+  EXPECT_NEAR( RAIL_VOLTS, single, RAIL_TOLERANCE );
+}
+
+TEST_F( BinaryADCFixture, InvalidParameters )
+{
+  uint16_t counts = 0;
+  size_t received = 0;
+  float volts     = 0.0f;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_READY, adc->read( &counts, 1, received ) );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, adc->startStream() );
+  EXPECT_EQ( true, adc->isStreaming() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_READY, adc->measure( volts ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, adc->read( nullptr, 1, received ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, adc->read( &counts, 0, received ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, adc->stopStream() );
+  EXPECT_EQ( false, adc->isStreaming() );
+}
@@ -0,0 +1,168 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_i2c.cpp
+ *
+ *  Description:
+ *    Tests the binary I2C interface. Expects a 24LC256 style EEPROM on the bus at
+ *    address 0x50 and nothing at 0x51.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+static constexpr uint8_t EEPROM_ADDRESS  = 0x50;
+static constexpr uint8_t MISSING_ADDRESS = 0x51;
+
+/*------------------------------------------------
+The EEPROM doesn't acknowledge its address while it writes a page, which takes up
+to 5ms. Polling it with the address pointer for the next read is enough to tell
+when it's done.
+------------------------------------------------*/
+static constexpr std::chrono::milliseconds EEPROM_WRITE_CYCLE( 20 );
+
+static bool waitForWriteCycle( HWInterface::BusPirate::BinaryI2C *const i2c, const uint8_t *const address )
+{
+  const auto deadline = std::chrono::steady_clock::now() + EEPROM_WRITE_CYCLE;
+
+  do
+  {
+    if ( i2c->write( EEPROM_ADDRESS, address, 2 ) == Chimera::CommonStatusCodes::OK )
+    {
+      return true;
+    }
+  } while ( std::chrono::steady_clock::now() < deadline );
+
+  return false;
+}
+
+TEST_F( BusPirateFixture, EnterBinaryI2C )
+{
+  EXPECT_EQ( true, busPirate->bbI2C() );
+  EXPECT_EQ( true, busPirate->resyncFraming() );
+  EXPECT_EQ( true, busPirate->reset() );
+}
+
+TEST( BinaryI2CTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryI2C i2c( busPirate );
+
+  HWInterface::BusPirate::I2CSetup setup;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c.deInit() );
+}
+
+TEST_F( BinaryI2CFixture, ClockSetGet )
+{
+  using namespace HWInterface::BusPirate;
+
+  uint32_t freq = 0;
+
+  for ( auto speed : { I2C_SPEED_5kHz, I2C_SPEED_50kHz, I2C_SPEED_100kHz, I2C_SPEED_400kHz } )
+  {
+    EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c->setClockFrequency( speed, 0 ) );
+    EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c->getClockFrequency( freq ) );
+    EXPECT_EQ( static_cast<uint32_t>( speed ), freq );
+  }
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c->setClockFrequency( 120000, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c->getClockFrequency( freq ) );
+  EXPECT_EQ( static_cast<uint32_t>( I2C_SPEED_100kHz ), freq );
+}
+
+TEST_F( BinaryI2CFixture, RegisterWriteRead )
+{
+  /*------------------------------------------------
+  Short accesses: a single streamed transaction each, the read joined to the
+  address write with a repeated start
+  ------------------------------------------------*/
+  const std::array<uint8_t, 6> tx = { 0x01, 0x20, 0xDE, 0xAD, 0xBE, 0xEF };
+  const std::array<uint8_t, 2> reg = { 0x01, 0x20 };
+  std::array<uint8_t, 4> rx;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->write( EEPROM_ADDRESS, tx.data(), tx.size() ) );
+  ASSERT_EQ( true, waitForWriteCycle( i2c, reg.data() ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->writeRead( EEPROM_ADDRESS, reg.data(), reg.size(), rx.data(), rx.size() ) );
+  EXPECT_EQ( true, std::equal( rx.begin(), rx.end(), tx.begin() + 2 ) );
+}
+
+TEST_F( BinaryI2CFixture, EEPROMPageWriteRead )
+{
+  using namespace std::chrono;
+
+  std::vector<uint8_t> page( 2 + 64 );
+  page[ 0 ] = 0x02;
+  page[ 1 ] = 0x00;
+  std::iota( page.begin() + 2, page.end(), static_cast<uint8_t>( 0x40 ) );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->write( EEPROM_ADDRESS, page.data(), page.size() ) );
+  ASSERT_EQ( true, waitForWriteCycle( i2c, page.data() ) );
+
+  /*------------------------------------------------
+  A whole 256 byte block takes two commands, one to set the address pointer and
+  one to read
+  ------------------------------------------------*/
+  std::vector<uint8_t> rx( 256 );
+  auto start = steady_clock::now();
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->writeRead( EEPROM_ADDRESS, page.data(), 2, rx.data(), rx.size() ) );
+  auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start ).count();
+
+  EXPECT_EQ( true, std::equal( page.begin() + 2, page.end(), rx.begin() ) );
+  EXPECT_LT( elapsed, 100 );
+}
+
+TEST_F( BinaryI2CFixture, SlowClockStreams )
+{
+  using namespace HWInterface::BusPirate;
+
+  /*------------------------------------------------
+  At 5kHz the firmware falls well behind the link, so the transaction has to be
+  paced to keep its UART FIFO from overflowing
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->setClockFrequency( I2C_SPEED_5kHz, 0 ) );
+
+  const std::array<uint8_t, 12> tx = { 0x03, 0x00, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+  std::array<uint8_t, 10> rx;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->write( EEPROM_ADDRESS, tx.data(), tx.size() ) );
+  ASSERT_EQ( true, waitForWriteCycle( i2c, tx.data() ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, i2c->writeRead( EEPROM_ADDRESS, tx.data(), 2, rx.data(), rx.size() ) );
+  EXPECT_EQ( true, std::equal( rx.begin(), rx.end(), tx.begin() + 2 ) );
+}
+
+TEST_F( BinaryI2CFixture, MissingTargetNacks )
+{
+  using namespace std::chrono;
+
+  const std::array<uint8_t, 2> reg = { 0x00, 0x00 };
+  std::array<uint8_t, 32> rx;
+
+  /*------------------------------------------------
+  Every NACK is reported from the replies already on their way, without waiting
+  out a timeout or losing framing
+  ------------------------------------------------*/
+  auto start = steady_clock::now();
+  EXPECT_EQ( Chimera::CommonStatusCodes::FAIL, i2c->write( MISSING_ADDRESS, reg.data(), reg.size() ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::FAIL, i2c->writeRead( MISSING_ADDRESS, reg.data(), reg.size(), rx.data(), 4 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::FAIL, i2c->writeRead( MISSING_ADDRESS, reg.data(), reg.size(), rx.data(), rx.size() ) );
+
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 100 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, i2c->writeRead( EEPROM_ADDRESS, reg.data(), reg.size(), rx.data(), 4 ) );
+}
+
+TEST_F( BinaryI2CFixture, InvalidParameters )
+{
+  uint8_t data = 0;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, i2c->write( 0x80, &data, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, i2c->write( EEPROM_ADDRESS, nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, i2c->read( EEPROM_ADDRESS, &data, 0 ) );
+}
@@ -0,0 +1,240 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_jtag.cpp
+ *
+ *  Description:
+ *    Tests the binary OpenOCD JTAG interface. Expects a two device chain: a CPLD
+ *    with an 8-bit IR and a 64-bit boundary scan register on the TDI side, and the
+ *    JTAG-DP of a Cortex-M (4-bit IR) on the TDO side. The CPLD's boundary pins are
+ *    looped back, so a SAMPLE sees whatever EXTEST last drove.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <chrono>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+static constexpr uint32_t DP_IDCODE   = 0x4BA00477;
+static constexpr uint32_t CPLD_IDCODE = 0x16D4A093;
+
+/*------------------------------------------------
+Both instruction registers, the DP's shifted in first. The DP stays on IDCODE while
+the CPLD drives (EXTEST) or samples (SAMPLE) its pins.
+------------------------------------------------*/
+static constexpr size_t CHAIN_IR_BITS = 12;
+static constexpr uint64_t IR_EXTEST   = 0x00E;
+static constexpr uint64_t IR_SAMPLE   = 0x03E;
+static constexpr size_t DP_DR_BITS    = 32;
+static constexpr size_t CPLD_BSR_BITS = 64;
+static constexpr size_t CHAIN_DR_BITS = DP_DR_BITS + CPLD_BSR_BITS;
+
+static std::vector<uint8_t> boundaryData( const uint64_t pins )
+{
+  std::vector<uint8_t> data( CHAIN_DR_BITS / 8, 0 );
+
+  for ( size_t x = 0; x < CPLD_BSR_BITS / 8; x++ )
+  {
+    data[ DP_DR_BITS / 8 + x ] = static_cast<uint8_t>( pins >> ( 8 * x ) );
+  }
+
+  return data;
+}
+
+static uint64_t boundaryPins( const std::vector<uint8_t> &tdo )
+{
+  uint64_t pins = 0;
+
+  for ( size_t x = 0; x < CPLD_BSR_BITS / 8; x++ )
+  {
+    pins |= static_cast<uint64_t>( tdo[ DP_DR_BITS / 8 + x ] ) << ( 8 * x );
+  }
+
+  return pins;
+}
+
+TEST_F( BusPirateFixture, EnterBinaryJTAG )
+{
+  EXPECT_EQ( true, busPirate->bbJTAG() );
+  EXPECT_EQ( true, busPirate->resyncFraming() );
+  EXPECT_EQ( true, busPirate->reset() );
+}
+
+TEST( BinaryJTAGTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryJTAG jtag( busPirate );
+
+  HWInterface::BusPirate::JTAGSetup setup;
+  jtag.setPowerUpDelay( 0 );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag.init( setup ) );
+  EXPECT_EQ( TAP_RESET, jtag.getState() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag.deInit() );
+}
+
+TEST_F( BinaryJTAGFixture, DetectChain )
+{
+  std::vector<uint32_t> idcodes;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->detectChain( idcodes ) );
+  ASSERT_EQ( 2u, idcodes.size() );
+  EXPECT_EQ( DP_IDCODE, idcodes[ 0 ] );
+  EXPECT_EQ( CPLD_IDCODE, idcodes[ 1 ] );
+  EXPECT_EQ( TAP_IDLE, jtag->getState() );
+}
+
+TEST_F( BinaryJTAGFixture, ShortestTMSPaths )
+{
+  JTAGSequence sequence;
+
+  /*------------------------------------------------
+  Test-Logic-Reset to Pause-DR is five clocks
+  ------------------------------------------------*/
+  sequence.goTo( TAP_DR_PAUSE );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->compile( sequence ) );
+  EXPECT_EQ( 5u, sequence.clockCycles() );
+
+  /*------------------------------------------------
+  One clock to Run-Test/Idle, four to Shift-IR, the scan, then two back to idle
+  ------------------------------------------------*/
+  sequence.clear();
+  sequence.goTo( TAP_IDLE ).scanIRBits( IR_EXTEST, CHAIN_IR_BITS );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->compile( sequence ) );
+  EXPECT_EQ( 1u + 4u + CHAIN_IR_BITS + 2u, sequence.clockCycles() );
+
+  /*------------------------------------------------
+  Pause-DR straight back into Shift-DR takes two clocks, not a trip through idle
+  ------------------------------------------------*/
+  sequence.clear();
+  sequence.scanDRBits( 0, 8, false, TAP_DR_PAUSE ).scanDRBits( 0, 8 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->compile( sequence ) );
+  EXPECT_EQ( 4u + 8u + 1u + 2u + 8u + 2u, sequence.clockCycles() );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->run( sequence ) );
+  EXPECT_EQ( TAP_IDLE, jtag->getState() );
+}
+
+TEST_F( BinaryJTAGFixture, ScanContinuesInShiftState )
+{
+  JTAGSequence sequence;
+
+  /*------------------------------------------------
+  Reading the DP's IDCODE in two halves is the same as reading it in one
+  ------------------------------------------------*/
+  sequence.reset().scanDRBits( ~0ull, 16, true, TAP_DR_SHIFT ).scanDRBits( ~0ull, 16, true );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->run( sequence ) );
+  ASSERT_EQ( 2u, sequence.results().size() );
+  EXPECT_EQ( DP_IDCODE, sequence.result( 0 ) | ( sequence.result( 1 ) << 16 ) );
+}
+
+TEST_F( BinaryJTAGFixture, BoundaryScanLoopback )
+{
+  const uint64_t pattern = 0x0123456789ABCDEFull;
+  const auto drive       = boundaryData( pattern );
+  const auto none        = boundaryData( 0 );
+
+  JTAGSequence sequence;
+  sequence.scanIRBits( IR_EXTEST, CHAIN_IR_BITS, true ).scanDR( drive.data(), CHAIN_DR_BITS );
+  sequence.scanIRBits( IR_SAMPLE, CHAIN_IR_BITS ).scanDR( none.data(), CHAIN_DR_BITS, true );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->run( sequence ) );
+  ASSERT_EQ( 2u, sequence.results().size() );
+
+  /*------------------------------------------------
+  Every instruction register captures 0b..01
+  ------------------------------------------------*/
+  EXPECT_EQ( 0x011u, sequence.result( 0 ) );
+  EXPECT_EQ( pattern, boundaryPins( sequence.results()[ 1 ] ) );
+}
+
+TEST_F( BinaryJTAGFixture, PipelinedBoundarySweep )
+{
+  using namespace std::chrono;
+
+  static constexpr size_t SCANS = 200;
+
+  /*------------------------------------------------
+  Walk a one across the pins. Each EXTEST scan captures what the scan before it drove.
+  ------------------------------------------------*/
+  JTAGSequence sequence;
+  sequence.scanIRBits( IR_EXTEST, CHAIN_IR_BITS );
+
+  for ( size_t x = 0; x < SCANS; x++ )
+  {
+    const auto drive = boundaryData( 1ull << ( x % CPLD_BSR_BITS ) );
+    sequence.scanDR( drive.data(), CHAIN_DR_BITS, true );
+  }
+
+  /*------------------------------------------------
+  Over 20k clocks fit in three shift commands
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->compile( sequence ) );
+  EXPECT_EQ( 3u * 3u + 2u * ( ( sequence.clockCycles() + 7 ) / 8 ), sequence.txBytes() );
+
+  /*------------------------------------------------
+  About 5KB each way on the link. A round trip per scan would take several times longer.
+  ------------------------------------------------*/
+  const auto start = steady_clock::now();
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->run( sequence ) );
+  const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start );
+
+  ASSERT_EQ( SCANS, sequence.results().size() );
+  for ( size_t x = 1; x < SCANS; x++ )
+  {
+    EXPECT_EQ( 1ull << ( ( x - 1 ) % CPLD_BSR_BITS ), boundaryPins( sequence.results()[ x ] ) );
+  }
+
+  EXPECT_LT( elapsed.count(), 1500 );
+}
+
+TEST_F( BinaryJTAGFixture, ResetLines )
+{
+  JTAGSequence sequence;
+  sequence.goTo( TAP_IR_PAUSE );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, jtag->run( sequence ) );
+  EXPECT_EQ( TAP_IR_PAUSE, jtag->getState() );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag->cfgTRST( true ) );
+  EXPECT_EQ( TAP_RESET, jtag->getState() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag->cfgTRST( false ) );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag->cfgSRST( true ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag->cfgSRST( false ) );
+
+  std::vector<uint32_t> idcodes;
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, jtag->detectChain( idcodes ) );
+  EXPECT_EQ( 2u, idcodes.size() );
+}
+
+TEST_F( BinaryJTAGFixture, InvalidParameters )
+{
+  JTAGSequence sequence;
+
+  sequence.scanDR( nullptr, 8 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, jtag->run( sequence ) );
+
+  sequence.clear();
+  sequence.scanDRBits( 0, 65 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, jtag->run( sequence ) );
+
+  sequence.clear();
+  sequence.scanIRBits( 0, 0 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, jtag->run( sequence ) );
+
+  sequence.clear();
+  sequence.goTo( TAP_DR_EXIT1 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, jtag->compile( sequence ) );
+
+  sequence.clear();
+  sequence.idle( 0 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, jtag->compile( sequence ) );
+
+  EXPECT_EQ( TAP_RESET, jtag->getState() );
+}
@@ -0,0 +1,178 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_rawwire.cpp
+ *
+ *  Description:
+ *    Tests the binary raw-wire interface. Expects a 74HC595 style shift register
+ *    clocked by CLK with MOSI on its serial input and its serial output (QH') on
+ *    MISO, so every bit written comes back eight clocks later.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <array>
+#include <numeric>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+TEST_F( BusPirateFixture, EnterBinaryRawWire )
+{
+  EXPECT_EQ( true, busPirate->bbRawWire() );
+  EXPECT_EQ( true, busPirate->resyncFraming() );
+  EXPECT_EQ( true, busPirate->reset() );
+}
+
+TEST( BinaryRawWireTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryRawWire rawWire( busPirate );
+
+  HWInterface::BusPirate::RawWireSetup setup;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, rawWire.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, rawWire.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, rawWire.deInit() );
+}
+
+TEST_F( BinaryRawWireFixture, CompilesToDensestCommands )
+{
+  const std::array<uint8_t, 2> data = { 0x12, 0x34 };
+  RawWireSequence sequence;
+
+  /*------------------------------------------------
+  35 ticks fit in three bulk tick commands
+  ------------------------------------------------*/
+  sequence.tick( 5 ).tick( 30 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->compile( sequence ) );
+  EXPECT_EQ( 3u, sequence.txBytes() );
+
+  /*------------------------------------------------
+  Fields that add up to whole bytes become a single bulk write
+  ------------------------------------------------*/
+  sequence.clear();
+  sequence.writeBits( 0x5, 3 ).writeBytes( data.data(), data.size() ).writeBits( 0x1F, 5 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->compile( sequence ) );
+  EXPECT_EQ( 4u, sequence.txBytes() );
+
+  /*------------------------------------------------
+  Only the odd bits left over need a bulk bits command
+  ------------------------------------------------*/
+  sequence.writeBits( 0x3, 3 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->compile( sequence ) );
+  EXPECT_EQ( 6u, sequence.txBytes() );
+
+  /*------------------------------------------------
+  3-wire reads use bulk writes, 16 bytes at a time
+  ------------------------------------------------*/
+  sequence.clear();
+  sequence.readBytes( 20 ).readBits( 2 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->compile( sequence ) );
+  EXPECT_EQ( 17u + 5u + 2u, sequence.txBytes() );
+
+  /*------------------------------------------------
+  Reads share a bulk write with the writes around them
+  ------------------------------------------------*/
+  sequence.clear();
+  sequence.writeBits( 0xA5, 8 ).readBits( 8 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->compile( sequence ) );
+  EXPECT_EQ( 3u, sequence.txBytes() );
+}
+
+TEST_F( BinaryRawWireFixture, BitsComeBackThroughShiftRegister )
+{
+  const std::array<uint8_t, 2> data = { 0x12, 0x34 };
+  RawWireSequence sequence;
+
+  sequence.writeBits( 0xA, 4 ).writeBits( 0x5, 4 ).readBits( 8 );
+  sequence.writeBytes( data.data(), data.size() ).readBytes( 1 );
+  sequence.writeBits( 0x1, 1 ).writeBits( 0x2E, 7 ).readBits( 3 ).readBits( 5 );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->run( sequence ) );
+  ASSERT_EQ( 3u, sequence.bits().size() );
+  ASSERT_EQ( 1u, sequence.bytes().size() );
+
+  EXPECT_EQ( 0xA5u, sequence.bits()[ 0 ] );
+  EXPECT_EQ( 0x34, sequence.bytes()[ 0 ] );
+  EXPECT_EQ( 0x5u, sequence.bits()[ 1 ] );
+  EXPECT_EQ( 0x0Eu, sequence.bits()[ 2 ] );
+
+  /*------------------------------------------------
+  A compiled sequence can be run again as is
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->run( sequence ) );
+  EXPECT_EQ( 0xA5u, sequence.bits()[ 0 ] );
+}
+
+TEST_F( BinaryRawWireFixture, BitOrderChangeRecompiles )
+{
+  RawWireSequence sequence;
+  sequence.writeBits( 0x0F, 8 ).readBits( 4 ).readBits( 4 );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->run( sequence ) );
+  EXPECT_EQ( 0x0u, sequence.bits()[ 0 ] );
+  EXPECT_EQ( 0xFu, sequence.bits()[ 1 ] );
+
+  /*------------------------------------------------
+  LSB first, the low nibble goes out and comes back first
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->cfgBitOrder( true ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->run( sequence ) );
+  EXPECT_EQ( 0xFu, sequence.bits()[ 0 ] );
+  EXPECT_EQ( 0x0u, sequence.bits()[ 1 ] );
+}
+
+TEST_F( BinaryRawWireFixture, BlockWriteRead )
+{
+  std::vector<uint8_t> tx( 1000 );
+  std::vector<uint8_t> rx( tx.size() );
+  std::iota( tx.begin(), tx.end(), static_cast<uint8_t>( 0 ) );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, rawWire->write( tx.data(), tx.size() ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, rawWire->read( rx.data(), 1 ) );
+  EXPECT_EQ( tx.back(), rx[ 0 ] );
+
+  /*------------------------------------------------
+  Reads shift ones in behind them
+  ------------------------------------------------*/
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, rawWire->read( rx.data(), rx.size() ) );
+  EXPECT_EQ( std::vector<uint8_t>( rx.size(), 0xFF ), rx );
+}
+
+TEST_F( BinaryRawWireFixture, TwoWireMode )
+{
+  RawWireSequence sequence;
+  sequence.start().writeBits( 0xA5, 8 ).readBytes( 4 ).stop();
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->cfgThreeWire( false ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, rawWire->run( sequence ) );
+
+  /*------------------------------------------------
+  Reads go a byte at a time without the separate data input
+  ------------------------------------------------*/
+  EXPECT_EQ( 1u + 2u + 4u + 1u, sequence.txBytes() );
+  EXPECT_EQ( 4u, sequence.bytes().size() );
+}
+
+TEST_F( BinaryRawWireFixture, InvalidParameters )
+{
+  uint8_t data = 0;
+  RawWireSequence sequence;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, rawWire->write( nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, rawWire->write( &data, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, rawWire->read( nullptr, 1 ) );
+
+  sequence.writeBits( 0, 33 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, rawWire->run( sequence ) );
+
+  sequence.clear();
+  sequence.readBits( 0 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, rawWire->run( sequence ) );
+
+  sequence.clear();
+  sequence.tick( 0 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, rawWire->compile( sequence ) );
+}
@@ -3,14 +3,22 @@
  *    bp_test_binary_spi.cpp
  *
  *  Description:
- *    Tests the binary SPI interface to ensure that it works properly
+ *    Tests the binary SPI interface to ensure that it works properly. Transfers are
+ *    checked with MISO looped back to MOSI. The sniffer capture test instead needs
+ *    a target that keeps clocking numbered frames, answering each byte with its
+ *    inverse, and only runs with BP_SPI_RIG=sniffer.
  *
  *  2019 | Brandon Braun | brandonbraun653@gmail.com
  ********************************************************************************/
 
 #include <random>
 #include <algorithm>
+#include <chrono>
 #include <functional>
+#include <numeric>
+#include <thread>
+
+#include <boost/filesystem.hpp>
 
 #include "bp_test_fixtures.hpp"
 
@@ -25,6 +33,141 @@ TEST_F( BusPirateFixture, ResetFromBinarySPI )
   EXPECT_EQ( true, busPirate->reset() );
 }
 
+TEST_F( BusPirateFixture, ResetTakesDirectExit )
+{
+  using namespace std::chrono;
+
+  /*------------------------------------------------
+  Each tracked mode exits without trying the terminal first,
+  which alone would spend over 200ms pinging the prompt
+  ------------------------------------------------*/
+  ASSERT_EQ( true, busPirate->bbEnterSPI() );
+  auto start = steady_clock::now();
+  EXPECT_EQ( true, busPirate->reset() );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 150 );
+
+  ASSERT_EQ( true, busPirate->bbInit() );
+  start = steady_clock::now();
+  EXPECT_EQ( true, busPirate->reset() );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 150 );
+
+  start = steady_clock::now();
+  EXPECT_EQ( true, busPirate->reset() );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 150 );
+}
+
+TEST_F( BusPirateFixture, StrictFramingResync )
+{
+  using namespace HWInterface::BusPirate;
+
+  ASSERT_EQ( true, busPirate->bbEnterSPI() );
+  EXPECT_EQ( FramingMode::STRICT, busPirate->getFramingMode() );
+
+  /*------------------------------------------------
+  Chip select commands answer with exactly one byte
+  ------------------------------------------------*/
+  auto rx = busPirate->sendResponsiveCommand( { 0x02 }, 1 );
+  EXPECT_EQ( 0x01, rx[ 0 ] );
+
+  /*------------------------------------------------
+  Asking for more than the device owes loses framing, which must be recovered
+  ------------------------------------------------*/
+  busPirate->sendResponsiveCommand( { 0x03 }, 2 );
+  EXPECT_EQ( 1u, busPirate->getFramingErrors() );
+  EXPECT_EQ( true, busPirate->resyncFraming() );
+
+  rx = busPirate->sendResponsiveCommand( { 0x03 }, 1 );
+  EXPECT_EQ( 0x01, rx[ 0 ] );
+}
+
+TEST_F( BusPirateFixture, CommandBatchPipelines )
+{
+  using namespace HWInterface::BusPirate;
+
+  ASSERT_EQ( true, busPirate->bbEnterSPI() );
+
+  CommandBatch batch;
+  auto csLow  = batch.add( { 0x02 }, 1 );
+  auto bulk   = batch.add( { 0x11, 0xA5, 0x5A }, 3 );
+  auto csHigh = batch.add( { 0x03 }, 1 );
+  auto query  = batch.add( { 0x01 }, 4, false );
+
+  EXPECT_EQ( 4u, batch.size() );
+  EXPECT_EQ( 9u, batch.rxBytes() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, busPirate->execute( batch ) );
+  EXPECT_EQ( true, batch.ok() );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, batch.reply( csLow ).status );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, batch.reply( csHigh ).status );
+  EXPECT_EQ( 3u, batch.reply( bulk ).length );
+  EXPECT_EQ( "SPI1", std::string( batch.reply( query ).data, batch.reply( query ).data + 4 ) );
+  EXPECT_EQ( 0u, busPirate->getFramingErrors() );
+}
+
+TEST_F( BusPirateFixture, CommandBatchWindowed )
+{
+  using namespace HWInterface::BusPirate;
+
+  ASSERT_EQ( true, busPirate->bbEnterSPI() );
+
+  /*------------------------------------------------
+  A window smaller than a single command still sends every command
+  ------------------------------------------------*/
+  CommandBatch batch;
+  for ( auto x = 0; x < 10; x++ )
+  {
+    batch.add( { 0x02 }, 1 );
+    batch.add( { 0x03 }, 1 );
+  }
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, busPirate->execute( batch, 1 ) );
+  EXPECT_EQ( true, batch.ok() );
+}
+
+TEST_F( BusPirateFixture, StreamRunsAheadOfReplies )
+{
+  using namespace HWInterface::BusPirate;
+
+  REQUIRE_SPI_RIG( SPI_RIG_LOOPBACK );
+
+  ASSERT_EQ( true, busPirate->bbEnterSPI() );
+
+  /*------------------------------------------------
+  A window smaller than a single command still streams every byte through
+  ------------------------------------------------*/
+  CommandBatch batch;
+  batch.add( { 0x02 }, 1 );
+  auto bulk = batch.add( { 0x13, 0x01, 0x02, 0x03, 0x04 }, 5 );
+  batch.add( { 0x03 }, 1 );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, busPirate->stream( batch, 3 ) );
+  EXPECT_EQ( true, batch.ok() );
+  EXPECT_EQ( std::vector<uint8_t>( { 0x01, 0x01, 0x02, 0x03, 0x04 } ),
+             std::vector<uint8_t>( batch.reply( bulk ).data, batch.reply( bulk ).data + batch.reply( bulk ).length ) );
+
+  /*------------------------------------------------
+  Commands that don't answer byte for byte can't be streamed
+  ------------------------------------------------*/
+  CommandBatch uneven;
+  uneven.add( { 0x01 }, 4, false );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, busPirate->stream( uneven ) );
+}
+
+TEST( CommandBatchTest, ReplyBeforeExecute )
+{
+  HWInterface::BusPirate::CommandBatch batch;
+  auto index = batch.add( { 0x02 }, 1 );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::FAIL, batch.reply( index ).status );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, batch.reply( index + 1 ).status );
+  EXPECT_EQ( false, batch.ok() );
+
+  batch.clear();
+  EXPECT_EQ( 0u, batch.size() );
+  EXPECT_EQ( 0u, batch.txBytes() );
+}
+
 TEST( BinarySPITest, initialization )
 {
   HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
@@ -36,6 +179,36 @@ TEST( BinarySPITest, initialization )
   EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi.deInit() );
 }
 
+TEST( BinarySPITest, ReinitFastPath )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinarySPI spi( busPirate );
+
+  Chimera::SPI::Setup setup;
+
+  /*------------------------------------------------
+  The first init starts from the prompt open() left behind. It gets to bit bang
+  mode without a reset, so the power-up delay is most of what it costs.
+  ------------------------------------------------*/
+  spi.setPowerUpDelay( 10 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi.init( setup ) );
+  EXPECT_LT( spi.getInitLatency_uS(), 60000u );
+
+  /*------------------------------------------------
+  The second init finds SPI mode and the configuration already in place
+  ------------------------------------------------*/
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi.init( setup ) );
+  EXPECT_LT( spi.getInitLatency_uS(), 50000u );
+
+  /*------------------------------------------------
+  A different clock mode only costs the register that changed
+  ------------------------------------------------*/
+  setup.clockMode = Chimera::SPI::ClockMode::MODE3;
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi.init( setup ) );
+  EXPECT_LT( spi.getInitLatency_uS(), 50000u );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi.deInit() );
+}
+
 TEST_F( BinarySPIFixture, ConfigPWR )
 {
   EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgPowerSupplies( true ) );
@@ -78,6 +251,33 @@ TEST_F( BinarySPIFixture, ConfigCLK_EDGE )
   EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgSPIClkEdge( false ) );
 }
 
+TEST_F( BinarySPIFixture, ConfigStagedCommit )
+{
+  using namespace HWInterface::BusPirate;
+
+  uint32_t freq = 0;
+
+  /*------------------------------------------------
+  Nothing is applied until the commit
+  ------------------------------------------------*/
+  spi->stageConfig();
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgSPIClkIdle( true ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgSPIClkEdge( false ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgAuxPin( true ) );
+  EXPECT_EQ( Chimera::SPI::Status::CLOCK_SET_EQ, spi->setClockFrequency( SPEED_1MHz, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->commitConfig() );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->getClockFrequency( freq ) );
+  EXPECT_EQ( SPEED_1MHz, freq );
+
+  /*------------------------------------------------
+  Writes that change nothing still succeed
+  ------------------------------------------------*/
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->commitConfig() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgSPIClkIdle( true ) );
+  EXPECT_EQ( Chimera::SPI::Status::CLOCK_SET_EQ, spi->setClockFrequency( SPEED_1MHz, 0 ) );
+}
+
 TEST_F( BinarySPIFixture, ClockSetGetExact )
 {
   using namespace HWInterface::BusPirate;
@@ -276,7 +476,7 @@ TEST_F( BinarySPIFixture, ClockSetGetImprecise )
   EXPECT_EQ( SPEED_8MHz, actual_clock );
 }
 
-TEST_F( BinarySPIFixture, WriteReadSmallAmount )
+TEST_F( SPILoopbackFixture, WriteReadSmallAmount )
 {
   using namespace HWInterface::BusPirate;
   using namespace Chimera;
@@ -290,7 +490,7 @@ TEST_F( BinarySPIFixture, WriteReadSmallAmount )
   EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
 }
 
-TEST_F( BinarySPIFixture, WriteReadLargeAmount )
+TEST_F( SPILoopbackFixture, WriteReadLargeAmount )
 {
   using namespace HWInterface::BusPirate;
   using namespace Chimera;
@@ -313,7 +513,7 @@ TEST_F( BinarySPIFixture, WriteReadLargeAmount )
   EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
 }
 
-TEST_F( BinarySPIFixture, WriteReadGinormousAmount )
+TEST_F( SPILoopbackFixture, WriteReadGinormousAmount )
 {
   using namespace HWInterface::BusPirate;
   using namespace Chimera;
@@ -334,4 +534,242 @@ TEST_F( BinarySPIFixture, WriteReadGinormousAmount )
 
   EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readWriteBytes( writeData.data(), readData.data(), len ) );
   EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
-}
\ No newline at end of file
+}
+
+TEST_F( SPILoopbackFixture, WriteReadSlowClock )
+{
+  using namespace Chimera;
+
+  /*------------------------------------------------
+  At 30kHz the firmware is slower than the UART, so the stream has to throttle itself
+  ------------------------------------------------*/
+  std::vector<uint8_t> writeData( 200 );
+  std::vector<uint8_t> readData( writeData.size(), 0 );
+  std::iota( writeData.begin(), writeData.end(), static_cast<uint8_t>( 0 ) );
+
+  EXPECT_EQ( Chimera::SPI::Status::CLOCK_SET_EQ, spi->setClockFrequency( HWInterface::BusPirate::SPEED_30kHz, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readWriteBytes( writeData.data(), readData.data(), writeData.size() ) );
+  EXPECT_EQ( writeData, readData );
+}
+
+TEST_F( BinarySPIFixture, WriteLargeAmount )
+{
+  using namespace Chimera;
+
+  /*------------------------------------------------
+  Spans more than one write-then-read segment
+  ------------------------------------------------*/
+  std::vector<uint8_t> writeData( 5000 );
+  std::iota( writeData.begin(), writeData.end(), static_cast<uint8_t>( 0 ) );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->writeBytes( writeData.data(), writeData.size() ) );
+}
+
+TEST_F( SPILoopbackFixture, ReadLargeAmount )
+{
+  using namespace Chimera;
+
+  /*------------------------------------------------
+  With MISO looped back to MOSI, a read sees the 0xFF the firmware clocks out
+  ------------------------------------------------*/
+  std::vector<uint8_t> readData( 5000, 0 );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readBytes( readData.data(), readData.size() ) );
+  EXPECT_EQ( true, std::all_of( readData.begin(), readData.end(), []( uint8_t b ) { return b == 0xFF; } ) );
+}
+
+TEST_F( SPILoopbackFixture, ReadFillsWithOnesAtAnyLength )
+{
+  /*------------------------------------------------
+  Short reads go out as bulk transfers and long ones as many write-then-read
+  segments, but MOSI carries 0xFF either way
+  ------------------------------------------------*/
+  std::vector<uint8_t> shortRead( 8, 0 );
+  std::vector<uint8_t> longRead( 70000, 0 );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readBytes( shortRead.data(), shortRead.size() ) );
+  EXPECT_EQ( true, std::all_of( shortRead.begin(), shortRead.end(), []( uint8_t b ) { return b == 0xFF; } ) );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readBytes( longRead.data(), longRead.size() ) );
+  EXPECT_EQ( true, std::all_of( longRead.begin(), longRead.end(), []( uint8_t b ) { return b == 0xFF; } ) );
+}
+
+TEST_F( SPILoopbackFixture, ReadLargeAmountManualCS )
+{
+  using namespace Chimera;
+
+  std::vector<uint8_t> readData( 100, 0 );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, spi->setChipSelectControlMode( SPI::ChipSelectMode::MANUAL ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, spi->setChipSelect( GPIO::State::LOW ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readBytes( readData.data(), readData.size() ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->setChipSelect( GPIO::State::HIGH ) );
+  EXPECT_EQ( 0xFF, readData.back() );
+}
+
+TEST( SPICaptureTest, RoundTrip )
+{
+  using namespace HWInterface::BusPirate;
+
+  const auto path = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path( "bp-spi-%%%%%%.bpsc" ) ).string();
+
+  std::vector<SPITransaction> written( 3 );
+  written[ 0 ].start_uS = 10;
+  written[ 0 ].end_uS   = 250;
+  written[ 0 ].complete = true;
+  written[ 0 ].mosi     = { 0x9F, 0x00, 0x00, 0x00 };
+  written[ 0 ].miso     = { 0xFF, 0xEF, 0x40, 0x18 };
+  written[ 1 ].start_uS = 100000;
+  written[ 1 ].end_uS   = 100000;
+  written[ 1 ].complete = true;
+  written[ 2 ].start_uS = 5000000000ull;
+  written[ 2 ].end_uS   = 5000000300ull;
+  written[ 2 ].complete = false;
+  written[ 2 ].mosi.assign( 300, 0x5C );
+  written[ 2 ].miso.assign( 300, 0xA3 );
+
+  SPICaptureWriter writer;
+  ASSERT_EQ( true, writer.open( path, SNIFF_CS_LOW, 1234567890123456ull ) );
+
+  for ( const auto &transaction : written )
+  {
+    EXPECT_EQ( true, writer.append( transaction ) );
+  }
+
+  SPITransaction mismatched;
+  mismatched.mosi = { 0x01 };
+  EXPECT_EQ( false, writer.append( mismatched ) );
+
+  const uint64_t size = writer.bytesWritten();
+  EXPECT_EQ( true, writer.close() );
+  EXPECT_EQ( size, boost::filesystem::file_size( path ) );
+
+  std::vector<SPITransaction> loaded;
+  uint64_t epoch_uS = 0;
+
+  ASSERT_EQ( true, loadSPICapture( path, loaded, epoch_uS ) );
+  EXPECT_EQ( 1234567890123456ull, epoch_uS );
+  ASSERT_EQ( written.size(), loaded.size() );
+
+  for ( size_t x = 0; x < written.size(); x++ )
+  {
+    EXPECT_EQ( written[ x ].start_uS, loaded[ x ].start_uS );
+    EXPECT_EQ( written[ x ].end_uS, loaded[ x ].end_uS );
+    EXPECT_EQ( written[ x ].complete, loaded[ x ].complete );
+    EXPECT_EQ( written[ x ].mosi, loaded[ x ].mosi );
+    EXPECT_EQ( written[ x ].miso, loaded[ x ].miso );
+  }
+
+  /*------------------------------------------------
+  A file cut off partway through a record doesn't load
+  ------------------------------------------------*/
+  boost::filesystem::resize_file( path, size - 1 );
+  EXPECT_EQ( false, loadSPICapture( path, loaded, epoch_uS ) );
+
+  boost::filesystem::remove( path );
+}
+
+TEST_F( SPISnifferFixture, SnifferCapturesEveryFrame )
+{
+  using namespace HWInterface::BusPirate;
+
+  const auto path = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path( "bp-spi-%%%%%%.bpsc" ) ).string();
+
+  SnifferSetup setup;
+  setup.capturePath = path;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, spi->startSniffer( setup ) );
+  std::this_thread::sleep_for( std::chrono::seconds( 1 ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, spi->stopSniffer() );
+
+  std::vector<SPITransaction> queued;
+  const auto stats = spi->getSnifferStats();
+
+  ASSERT_LT( 10u, spi->readTransactions( queued ) );
+  EXPECT_EQ( stats.transactions, queued.size() );
+  EXPECT_EQ( 0u, stats.decodeErrors );
+  EXPECT_EQ( 0u, stats.overflowBytes );
+
+  /*------------------------------------------------
+  The target numbers its frames and answers each byte with its inverse. Every frame
+  but the one cut off by stopping is whole and follows on from the last.
+  ------------------------------------------------*/
+  uint16_t expected = 0;
+
+  for ( size_t x = 0; x < queued.size(); x++ )
+  {
+    const auto &frame = queued[ x ];
+
+    if ( x + 1 < queued.size() )
+    {
+      ASSERT_EQ( true, frame.complete );
+    }
+
+    ASSERT_EQ( frame.mosi.size(), frame.miso.size() );
+    ASSERT_LE( frame.start_uS, frame.end_uS );
+
+    if ( !frame.complete )
+    {
+      continue;
+    }
+
+    ASSERT_LE( 3u, frame.mosi.size() );
+    const uint16_t sequence = static_cast<uint16_t>( ( frame.mosi[ 1 ] << 8 ) | frame.mosi[ 2 ] );
+
+    if ( x )
+    {
+      EXPECT_EQ( expected, sequence );
+      EXPECT_LE( queued[ x - 1 ].end_uS, frame.start_uS );
+    }
+
+    EXPECT_EQ( 3u + ( sequence % 13 ), frame.mosi.size() );
+
+    for ( size_t y = 0; y < frame.mosi.size(); y++ )
+    {
+      EXPECT_EQ( static_cast<uint8_t>( ~frame.mosi[ y ] ), frame.miso[ y ] );
+    }
+
+    expected = sequence + 1;
+  }
+
+  /*------------------------------------------------
+  The file holds the same frames in less space than the escaped stream
+  ------------------------------------------------*/
+  std::vector<SPITransaction> loaded;
+  uint64_t epoch_uS = 0;
+
+  ASSERT_EQ( true, loadSPICapture( path, loaded, epoch_uS ) );
+  ASSERT_EQ( queued.size(), loaded.size() );
+  EXPECT_EQ( queued.back().mosi, loaded.back().mosi );
+  EXPECT_EQ( queued.back().start_uS, loaded.back().start_uS );
+  EXPECT_GT( stats.streamBytes, boost::filesystem::file_size( path ) );
+
+  boost::filesystem::remove( path );
+
+  /*------------------------------------------------
+  The bus is usable again afterwards
+  ------------------------------------------------*/
+  std::vector<uint8_t> readData( 8, 0 );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->readBytes( readData.data(), readData.size() ) );
+}
+
+TEST_F( BinarySPIFixture, SnifferBlocksBusAccess )
+{
+  using namespace HWInterface::BusPirate;
+
+  SnifferSetup setup;
+  std::vector<uint8_t> data( 4, 0 );
+
+  setup.ringSize = 0;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, spi->startSniffer( setup ) );
+
+  setup.ringSize = 64 * 1024;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, spi->startSniffer( setup ) );
+  EXPECT_EQ( true, spi->isSniffing() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_READY, spi->writeBytes( data.data(), data.size() ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_READY, spi->setChipSelect( Chimera::GPIO::State::LOW ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_READY, spi->cfgAuxPin( true ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->stopSniffer() );
+  EXPECT_EQ( false, spi->isSniffing() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, spi->cfgAuxPin( false ) );
+}
@@ -0,0 +1,139 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_swd.cpp
+ *
+ *  Description:
+ *    Tests the SWD engine. Expects a Cortex-M4 style target with SWDIO on both MOSI
+ *    and MISO, SWCLK on CLK, a MEM-AP at AP 0 and writable RAM at 0x20000000.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+static constexpr uint32_t TARGET_IDCODE = 0x2BA01477; /**< SW-DP of a Cortex-M3/M4 */
+static constexpr uint32_t TARGET_AP_IDR = 0x24770011; /**< AHB-AP of a Cortex-M4 */
+static constexpr uint32_t TARGET_RAM    = 0x20000000;
+static constexpr uint32_t TARGET_HOLE   = 0x5FFF0000; /**< Nothing is mapped here */
+
+TEST( BinarySWDTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinarySWD swd( busPirate );
+
+  HWInterface::BusPirate::SWDSetup setup;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, swd.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, swd.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, swd.deInit() );
+}
+
+TEST_F( BinarySWDFixture, ConnectReadsIDCODE )
+{
+  uint32_t idcode = 0;
+  uint32_t ctrl   = 0;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->connect( idcode ) );
+  EXPECT_EQ( TARGET_IDCODE, idcode );
+
+  /*------------------------------------------------
+  Both power domains acknowledged, with no sticky errors
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readDP( SWD_DP_CTRL_STAT, ctrl ) );
+  EXPECT_EQ( 0xA0000000u, ctrl & 0xA0000000u );
+  EXPECT_EQ( 0u, ctrl & 0x22u );
+}
+
+TEST_F( BinarySWDFixture, ReadAccessPort )
+{
+  uint32_t idr = 0;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readAP( 0, 0xFC, idr ) );
+  EXPECT_EQ( TARGET_AP_IDR, idr );
+
+  /*------------------------------------------------
+  Switching banks and back again
+  ------------------------------------------------*/
+  uint32_t csw = 0;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->writeAP( 0, 0x00, 0x23000012 ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readAP( 0, 0x00, csw ) );
+  EXPECT_EQ( 0x23000012u, csw & 0xFF0000FFu );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readAP( 0, 0xFC, idr ) );
+  EXPECT_EQ( TARGET_AP_IDR, idr );
+}
+
+TEST_F( BinarySWDFixture, MemoryRoundTrip )
+{
+  std::vector<uint32_t> tx( 300 );
+  std::vector<uint32_t> rx( tx.size() );
+  std::iota( tx.begin(), tx.end(), 0xC0DE0000 );
+
+  /*------------------------------------------------
+  Crosses a 1KB boundary, so the TAR has to be reloaded part way
+  ------------------------------------------------*/
+  const uint32_t address = TARGET_RAM + 0x3F0;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->writeMemory( address, tx.data(), tx.size() ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readMemory( address, rx.data(), rx.size() ) );
+  EXPECT_EQ( tx, rx );
+
+  uint32_t word = 0;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readMemory( address + 4, &word, 1 ) );
+  EXPECT_EQ( tx[ 1 ], word );
+}
+
+TEST_F( BinarySWDFixture, BlockReadThroughput )
+{
+  using namespace std::chrono;
+
+  std::vector<uint32_t> rx( 1024 );
+
+  /*------------------------------------------------
+  4KB is about 50k bits on the wire, or 125mS at 400kHz. A round trip per
+  transaction would take over 4 seconds.
+  ------------------------------------------------*/
+  const auto start = steady_clock::now();
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readMemory( TARGET_RAM, rx.data(), rx.size() ) );
+  const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start );
+
+  EXPECT_LT( elapsed.count(), 2000 );
+}
+
+TEST_F( BinarySWDFixture, FaultRecovery )
+{
+  uint32_t word = 0;
+  uint32_t ctrl = 0;
+  std::vector<uint32_t> rx( 4 );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::FAIL, swd->readMemory( TARGET_HOLE, rx.data(), rx.size() ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::FAIL, swd->writeMemory( TARGET_HOLE, rx.data(), rx.size() ) );
+
+  /*------------------------------------------------
+  The sticky flags were cleared, so the next access goes through
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, swd->readDP( SWD_DP_CTRL_STAT, ctrl ) );
+  EXPECT_EQ( 0u, ctrl & 0x22u );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, swd->writeMemory( TARGET_RAM, &ctrl, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, swd->readMemory( TARGET_RAM, &word, 1 ) );
+  EXPECT_EQ( ctrl, word );
+}
+
+TEST_F( BinarySWDFixture, InvalidParameters )
+{
+  uint32_t word = 0;
+  std::vector<SWDTransfer> transfers;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, swd->readMemory( TARGET_RAM, nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, swd->readMemory( TARGET_RAM, &word, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, swd->readMemory( TARGET_RAM + 2, &word, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, swd->writeMemory( TARGET_RAM, nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, swd->transfer( transfers ) );
+}
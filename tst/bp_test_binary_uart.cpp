@@ -0,0 +1,190 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_binary_uart.cpp
+ *
+ *  Description:
+ *    Tests the binary UART interface. Expects a target on the UART pins that sends
+ *    4096 bytes of a running byte counter each time RX echo starts, carrying on
+ *    from where the last burst stopped.
+ *    Bridge mode isn't covered since only unplugging the board gets it back.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <array>
+#include <numeric>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace Chimera::Serial;
+
+static bool isCounter( const uint8_t *const data, const size_t length )
+{
+  for ( size_t x = 1; x < length; x++ )
+  {
+    if ( static_cast<uint8_t>( data[ x - 1 ] + 1 ) != data[ x ] )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+TEST_F( BusPirateFixture, EnterBinaryUART )
+{
+  EXPECT_EQ( true, busPirate->bbUART() );
+  EXPECT_EQ( true, busPirate->resyncFraming() );
+  EXPECT_EQ( true, busPirate->reset() );
+}
+
+TEST( BinaryUARTTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryUART uart( busPirate );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart.begin() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart.begin() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart.end() );
+}
+
+TEST_F( BinaryUARTFixture, BaudRates )
+{
+  /*------------------------------------------------
+  Presets, then bauds that need the baud rate generator
+  ------------------------------------------------*/
+  for ( uint32_t baud : { 300u, 9600u, 31250u, 115200u, 100000u, 250000u, 1000000u } )
+  {
+    EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->setBaud( baud ) );
+    EXPECT_EQ( baud, uart->getBaud() );
+  }
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->setBaud( 74880 ) );
+  EXPECT_NEAR( 74880.0, static_cast<double>( uart->getBaud() ), 74880.0 * 0.02 );
+
+  /*------------------------------------------------
+  Out of range bauds leave the last one in place
+  ------------------------------------------------*/
+  const uint32_t baud = uart->getBaud();
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, uart->setBaud( 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, uart->setBaud( 30 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, uart->setBaud( 3000000 ) );
+  EXPECT_EQ( baud, uart->getBaud() );
+}
+
+TEST_F( BinaryUARTFixture, FrameFormat )
+{
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->configure( 57600, CharWid::CW_8BIT, Parity::PAR_EVEN, StopBits::SBITS_TWO ) );
+  EXPECT_EQ( 57600u, uart->getBaud() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->configure( 115200 ) );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_SUPPORTED,
+             uart->configure( 115200, CharWid::CW_8BIT, Parity::PAR_NONE, StopBits::SBITS_ONE_POINT_FIVE ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_SUPPORTED,
+             uart->configure( 115200, CharWid::CW_8BIT, Parity::PAR_NONE, StopBits::SBITS_ONE, FlowControl::FCTRL_HW ) );
+}
+
+TEST_F( BinaryUARTFixture, BulkWrite )
+{
+  std::vector<uint8_t> data( 1000 );
+  std::iota( data.begin(), data.end(), static_cast<uint8_t>( 0 ) );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->write( data.data(), data.size() ) );
+
+  /*------------------------------------------------
+  A slow target holds the stream back without losing framing
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setBaud( 9600 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->write( data.data(), 64 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->write( data.data(), 1 ) );
+}
+
+TEST_F( BinaryUARTFixture, EchoStreamsTargetOutput )
+{
+  std::vector<uint8_t> rx( 4096 );
+  uint8_t data = 0x55;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+  EXPECT_EQ( true, uart->isReceiving() );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->read( rx.data(), rx.size() ) );
+  EXPECT_EQ( true, isCounter( rx.data(), rx.size() ) );
+  EXPECT_EQ( 0u, uart->getRxOverflowCount() );
+
+  /*------------------------------------------------
+  The acks would corrupt the received data
+  ------------------------------------------------*/
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_READY, uart->write( &data, 1 ) );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setMode( SubPeripheral::RX, Modes::BLOCKING ) );
+  EXPECT_EQ( false, uart->isReceiving() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->write( &data, 1 ) );
+}
+
+TEST_F( BinaryUARTFixture, StoppingEchoKeepsReceivedData )
+{
+  std::vector<uint8_t> rx( 4096 );
+  size_t total    = 0;
+  size_t received = 0;
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->begin( Modes::BLOCKING, Modes::INTERRUPT ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->readSome( rx.data(), 16, received ) );
+  total += received;
+
+  /*------------------------------------------------
+  Everything that arrived ahead of the ack can still be read
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setMode( SubPeripheral::RX, Modes::BLOCKING ) );
+
+  while ( uart->readSome( rx.data() + total, rx.size() - total, received, 10 ) == Chimera::CommonStatusCodes::OK )
+  {
+    total += received;
+  }
+
+  EXPECT_EQ( rx.size(), total );
+  EXPECT_EQ( true, isCounter( rx.data(), total ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::EMPTY, uart->read( rx.data(), 1, 10 ) );
+}
+
+TEST_F( BinaryUARTFixture, ReconfigureDuringEcho )
+{
+  std::vector<uint8_t> rx( 8192 );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->read( rx.data(), 100 ) );
+
+  /*------------------------------------------------
+  The echo pauses around the change and carries on where it left off
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setBaud( 57600 ) );
+  EXPECT_EQ( true, uart->isReceiving() );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->read( rx.data() + 100, rx.size() - 100 ) );
+  EXPECT_EQ( true, isCounter( rx.data(), rx.size() ) );
+}
+
+TEST_F( BinaryUARTFixture, PartialReadIsNotLost )
+{
+  std::vector<uint8_t> rx( 8192 );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, uart->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+
+  /*------------------------------------------------
+  More than the target sends, so this times out part way
+  ------------------------------------------------*/
+  EXPECT_EQ( Chimera::CommonStatusCodes::TIMEOUT, uart->read( rx.data(), rx.size(), 50 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, uart->read( rx.data(), 4096 ) );
+  EXPECT_EQ( true, isCounter( rx.data(), 4096 ) );
+}
+
+TEST_F( BinaryUARTFixture, InvalidParameters )
+{
+  uint8_t data = 0;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, uart->write( nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, uart->write( &data, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, uart->read( &data, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_SUPPORTED, uart->setMode( SubPeripheral::TX, Modes::INTERRUPT ) );
+}
@@ -8,6 +8,8 @@
  *  2019 | Brandon Braun | brandonbraun653@gmail.com
  ********************************************************************************/
 
+#include <cstdlib>
+
 #include "bp_test_fixtures.hpp"
          
 std::string USB_TO_UART_PORT = "COM7";
@@ -16,6 +18,12 @@ std::string BUS_PIRATE_PORT  = "COM6";
 using namespace HWInterface;
 using namespace Chimera::Serial;
 
+std::string spiRig()
+{
+  const char *rig = std::getenv( "BP_SPI_RIG" );
+  return ( rig && *rig ) ? rig : SPI_RIG_LOOPBACK;
+}
+
 void SerialFixture::SetUp()
 {
   serial = new SerialDriver( USB_TO_UART_PORT );
@@ -55,6 +63,145 @@ void BinarySPIFixture::SetUp()
 
 void BinarySPIFixture::TearDown()
 {
-  spi->deInit();
-  delete spi;
-}
\ No newline at end of file
+  if ( spi )
+  {
+    spi->deInit();
+    delete spi;
+  }
+}
+
+void SPILoopbackFixture::SetUp()
+{
+  REQUIRE_SPI_RIG( SPI_RIG_LOOPBACK );
+  BinarySPIFixture::SetUp();
+}
+
+void SPISnifferFixture::SetUp()
+{
+  REQUIRE_SPI_RIG( SPI_RIG_SNIFFER );
+  BinarySPIFixture::SetUp();
+}
+
+void BinaryI2CFixture::SetUp()
+{
+  i2c = new HWInterface::BusPirate::BinaryI2C( busPirate );
+
+  HWInterface::BusPirate::I2CSetup setup;
+  i2c->init( setup );
+}
+
+void BinaryI2CFixture::TearDown()
+{
+  i2c->deInit();
+  delete i2c;
+}
+
+void BinaryUARTFixture::SetUp()
+{
+  uart = new HWInterface::BusPirate::BinaryUART( busPirate );
+  uart->begin();
+}
+
+void BinaryUARTFixture::TearDown()
+{
+  uart->end();
+  delete uart;
+}
+
+void Binary1WireFixture::SetUp()
+{
+  oneWire = new HWInterface::BusPirate::Binary1Wire( busPirate );
+
+  HWInterface::BusPirate::OneWireSetup setup;
+  oneWire->init( setup );
+}
+
+void Binary1WireFixture::TearDown()
+{
+  oneWire->deInit();
+  delete oneWire;
+}
+
+void BinaryRawWireFixture::SetUp()
+{
+  rawWire = new HWInterface::BusPirate::BinaryRawWire( busPirate );
+
+  HWInterface::BusPirate::RawWireSetup setup;
+  rawWire->init( setup );
+}
+
+void BinaryRawWireFixture::TearDown()
+{
+  rawWire->deInit();
+  delete rawWire;
+}
+
+void BinarySWDFixture::SetUp()
+{
+  swd = new HWInterface::BusPirate::BinarySWD( busPirate );
+
+  HWInterface::BusPirate::SWDSetup setup;
+  swd->init( setup );
+}
+
+void BinarySWDFixture::TearDown()
+{
+  swd->deInit();
+  delete swd;
+}
+
+void BinaryJTAGFixture::SetUp()
+{
+  jtag = new HWInterface::BusPirate::BinaryJTAG( busPirate );
+
+  HWInterface::BusPirate::JTAGSetup setup;
+  jtag->init( setup );
+}
+
+void BinaryJTAGFixture::TearDown()
+{
+  jtag->deInit();
+  delete jtag;
+}
+
+void LogicAnalyzerFixture::SetUp()
+{
+  analyzer = new HWInterface::BusPirate::LogicAnalyzer( busPirate );
+  analyzer->init();
+}
+
+void LogicAnalyzerFixture::TearDown()
+{
+  analyzer->deInit();
+  delete analyzer;
+}
+
+void BinaryADCFixture::SetUp()
+{
+  adc = new HWInterface::BusPirate::BinaryADC( busPirate );
+  adc->init();
+}
+
+void BinaryADCFixture::TearDown()
+{
+  adc->deInit();
+  delete adc;
+}
+
+void SPIFlashFixture::SetUp()
+{
+  REQUIRE_SPI_RIG( SPI_RIG_FLASH );
+  flash = new HWInterface::BusPirate::SPIFlash( busPirate );
+
+  HWInterface::BusPirate::SPIFlashSetup setup;
+  flash->init( setup );
+}
+
+void SPIFlashFixture::TearDown()
+{
+  if ( flash )
+  {
+    flash->deInit();
+    delete flash;
+  }
+}
@@ -9,6 +9,15 @@
 #include "serial_driver.hpp"
 #include "bus_pirate.hpp"
 #include "bp_spi.hpp"
+#include "bp_i2c.hpp"
+#include "bp_uart.hpp"
+#include "bp_1wire.hpp"
+#include "bp_rawwire.hpp"
+#include "bp_swd.hpp"
+#include "bp_jtag.hpp"
+#include "bp_sump.hpp"
+#include "bp_adc.hpp"
+#include "bp_spi_flash.hpp"
 
 /*------------------------------------------------
 Defines the port that some generic USB to UART adapter is connected on
@@ -20,6 +29,26 @@ Port that the Bus Pirate is connected on
 ------------------------------------------------*/
 extern std::string BUS_PIRATE_PORT;
 
+/*------------------------------------------------
+What is wired to the Bus Pirate's SPI pins, from the BP_SPI_RIG environment
+variable. The SPI rigs can't share the bus, so tests for the others skip.
+------------------------------------------------*/
+static constexpr const char *SPI_RIG_LOOPBACK = "loopback"; /**< MISO tied to MOSI, the default */
+static constexpr const char *SPI_RIG_SNIFFER  = "sniffer";  /**< A target clocking numbered frames */
+static constexpr const char *SPI_RIG_FLASH    = "flash";    /**< A W25Q64 or another 8MB flash like it */
+
+std::string spiRig();
+
+#if defined( GTEST_SKIP )
+#define REQUIRE_SPI_RIG( rig )                                    \
+  if ( spiRig() != ( rig ) )                                      \
+  {                                                               \
+    GTEST_SKIP() << "Needs BP_SPI_RIG=" << ( rig );               \
+  }
+#else
+#define REQUIRE_SPI_RIG( rig ) ASSERT_EQ( std::string( rig ), spiRig() ) << "Needs BP_SPI_RIG=" << ( rig )
+#endif
+
 
 class SerialFixture : public ::testing::Test
 {
@@ -52,7 +81,127 @@ protected:
   void TearDown() override;
 
   HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
-  HWInterface::BusPirate::BinarySPI *spi;
+  HWInterface::BusPirate::BinarySPI *spi = nullptr;
+};
+
+class SPILoopbackFixture : public BinarySPIFixture
+{
+protected:
+  void SetUp() override;
+};
+
+class SPISnifferFixture : public BinarySPIFixture
+{
+protected:
+  void SetUp() override;
+};
+
+class BinaryI2CFixture : public ::testing::Test
+{
+protected:
+  virtual ~BinaryI2CFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryI2C *i2c;
+};
+
+class BinaryUARTFixture : public ::testing::Test
+{
+protected:
+  virtual ~BinaryUARTFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryUART *uart;
+};
+
+class Binary1WireFixture : public ::testing::Test
+{
+protected:
+  virtual ~Binary1WireFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::Binary1Wire *oneWire;
+};
+
+class BinaryRawWireFixture : public ::testing::Test
+{
+protected:
+  virtual ~BinaryRawWireFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryRawWire *rawWire;
+};
+
+class BinarySWDFixture : public ::testing::Test
+{
+protected:
+  virtual ~BinarySWDFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinarySWD *swd;
+};
+
+class BinaryJTAGFixture : public ::testing::Test
+{
+protected:
+  virtual ~BinaryJTAGFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryJTAG *jtag;
+};
+
+class LogicAnalyzerFixture : public ::testing::Test
+{
+protected:
+  virtual ~LogicAnalyzerFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::LogicAnalyzer *analyzer;
+};
+
+class BinaryADCFixture : public ::testing::Test
+{
+protected:
+  virtual ~BinaryADCFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::BinaryADC *adc;
+};
+
+class SPIFlashFixture : public ::testing::Test
+{
+protected:
+  virtual ~SPIFlashFixture() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  HWInterface::BusPirate::Device busPirate = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::SPIFlash *flash = nullptr;
 };
 
 
@@ -0,0 +1,144 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_info_cache.cpp
+ *
+ *  Description:
+ *    Tests the on-disk device identity cache
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "bus_pirate.hpp"
+#include "info_cache.hpp"
+
+using namespace HWInterface::BusPirate;
+
+class InfoCacheTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    dir  = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    file = ( dir / "devices.cache" ).string();
+
+    info.isValid             = true;
+    info.hwVer               = "v3b";
+    info.firmwareVer         = "v5.10";
+    info.mcuVer              = "24FJ64GA002 B8";
+    info.firmwareVerNum      = 510;
+    info.firmwareVerNumMajor = 5;
+
+    caps.spiWriteThenRead = false;
+  }
+
+  void TearDown() override
+  {
+    boost::filesystem::remove_all( dir );
+  }
+
+  boost::filesystem::path dir;
+  std::string file;
+  Info info;
+  Capabilities caps;
+};
+
+TEST_F( InfoCacheTest, RoundTrip )
+{
+  InfoCache cache( file );
+  Info cachedInfo;
+  Capabilities cachedCaps;
+  uint64_t version = 0;
+
+  EXPECT_EQ( false, cache.lookup( "/dev/ttyUSB0|A1234", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( true, cache.store( "/dev/ttyUSB0|A1234", 42, info, caps ) );
+
+  /*------------------------------------------------
+  A fresh instance, as in a later process, sees the same entry
+  ------------------------------------------------*/
+  EXPECT_EQ( true, InfoCache( file ).lookup( "/dev/ttyUSB0|A1234", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( 42u, version );
+  EXPECT_EQ( true, cachedInfo.isValid );
+  EXPECT_EQ( "v5.10", cachedInfo.firmwareVer );
+  EXPECT_EQ( "24FJ64GA002 B8", cachedInfo.mcuVer );
+  EXPECT_EQ( 510u, cachedInfo.firmwareVerNum );
+  EXPECT_EQ( false, cachedCaps.spiWriteThenRead );
+  EXPECT_EQ( true, cachedCaps.binaryModes );
+}
+
+TEST_F( InfoCacheTest, LoadsTheFileOnce )
+{
+  InfoCache writer( file );
+  InfoCache reader( file );
+  Info cachedInfo;
+  Capabilities cachedCaps;
+  uint64_t version = 0;
+
+  EXPECT_EQ( true, writer.store( "COM6|A1234", 42, info, caps ) );
+  EXPECT_EQ( true, reader.lookup( "COM6|A1234", cachedInfo, cachedCaps, version ) );
+
+  /*------------------------------------------------
+  Lookups after the first come from memory, so they don't notice the file going away
+  ------------------------------------------------*/
+  boost::filesystem::remove( file );
+  EXPECT_EQ( true, reader.lookup( "COM6|A1234", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( false, InfoCache( file ).lookup( "COM6|A1234", cachedInfo, cachedCaps, version ) );
+}
+
+TEST_F( InfoCacheTest, StoreKeepsOtherEntries )
+{
+  InfoCache first( file );
+  InfoCache second( file );
+  Info cachedInfo;
+  Capabilities cachedCaps;
+  uint64_t version = 0;
+
+  /*------------------------------------------------
+  Both load the empty file, then each stores its own board as another process would
+  ------------------------------------------------*/
+  EXPECT_EQ( false, first.lookup( "COM6|A1234", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( false, second.lookup( "COM7|B5678", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( true, first.store( "COM6|A1234", 42, info, caps ) );
+  EXPECT_EQ( true, second.store( "COM7|B5678", 43, info, caps ) );
+
+  InfoCache later( file );
+  EXPECT_EQ( true, later.lookup( "COM6|A1234", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( 42u, version );
+  EXPECT_EQ( true, later.lookup( "COM7|B5678", cachedInfo, cachedCaps, version ) );
+  EXPECT_EQ( 43u, version );
+}
+
+TEST_F( InfoCacheTest, VersionHashUsesTheFirmwareLine )
+{
+  const std::string firmware = "Firmware v5.10 (r559)  Bootloader v4.4\r\n";
+  const std::string identity = "Bus Pirate v3b\r\n" + firmware + "DEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)\r\n";
+
+  /*------------------------------------------------
+  The 'i' command and a reset frame the same lines differently
+  ------------------------------------------------*/
+  const auto query = InfoCache::versionHash( "i\r\n" + identity + "HiZ>" );
+  const auto reset = InfoCache::versionHash( "RESET\r\n\r\n" + identity + "http://dangerousprototypes.com\r\nHiZ>" );
+  const auto newer = InfoCache::versionHash( "Bus Pirate v3b\r\nFirmware v6.1 (r1676)  Bootloader v4.4\r\nHiZ>" );
+
+  EXPECT_NE( 0u, query );
+  EXPECT_EQ( query, reset );
+  EXPECT_NE( query, newer );
+  EXPECT_EQ( 0u, InfoCache::versionHash( "HiZ>" ) );
+}
+
+TEST_F( InfoCacheTest, EmptyPathDisables )
+{
+  InfoCache cache( "" );
+  Info cachedInfo;
+  Capabilities cachedCaps;
+  uint64_t version = 0;
+
+  EXPECT_EQ( false, cache.enabled() );
+  EXPECT_EQ( false, cache.store( "COM6|A1234", 42, info, caps ) );
+  EXPECT_EQ( false, cache.lookup( "COM6|A1234", cachedInfo, cachedCaps, version ) );
+}
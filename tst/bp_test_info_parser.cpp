@@ -0,0 +1,233 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_info_parser.cpp
+ *
+ *  Description:
+ *    Tests the info banner parser against banners recorded from real boards and
+ *    benchmarks it against the strtk/regex parser it replaced.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <regex>
+#include <string>
+
+#include <strtk/strtk.hpp>
+
+#include "bus_pirate.hpp"
+#include "info_parser.hpp"
+
+using namespace HWInterface::BusPirate;
+
+/*------------------------------------------------
+Output of the 'i' command as it arrives, echo already stripped
+------------------------------------------------*/
+static const std::string bannerV3b = "Bus Pirate v3b\r\n"
+                                     "Firmware v5.10 (r559)  Bootloader v4.4\r\n"
+                                     "DEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)\r\n"
+                                     "http://dangerousprototypes.com\r\n"
+                                     "HiZ>";
+
+static const std::string bannerV35 = "Bus Pirate v3.5\r\n"
+                                     "Firmware v6.1 r1676  Bootloader v4.4\r\n"
+                                     "DEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)\r\n"
+                                     "http://dangerousprototypes.com\r\n"
+                                     "HiZ>";
+
+static const std::string bannerV4 =
+    "Bus Pirate v4\r\n"
+    "Community Firmware v7.0 - goo.gl/gCzQnW [HiZ 1-WIRE UART I2C SPI 2WIRE 3WIRE KEYB LCD PIC DIO] Bootloader v4.5\r\n"
+    "DEVID:0x1019 REVID:0x0004 (24FJ256GB106 A5)\r\n"
+    "http://dangerousprototypes.com\r\n"
+    "HiZ>";
+
+/*------------------------------------------------
+The parser as it stood before, kept as the benchmark baseline
+------------------------------------------------*/
+static Info legacyParseInfo( const std::string &rawOutput )
+{
+  static const std::regex numberOnlyRegex = std::regex( R"([\D])" );
+
+  Info info;
+  auto split_opt = strtk::split_options::compress_delimiters;
+
+  std::deque<std::string> tokenList;
+  strtk::multiple_char_delimiter_predicate predicate( "\r\n" );
+  strtk::split( predicate, rawOutput, strtk::range_to_type_back_inserter( tokenList ), split_opt );
+
+  std::deque<std::string> l1Tokens;
+  strtk::split( ' ', tokenList[ 0 ], strtk::range_to_type_back_inserter( l1Tokens ), split_opt );
+  info.hwVer         = l1Tokens[ 2 ];
+  info.hwVerNum      = static_cast<uint32_t>( std::stoi( std::regex_replace( info.hwVer, numberOnlyRegex, "" ) ) );
+  info.hwVerNumMajor = static_cast<uint32_t>( std::stoi( info.hwVer.substr( 1, 1 ) ) );
+
+  std::deque<std::string> l2Tokens;
+  strtk::split( ' ', tokenList[ 1 ], strtk::range_to_type_back_inserter( l2Tokens ), split_opt );
+  info.firmwareVer         = l2Tokens[ 1 ];
+  info.bootLoaderVer       = l2Tokens[ 4 ];
+  info.firmwareVerNum      = static_cast<uint32_t>( std::stoi( std::regex_replace( info.firmwareVer, numberOnlyRegex, "" ) ) );
+  info.firmwareVerNumMajor = static_cast<uint32_t>( std::stoi( info.firmwareVer.substr( 1, 1 ) ) );
+  info.firmwareVerNumMinor = static_cast<uint32_t>( std::stoi( info.firmwareVer.substr( 3, 1 ) ) );
+  info.bootloaderVerNum    = static_cast<uint32_t>( std::stoi( std::regex_replace( info.bootLoaderVer, numberOnlyRegex, "" ) ) );
+  info.bootloaderVerNumMajor = static_cast<uint32_t>( std::stoi( info.bootLoaderVer.substr( 1, 1 ) ) );
+  info.bootloaderVerNumMinor = static_cast<uint32_t>( std::stoi( info.bootLoaderVer.substr( 3, 1 ) ) );
+
+  std::deque<std::string> l3Tokens;
+  strtk::split( ' ', tokenList[ 2 ], strtk::range_to_type_back_inserter( l3Tokens ), split_opt );
+
+  std::deque<std::string> devIDTokens;
+  strtk::split( ':', l3Tokens[ 0 ], strtk::range_to_type_back_inserter( devIDTokens ), split_opt );
+  info.deviceID = devIDTokens[ 1 ];
+
+  std::deque<std::string> revIDTokens;
+  strtk::split( ':', l3Tokens[ 1 ], strtk::range_to_type_back_inserter( revIDTokens ), split_opt );
+  info.revID = revIDTokens[ 1 ];
+
+  std::string mcu = l3Tokens[ 2 ] + ' ' + l3Tokens[ 3 ];
+  mcu.erase( std::remove( mcu.begin(), mcu.end(), '(' ), mcu.end() );
+  mcu.erase( std::remove( mcu.begin(), mcu.end(), ')' ), mcu.end() );
+  info.mcuVer = mcu;
+
+  info.isValid = true;
+  return info;
+}
+
+TEST( InfoParserTest, ParsesV3b )
+{
+  Info info;
+
+  ASSERT_EQ( true, parseInfoBanner( bannerV3b, info ) );
+  EXPECT_EQ( "v3b", info.hwVer );
+  EXPECT_EQ( 3u, info.hwVerNum );
+  EXPECT_EQ( 3u, info.hwVerNumMajor );
+  EXPECT_EQ( "v5.10", info.firmwareVer );
+  EXPECT_EQ( 510u, info.firmwareVerNum );
+  EXPECT_EQ( 5u, info.firmwareVerNumMajor );
+  EXPECT_EQ( 10u, info.firmwareVerNumMinor );
+  EXPECT_EQ( "v4.4", info.bootLoaderVer );
+  EXPECT_EQ( 44u, info.bootloaderVerNum );
+  EXPECT_EQ( 4u, info.bootloaderVerNumMajor );
+  EXPECT_EQ( 4u, info.bootloaderVerNumMinor );
+  EXPECT_EQ( "0x0447", info.deviceID );
+  EXPECT_EQ( "0x3046", info.revID );
+  EXPECT_EQ( "24FJ64GA002 B8", info.mcuVer );
+}
+
+TEST( InfoParserTest, ParsesV35 )
+{
+  Info info;
+
+  ASSERT_EQ( true, parseInfoBanner( bannerV35, info ) );
+  EXPECT_EQ( "v3.5", info.hwVer );
+  EXPECT_EQ( 35u, info.hwVerNum );
+  EXPECT_EQ( 3u, info.hwVerNumMajor );
+  EXPECT_EQ( "v6.1", info.firmwareVer );
+  EXPECT_EQ( 61u, info.firmwareVerNum );
+  EXPECT_EQ( 6u, info.firmwareVerNumMajor );
+  EXPECT_EQ( 1u, info.firmwareVerNumMinor );
+  EXPECT_EQ( "v4.4", info.bootLoaderVer );
+}
+
+TEST( InfoParserTest, ParsesV4CommunityFirmware )
+{
+  Info info;
+
+  ASSERT_EQ( true, parseInfoBanner( bannerV4, info ) );
+  EXPECT_EQ( "v4", info.hwVer );
+  EXPECT_EQ( 4u, info.hwVerNumMajor );
+  EXPECT_EQ( "v7.0", info.firmwareVer );
+  EXPECT_EQ( 7u, info.firmwareVerNumMajor );
+  EXPECT_EQ( "v4.5", info.bootLoaderVer );
+  EXPECT_EQ( 5u, info.bootloaderVerNumMinor );
+  EXPECT_EQ( "0x1019", info.deviceID );
+  EXPECT_EQ( "0x0004", info.revID );
+  EXPECT_EQ( "24FJ256GB106 A5", info.mcuVer );
+}
+
+TEST( InfoParserTest, MatchesLegacyParser )
+{
+  for ( const auto &banner : { bannerV3b, bannerV35 } )
+  {
+    Info info;
+    const Info legacy = legacyParseInfo( banner );
+
+    ASSERT_EQ( true, parseInfoBanner( banner, info ) );
+    EXPECT_EQ( legacy.hwVer, info.hwVer );
+    EXPECT_EQ( legacy.hwVerNum, info.hwVerNum );
+    EXPECT_EQ( legacy.firmwareVer, info.firmwareVer );
+    EXPECT_EQ( legacy.firmwareVerNum, info.firmwareVerNum );
+    EXPECT_EQ( legacy.firmwareVerNumMajor, info.firmwareVerNumMajor );
+    EXPECT_EQ( legacy.bootLoaderVer, info.bootLoaderVer );
+    EXPECT_EQ( legacy.bootloaderVerNum, info.bootloaderVerNum );
+    EXPECT_EQ( legacy.deviceID, info.deviceID );
+    EXPECT_EQ( legacy.revID, info.revID );
+    EXPECT_EQ( legacy.mcuVer, info.mcuVer );
+  }
+}
+
+TEST( InfoParserTest, RejectsMalformedBanners )
+{
+  const std::string malformed[] = {
+    "",
+    "HiZ>",
+    "Bus Pirate v3b\r\n",
+    "Bus Pirate v3b\r\nFirmware v5.10 (r559)  Bootloader v4.4\r\n",
+    "Bus Pirate v3b\r\nFirmware v5.10 (r559)  Bootloader v4.4\r\nDEVID:0x0447 REVID:0x3046\r\n",
+    "Bus Pirate v3b\r\nFirmware (r559)  Bootloader v4.4\r\nDEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)\r\n",
+    "Bus Pirate\r\nFirmware v5.10 (r559)  Bootloader v4.4\r\nDEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)\r\n",
+    "Bus Pirate v3b\r\nFirmware v5.10 (r559)  Bootloader\r\nDEVID:0x0447 REVID:0x3046 (24FJ64GA002 B8)\r\n",
+    "Bus Pirate v3b\r\nFirmware v5.10 (r559)  Bootloader v4.4\r\nDEVID: REVID: ()\r\n",
+    bannerV3b.substr( 0, bannerV3b.size() / 2 ),
+  };
+
+  for ( const auto &banner : malformed )
+  {
+    Info info;
+    EXPECT_EQ( false, parseInfoBanner( banner, info ) ) << banner;
+    EXPECT_EQ( false, info.isValid );
+  }
+}
+
+TEST( InfoParserTest, BenchmarkAgainstLegacy )
+{
+  using namespace std::chrono;
+  static constexpr size_t iterations = 20000;
+
+  for ( const auto &banner : { bannerV3b, bannerV35, bannerV4 } )
+  {
+    Info info;
+    size_t legacyFailures = 0;
+
+    auto start = steady_clock::now();
+    for ( size_t x = 0; x < iterations; x++ )
+    {
+      try
+      {
+        info = legacyParseInfo( banner );
+      }
+      catch ( const std::exception & )
+      {
+        legacyFailures++;
+      }
+    }
+    const auto legacy_nS = duration_cast<nanoseconds>( steady_clock::now() - start ).count() / iterations;
+
+    start = steady_clock::now();
+    for ( size_t x = 0; x < iterations; x++ )
+    {
+      ASSERT_EQ( true, parseInfoBanner( banner, info ) );
+    }
+    const auto current_nS = duration_cast<nanoseconds>( steady_clock::now() - start ).count() / iterations;
+
+    std::cout << banner.substr( 0, banner.find( '\r' ) ) << ": legacy " << legacy_nS << " ns/parse"
+              << ( legacyFailures ? " (threw)" : "" ) << ", single pass " << current_nS << " ns/parse" << std::endl;
+
+    EXPECT_LT( current_nS, legacy_nS );
+  }
+}
@@ -8,6 +8,11 @@
  *  2019 | Brandon Braun | brandonbraun653@gmail.com
  ********************************************************************************/
 
+#include <chrono>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
 #include "bp_test_fixtures.hpp"
 
 
@@ -25,4 +30,201 @@ TEST( BPInit, WillItOpenAndClose )
   bp.close();
   EXPECT_EQ( true, bp.open() );
   bp.close();
-}
\ No newline at end of file
+}
+
+TEST( BPInit, WarmAttachAdoptsSPIMode )
+{
+  using namespace std::chrono;
+
+  {
+    auto bp = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+    ASSERT_EQ( true, bp.open() );
+    ASSERT_EQ( true, bp.bbEnterSPI() );
+    bp.detach();
+  }
+
+  /*------------------------------------------------
+  A later session picks up where the last one left off
+  ------------------------------------------------*/
+  auto bp    = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  auto start = steady_clock::now();
+
+  EXPECT_EQ( true, bp.attach() );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 100 );
+
+  auto rx = bp.sendResponsiveCommand( { 0x01 }, 4 );
+  EXPECT_EQ( "SPI1", std::string( rx.begin(), rx.end() ) );
+  bp.close();
+}
+
+TEST( BPInit, BitBangEntrySkipsTheReset )
+{
+  using namespace std::chrono;
+
+  auto bp = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  ASSERT_EQ( true, bp.open() );
+
+  /*------------------------------------------------
+  From the prompt right after open(), from bit bang root, and from a binary mode,
+  entry costs one exchange and no reset
+  ------------------------------------------------*/
+  for ( auto step : { 0, 1, 2 } )
+  {
+    if ( step == 2 )
+    {
+      ASSERT_EQ( true, bp.bbEnterSPI() );
+    }
+
+    auto start = steady_clock::now();
+    EXPECT_EQ( true, bp.bbInit() );
+    EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 40 );
+  }
+
+  auto rx = bp.sendResponsiveCommand( { HWInterface::BusPirate::BitBangCommands::init }, 5 );
+  EXPECT_EQ( "BBIO1", std::string( rx.begin(), rx.end() ) );
+  bp.close();
+}
+
+TEST( BPInit, WarmAttachFallsBackToReset )
+{
+  auto bp = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+
+  EXPECT_EQ( true, bp.attach() );
+  EXPECT_EQ( true, bp.bbEnterSPI() );
+  bp.close();
+}
+
+TEST( BPInit, AttachGivesUpWaitingOnAStreamingBoard )
+{
+  using namespace std::chrono;
+
+  /*------------------------------------------------
+  Leave the board streaming ADC readings, like a session that never stopped it
+  ------------------------------------------------*/
+  {
+    auto bp = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+    ASSERT_EQ( true, bp.open() );
+    ASSERT_EQ( true, bp.bbInit() );
+    bp.sendCommand( std::vector<uint8_t>{ HWInterface::BusPirate::BitBangCommands::adcStream } );
+    bp.detach();
+  }
+
+  /*------------------------------------------------
+  The probe can't wait for a quiet line forever. It gives up, and the full reset
+  that follows stops the stream.
+  ------------------------------------------------*/
+  auto bp    = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  auto start = steady_clock::now();
+
+  EXPECT_EQ( true, bp.attach() );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 3000 );
+  EXPECT_EQ( true, bp.bbEnterSPI() );
+  bp.close();
+}
+
+TEST( BPInit, DriversShareTheTrackedMode )
+{
+  using namespace std::chrono;
+
+  auto bp = HWInterface::BusPirate::Device( BUS_PIRATE_PORT );
+  ASSERT_EQ( true, bp.open() );
+
+  /*------------------------------------------------
+  The driver works through its own copy of the device, but the mode it enters is
+  the one the caller's device knows about too
+  ------------------------------------------------*/
+  HWInterface::BusPirate::BinarySPI spi( bp );
+  Chimera::SPI::Setup setup;
+
+  spi.setPowerUpDelay( 0 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, spi.init( setup ) );
+  EXPECT_EQ( true, bp.resyncFraming() );
+
+  /*------------------------------------------------
+  So the caller's reset takes the direct way out of SPI mode
+  ------------------------------------------------*/
+  auto start = steady_clock::now();
+  EXPECT_EQ( true, bp.reset() );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 150 );
+  bp.close();
+}
+
+#if defined( __linux__ )
+/*------------------------------------------------
+Gives the board a USB serial number through a fake sysfs tree, so that it gets a
+cache key the way a real FTDI board would
+------------------------------------------------*/
+class SysfsDevice : public HWInterface::BusPirate::Device
+{
+public:
+  SysfsDevice( std::string &port, const std::string &sysfsRoot ) : Device( port )
+  {
+    serial->setSysfsRoot( sysfsRoot );
+  }
+};
+
+TEST( BPInit, CachedInfoSkipsTheQuery )
+{
+  namespace fs = boost::filesystem;
+  using namespace HWInterface::BusPirate;
+
+  const fs::path root = fs::temp_directory_path() / fs::unique_path( "bp-cache-%%%%%%" );
+  const fs::path tty  = root / "class" / "tty" / fs::canonical( BUS_PIRATE_PORT ).filename();
+  const std::string file = ( root / "devices.cache" ).string();
+  const std::string key  = BUS_PIRATE_PORT + "|A1234XYZ";
+
+  ASSERT_EQ( true, fs::create_directories( tty / "device" ) );
+  std::ofstream( ( tty / "serial" ).string() ) << "A1234XYZ" << std::endl;
+
+  Info info;
+  Capabilities caps;
+  uint64_t version = 0;
+
+  /*------------------------------------------------
+  The first connect queries the board and caches what it found
+  ------------------------------------------------*/
+  {
+    SysfsDevice bp( BUS_PIRATE_PORT, root.string() );
+    bp.setInfoCache( file );
+    ASSERT_EQ( true, bp.open() );
+    bp.close();
+  }
+
+  ASSERT_EQ( true, InfoCache( file ).lookup( key, info, caps, version ) );
+  EXPECT_NE( 0u, version );
+
+  /*------------------------------------------------
+  Doctor the entry. A connect that still reports it never asked the board.
+  ------------------------------------------------*/
+  const uint64_t boardVersion = version;
+  info.firmwareVer            = "v9.99";
+  ASSERT_EQ( true, InfoCache( file ).store( key, boardVersion, info, caps ) );
+
+  {
+    SysfsDevice bp( BUS_PIRATE_PORT, root.string() );
+    bp.setInfoCache( file );
+    ASSERT_EQ( true, bp.open() );
+    EXPECT_EQ( "v9.99", bp.getInfo().firmwareVer );
+    bp.close();
+  }
+
+  /*------------------------------------------------
+  An entry whose firmware disagrees with the reset banner is queried and replaced
+  ------------------------------------------------*/
+  ASSERT_EQ( true, InfoCache( file ).store( key, boardVersion + 1, info, caps ) );
+
+  {
+    SysfsDevice bp( BUS_PIRATE_PORT, root.string() );
+    bp.setInfoCache( file );
+    ASSERT_EQ( true, bp.open() );
+    EXPECT_EQ( "v5.10", bp.getInfo().firmwareVer );
+    bp.close();
+  }
+
+  ASSERT_EQ( true, InfoCache( file ).lookup( key, info, caps, version ) );
+  EXPECT_EQ( boardVersion, version );
+  EXPECT_EQ( "v5.10", info.firmwareVer );
+
+  fs::remove_all( root );
+}
+#endif
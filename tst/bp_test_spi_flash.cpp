@@ -0,0 +1,142 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_spi_flash.cpp
+ *
+ *  Description:
+ *    Tests the SPI NOR flash host. Expects an 8MB flash with SFDP tables and 4KB,
+ *    32KB and 64KB erases, like the W25Q64, and only runs with BP_SPI_RIG=flash.
+ *    The second and fourth 64KB of it get overwritten.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <algorithm>
+#include <vector>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+static constexpr uint32_t TEST_REGION    = 0x10000;
+static constexpr uint32_t SCRATCH_REGION = 0x30000;
+
+TEST( SPIFlashTest, initialization )
+{
+  REQUIRE_SPI_RIG( SPI_RIG_FLASH );
+
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::SPIFlash flash( busPirate );
+  SPIFlashSetup setup;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, flash.init( setup ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, flash.deInit() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::NOT_INITIALIZED, flash.discover() );
+}
+
+TEST_F( SPIFlashFixture, DiscoverFromSFDP )
+{
+  std::array<uint8_t, 3> id;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->readJEDECID( id ) );
+
+  const auto &geometry = flash->getGeometry();
+
+  EXPECT_EQ( id, geometry.jedecID );
+  EXPECT_EQ( true, geometry.sfdp );
+  EXPECT_EQ( 8u * 1024u * 1024u, geometry.size );
+  EXPECT_EQ( 256u, geometry.pageSize );
+  EXPECT_LT( 0u, geometry.pageProgram_uS );
+
+  EXPECT_EQ( 4096u, geometry.eraseTypes[ 0 ].size );
+  EXPECT_EQ( 0x20, geometry.eraseTypes[ 0 ].opcode );
+  EXPECT_EQ( 32768u, geometry.eraseTypes[ 1 ].size );
+  EXPECT_EQ( 65536u, geometry.eraseTypes[ 2 ].size );
+  EXPECT_EQ( 0xD8, geometry.eraseTypes[ 2 ].opcode );
+  EXPECT_EQ( 0u, geometry.eraseTypes[ 3 ].size );
+}
+
+TEST_F( SPIFlashFixture, EraseProgramRead )
+{
+  /*------------------------------------------------
+  A 64KB block plus one 4KB sector, programmed from part way into a page so
+  the first and last pages are partial
+  ------------------------------------------------*/
+  static constexpr size_t ERASE_LENGTH = 0x11000;
+  static constexpr uint32_t START      = TEST_REGION + 0x10;
+  static constexpr size_t LENGTH       = 0x10100;
+
+  std::vector<uint8_t> data( LENGTH );
+  std::vector<uint8_t> readBack( ERASE_LENGTH );
+
+  for ( size_t x = 0; x < data.size(); x++ )
+  {
+    data[ x ] = static_cast<uint8_t>( ( x * 31 ) ^ ( x >> 8 ) );
+  }
+
+  flash->resetPhaseStats();
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->erase( TEST_REGION, ERASE_LENGTH ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->read( TEST_REGION, readBack.data(), readBack.size() ) );
+  EXPECT_EQ( true, std::all_of( readBack.begin(), readBack.end(), []( uint8_t b ) { return b == 0xFF; } ) );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->program( START, data.data(), data.size() ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->read( START, readBack.data(), LENGTH ) );
+  EXPECT_EQ( true, std::equal( data.begin(), data.end(), readBack.begin() ) );
+
+  /*------------------------------------------------
+  Reads cost barely more than the data itself on the link, and programs one
+  status poll or so per page on top of the program command
+  ------------------------------------------------*/
+  const auto read    = flash->getPhaseStats( FLASH_PHASE_READ );
+  const auto erase   = flash->getPhaseStats( FLASH_PHASE_ERASE );
+  const auto program = flash->getPhaseStats( FLASH_PHASE_PROGRAM );
+
+  EXPECT_EQ( ERASE_LENGTH + LENGTH, read.bytes );
+  EXPECT_LT( read.linkBytes, read.bytes + read.bytes / 100 );
+  EXPECT_LT( 0u, read.elapsed_uS );
+
+  EXPECT_EQ( ERASE_LENGTH, erase.bytes );
+
+  EXPECT_EQ( LENGTH, program.bytes );
+  EXPECT_LT( program.linkBytes, program.bytes + program.bytes / 5 );
+  EXPECT_LT( program.retries, LENGTH / 256 / 4 );
+  EXPECT_LT( 0u, program.linkTime_uS );
+}
+
+TEST_F( SPIFlashFixture, ProgramWithoutPolls )
+{
+  /*------------------------------------------------
+  With no polls ahead of them, most pages reach the flash while it is still busy
+  with the one before and have to be caught and sent again
+  ------------------------------------------------*/
+  static constexpr uint32_t START = SCRATCH_REGION;
+  static constexpr size_t LENGTH  = 16 * 256;
+
+  std::vector<uint8_t> data( LENGTH );
+  std::vector<uint8_t> readBack( LENGTH );
+
+  for ( size_t x = 0; x < data.size(); x++ )
+  {
+    data[ x ] = static_cast<uint8_t>( ( x * 7 ) + ( x >> 8 ) );
+  }
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->erase( START, LENGTH ) );
+
+  flash->setSpeculativePolls( 0 );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->program( START, data.data(), data.size() ) );
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, flash->read( START, readBack.data(), readBack.size() ) );
+  EXPECT_EQ( true, std::equal( data.begin(), data.end(), readBack.begin() ) );
+}
+
+TEST_F( SPIFlashFixture, InvalidParameters )
+{
+  uint8_t byte   = 0;
+  const auto end = flash->getGeometry().size;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->erase( TEST_REGION + 0x100, 4096 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->erase( TEST_REGION, 100 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->erase( end, 4096 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->read( end - 1, &byte, 2 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->read( 0, nullptr, 1 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->program( 0, &byte, 0 ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, flash->readSFDP( 0, &byte, 4097 ) );
+}
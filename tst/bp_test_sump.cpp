@@ -0,0 +1,175 @@
+/********************************************************************************
+ *  File Name:
+ *    bp_test_sump.cpp
+ *
+ *  Description:
+ *    Tests the SUMP logic analyzer interface. Expects a 4-bit counter driving CS,
+ *    MISO, CLK and MOSI (bit 0 on CS), clocked at the sample rate, with AUX held low.
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "bp_test_fixtures.hpp"
+
+using namespace HWInterface::BusPirate;
+
+static constexpr uint8_t COUNTER_MASK = 0x0F;
+
+static void expectCounting( const uint8_t *const samples, const size_t count )
+{
+  for ( size_t x = 1; x < count; x++ )
+  {
+    ASSERT_EQ( ( samples[ x - 1 ] + 1 ) & COUNTER_MASK, samples[ x ] ) << "at sample " << x;
+  }
+}
+
+TEST_F( BusPirateFixture, EnterSUMP )
+{
+  EXPECT_EQ( true, busPirate->sumpInit() );
+  EXPECT_EQ( true, busPirate->sumpInit() );
+  EXPECT_EQ( true, busPirate->reset() );
+}
+
+TEST( LogicAnalyzerTest, initialization )
+{
+  HWInterface::BusPirate::Device busPirate( BUS_PIRATE_PORT );
+  HWInterface::BusPirate::LogicAnalyzer analyzer( busPirate );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, analyzer.init() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, analyzer.init() );
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, analyzer.deInit() );
+}
+
+TEST( LogicAnalyzerTest, UnpackBitplanes )
+{
+  std::vector<uint8_t> samples( 21 );
+
+  for ( size_t x = 0; x < samples.size(); x++ )
+  {
+    samples[ x ] = static_cast<uint8_t>( x );
+  }
+
+  SUMPBitplanes planes;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, LogicAnalyzer::unpackBitplanes( samples.data(), samples.size(), planes ) );
+
+  /*------------------------------------------------
+  21 samples take three bytes a plane, the last one only partly used
+  ------------------------------------------------*/
+  EXPECT_EQ( std::vector<uint8_t>( { 0xAA, 0xAA, 0x0A } ), planes[ SUMP_CH_CS ] );
+  EXPECT_EQ( std::vector<uint8_t>( { 0xCC, 0xCC, 0x0C } ), planes[ SUMP_CH_MISO ] );
+  EXPECT_EQ( std::vector<uint8_t>( { 0xF0, 0xF0, 0x10 } ), planes[ SUMP_CH_CLK ] );
+  EXPECT_EQ( std::vector<uint8_t>( { 0x00, 0xFF, 0x00 } ), planes[ SUMP_CH_MOSI ] );
+  EXPECT_EQ( std::vector<uint8_t>( { 0x00, 0x00, 0x1F } ), planes[ SUMP_CH_AUX ] );
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, LogicAnalyzer::unpackBitplanes( nullptr, 0, planes ) );
+  EXPECT_EQ( 0u, planes[ SUMP_CH_CS ].size() );
+}
+
+TEST_F( LogicAnalyzerFixture, CaptureIntoBuffer )
+{
+  SUMPConfig config;
+  config.samples = 1024;
+
+  std::vector<uint8_t> samples( config.samples, 0xFF );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, analyzer->capture( config, samples.data(), samples.size() ) );
+  expectCounting( samples.data(), samples.size() );
+
+  /*------------------------------------------------
+  The board drops back to the terminal after each capture, so the next one has to
+  enter SUMP mode again
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, analyzer->capture( config, samples.data(), samples.size() ) );
+  expectCounting( samples.data(), samples.size() );
+
+  SUMPBitplanes planes;
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, LogicAnalyzer::unpackBitplanes( samples.data(), samples.size(), planes ) );
+  EXPECT_EQ( std::vector<uint8_t>( samples.size() / 8, 0 ), planes[ SUMP_CH_AUX ] );
+}
+
+TEST_F( LogicAnalyzerFixture, TriggerStartsCapture )
+{
+  SUMPConfig config;
+  config.samples       = 64;
+  config.triggerMask   = COUNTER_MASK;
+  config.triggerValues = 0x0A;
+
+  std::vector<uint8_t> samples( config.samples );
+
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, analyzer->capture( config, samples.data(), samples.size() ) );
+  EXPECT_EQ( 0x0A, samples[ 0 ] );
+  expectCounting( samples.data(), samples.size() );
+
+  /*------------------------------------------------
+  AUX never goes high, so this one never starts. The analyzer recovers afterwards.
+  ------------------------------------------------*/
+  config.triggerMask   = 1u << SUMP_CH_AUX;
+  config.triggerValues = 1u << SUMP_CH_AUX;
+  config.timeout_mS    = 100;
+
+  EXPECT_EQ( Chimera::CommonStatusCodes::TIMEOUT, analyzer->capture( config, samples.data(), samples.size() ) );
+
+  config.triggerMask   = 0;
+  config.triggerValues = 0;
+  EXPECT_EQ( Chimera::CommonStatusCodes::OK, analyzer->capture( config, samples.data(), samples.size() ) );
+}
+
+TEST_F( LogicAnalyzerFixture, CaptureIntoFile )
+{
+  using namespace std::chrono;
+
+  const auto path = ( boost::filesystem::temp_directory_path() / boost::filesystem::unique_path( "bp-sump-%%%%%%.bin" ) ).string();
+
+  SUMPConfig config;
+  config.samples = LogicAnalyzer::MAX_SAMPLES;
+
+  /*------------------------------------------------
+  A full depth capture takes 4KB on the link, about 360mS at 115200 baud
+  ------------------------------------------------*/
+  const auto start = steady_clock::now();
+  ASSERT_EQ( Chimera::CommonStatusCodes::OK, analyzer->capture( config, path ) );
+  const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start );
+
+  std::ifstream file( path, std::ios::binary );
+  std::vector<uint8_t> samples( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+  file.close();
+  boost::filesystem::remove( path );
+
+  ASSERT_EQ( config.samples, samples.size() );
+  expectCounting( samples.data(), samples.size() );
+  EXPECT_LT( elapsed.count(), 1000 );
+}
+
+TEST_F( LogicAnalyzerFixture, InvalidParameters )
+{
+  std::vector<uint8_t> samples( LogicAnalyzer::MAX_SAMPLES + 4 );
+  SUMPConfig config;
+
+  config.samples = 6;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, samples.data(), samples.size() ) );
+
+  config.samples = LogicAnalyzer::MAX_SAMPLES + 4;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, samples.data(), samples.size() ) );
+
+  config.samples = 64;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, nullptr, samples.size() ) );
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, samples.data(), 32 ) );
+
+  config.sampleRate = LogicAnalyzer::MAX_SAMPLE_RATE + 1;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, samples.data(), samples.size() ) );
+
+  config.sampleRate  = LogicAnalyzer::MAX_SAMPLE_RATE;
+  config.triggerMask = 0x20;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, samples.data(), samples.size() ) );
+
+  config.triggerMask   = 0x01;
+  config.triggerValues = 0x02;
+  EXPECT_EQ( Chimera::CommonStatusCodes::INVAL_FUNC_PARAM, analyzer->capture( config, samples.data(), samples.size() ) );
+}
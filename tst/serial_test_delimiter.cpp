@@ -0,0 +1,124 @@
+/********************************************************************************
+ *  File Name:
+ *    serial_test_delimiter.cpp
+ *
+ *  Description:
+ *    Tests the response delimiter matcher used by SerialDriver::readUntil()
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "delimiter.hpp"
+
+using namespace HWInterface;
+
+static const uint8_t *bytes( const std::string &str )
+{
+  return reinterpret_cast<const uint8_t *>( str.data() );
+}
+
+TEST( DelimiterTests, EmptyNeverMatches )
+{
+  std::string data = "BBIO1\r\nHiZ>";
+  size_t end       = 0;
+
+  EXPECT_EQ( true, Delimiter().empty() );
+  EXPECT_EQ( true, Delimiter( boost::regex{} ).empty() );
+  EXPECT_EQ( false, Delimiter().find( bytes( data ), data.size(), end ) );
+}
+
+TEST( DelimiterTests, LiteralMatchEnd )
+{
+  std::string data = "xxBBIO1yy";
+  size_t end       = 0;
+
+  EXPECT_EQ( true, Delimiter( "BBIO1" ).find( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( 7u, end );
+}
+
+TEST( DelimiterTests, MultiPatternReturnsFirst )
+{
+  Delimiter delimiter( std::vector<std::string>{ "SPI1", "BBIO1", "I2C1" } );
+  std::string data = "00I2C1BBIO1";
+  size_t end       = 0;
+
+  EXPECT_EQ( Delimiter::Type::LITERAL, delimiter.type() );
+  EXPECT_EQ( true, delimiter.find( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( 6u, end );
+}
+
+TEST( DelimiterTests, LiteralSplitAcrossUpdates )
+{
+  Delimiter delimiter( "BBIO1" );
+  Delimiter::Scanner scanner( delimiter );
+  std::string data = "......BBIO1";
+  size_t end       = 0;
+
+  /*------------------------------------------------
+  Feed the buffer a few bytes at a time, splitting the literal
+  ------------------------------------------------*/
+  EXPECT_EQ( false, scanner.scan( bytes( data ), 8, end ) );
+  EXPECT_EQ( 8u, scanner.position() );
+  EXPECT_EQ( false, scanner.scan( bytes( data ), 10, end ) );
+  EXPECT_EQ( true, scanner.scan( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( data.size(), end );
+}
+
+TEST( DelimiterTests, PromptMatchesTerminal )
+{
+  std::string data = "i\r\nBus Pirate v3b\r\nHiZ>trailing";
+  size_t end       = 0;
+
+  EXPECT_EQ( true, Delimiter::prompt().find( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( "i\r\nBus Pirate v3b\r\nHiZ>", data.substr( 0, end ) );
+}
+
+TEST( DelimiterTests, PromptNeedsNewlineFirst )
+{
+  Delimiter delimiter = Delimiter::prompt();
+  Delimiter::Scanner scanner( delimiter );
+  std::string data = "HiZ>#\r\n>SPI>";
+  size_t end       = 0;
+
+  /*------------------------------------------------
+  The '>' before the newline and the one right after it don't count
+  ------------------------------------------------*/
+  EXPECT_EQ( false, scanner.scan( bytes( data ), 8, end ) );
+  EXPECT_EQ( true, scanner.scan( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( data.size(), end );
+}
+
+TEST( DelimiterTests, PromptSplitAfterNewline )
+{
+  Delimiter delimiter = Delimiter::prompt();
+  Delimiter::Scanner scanner( delimiter );
+  std::string data = "HiZ>#\r\n>SPI>";
+  size_t end       = 0;
+
+  /*------------------------------------------------
+  Data ending right on the "\r\n" is scanned to its end and no further, and
+  the '>' straight after it still doesn't count once it arrives
+  ------------------------------------------------*/
+  EXPECT_EQ( false, scanner.scan( bytes( data ), 7, end ) );
+  EXPECT_EQ( 7u, scanner.position() );
+  EXPECT_EQ( false, scanner.scan( bytes( data ), 8, end ) );
+  EXPECT_EQ( 8u, scanner.position() );
+  EXPECT_EQ( true, scanner.scan( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( data.size(), end );
+}
+
+TEST( DelimiterTests, RegexSlowPath )
+{
+  Delimiter delimiter( boost::regex{ "(758ryt)" } );
+  std::string data = "I have no clue when this will 758ryt end";
+  size_t end       = 0;
+
+  EXPECT_EQ( Delimiter::Type::REGEX, delimiter.type() );
+  EXPECT_EQ( true, delimiter.find( bytes( data ), data.size(), end ) );
+  EXPECT_EQ( "I have no clue when this will 758ryt", data.substr( 0, end ) );
+}
@@ -13,6 +13,10 @@
 
 #include "serial_driver.hpp"
 
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
 using namespace HWInterface;
 using namespace Chimera::Serial;
 
@@ -53,4 +57,131 @@ TEST( SerialDriverTests, OpenCloseConfigureRinseRepeat )
   ASSERT_EQ( Chimera::Serial::Status::OK,
              serial.configure( 115200, CharWid::CW_8BIT, Parity::PAR_NONE, StopBits::SBITS_ONE, FlowControl::FCTRL_NONE ) );
   ASSERT_EQ( Chimera::Serial::Status::OK, serial.end() );
-}
\ No newline at end of file
+}
+
+TEST( SerialDriverTests, WireTimeDefaultFrame )
+{
+  SerialDriver serial( USB_TO_UART_PORT );
+
+  /*------------------------------------------------
+  115200 8N1 is 10 bits per byte, so 11520 bytes take exactly one second
+  ------------------------------------------------*/
+  EXPECT_EQ( 0u, serial.wireTime_uS( 0 ) );
+  EXPECT_EQ( 87u, serial.wireTime_uS( 1 ) );
+  EXPECT_EQ( 1000000u, serial.wireTime_uS( 11520 ) );
+}
+
+TEST( SerialDriverTests, WireTimeFollowsFrameFormat )
+{
+  SerialDriver serial( USB_TO_UART_PORT );
+
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.begin() );
+  ASSERT_EQ( Chimera::Serial::Status::OK,
+             serial.configure( 9600, CharWid::CW_8BIT, Parity::PAR_EVEN, StopBits::SBITS_TWO, FlowControl::FCTRL_NONE ) );
+
+  /*------------------------------------------------
+  9600 8E2 is 12 bits per byte, so 800 bytes take exactly one second
+  ------------------------------------------------*/
+  EXPECT_EQ( 1000000u, serial.wireTime_uS( 800 ) );
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.end() );
+}
+
+#if defined( __linux__ )
+/*------------------------------------------------
+Builds <root>/class/tty/<tty>/device/latency_timer for the test port in a fresh
+temporary directory. The test removes it when done.
+------------------------------------------------*/
+static std::string makeFakeSysfs( const uint32_t timer_mS )
+{
+  namespace fs = boost::filesystem;
+
+  boost::system::error_code error;
+  fs::path port = fs::canonical( USB_TO_UART_PORT, error );
+  if ( error )
+  {
+    port = USB_TO_UART_PORT;
+  }
+
+  const fs::path root = fs::temp_directory_path() / fs::unique_path( "bp-sysfs-%%%%%%" );
+  const fs::path dir  = root / "class" / "tty" / port.filename() / "device";
+  EXPECT_EQ( true, fs::create_directories( dir ) );
+
+  std::ofstream( ( dir / "latency_timer" ).string() ) << timer_mS << std::endl;
+  return root.string();
+}
+
+static uint32_t readFakeTimer( const LatencyTimerReport &report )
+{
+  uint32_t value = 0;
+  std::ifstream( report.path ) >> value;
+  return value;
+}
+
+TEST( SerialDriverTests, LatencyTimerLoweredAndRestored )
+{
+  SerialDriver serial( USB_TO_UART_PORT );
+  const std::string root = makeFakeSysfs( 16 );
+  serial.setSysfsRoot( root );
+
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.begin() );
+
+  auto report = serial.getLatencyTimerReport();
+  EXPECT_EQ( true, report.found );
+  EXPECT_EQ( true, report.changed );
+  EXPECT_EQ( 16u, report.original_mS );
+  EXPECT_EQ( 1u, report.current_mS );
+  EXPECT_EQ( 1u, readFakeTimer( report ) );
+
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.end() );
+  EXPECT_EQ( 16u, readFakeTimer( report ) );
+
+  boost::filesystem::remove_all( root );
+}
+
+TEST( SerialDriverTests, LatencyTimerDisabled )
+{
+  SerialDriver serial( USB_TO_UART_PORT );
+  const std::string root = makeFakeSysfs( 16 );
+  serial.setSysfsRoot( root );
+  serial.setLatencyTimer( 0 );
+
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.begin() );
+  EXPECT_EQ( false, serial.getLatencyTimerReport().changed );
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.end() );
+
+  boost::filesystem::remove_all( root );
+}
+
+TEST( SerialDriverTests, LatencyTimerMissingNode )
+{
+  SerialDriver serial( USB_TO_UART_PORT );
+  serial.setSysfsRoot( "/tmp/bp_sysfs_does_not_exist" );
+
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.begin() );
+  EXPECT_EQ( false, serial.getLatencyTimerReport().found );
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.end() );
+}
+
+TEST( SerialDriverTests, USBSerialNumberFromSysfs )
+{
+  SerialDriver serial( USB_TO_UART_PORT );
+  const std::string root = makeFakeSysfs( 16 );
+  serial.setSysfsRoot( root );
+
+  EXPECT_EQ( "", serial.getUSBSerialNumber() );
+
+  /*------------------------------------------------
+  The serial number sits on the USB device above the tty's interface
+  ------------------------------------------------*/
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.begin() );
+  std::string device = serial.getLatencyTimerReport().path;
+  device             = device.substr( 0, device.find_last_of( '/' ) );
+  ASSERT_EQ( Chimera::Serial::Status::OK, serial.end() );
+
+  std::ofstream( device + "/../serial" ) << "A1234XYZ" << std::endl;
+  EXPECT_EQ( "A1234XYZ", serial.getUSBSerialNumber() );
+
+  boost::filesystem::remove_all( root );
+}
+
+#endif
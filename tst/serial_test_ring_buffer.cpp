@@ -0,0 +1,100 @@
+/********************************************************************************
+ *  File Name:
+ *    serial_test_ring_buffer.cpp
+ *
+ *  Description:
+ *    Tests the lock-free ring buffer that backs the serial driver's background RX
+ *
+ *  2019 | Brandon Braun | brandonbraun653@gmail.com
+ ********************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "ring_buffer.hpp"
+
+using namespace HWInterface;
+
+TEST( SPSCRingBufferTests, CapacityRoundsUp )
+{
+  SPSCRingBuffer<uint8_t> ring( 100 );
+
+  EXPECT_EQ( 128u, ring.capacity() );
+  EXPECT_EQ( true, ring.empty() );
+}
+
+TEST( SPSCRingBufferTests, PushPopWraps )
+{
+  SPSCRingBuffer<uint8_t> ring( 8 );
+  std::vector<uint8_t> in( 6 );
+  std::vector<uint8_t> out( 6 );
+
+  /*------------------------------------------------
+  Move the indices so the second write straddles the end of the storage
+  ------------------------------------------------*/
+  std::iota( in.begin(), in.end(), static_cast<uint8_t>( 0 ) );
+  EXPECT_EQ( 6u, ring.push( in.data(), in.size() ) );
+  EXPECT_EQ( 6u, ring.pop( out.data(), out.size() ) );
+  EXPECT_EQ( in, out );
+
+  std::iota( in.begin(), in.end(), static_cast<uint8_t>( 10 ) );
+  EXPECT_EQ( 6u, ring.push( in.data(), in.size() ) );
+  EXPECT_EQ( 6u, ring.size() );
+  EXPECT_EQ( 6u, ring.pop( out.data(), out.size() ) );
+  EXPECT_EQ( in, out );
+}
+
+TEST( SPSCRingBufferTests, PushStopsWhenFull )
+{
+  SPSCRingBuffer<uint8_t> ring( 4 );
+  std::vector<uint8_t> in = { 1, 2, 3, 4, 5, 6 };
+
+  EXPECT_EQ( 4u, ring.push( in.data(), in.size() ) );
+  EXPECT_EQ( 0u, ring.push( in.data(), in.size() ) );
+
+  ring.clear();
+  EXPECT_EQ( true, ring.empty() );
+}
+
+TEST( SPSCRingBufferTests, ProducerConsumerThreads )
+{
+  static constexpr size_t total = 100000;
+  SPSCRingBuffer<uint32_t> ring( 256 );
+
+  std::thread producer( [ &ring ]() {
+    uint32_t next = 0;
+    while ( next < total )
+    {
+      if ( !ring.push( &next, 1 ) )
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      next++;
+    }
+  } );
+
+  uint32_t expected = 0;
+  bool inOrder      = true;
+
+  while ( expected < total )
+  {
+    uint32_t value;
+    if ( ring.pop( &value, 1 ) )
+    {
+      inOrder &= ( value == expected );
+      expected++;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  EXPECT_EQ( true, inOrder );
+}
@@ -19,6 +19,8 @@
 #include <functional>
 
 #include <boost/regex.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
 
 
 using namespace Chimera::Serial;
@@ -77,6 +79,18 @@ TEST_F( SerialFixture, UnknownLength )
   ASSERT_GT( output.find( nonExistantString ), 35 );
 }
 
+TEST_F( SerialFixture, UnknownLengthLiteral )
+{
+  std::string writeData = "I have no clue when this will 758ryt end";
+  std::vector<uint8_t> readData;
+
+  serial->write( reinterpret_cast<const uint8_t *>( writeData.c_str() ), writeData.length() );
+  EXPECT_EQ( Status::OK, serial->readUntil( readData, HWInterface::Delimiter( "758ryt" ) ) );
+
+  std::string output = std::string( readData.begin(), readData.end() );
+  EXPECT_NE( std::string::npos, output.find( "758ryt" ) );
+}
+
 TEST_F( SerialFixture, RegexReadTimeout )
 {
   std::vector<uint8_t> readData;
@@ -124,6 +138,22 @@ TEST_F( SerialFixture, FailedReadThenAttemptToWrite )
   EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
 }
 
+TEST_F( SerialFixture, RawModePassesControlBytes )
+{
+  /*------------------------------------------------
+  Bytes a cooked terminal would translate or act on
+  ------------------------------------------------*/
+  static constexpr size_t len = 8;
+
+  std::array<uint8_t, len> writeData = { 0x0D, 0x0A, 0x03, 0x11, 0x13, 0x1A, 0x7F, 0x00 };
+  std::array<uint8_t, len> readData;
+  readData.fill( 0xFF );
+
+  EXPECT_EQ( Status::OK, serial->write( writeData.data(), len ) );
+  EXPECT_EQ( Status::OK, serial->read( readData.data(), len ) );
+  EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
+}
+
 TEST_F( SerialFixture, FlushTheToilet )
 {
   static constexpr size_t len = 4;
@@ -155,4 +185,185 @@ TEST_F( SerialFixture, ResetAllTheThings )
   EXPECT_EQ( Status::OK, serial->write( writeData.data(), len ) );
   EXPECT_EQ( Status::OK, serial->read( readData.data(), len ) );
   EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
-}
\ No newline at end of file
+}
+
+TEST_F( SerialFixture, CalibratePacing )
+{
+  static constexpr size_t len = 4;
+
+  std::array<uint8_t, len> writeData = { 0x55, 0x33, 0x23, 0x99 };
+  std::array<uint8_t, len> readData  = { 0x00, 0x00, 0x00, 0x00 };
+
+  EXPECT_EQ( Status::OK, serial->calibrate() );
+
+  /*------------------------------------------------
+  The measured byte time can't beat the theoretical wire time by much
+  ------------------------------------------------*/
+  EXPECT_GT( serial->wireTime_uS( 11520 ), 900000u );
+
+  EXPECT_EQ( Status::OK, serial->write( writeData.data(), len ) );
+  EXPECT_EQ( Status::OK, serial->read( readData.data(), len ) );
+  EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
+}
+
+TEST_F( SerialFixture, BackToBackWritesWithoutFixedDelay )
+{
+  using namespace boost::chrono;
+  static constexpr size_t len = 4;
+  static constexpr size_t cycles = 100;
+
+  std::array<uint8_t, len> writeData = { 0x55, 0x33, 0x23, 0x99 };
+  std::array<uint8_t, len> readData;
+
+  /*------------------------------------------------
+  The old fixed 25mS sleep capped this at 40 cycles per second
+  ------------------------------------------------*/
+  auto start = steady_clock::now();
+  for ( size_t x = 0; x < cycles; x++ )
+  {
+    readData.fill( 0 );
+    ASSERT_EQ( Status::OK, serial->write( writeData.data(), len ) );
+    ASSERT_EQ( Status::OK, serial->read( readData.data(), len ) );
+    ASSERT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
+  }
+
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), static_cast<long long>( cycles * 25 ) );
+}
+
+TEST_F( SerialFixture, BackgroundRxWriteRead )
+{
+  static constexpr size_t len = 4;
+
+  std::array<uint8_t, len> writeData = { 0x55, 0x33, 0x23, 0x99 };
+  std::array<uint8_t, len> readData  = { 0x00, 0x00, 0x00, 0x00 };
+
+  ASSERT_EQ( Status::OK, serial->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+  EXPECT_EQ( true, serial->isBackgroundRxActive() );
+
+  EXPECT_EQ( Status::OK, serial->write( writeData.data(), len ) );
+  EXPECT_EQ( Status::OK, serial->read( readData.data(), len ) );
+  EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
+
+  /*------------------------------------------------
+  Nothing left to read, so this should time out empty
+  ------------------------------------------------*/
+  EXPECT_EQ( Status::EMPTY, serial->read( readData.data(), len, 50 ) );
+
+  ASSERT_EQ( Status::OK, serial->setMode( SubPeripheral::RX, Modes::BLOCKING ) );
+  EXPECT_EQ( false, serial->isBackgroundRxActive() );
+}
+
+TEST_F( SerialFixture, BackgroundRxReadUntilKeepsRemainder )
+{
+  std::string writeData = "I have no clue when this will 758ryt end";
+  std::vector<uint8_t> readData;
+  boost::regex regex{ "(758ryt)" };
+
+  ASSERT_EQ( Status::OK, serial->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+
+  serial->write( reinterpret_cast<const uint8_t *>( writeData.c_str() ), writeData.length() );
+  EXPECT_EQ( Status::OK, serial->readUntil( readData, regex ) );
+  EXPECT_EQ( "I have no clue when this will 758ryt", std::string( readData.begin(), readData.end() ) );
+
+  /*------------------------------------------------
+  Data received past the match stays buffered for the next read
+  ------------------------------------------------*/
+  std::array<uint8_t, 4> tail;
+  EXPECT_EQ( Status::OK, serial->read( tail.data(), tail.size() ) );
+  EXPECT_EQ( " end", std::string( tail.begin(), tail.end() ) );
+}
+
+TEST_F( SerialFixture, BackgroundRxReadSome )
+{
+  std::array<uint8_t, 4> writeData = { 0x55, 0x33, 0x23, 0x99 };
+  std::array<uint8_t, 64> readData;
+  size_t received = 0;
+
+  EXPECT_EQ( Status::NOT_READY, serial->readSome( readData.data(), readData.size(), received, 10 ) );
+
+  ASSERT_EQ( Status::OK, serial->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+
+  /*------------------------------------------------
+  Asking for more than was sent hands back what arrived instead of timing out
+  ------------------------------------------------*/
+  EXPECT_EQ( Status::OK, serial->write( writeData.data(), writeData.size() ) );
+
+  size_t total = 0;
+  while ( ( total < writeData.size() ) &&
+          ( serial->readSome( readData.data() + total, readData.size() - total, received, 100 ) == Status::OK ) )
+  {
+    total += received;
+  }
+
+  EXPECT_EQ( writeData.size(), total );
+  EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), writeData.size() ) );
+
+  EXPECT_EQ( Status::EMPTY, serial->readSome( readData.data(), readData.size(), received, 20 ) );
+  EXPECT_EQ( 0u, received );
+}
+
+TEST_F( SerialFixture, BackgroundRxBuffersBetweenCalls )
+{
+  using namespace boost::chrono;
+  static constexpr size_t len = 4;
+
+  std::array<uint8_t, len> writeData = { 0x55, 0x33, 0x23, 0x99 };
+  std::array<uint8_t, len> readData  = { 0x00, 0x00, 0x00, 0x00 };
+
+  ASSERT_EQ( Status::OK, serial->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+
+  /*------------------------------------------------
+  Let the loopback data land before asking for it. The read should then
+  complete straight from the ring without waiting on the port.
+  ------------------------------------------------*/
+  EXPECT_EQ( Status::OK, serial->write( writeData.data(), len ) );
+  boost::this_thread::sleep_for( milliseconds( 50 ) );
+
+  auto start = steady_clock::now();
+  EXPECT_EQ( Status::OK, serial->read( readData.data(), len ) );
+  EXPECT_LT( duration_cast<milliseconds>( steady_clock::now() - start ).count(), 5 );
+  EXPECT_EQ( 0, memcmp( writeData.data(), readData.data(), len ) );
+}
+
+TEST_F( SerialFixture, BackgroundRxOverflowDropsWholeRecords )
+{
+  using namespace boost::chrono;
+  static constexpr size_t record  = 3;
+  static constexpr size_t records = 30;
+
+  std::vector<uint8_t> writeData;
+  std::array<uint8_t, 15> readData;
+  size_t received = 0;
+
+  for ( size_t x = 0; x < records; x++ )
+  {
+    const uint8_t id = static_cast<uint8_t>( x );
+    writeData.insert( writeData.end(), { id, static_cast<uint8_t>( id ^ 0xAA ), static_cast<uint8_t>( id ^ 0x55 ) } );
+  }
+
+  /*------------------------------------------------
+  A 16 byte ring holds five records. Writing in odd sized pieces splits records
+  across reads, and whatever is dropped must still leave every stored record whole.
+  ------------------------------------------------*/
+  serial->setRxBufferSize( 16 );
+  serial->setRxRecordSize( record );
+  ASSERT_EQ( Status::OK, serial->setMode( SubPeripheral::RX, Modes::INTERRUPT ) );
+
+  for ( size_t offset = 0; offset < writeData.size(); offset += 7 )
+  {
+    EXPECT_EQ( Status::OK, serial->write( writeData.data() + offset, std::min<size_t>( 7, writeData.size() - offset ) ) );
+    boost::this_thread::sleep_for( milliseconds( 5 ) );
+  }
+
+  boost::this_thread::sleep_for( milliseconds( 50 ) );
+
+  EXPECT_EQ( Status::OK, serial->read( readData.data(), readData.size() ) );
+  EXPECT_EQ( Status::EMPTY, serial->readSome( readData.data(), readData.size(), received, 20 ) );
+  EXPECT_EQ( writeData.size() - readData.size(), serial->getRxOverflowCount() );
+
+  for ( size_t x = 0; x < readData.size(); x += record )
+  {
+    EXPECT_EQ( readData[ x ] ^ 0xAA, readData[ x + 1 ] );
+    EXPECT_EQ( readData[ x ] ^ 0x55, readData[ x + 2 ] );
+  }
+}